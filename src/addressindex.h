@@ -8,6 +8,7 @@
 
 #include "uint256.h"
 #include "amount.h"
+#include "hash.h"
 #include "script/script.h"
 
 static const std::string RVN = "RVN";
@@ -66,6 +67,10 @@ struct CAddressUnspentKey {
         txhash.SetNull();
         index = 0;
     }
+
+    bool IsNull() const {
+        return (type == 0);
+    }
 };
 
 struct CAddressUnspentValue {
@@ -181,6 +186,9 @@ struct CAddressIndexKey {
         spending = false;
     }
 
+    bool IsNull() const {
+        return (type == 0);
+    }
 };
 
 struct CAddressIndexIteratorKey {
@@ -310,6 +318,42 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Running totals of one address and asset, keyed by CAddressIndexIteratorAssetKey */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t txCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+    }
+
+    CAddressBalanceValue(CAmount sats, CAmount receivedSats, int64_t count) {
+        balance = sats;
+        received = receivedSats;
+        txCount = count;
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+    }
+
+    bool IsNull() const {
+        return (txCount == 0);
+    }
+};
+
 struct CMempoolAddressDelta
 {
     int64_t time;
@@ -337,24 +381,17 @@ struct CMempoolAddressDeltaKey
     int type;
     uint160 addressBytes;
     std::string asset;
+    int64_t time;
     uint256 txhash;
     unsigned int index;
     int spending;
 
-    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, std::string assetName,
+    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, std::string assetName, int64_t t,
                             uint256 hash, unsigned int i, int s) {
         type = addressType;
         addressBytes = addressHash;
         asset = assetName;
-        txhash = hash;
-        index = i;
-        spending = s;
-    }
-
-    CMempoolAddressDeltaKey(int addressType, uint160 addressHash, uint256 hash, unsigned int i, int s) {
-        type = addressType;
-        addressBytes = addressHash;
-        asset = "";
+        time = t;
         txhash = hash;
         index = i;
         spending = s;
@@ -364,6 +401,7 @@ struct CMempoolAddressDeltaKey
         type = addressType;
         addressBytes = addressHash;
         asset = assetName;
+        time = 0;
         txhash.SetNull();
         index = 0;
         spending = 0;
@@ -373,26 +411,32 @@ struct CMempoolAddressDeltaKey
         type = addressType;
         addressBytes = addressHash;
         asset = "";
+        time = 0;
         txhash.SetNull();
         index = 0;
         spending = 0;
     }
 };
 
+/** Orders the mempool deltas by address and asset, and by the time their transaction was added within those */
 struct CMempoolAddressDeltaKeyCompare
 {
     bool operator()(const CMempoolAddressDeltaKey& a, const CMempoolAddressDeltaKey& b) const {
         if (a.type == b.type) {
             if (a.addressBytes == b.addressBytes) {
                 if (a.asset == b.asset) {
-                    if (a.txhash == b.txhash) {
-                        if (a.index == b.index) {
-                            return a.spending < b.spending;
+                    if (a.time == b.time) {
+                        if (a.txhash == b.txhash) {
+                            if (a.index == b.index) {
+                                return a.spending < b.spending;
+                            } else {
+                                return a.index < b.index;
+                            }
                         } else {
-                            return a.index < b.index;
+                            return a.txhash < b.txhash;
                         }
                     } else {
-                        return a.txhash < b.txhash;
+                        return a.time < b.time;
                     }
                 } else {
                     return a.asset < b.asset;
@@ -406,4 +450,21 @@ struct CMempoolAddressDeltaKeyCompare
     }
 };
 
+/** Address type (1 = pubkey hash, 2 = script hash) and hash a plain output script is indexed under, or 0 if it has
+ *  none. Shared by the address index and the mempool address index, so both file outputs under the same keys */
+inline int GetScriptAddress(const CScript& script, uint160& hashBytes)
+{
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+    return 0;
+}
+
 #endif // RAVEN_ADDRESSINDEX_H
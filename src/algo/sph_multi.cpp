@@ -0,0 +1,325 @@
+// Copyright (c) 2017-2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "algo/sph_multi.h"
+
+#include "algo/sph_keccak.h"
+#include "algo/sph_sha2.h"
+#include "crypto/common.h"
+
+#include <string.h>
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#define SPH_MULTI_X86 1
+#include <cpuid.h>
+#endif
+
+namespace
+{
+typedef void (*MultiFn)(const unsigned char* const* in, size_t len, unsigned char* const* out);
+
+void Keccak512Scalar(const unsigned char* in, size_t len, unsigned char* out)
+{
+    sph_keccak512_context ctx;
+    sph_keccak512_init(&ctx);
+    sph_keccak512(&ctx, in, len);
+    sph_keccak512_close(&ctx, out);
+}
+
+void SHA512Scalar(const unsigned char* in, size_t len, unsigned char* out)
+{
+    sph_sha512_context ctx;
+    sph_sha512_init(&ctx);
+    sph_sha512(&ctx, in, len);
+    sph_sha512_close(&ctx, out);
+}
+
+#if defined(SPH_MULTI_X86)
+
+#define SPH_MULTI_INLINE inline __attribute__((always_inline))
+#define SPH_MULTI_ROTL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define SPH_MULTI_ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+/*
+ * The kernels are written once against GCC vector extensions and inlined into
+ * per-ISA entry points, so the same code is compiled for 4 lanes with AVX2 and
+ * 8 lanes with AVX-512F. Lane l of every vector belongs to input l.
+ */
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint64_t u64x8 __attribute__((vector_size(64)));
+
+namespace keccak
+{
+const uint64_t RC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+    0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+const int ROTC[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+const int PILN[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+
+/** Keccak-512 as used by sph: 72 byte rate, 0x01 ... 0x80 padding. */
+const size_t RATE = 72;
+
+template<typename V>
+SPH_MULTI_INLINE void Permute(V st[25])
+{
+    V bc[5], t;
+    for (int round = 0; round < 24; round++) {
+        // Fully unrolled so the state stays in registers and rotations take immediates
+#pragma GCC unroll 5
+        for (int i = 0; i < 5; i++)
+            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+#pragma GCC unroll 5
+        for (int i = 0; i < 5; i++) {
+            t = bc[(i + 4) % 5] ^ SPH_MULTI_ROTL(bc[(i + 1) % 5], 1);
+#pragma GCC unroll 5
+            for (int j = 0; j < 25; j += 5)
+                st[j + i] ^= t;
+        }
+
+        t = st[1];
+#pragma GCC unroll 24
+        for (int i = 0; i < 24; i++) {
+            int j = PILN[i];
+            bc[0] = st[j];
+            st[j] = SPH_MULTI_ROTL(t, ROTC[i]);
+            t = bc[0];
+        }
+
+#pragma GCC unroll 5
+        for (int j = 0; j < 25; j += 5) {
+#pragma GCC unroll 5
+            for (int i = 0; i < 5; i++)
+                bc[i] = st[j + i];
+#pragma GCC unroll 5
+            for (int i = 0; i < 5; i++)
+                st[j + i] ^= ~bc[(i + 1) % 5] & bc[(i + 2) % 5];
+        }
+
+        st[0] ^= RC[round];
+    }
+}
+
+template<typename V, int N>
+SPH_MULTI_INLINE void Absorb(V st[25], const unsigned char* const* block, size_t offset)
+{
+    for (size_t w = 0; w < RATE / 8; w++) {
+        V m;
+        for (int l = 0; l < N; l++)
+            m[l] = ReadLE64(block[l] + offset + 8 * w);
+        st[w] ^= m;
+    }
+    Permute(st);
+}
+
+template<typename V, int N>
+SPH_MULTI_INLINE void Hash(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    V st[25] = {};
+
+    size_t pos = 0;
+    for (; pos + RATE <= len; pos += RATE)
+        Absorb<V, N>(st, in, pos);
+
+    unsigned char tail[N][RATE];
+    const unsigned char* ptail[N];
+    for (int l = 0; l < N; l++) {
+        memset(tail[l], 0, RATE);
+        memcpy(tail[l], in[l] + pos, len - pos);
+        tail[l][len - pos] ^= 0x01;
+        tail[l][RATE - 1] ^= 0x80;
+        ptail[l] = tail[l];
+    }
+    Absorb<V, N>(st, ptail, 0);
+
+    for (int l = 0; l < N; l++)
+        for (int w = 0; w < 8; w++)
+            WriteLE64(out[l] + 8 * w, st[w][l]);
+}
+} // namespace keccak
+
+namespace sha512
+{
+const uint64_t K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+const size_t BLOCK = 128;
+
+template<typename V, int N>
+SPH_MULTI_INLINE void Transform(V s[8], const unsigned char* const* block, size_t offset)
+{
+    V w[16];
+    for (int t = 0; t < 16; t++)
+        for (int l = 0; l < N; l++)
+            w[t][l] = ReadBE64(block[l] + offset + 8 * t);
+
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            V w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+            w[t & 15] += (SPH_MULTI_ROTR(w15, 1) ^ SPH_MULTI_ROTR(w15, 8) ^ (w15 >> 7)) + w[(t - 7) & 15] +
+                         (SPH_MULTI_ROTR(w2, 19) ^ SPH_MULTI_ROTR(w2, 61) ^ (w2 >> 6));
+        }
+        V t1 = h + (SPH_MULTI_ROTR(e, 14) ^ SPH_MULTI_ROTR(e, 18) ^ SPH_MULTI_ROTR(e, 41)) + (g ^ (e & (f ^ g))) + K[t] + w[t & 15];
+        V t2 = (SPH_MULTI_ROTR(a, 28) ^ SPH_MULTI_ROTR(a, 34) ^ SPH_MULTI_ROTR(a, 39)) + ((a & b) | (c & (a | b)));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+    s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+template<typename V, int N>
+SPH_MULTI_INLINE void Hash(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    V s[8];
+    for (int i = 0; i < 8; i++)
+        s[i] = V{} + IV[i];
+
+    size_t pos = 0;
+    for (; pos + BLOCK <= len; pos += BLOCK)
+        Transform<V, N>(s, in, pos);
+
+    // One or two final blocks carrying the 0x80 marker and the 128-bit bit length
+    size_t rem = len - pos;
+    size_t tailLen = rem + 17 <= BLOCK ? BLOCK : 2 * BLOCK;
+    unsigned char tail[N][2 * BLOCK];
+    const unsigned char* ptail[N];
+    for (int l = 0; l < N; l++) {
+        memset(tail[l], 0, tailLen);
+        memcpy(tail[l], in[l] + pos, rem);
+        tail[l][rem] = 0x80;
+        WriteBE64(tail[l] + tailLen - 16, (uint64_t)len >> 61);
+        WriteBE64(tail[l] + tailLen - 8, (uint64_t)len << 3);
+        ptail[l] = tail[l];
+    }
+    for (size_t off = 0; off < tailLen; off += BLOCK)
+        Transform<V, N>(s, ptail, off);
+
+    for (int l = 0; l < N; l++)
+        for (int i = 0; i < 8; i++)
+            WriteBE64(out[l] + 8 * i, s[i][l]);
+}
+} // namespace sha512
+
+__attribute__((target("avx2")))
+void Keccak512AVX2(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    keccak::Hash<u64x4, 4>(in, len, out);
+}
+
+__attribute__((target("avx2")))
+void SHA512AVX2(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    sha512::Hash<u64x4, 4>(in, len, out);
+}
+
+__attribute__((target("avx512f")))
+void Keccak512AVX512(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    keccak::Hash<u64x8, 8>(in, len, out);
+}
+
+__attribute__((target("avx512f")))
+void SHA512AVX512(const unsigned char* const* in, size_t len, unsigned char* const* out)
+{
+    sha512::Hash<u64x8, 8>(in, len, out);
+}
+
+uint64_t ReadXCR0()
+{
+    uint32_t a, d;
+    __asm__ ("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return ((uint64_t)d << 32) | a;
+}
+#endif // SPH_MULTI_X86
+
+MultiFn Keccak512Multi = nullptr;
+MultiFn SHA512Multi = nullptr;
+size_t nLanes = 1;
+
+void HashMulti(MultiFn multi, void (*scalar)(const unsigned char*, size_t, unsigned char*),
+               const unsigned char* const* in, size_t len, unsigned char* const* out, size_t count)
+{
+    size_t i = 0;
+    if (multi) {
+        for (; i + nLanes <= count; i += nLanes)
+            multi(in + i, len, out + i);
+    }
+    for (; i < count; i++)
+        scalar(in[i], len, out[i]);
+}
+} // namespace
+
+void sph_keccak512_multi(const unsigned char* const* in, size_t len, unsigned char* const* out, size_t count)
+{
+    HashMulti(Keccak512Multi, Keccak512Scalar, in, len, out, count);
+}
+
+void sph_sha512_multi(const unsigned char* const* in, size_t len, unsigned char* const* out, size_t count)
+{
+    HashMulti(SHA512Multi, SHA512Scalar, in, len, out, count);
+}
+
+size_t SphMultiLanes()
+{
+    return nLanes;
+}
+
+std::string SphMultiAutoDetect()
+{
+    Keccak512Multi = nullptr;
+    SHA512Multi = nullptr;
+    nLanes = 1;
+#if defined(SPH_MULTI_X86)
+    uint32_t eax, ebx, ecx, edx;
+    // AVX needs both the CPU flag and OS support for saving the YMM/ZMM state
+    if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        !((ecx >> 27) & 1) || !((ecx >> 28) & 1)) {
+        return "scalar";
+    }
+    uint64_t xcr0 = ReadXCR0();
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if ((xcr0 & 0xe6) == 0xe6 && ((ebx >> 16) & 1)) {
+        Keccak512Multi = Keccak512AVX512;
+        SHA512Multi = SHA512AVX512;
+        nLanes = 8;
+        return "avx512f(8-way)";
+    }
+    if ((xcr0 & 0x6) == 0x6 && ((ebx >> 5) & 1)) {
+        Keccak512Multi = Keccak512AVX2;
+        SHA512Multi = SHA512AVX2;
+        nLanes = 4;
+        return "avx2(4-way)";
+    }
+#endif
+    return "scalar";
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_ALGO_SPH_MULTI_H
+#define RAVEN_ALGO_SPH_MULTI_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/**
+ * Multi-buffer versions of the X16R primitives built on 64-bit words.
+ *
+ * Each call hashes count independent inputs of the same length and writes a
+ * 64 byte digest for each of them. The output is identical to running the
+ * matching sph_* function on every input in turn; inputs are spread over the
+ * SIMD lanes picked by SphMultiAutoDetect() and any remainder is hashed with
+ * the scalar code.
+ */
+void sph_keccak512_multi(const unsigned char* const* in, size_t len, unsigned char* const* out, size_t count);
+void sph_sha512_multi(const unsigned char* const* in, size_t len, unsigned char* const* out, size_t count);
+
+/** Number of inputs the selected implementation hashes at once (1 when scalar). */
+size_t SphMultiLanes();
+
+/** Autodetect the best available multi-buffer implementation.
+ *  Returns the name of the implementation.
+ */
+std::string SphMultiAutoDetect();
+
+#endif // RAVEN_ALGO_SPH_MULTI_H
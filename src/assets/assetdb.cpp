@@ -2,14 +2,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <util.h>
 #include <consensus/params.h>
 #include <script/ismine.h>
 #include <tinyformat.h>
 #include "assetdb.h"
 #include "assets.h"
+#include "utxosnapshot.h"
 #include "validation.h"
 
+#include <algorithm>
+
 #include <boost/thread.hpp>
 
 static const char ASSET_FLAG = 'A';
@@ -18,8 +22,18 @@ static const char ADDRESS_ASSET_QUANTITY_FLAG = 'C';
 static const char MY_ASSET_FLAG = 'M';
 static const char BLOCK_ASSET_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
+static const char ASSET_HOLDER_STATS_FLAG = 'H';
+static const char ASSET_HOLDER_STATS_BUILT = 'h';
+static const char OWNERSHIP_JOURNAL_FLAG = 'J';
+static const char OWNERSHIP_JOURNAL_HEIGHT_FLAG = 'j';
+
+// The tables a UTXO snapshot carries, the holder tables only exist with -assetindex
+static const char SNAPSHOT_TABLES[] = {ASSET_FLAG};
+// The holder stats aren't in a snapshot, their heights depend on when the node flushed. They are rebuilt on load
+static const char SNAPSHOT_HOLDER_TABLES[] = {ASSET_ADDRESS_QUANTITY_FLAG, ADDRESS_ASSET_QUANTITY_FLAG};
 
 static size_t MAX_DATABASE_RESULTS = 50000;
+static const size_t MAX_HOLDER_STATS_BATCH_SIZE = 16 << 20;
 
 CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {
 }
@@ -32,10 +46,21 @@ bool CAssetsDB::WriteAssetData(const CNewAsset &asset, const int nHeight, const
 
 bool CAssetsDB::WriteAssetAddressQuantity(const std::string &assetName, const std::string &address, const CAmount &quantity)
 {
-    return Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+    bool fCommit = !pquantityBatch;
+    if (fCommit)
+        BeginAddressQuantities(nHolderStatsHeight);
+
+    StageAssetAddressQuantity(assetName, address, quantity);
+    pquantityBatch->batch.Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+
+    return !fCommit || CommitAddressQuantities();
 }
 
 bool CAssetsDB::WriteAddressAssetQuantity(const std::string &address, const std::string &assetName, const CAmount& quantity) {
+    if (pquantityBatch) {
+        pquantityBatch->batch.Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
+        return true;
+    }
     return Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
 }
 
@@ -74,10 +99,21 @@ bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
 }
 
 bool CAssetsDB::EraseAssetAddressQuantity(const std::string &assetName, const std::string &address) {
-    return Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+    bool fCommit = !pquantityBatch;
+    if (fCommit)
+        BeginAddressQuantities(nHolderStatsHeight);
+
+    StageAssetAddressQuantity(assetName, address, 0);
+    pquantityBatch->batch.Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+
+    return !fCommit || CommitAddressQuantities();
 }
 
 bool CAssetsDB::EraseAddressAssetQuantity(const std::string &address, const std::string &assetName) {
+    if (pquantityBatch) {
+        pquantityBatch->batch.Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
+        return true;
+    }
     return Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
 }
 
@@ -116,6 +152,243 @@ bool CAssetsDB::ReadReissuedMempoolState()
     return rv;
 }
 
+bool CAssetsDB::ReadAssetHolderStats(const std::string& assetName, CAssetHolderStats& stats)
+{
+    stats.SetNull();
+    if (!Exists(std::make_pair(ASSET_HOLDER_STATS_FLAG, assetName)))
+        return true;
+
+    return Read(std::make_pair(ASSET_HOLDER_STATS_FLAG, assetName), stats);
+}
+
+void CAssetsDB::BeginAddressQuantities(const int nHeight)
+{
+    if (pquantityBatch)
+        LogPrintf("%s: dropping %u address quantities of a flush that failed\n", __func__, pquantityBatch->mapQuantities.size());
+
+    nHolderStatsHeight = nHeight;
+    pquantityBatch.reset(new CAddressQuantityBatch(*this));
+}
+
+void CAssetsDB::StageAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount nQuantity)
+{
+    // Remember what the database held before the batch, the first time the batch touches the row
+    auto it = pquantityBatch->mapQuantities.find(std::make_pair(assetName, address));
+    if (it == pquantityBatch->mapQuantities.end()) {
+        CAmount nOldQuantity = 0;
+        Read(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), nOldQuantity);
+        it = pquantityBatch->mapQuantities.emplace(std::make_pair(assetName, address), std::make_pair(nOldQuantity, 0)).first;
+    }
+    it->second.second = nQuantity;
+}
+
+bool CAssetsDB::CommitAddressQuantities()
+{
+    if (!pquantityBatch)
+        return true;
+
+    std::unique_ptr<CAddressQuantityBatch> pbatch(std::move(pquantityBatch));
+    if (!fOwnershipJournalsLoaded && !LoadOwnershipJournals())
+        return false;
+
+    // Only the net change of each row counts, a row changed and changed back within the batch changes nothing
+    std::map<std::string, CAssetHolderStats> mapStatsDeltas;
+    for (const auto& item : pbatch->mapQuantities) {
+        const std::string& assetName = item.first.first;
+        const std::string& address = item.first.second;
+        const CAmount nOldQuantity = item.second.first;
+        const CAmount nNewQuantity = item.second.second;
+        if (nOldQuantity == nNewQuantity)
+            continue;
+
+        if (mapOwnershipJournals.count(assetName))
+            pbatch->batch.Write(std::make_pair(OWNERSHIP_JOURNAL_FLAG, std::make_pair(assetName, address)), true);
+
+        CAssetHolderStats& delta = mapStatsDeltas[assetName];
+        if (nOldQuantity <= 0 && nNewQuantity > 0)
+            delta.nHolders++;
+        else if (nOldQuantity > 0 && nNewQuantity <= 0)
+            delta.nHolders--;
+
+        if (!GetParams().IsBurnAddress(address))
+            delta.nCirculating += nNewQuantity - nOldQuantity;
+    }
+
+    for (const auto& item : mapStatsDeltas) {
+        CAssetHolderStats stats;
+        if (!ReadAssetHolderStats(item.first, stats))
+            return error("%s: failed to read the holder stats of %s", __func__, item.first);
+
+        stats.nHolders += item.second.nHolders;
+        stats.nCirculating += item.second.nCirculating;
+        stats.nLastChangedHeight = nHolderStatsHeight;
+        pbatch->batch.Write(std::make_pair(ASSET_HOLDER_STATS_FLAG, item.first), stats);
+    }
+
+    if (!WriteBatch(pbatch->batch))
+        return error("%s: failed to write %u address quantities", __func__, pbatch->mapQuantities.size());
+
+    return true;
+}
+
+void CAssetsDB::AbortAddressQuantities()
+{
+    pquantityBatch.reset();
+}
+
+bool CAssetsDB::BuildAssetHolderStats(const int nHeight)
+{
+    bool fBuilt = false;
+    if (Read(ASSET_HOLDER_STATS_BUILT, fBuilt) && fBuilt)
+        return true;
+
+    LogPrintf("%s: Counting asset holders from the asset address quantities\n", __func__);
+
+    // Rows are ordered by asset name, so each asset's stats are complete once the cursor moves past its rows
+    CDBBatch batch(*this);
+    std::string strCurrentAsset;
+    CAssetHolderStats stats;
+    size_t nAssets = 0;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key; // <Asset Name, Address> -> Quantity
+        if (!pcursor->GetKey(key) || key.first != ASSET_ADDRESS_QUANTITY_FLAG)
+            break;
+
+        CAmount nQuantity;
+        if (!pcursor->GetValue(nQuantity))
+            return error("%s: failed to read address quantity from database", __func__);
+
+        if (key.second.first != strCurrentAsset) {
+            if (stats.nHolders || stats.nCirculating) {
+                batch.Write(std::make_pair(ASSET_HOLDER_STATS_FLAG, strCurrentAsset), stats);
+                nAssets++;
+            }
+            strCurrentAsset = key.second.first;
+            stats.SetNull();
+            stats.nLastChangedHeight = nHeight;
+        }
+
+        if (nQuantity > 0)
+            stats.nHolders++;
+        if (!GetParams().IsBurnAddress(key.second.second))
+            stats.nCirculating += nQuantity;
+
+        if (batch.SizeEstimate() > MAX_HOLDER_STATS_BATCH_SIZE) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write asset holder stats", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    if (stats.nHolders || stats.nCirculating) {
+        batch.Write(std::make_pair(ASSET_HOLDER_STATS_FLAG, strCurrentAsset), stats);
+        nAssets++;
+    }
+    batch.Write(ASSET_HOLDER_STATS_BUILT, true);
+
+    LogPrintf("%s: Counted the holders of %u assets\n", __func__, nAssets);
+    return WriteBatch(batch);
+}
+
+bool CAssetsDB::LoadOwnershipJournals()
+{
+    mapOwnershipJournals.clear();
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(OWNERSHIP_JOURNAL_HEIGHT_FLAG, std::string()));
+    while (pcursor->Valid()) {
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != OWNERSHIP_JOURNAL_HEIGHT_FLAG)
+            break;
+
+        int nSnapshotHeight;
+        if (!pcursor->GetValue(nSnapshotHeight))
+            return error("%s: failed to read ownership journal height", __func__);
+        mapOwnershipJournals[key.second] = nSnapshotHeight;
+        pcursor->Next();
+    }
+
+    fOwnershipJournalsLoaded = true;
+    return true;
+}
+
+void CAssetsDB::ClearOwnershipJournal(CDBBatch& batch, const std::string& assetName)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(OWNERSHIP_JOURNAL_FLAG, std::make_pair(assetName, std::string())));
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<std::string, std::string> > key; // <Asset Name, Address> -> true
+        if (!pcursor->GetKey(key) || key.first != OWNERSHIP_JOURNAL_FLAG || key.second.first != assetName)
+            break;
+
+        batch.Erase(key);
+        pcursor->Next();
+    }
+}
+
+bool CAssetsDB::StartOwnershipJournal(const std::string& assetName, const int nSnapshotHeight)
+{
+    if (!fOwnershipJournalsLoaded && !LoadOwnershipJournals())
+        return false;
+
+    CDBBatch batch(*this);
+    ClearOwnershipJournal(batch, assetName);
+    batch.Write(std::make_pair(OWNERSHIP_JOURNAL_HEIGHT_FLAG, assetName), nSnapshotHeight);
+    if (!WriteBatch(batch))
+        return error("%s: failed to start the ownership journal of %s", __func__, assetName);
+
+    mapOwnershipJournals[assetName] = nSnapshotHeight;
+    return true;
+}
+
+bool CAssetsDB::StopOwnershipJournal(const std::string& assetName)
+{
+    if (!fOwnershipJournalsLoaded && !LoadOwnershipJournals())
+        return false;
+
+    if (!mapOwnershipJournals.count(assetName))
+        return true;
+
+    CDBBatch batch(*this);
+    ClearOwnershipJournal(batch, assetName);
+    batch.Erase(std::make_pair(OWNERSHIP_JOURNAL_HEIGHT_FLAG, assetName));
+    if (!WriteBatch(batch))
+        return error("%s: failed to stop the ownership journal of %s", __func__, assetName);
+
+    mapOwnershipJournals.erase(assetName);
+    return true;
+}
+
+bool CAssetsDB::ReadOwnershipJournal(const std::string& assetName, int& nSnapshotHeight, std::vector<std::string>& vAddresses)
+{
+    vAddresses.clear();
+    if (!fOwnershipJournalsLoaded && !LoadOwnershipJournals())
+        return false;
+
+    auto it = mapOwnershipJournals.find(assetName);
+    if (it == mapOwnershipJournals.end())
+        return false;
+    nSnapshotHeight = it->second;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(OWNERSHIP_JOURNAL_FLAG, std::make_pair(assetName, std::string())));
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<std::string, std::string> > key; // <Asset Name, Address> -> true
+        if (!pcursor->GetKey(key) || key.first != OWNERSHIP_JOURNAL_FLAG || key.second.first != assetName)
+            break;
+
+        vAddresses.push_back(key.second.second);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CAssetsDB::LoadAssets()
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -173,222 +446,393 @@ bool CAssetsDB::LoadAssets()
     return true;
 }
 
-bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start)
+// Split a listassets filter into the name prefix and whether it ends in a wildcard, an empty prefix matches every name
+static bool ParseAssetNameFilter(const std::string& filter, std::string& prefix)
 {
-    FlushStateToDisk();
+    prefix = filter;
+    bool fWildcard = !prefix.empty() && prefix.back() == '*';
+    if (fWildcard)
+        prefix.pop_back();
+    return fWildcard || prefix.empty();
+}
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
+void CAssetNameIndex::Add(const std::string& name)
+{
+    if (vNamesByLength.size() <= name.size())
+        vNamesByLength.resize(name.size() + 1);
+
+    std::vector<std::string>& vNames = vNamesByLength[name.size()];
+    auto it = std::lower_bound(vNames.begin(), vNames.end(), name);
+    if (it != vNames.end() && *it == name)
+        return;
+    vNames.insert(it, name);
+    nSize++;
+}
 
-    auto prefix = filter;
-    bool wildcard = prefix.back() == '*';
-    if (wildcard)
-        prefix.pop_back();
+void CAssetNameIndex::Remove(const std::string& name)
+{
+    if (vNamesByLength.size() <= name.size())
+        return;
+
+    std::vector<std::string>& vNames = vNamesByLength[name.size()];
+    auto it = std::lower_bound(vNames.begin(), vNames.end(), name);
+    if (it == vNames.end() || *it != name)
+        return;
+    vNames.erase(it);
+    nSize--;
+}
 
-    size_t skip = 0;
-    if (start >= 0) {
-        skip = start;
+void CAssetNameIndex::Clear()
+{
+    vNamesByLength.clear();
+    nSize = 0;
+}
+
+std::pair<CAssetNameIndex::name_iterator, CAssetNameIndex::name_iterator> CAssetNameIndex::Range(const std::vector<std::string>& vNames, const std::string& prefix, bool fWildcard) const
+{
+    auto begin = std::lower_bound(vNames.begin(), vNames.end(), prefix);
+    if (!fWildcard)
+        return std::make_pair(begin, begin != vNames.end() && *begin == prefix ? begin + 1 : begin);
+
+    // Names starting with the prefix are contiguous in a sorted bucket
+    auto end = std::partition_point(begin, vNames.end(), [&prefix](const std::string& name) {
+        return name.compare(0, prefix.size(), prefix) == 0;
+    });
+    return std::make_pair(begin, end);
+}
+
+size_t CAssetNameIndex::Count(const std::string& filter) const
+{
+    std::string prefix;
+    bool fWildcard = ParseAssetNameFilter(filter, prefix);
+
+    size_t nCount = 0;
+    for (size_t nLength = prefix.size(); nLength < vNamesByLength.size(); nLength++) {
+        auto range = Range(vNamesByLength[nLength], prefix, fWildcard);
+        nCount += range.second - range.first;
+        if (!fWildcard)
+            break;
     }
-    else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+    return nCount;
+}
 
-            std::pair<char, std::string> key;
-            if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-                if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                    table_size += 1;
-                }
-            }
-            pcursor->Next();
+void CAssetNameIndex::Get(const std::string& filter, size_t nSkip, size_t count, std::vector<std::string>& names) const
+{
+    std::string prefix;
+    bool fWildcard = ParseAssetNameFilter(filter, prefix);
+
+    for (size_t nLength = prefix.size(); nLength < vNamesByLength.size() && count > 0; nLength++) {
+        auto range = Range(vNamesByLength[nLength], prefix, fWildcard);
+        size_t nMatches = range.second - range.first;
+        if (nSkip >= nMatches) {
+            nSkip -= nMatches;
+        } else {
+            size_t nTake = std::min(nMatches - nSkip, count);
+            names.insert(names.end(), range.first + nSkip, range.first + nSkip + nTake);
+            count -= nTake;
+            nSkip = 0;
         }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+        if (!fWildcard)
+            break;
     }
+}
 
+bool CAssetsDB::LoadAssetNameIndex()
+{
+    AssertLockHeld(cs_main);
+    assetNameIndex.Clear();
 
-    size_t loaded = 0;
-    size_t offset = 0;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
 
-    // Load assets
-    while (pcursor->Valid() && loaded < count) {
+    while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
 
         std::pair<char, std::string> key;
         if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-            if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                if (offset < skip) {
-                    offset += 1;
-                }
-                else {
-                    CDatabasedAssetData data;
-                    if (pcursor->GetValue(data)) {
-                        assets.push_back(data);
-                        loaded += 1;
-                    } else {
-                        return error("%s: failed to read asset", __func__);
-                    }
-                }
-            }
+            assetNameIndex.Add(key.second);
             pcursor->Next();
         } else {
             break;
         }
     }
 
+    // Apply the changes passets hasn't written to the database yet, from here on AddAssetName and RemoveAssetName do
+    if (passets) {
+        for (const auto& newAsset : passets->setNewAssetsToAdd)
+            assetNameIndex.Add(newAsset.asset.strName);
+        for (const auto& newAsset : passets->setNewAssetsToRemove)
+            assetNameIndex.Remove(newAsset.asset.strName);
+    }
+
+    fAssetNameIndexLoaded = true;
     return true;
 }
 
-bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start)
+void CAssetsDB::AddAssetName(const std::string& assetName)
 {
-    FlushStateToDisk();
+    if (fAssetNameIndexLoaded) {
+        AssertLockHeld(cs_main);
+        assetNameIndex.Add(assetName);
+    }
+}
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, std::string())));
+void CAssetsDB::RemoveAssetName(const std::string& assetName)
+{
+    if (fAssetNameIndexLoaded) {
+        AssertLockHeld(cs_main);
+        assetNameIndex.Remove(assetName);
+    }
+}
 
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start)
+{
+    LOCK(cs_main);
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                totalEntries++;
-            }
-            pcursor->Next();
-        }
-        return true;
-    }
+    if (!fAssetNameIndexLoaded && !LoadAssetNameIndex())
+        return error("%s: failed to load the asset name index", __func__);
 
     size_t skip = 0;
     if (start >= 0) {
         skip = start;
     }
     else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+        // compute table size for backwards offset, an offset before the first asset returns nothing
+        long table_size = assetNameIndex.Count(filter);
+        skip = table_size + start >= 0 ? table_size + start : table_size;
+    }
+
+    std::vector<std::string> names;
+    assetNameIndex.Get(filter, skip, count, names);
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                table_size += 1;
+    // Only flush when an asset on this page was issued or reissued since the last flush, its database entry is stale
+    if (passets) {
+        for (const auto& name : names) {
+            CNewAsset tempAsset;
+            tempAsset.strName = name;
+            if (passets->mapReissuedAssetData.count(name) || passets->setNewAssetsToAdd.count(CAssetCacheNewAsset(tempAsset, "", 0, uint256()))) {
+                FlushStateToDisk();
+                break;
             }
-            pcursor->Next();
         }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
     }
 
+    // Load assets
+    assets.reserve(assets.size() + names.size());
+    for (const auto& name : names) {
+        CDatabasedAssetData data;
+        if (!Read(std::make_pair(ASSET_FLAG, name), data))
+            return error("%s: failed to read asset", __func__);
+        assets.push_back(data);
+    }
 
-    size_t loaded = 0;
-    size_t offset = 0;
+    return true;
+}
 
-    // Load assets
-    while (pcursor->Valid() && loaded < count && loaded < MAX_DATABASE_RESULTS) {
+// Flush the chainstate only when passets holds quantity changes that haven't reached the database yet
+static void FlushIfAssetQuantitiesDirty()
+{
+    if (passets && passets->HasDirtyAddressQuantities())
+        FlushStateToDisk();
+}
+
+// Walk the <flag, <strOuter, strInner> > rows starting at strStartKey. Up to count rows are decoded into vecResults,
+// and strNextKey is set to the inner key of the first row that wasn't returned (empty once the rows are exhausted)
+static bool ReadQuantityPage(CDBIterator& cursor, const char flag, const std::string& strOuter, const std::string& strStartKey, const size_t count, std::vector<std::pair<std::string, CAmount> >& vecResults, std::string& strNextKey)
+{
+    strNextKey.clear();
+    cursor.Seek(std::make_pair(flag, std::make_pair(strOuter, strStartKey)));
+
+    size_t loaded = 0;
+    while (cursor.Valid()) {
         boost::this_thread::interruption_point();
 
         std::pair<char, std::pair<std::string, std::string> > key;
-        if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                if (offset < skip) {
-                    offset += 1;
-                }
-                else {
-                    CAmount amount;
-                    if (pcursor->GetValue(amount)) {
-                        vecAssetAmount.emplace_back(std::make_pair(key.second.second, amount));
-                        loaded += 1;
-                    } else {
-                        return error("%s: failed to Address Asset Quanity", __func__);
-                    }
-                }
-            pcursor->Next();
-        } else {
+        if (!cursor.GetKey(key) || key.first != flag || key.second.first != strOuter)
+            break;
+
+        if (loaded >= count) {
+            strNextKey = key.second.second;
             break;
         }
+
+        CAmount amount;
+        if (!cursor.GetValue(amount))
+            return error("%s: failed to read quantity for %s, %s", __func__, strOuter, key.second.second);
+
+        vecResults.emplace_back(key.second.second, amount);
+        loaded++;
+        cursor.Next();
     }
 
     return true;
 }
 
-// Can get to total count of addresses that belong to a certain asset_name, or get you the list of all address that belong to a certain asset_name
-bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start)
+// Count the <flag, <strOuter, *> > rows without decoding their values
+static int CountQuantityRows(CDBIterator& cursor, const char flag, const std::string& strOuter)
+{
+    int total = 0;
+    cursor.Seek(std::make_pair(flag, std::make_pair(strOuter, std::string())));
+    while (cursor.Valid()) {
+        boost::this_thread::interruption_point();
+
+        std::pair<char, std::pair<std::string, std::string> > key;
+        if (!cursor.GetKey(key) || key.first != flag || key.second.first != strOuter)
+            break;
+
+        total++;
+        cursor.Next();
+    }
+
+    return total;
+}
+
+// Skip the first nSkip <flag, <strOuter, *> > rows, returning the inner key of the next row (empty if none is left)
+static std::string SkipQuantityRows(CDBIterator& cursor, const char flag, const std::string& strOuter, size_t nSkip)
+{
+    cursor.Seek(std::make_pair(flag, std::make_pair(strOuter, std::string())));
+    while (cursor.Valid()) {
+        boost::this_thread::interruption_point();
+
+        std::pair<char, std::pair<std::string, std::string> > key;
+        if (!cursor.GetKey(key) || key.first != flag || key.second.first != strOuter)
+            break;
+
+        if (nSkip == 0)
+            return key.second.second;
+
+        nSkip--;
+        cursor.Next();
+    }
+
+    return std::string();
+}
+
+bool CAssetsDB::AddressDirPage(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, std::string& strNextKey, const std::string& address, const std::string& strStartKey, const size_t count)
 {
-    FlushStateToDisk();
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    return ReadQuantityPage(*pcursor, ADDRESS_ASSET_QUANTITY_FLAG, address, strStartKey, count, vecAssetAmount, strNextKey);
+}
 
+bool CAssetsDB::AssetAddressDirPage(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, std::string& strNextKey, const std::string& assetName, const std::string& strStartKey, const size_t count)
+{
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, std::string())));
+    return ReadQuantityPage(*pcursor, ASSET_ADDRESS_QUANTITY_FLAG, assetName, strStartKey, count, vecAddressAmount, strNextKey);
+}
 
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start)
+{
+    FlushIfAssetQuantitiesDirty();
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                totalEntries += 1;
-            }
-            pcursor->Next();
-        }
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (fGetTotal) {
+        totalEntries = CountQuantityRows(*pcursor, ADDRESS_ASSET_QUANTITY_FLAG, address);
         return true;
     }
 
     size_t skip = 0;
     if (start >= 0) {
         skip = start;
-    }
-    else {
+    } else {
         // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+        long table_size = CountQuantityRows(*pcursor, ADDRESS_ASSET_QUANTITY_FLAG, address);
+        skip = std::max(table_size + start, 0L);
+    }
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                table_size += 1;
-            }
-            pcursor->Next();
-        }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+    std::string strStartKey;
+    if (skip > 0) {
+        strStartKey = SkipQuantityRows(*pcursor, ADDRESS_ASSET_QUANTITY_FLAG, address, skip);
+        if (strStartKey.empty())
+            return true;
     }
 
-    size_t loaded = 0;
-    size_t offset = 0;
+    std::string strNextKey;
+    return ReadQuantityPage(*pcursor, ADDRESS_ASSET_QUANTITY_FLAG, address, strStartKey, std::min(count, MAX_DATABASE_RESULTS), vecAssetAmount, strNextKey);
+}
 
-    // Load assets
-    while (pcursor->Valid() && loaded < count && loaded < MAX_DATABASE_RESULTS) {
-        boost::this_thread::interruption_point();
+// Can get to total count of addresses that belong to a certain asset_name, or get you the list of all address that belong to a certain asset_name
+bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start)
+{
+    FlushIfAssetQuantitiesDirty();
 
-        std::pair<char, std::pair<std::string, std::string> > key;
-        if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-            if (offset < skip) {
-                offset += 1;
-            }
-            else {
-                CAmount amount;
-                if (pcursor->GetValue(amount)) {
-                    vecAddressAmount.emplace_back(std::make_pair(key.second.second, amount));
-                    loaded += 1;
-                } else {
-                    return error("%s: failed to Asset Address Quanity", __func__);
-                }
-            }
-            pcursor->Next();
-        } else {
-            break;
-        }
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (fGetTotal) {
+        totalEntries = CountQuantityRows(*pcursor, ASSET_ADDRESS_QUANTITY_FLAG, assetName);
+        return true;
     }
 
-    return true;
+    size_t skip = 0;
+    if (start >= 0) {
+        skip = start;
+    } else {
+        // compute table size for backwards offset
+        long table_size = CountQuantityRows(*pcursor, ASSET_ADDRESS_QUANTITY_FLAG, assetName);
+        skip = std::max(table_size + start, 0L);
+    }
+
+    std::string strStartKey;
+    if (skip > 0) {
+        strStartKey = SkipQuantityRows(*pcursor, ASSET_ADDRESS_QUANTITY_FLAG, assetName, skip);
+        if (strStartKey.empty())
+            return true;
+    }
+
+    std::string strNextKey;
+    return ReadQuantityPage(*pcursor, ASSET_ADDRESS_QUANTITY_FLAG, assetName, strStartKey, std::min(count, MAX_DATABASE_RESULTS), vecAddressAmount, strNextKey);
 }
 
 bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets)
 {
     return CAssetsDB::AssetDir(assets, "*", MAX_SIZE, 0);
 }
+
+uint64_t CAssetsDB::DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor, const bool fHolderTables)
+{
+    uint64_t nEntries = 0;
+    for (const char chTable : SNAPSHOT_TABLES)
+        nEntries += writer.WriteTable(cursor, chTable, SNAPSHOT_CONTENT_ASSETS);
+    if (fHolderTables) {
+        for (const char chTable : SNAPSHOT_HOLDER_TABLES)
+            nEntries += writer.WriteTable(cursor, chTable, SNAPSHOT_CONTENT_ASSET_HOLDERS);
+    }
+    return nEntries;
+}
+
+bool CAssetsDB::LoadSnapshot(CUTXOSnapshotReader& reader, const bool fHolderTables, const int nHeight, uint64_t& nEntries)
+{
+    nEntries = 0;
+    uint64_t nTableEntries = 0;
+    for (const char chTable : SNAPSHOT_TABLES) {
+        if (!reader.ReadTable(this, chTable, SNAPSHOT_CONTENT_ASSETS, nTableEntries))
+            return false;
+        nEntries += nTableEntries;
+    }
+    if (fHolderTables) {
+        // Without -assetindex here the holder tables are read past, they would go stale
+        for (const char chTable : SNAPSHOT_HOLDER_TABLES) {
+            if (!reader.ReadTable(fAssetIndex ? this : nullptr, chTable, SNAPSHOT_CONTENT_ASSET_HOLDERS, nTableEntries))
+                return false;
+            nEntries += nTableEntries;
+        }
+    }
+
+    if (reader.VerifyOnly())
+        return true;
+
+    if (!reader.EraseTable(*this, BLOCK_ASSET_UNDO_DATA) || !reader.EraseTable(*this, MEMPOOL_REISSUED_TX) ||
+        !reader.EraseTable(*this, OWNERSHIP_JOURNAL_FLAG) || !reader.EraseTable(*this, OWNERSHIP_JOURNAL_HEIGHT_FLAG) ||
+        !reader.EraseTable(*this, ASSET_HOLDER_STATS_FLAG) || !reader.EraseTable(*this, ASSET_HOLDER_STATS_BUILT))
+        return false;
+
+    if (fHolderTables && fAssetIndex && !BuildAssetHolderStats(nHeight))
+        return false;
+    nHolderStatsHeight = nHeight;
+
+    assetNameIndex.Clear();
+    fAssetNameIndexLoaded = false;
+    mapOwnershipJournals.clear();
+    fOwnershipJournalsLoaded = false;
+    return true;
+}
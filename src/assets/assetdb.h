@@ -10,6 +10,8 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 #include <dbwrapper.h>
 
 const int8_t ASSET_UNDO_INCLUDES_VERIFIER_STRING = -1;
@@ -18,6 +20,8 @@ class CNewAsset;
 class uint256;
 class COutPoint;
 class CDatabasedAssetData;
+class CUTXOSnapshotReader;
+class CUTXOSnapshotWriter;
 
 struct CBlockAssetUndo
 {
@@ -56,6 +60,61 @@ struct CBlockAssetUndo
     }
 };
 
+/** Aggregates over the <asset, address> quantity rows of one asset (-assetindex only). They are updated together
+ *  with the rows when the asset cache is flushed, so they always describe the rows currently in the database */
+struct CAssetHolderStats
+{
+    int64_t nHolders;           // Addresses holding a positive quantity, burn addresses included
+    CAmount nCirculating;       // Total quantity held outside of the burn addresses
+    int32_t nLastChangedHeight; // Chain height of the flush that last changed the rows
+
+    CAssetHolderStats()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nHolders = 0;
+        nCirculating = 0;
+        nLastChangedHeight = -1;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHolders);
+        READWRITE(nCirculating);
+        READWRITE(nLastChangedHeight);
+    }
+};
+
+/** Sorted index of asset names, in the same order as the ASSET_FLAG database keys (by length, then by name).
+ *  Names are bucketed by length, so counting or skipping into the names matching a filter takes one binary
+ *  search per name length instead of a database scan */
+class CAssetNameIndex
+{
+public:
+    void Add(const std::string& name);
+    void Remove(const std::string& name);
+    void Clear();
+    size_t Size() const { return nSize; }
+
+    /** Number of names matching the filter, either an exact name or a prefix followed by '*' */
+    size_t Count(const std::string& filter) const;
+
+    /** Append up to count names matching the filter, skipping the first nSkip of them */
+    void Get(const std::string& filter, size_t nSkip, size_t count, std::vector<std::string>& names) const;
+
+private:
+    std::vector<std::vector<std::string> > vNamesByLength;
+    size_t nSize = 0;
+
+    typedef std::vector<std::string>::const_iterator name_iterator;
+    std::pair<name_iterator, name_iterator> Range(const std::vector<std::string>& vNames, const std::string& prefix, bool fWildcard) const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CAssetsDB : public CDBWrapper
 {
@@ -78,6 +137,7 @@ public:
     bool ReadAddressAssetQuantity(const std::string& address, const std::string& assetName, CAmount& quantity);
     bool ReadBlockUndoAssetData(const uint256& blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
     bool ReadReissuedMempoolState();
+    bool ReadAssetHolderStats(const std::string& assetName, CAssetHolderStats& stats);
 
     // Erase from database functions
     bool EraseAssetData(const std::string& assetName);
@@ -90,8 +150,75 @@ public:
     bool AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start);
     bool AssetDir(std::vector<CDatabasedAssetData>& assets);
 
+    // Build the holder stats from the quantity rows, once per database. Must run before the first flush
+    bool BuildAssetHolderStats(const int nHeight);
+
+    // Height recorded as nLastChangedHeight by the quantity writes that follow (cs_main held)
+    void SetHolderStatsHeight(const int nHeight) { nHolderStatsHeight = nHeight; }
+
+    // Height of the chainstate the holder stats in the database describe, the height of the last flush (cs_main held)
+    int GetHolderStatsHeight() const { return nHolderStatsHeight; }
+
+    // The <asset, address> quantity writes and erases between BeginAddressQuantities and CommitAddressQuantities go
+    // into one batch, and are written together with the ownership journal entries and holder stats they change, so a
+    // crash can't leave the stats out of step with the rows. Writes outside of them are committed one by one. A
+    // flush that fails drops its batch with AbortAddressQuantities (cs_main held)
+    void BeginAddressQuantities(const int nHeight);
+    bool CommitAddressQuantities();
+    void AbortAddressQuantities();
+
+    // Ownership journals: for the assets that have ownership snapshots, the addresses whose quantity changed since
+    // the journal was started at the latest snapshot, so the next snapshot only has to read those (cs_main held)
+    bool StartOwnershipJournal(const std::string& assetName, const int nSnapshotHeight);
+    bool StopOwnershipJournal(const std::string& assetName);
+    bool ReadOwnershipJournal(const std::string& assetName, int& nSnapshotHeight, std::vector<std::string>& vAddresses);
+
+    // Keep the asset name index in step with the assets added to and removed from the passets cache (cs_main held)
+    void AddAssetName(const std::string& assetName);
+    void RemoveAssetName(const std::string& assetName);
+
     bool AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start);
     bool AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start);
+
+    // Resumable directory reads. Each call returns up to count rows starting at strStartKey ("" for the first row),
+    // and sets strNextKey to the key to pass in for the next page, or to "" once every row has been returned.
+    // These don't flush the chainstate, callers that need the in-memory asset cache reflected must flush first.
+    bool AddressDirPage(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, std::string& strNextKey, const std::string& address, const std::string& strStartKey, const size_t count);
+    bool AssetAddressDirPage(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, std::string& strNextKey, const std::string& assetName, const std::string& strStartKey, const size_t count);
+
+    // Copy the asset tables to and from a UTXO snapshot, with the holder tables when fHolderTables is set. Loading
+    // drops the undo data and ownership journals, which only make sense for blocks connected here, and builds the
+    // holder stats of the snapshot at nHeight (cs_main held)
+    uint64_t DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor, const bool fHolderTables);
+    bool LoadSnapshot(CUTXOSnapshotReader& reader, const bool fHolderTables, const int nHeight, uint64_t& nEntries);
+
+private:
+    // Names of the assets in the database and the passets cache, loaded by the first AssetDir call (protected by cs_main)
+    CAssetNameIndex assetNameIndex;
+    bool fAssetNameIndexLoaded = false;
+
+    bool LoadAssetNameIndex();
+
+    int nHolderStatsHeight = -1;
+
+    struct CAddressQuantityBatch
+    {
+        CDBBatch batch;
+        // <Asset Name, Address> -> quantity in the database before the batch, and after it
+        std::map<std::pair<std::string, std::string>, std::pair<CAmount, CAmount> > mapQuantities;
+
+        explicit CAddressQuantityBatch(CDBWrapper& db) : batch(db) {}
+    };
+    std::unique_ptr<CAddressQuantityBatch> pquantityBatch;
+
+    void StageAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount nQuantity);
+
+    // Snapshot height of each asset with an ownership journal (protected by cs_main)
+    std::map<std::string, int> mapOwnershipJournals;
+    bool fOwnershipJournalsLoaded = false;
+
+    bool LoadOwnershipJournals();
+    void ClearOwnershipJournal(CDBBatch& batch, const std::string& assetName);
 };
 
 
@@ -28,6 +28,7 @@
 #include "utilmoneystr.h"
 #include "coins.h"
 #include "wallet/wallet.h"
+#include "verifierprogram.h"
 #include "LibBoolEE.h"
 
 #define SIX_MONTHS 15780000 // Six months worth of seconds
@@ -661,6 +662,11 @@ bool OwnerFromTransaction(const CTransaction& tx, std::string& ownerName, std::s
 }
 
 bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress)
+{
+    return TransferAssetFromScript(scriptPubKey, assetTransfer, strAddress, AreTransferScriptsSizeDeployed());
+}
+
+bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress, const bool fTransferScriptsSizeDeployed)
 {
     int nStartingIndex = 0;
     if (!IsScriptTransferAsset(scriptPubKey, nStartingIndex)) {
@@ -674,7 +680,7 @@ bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetT
 
     std::vector<unsigned char> vchTransferAsset;
 
-    if (AreTransferScriptsSizeDeployed()) {
+    if (fTransferScriptsSizeDeployed) {
         // Before kawpow activation we used the hardcoded 31 to find the data
         // This created a bug where large transfers scripts would fail to serialize.
         // This fixes that issue (https://github.com/RavenProject/Ravencoin/issues/752)
@@ -1608,7 +1614,7 @@ bool CAssetTransfer::ContextualCheckAgainstVerifyString(CAssetsCache *assetCache
         return false;
     }
 
-    if (!ContextualCheckVerifierString(assetCache, verifier.verifier_string, address, strError))
+    if (!ContextualCheckVerifierString(assetCache, verifier, address, strError))
         return false;
 
     return true;
@@ -1678,18 +1684,17 @@ bool CAssetsCache::AddTransferAsset(const CAssetTransfer& transferAsset, const s
 void CAssetsCache::AddToAssetBalance(const std::string& strName, const std::string& address, const CAmount& nAmount)
 {
     if (fAssetIndex) {
-        auto pair = std::make_pair(strName, address);
         // Add to map address -> amount map
 
-        // Get the best amount
-        if (!GetBestAssetAddressAmount(*this, strName, address))
-            mapAssetsAddressAmount.insert(make_pair(pair, 0));
+        // Get the best amount, an address that isn't in the map or database starts at 0
+        GetBestAssetAddressAmount(*this, strName, address);
+        CAmount& nBalance = mapAssetsAddressAmount.Get(strName, address);
 
         // Add the new amount to the balance
         if (IsAssetNameAnOwner(strName))
-            mapAssetsAddressAmount.at(pair) = OWNER_ASSET_AMOUNT;
+            nBalance = OWNER_ASSET_AMOUNT;
         else
-            mapAssetsAddressAmount.at(pair) += nAmount;
+            nBalance += nAmount;
     }
 }
 
@@ -1740,12 +1745,11 @@ bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
         if (fAssetIndex && nAmount > 0) {
             CAssetCacheSpendAsset spend(assetName, address, nAmount);
             if (GetBestAssetAddressAmount(*this, assetName, address)) {
-                auto pair = make_pair(assetName, address);
-                if (mapAssetsAddressAmount.count(pair))
-                    mapAssetsAddressAmount.at(pair) -= nAmount;
+                CAmount& nBalance = mapAssetsAddressAmount.Get(assetName, address);
+                nBalance -= nAmount;
 
-                if (mapAssetsAddressAmount.at(pair) < 0)
-                    mapAssetsAddressAmount.at(pair) = 0;
+                if (nBalance < 0)
+                    nBalance = 0;
 
                 // Update the cache so we can save to database
                 vSpentAssets.push_back(spend);
@@ -1831,14 +1835,11 @@ bool CAssetsCache::UndoAssetCoin(const Coin& coin, const COutPoint& out)
 bool CAssetsCache::AddBackSpentAsset(const Coin& coin, const std::string& assetName, const std::string& address, const CAmount& nAmount, const COutPoint& out)
 {
     if (fAssetIndex) {
-        // Update the assets address balance
-        auto pair = std::make_pair(assetName, address);
-
         // Get the map address amount from database if the map doesn't have it already
-        if (!GetBestAssetAddressAmount(*this, assetName, address))
-            mapAssetsAddressAmount.insert(std::make_pair(pair, 0));
+        GetBestAssetAddressAmount(*this, assetName, address);
 
-        mapAssetsAddressAmount.at(pair) += nAmount;
+        // Update the assets address balance
+        mapAssetsAddressAmount.Get(assetName, address) += nAmount;
     }
 
     // Add the undoAmount to the vector so we know what changes are dirty and what needs to be saved to database
@@ -1857,19 +1858,19 @@ bool CAssetsCache::UndoTransfer(const CAssetTransfer& transfer, const std::strin
             return error("%s : Failed to get the assets address balance from the database. Asset : %s Address : %s",
                          __func__, transfer.strName, address);
 
-        auto pair = std::make_pair(transfer.strName, address);
-        if (!mapAssetsAddressAmount.count(pair))
+        CAmount* pBalance = mapAssetsAddressAmount.Find(transfer.strName, address);
+        if (!pBalance)
             return error(
                     "%s : Tried undoing a transfer and the map of address amount didn't have the asset address pair. Asset : %s Address : %s",
                     __func__, transfer.strName, address);
 
-        if (mapAssetsAddressAmount.at(pair) < transfer.nAmount)
+        if (*pBalance < transfer.nAmount)
             return error(
                     "%s : Tried undoing a transfer and the map of address amount had less than the amount we are trying to undo. Asset : %s Address : %s",
                     __func__, transfer.strName, address);
 
         // Change the in memory balance of the asset at the address
-        mapAssetsAddressAmount[pair] -= transfer.nAmount;
+        *pBalance -= transfer.nAmount;
     }
 
     return true;
@@ -1918,8 +1919,6 @@ bool CAssetsCache::AddNewAsset(const CNewAsset& asset, const std::string address
 //! Changes Memory Only
 bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::string address, const COutPoint& out)
 {
-    auto pair = std::make_pair(reissue.strName, address);
-
     CNewAsset asset;
     int assetHeight;
     uint256 assetBlockHash;
@@ -1960,11 +1959,10 @@ bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::stri
 
     if (fAssetIndex) {
         // Add the reissued amount to the address amount map
-        if (!GetBestAssetAddressAmount(*this, reissue.strName, address))
-            mapAssetsAddressAmount.insert(make_pair(pair, 0));
+        GetBestAssetAddressAmount(*this, reissue.strName, address);
 
         // Add the reissued amount to the amount in the map
-        mapAssetsAddressAmount[pair] += reissue.nAmount;
+        mapAssetsAddressAmount.Get(reissue.strName, address) += reissue.nAmount;
     }
 
     return true;
@@ -1974,8 +1972,6 @@ bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::stri
 //! Changes Memory Only
 bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::string address, const COutPoint& out, const std::vector<std::pair<std::string, CBlockAssetUndo> >& vUndoIPFS)
 {
-    auto pair = std::make_pair(reissue.strName, address);
-
     CNewAsset assetData;
     int height;
     uint256 blockHash;
@@ -2027,9 +2023,10 @@ bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::s
                 return error("%s : Trying to undo reissue of an asset but the assets amount isn't in the database",
                          __func__);
         }
-        mapAssetsAddressAmount[pair] -= reissue.nAmount;
+        CAmount& nBalance = mapAssetsAddressAmount.Get(reissue.strName, address);
+        nBalance -= reissue.nAmount;
 
-        if (mapAssetsAddressAmount[pair] < 0)
+        if (nBalance < 0)
             return error("%s : Tried undoing reissue of an asset, but the assets amount went negative: %s", __func__,
                          reissue.strName);
     }
@@ -2067,8 +2064,7 @@ bool CAssetsCache::RemoveOwnerAsset(const std::string& assetsName, const std::st
     setNewOwnerAssetsToRemove.insert(newOwner);
 
     if (fAssetIndex) {
-        auto pair = std::make_pair(assetsName, address);
-        mapAssetsAddressAmount[pair] = 0;
+        mapAssetsAddressAmount.Get(assetsName, address) = 0;
     }
 
     return true;
@@ -2266,7 +2262,56 @@ bool CAssetsCache::RemoveRestrictedVerifier(const std::string& assetName, const
     return true;
 }
 
+/** True if the sorted qualifiers hold the qualifier or one of its sub qualifiers, like CRestrictedDB::CheckForAddressRootQualifier */
+static bool HasQualifierOrSubQualifier(const std::vector<std::string>& vQualifiers, const std::string& qualifier_name)
+{
+    for (auto it = std::lower_bound(vQualifiers.begin(), vQualifiers.end(), qualifier_name);
+         it != vQualifiers.end() && it->compare(0, qualifier_name.size(), qualifier_name) == 0; ++it) {
+        if (it->size() == qualifier_name.size() || (*it)[qualifier_name.size()] == '/')
+            return true;
+    }
+    return false;
+}
+
+/** Apply a qualifier written to or erased from the database to the address qualifier index, if the address is in it */
+static void UpdateAddressQualifierIndex(const std::string& address, const std::string& qualifier_name, bool fAdd)
+{
+    if (!passetsAddressQualifiersCache || !passetsAddressQualifiersCache->Exists(address))
+        return;
+
+    std::vector<std::string> vQualifiers = passetsAddressQualifiersCache->Get(address);
+    auto it = std::lower_bound(vQualifiers.begin(), vQualifiers.end(), qualifier_name);
+    bool fFound = it != vQualifiers.end() && *it == qualifier_name;
+    if (fAdd && !fFound)
+        vQualifiers.insert(it, qualifier_name);
+    else if (!fAdd && fFound)
+        vQualifiers.erase(it);
+    passetsAddressQualifiersCache->Put(address, vQualifiers);
+}
+
 bool CAssetsCache::DumpCacheToDatabase()
+{
+    // Stamp the holder stats changed by this flush with the height of the chainstate being flushed, which is
+    // ahead of (or behind) chainActive while a block is being connected (or disconnected)
+    int nFlushHeight = chainActive.Height();
+    if (pcoinsTip) {
+        BlockMap::const_iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+        if (it != mapBlockIndex.end())
+            nFlushHeight = it->second->nHeight;
+    }
+
+    // The address quantities of the whole flush are written in one batch with the holder stats
+    passetsdb->BeginAddressQuantities(nFlushHeight);
+    if (!WriteCacheToDatabase() || !passetsdb->CommitAddressQuantities()) {
+        passetsdb->AbortAddressQuantities();
+        return false;
+    }
+
+    ClearDirtyCache();
+    return true;
+}
+
+bool CAssetsCache::WriteCacheToDatabase()
 {
     try {
         bool dirty = false;
@@ -2580,6 +2625,7 @@ bool CAssetsCache::DumpCacheToDatabase()
         for (auto newQualifierAddress : setNewQualifierAddressToAdd) {
             if (newQualifierAddress.type == QualifierType::REMOVE_QUALIFIER) {
                 passetsQualifierCache->Erase(newQualifierAddress.GetHash().GetHex());
+                UpdateAddressQualifierIndex(newQualifierAddress.address, newQualifierAddress.assetName, false);
                 if (!prestricteddb->EraseAddressQualifier(newQualifierAddress.address, newQualifierAddress.assetName)) {
                     dirty = true;
                     message = "_Failed Erasing address qualifier from database";
@@ -2593,6 +2639,7 @@ bool CAssetsCache::DumpCacheToDatabase()
                 }
             } else if (newQualifierAddress.type == QualifierType::ADD_QUALIFIER) {
                 passetsQualifierCache->Put(newQualifierAddress.GetHash().GetHex(), 1);
+                UpdateAddressQualifierIndex(newQualifierAddress.address, newQualifierAddress.assetName, true);
                 if (!prestricteddb->WriteAddressQualifier(newQualifierAddress.address, newQualifierAddress.assetName))
                 {
                     dirty = true;
@@ -2616,6 +2663,7 @@ bool CAssetsCache::DumpCacheToDatabase()
         for (auto undoQualifierAddress : setNewQualifierAddressToRemove) {
             if (undoQualifierAddress.type == QualifierType::REMOVE_QUALIFIER) { // If we are undoing a removal, we write the data to database
                 passetsQualifierCache->Put(undoQualifierAddress.GetHash().GetHex(), 1);
+                UpdateAddressQualifierIndex(undoQualifierAddress.address, undoQualifierAddress.assetName, true);
                 if (!prestricteddb->WriteAddressQualifier(undoQualifierAddress.address, undoQualifierAddress.assetName)) {
                     dirty = true;
                     message = "_Failed undoing a removal of a address qualifier  from database";
@@ -2629,6 +2677,7 @@ bool CAssetsCache::DumpCacheToDatabase()
                 }
             } else if (undoQualifierAddress.type == QualifierType::ADD_QUALIFIER) { // If we are undoing an addition, we remove the data from the database
                 passetsQualifierCache->Erase(undoQualifierAddress.GetHash().GetHex());
+                UpdateAddressQualifierIndex(undoQualifierAddress.address, undoQualifierAddress.assetName, false);
                 if (!prestricteddb->EraseAddressQualifier(undoQualifierAddress.address, undoQualifierAddress.assetName))
                 {
                     dirty = true;
@@ -2799,8 +2848,6 @@ bool CAssetsCache::DumpCacheToDatabase()
             }
         }
 
-        ClearDirtyCache();
-
         return true;
     } catch (const std::runtime_error& e) {
         return error("%s : %s ", __func__, std::string("System error while flushing assets: ") + e.what());
@@ -2820,16 +2867,21 @@ bool CAssetsCache::Flush()
             if (passets->setNewAssetsToRemove.count(item))
                 passets->setNewAssetsToRemove.erase(item);
             passets->setNewAssetsToAdd.insert(item);
+            if (passetsdb)
+                passetsdb->AddAssetName(item.asset.strName);
         }
 
         for (auto &item : setNewAssetsToRemove) {
             if (passets->setNewAssetsToAdd.count(item))
                 passets->setNewAssetsToAdd.erase(item);
             passets->setNewAssetsToRemove.insert(item);
+            if (passetsdb)
+                passetsdb->RemoveAssetName(item.asset.strName);
         }
 
-        for (auto &item : mapAssetsAddressAmount)
-            passets->mapAssetsAddressAmount[item.first] = item.second;
+        mapAssetsAddressAmount.ForEach([](const std::string& assetName, const std::string& address, const CAmount& nAmount) {
+            passets->mapAssetsAddressAmount.Get(assetName, address) = nAmount;
+        });
 
         for (auto &item : mapReissuedAssetData)
             passets->mapReissuedAssetData[item.first] = item.second;
@@ -2993,11 +3045,33 @@ bool CAssetsCache::Flush()
     }
 }
 
+//! Memory of a dirty set or vector, along with the strings in its entries
+template <typename Container>
+static size_t DirtyCacheUsage(const Container& container)
+{
+    size_t size = memusage::DynamicUsage(container);
+    for (const auto& item : container)
+        size += item.DynamicMemoryUsage();
+    return size;
+}
+
 //! Get the amount of memory the cache is using
 size_t CAssetsCache::DynamicMemoryUsage() const
 {
-    // TODO make sure this is accurate
-    return memusage::DynamicUsage(mapAssetsAddressAmount) + memusage::DynamicUsage(mapReissuedAssetData);
+    size_t size = mapAssetsAddressAmount.DynamicMemoryUsage() + memusage::DynamicUsage(mapReissuedAssetData);
+    for (const auto& item : mapReissuedAssetData)
+        size += memusage::DynamicUsage(item.first) + memusage::DynamicUsage(item.second.strName) + memusage::DynamicUsage(item.second.strIPFSHash);
+    return size;
+}
+
+//! Returns true if there are address quantity changes that haven't been written to the database yet
+bool CAssetsCache::HasDirtyAddressQuantities() const
+{
+    return !vUndoAssetAmount.empty() || !vSpentAssets.empty() ||
+           !setNewAssetsToAdd.empty() || !setNewAssetsToRemove.empty() ||
+           !setNewReissueToAdd.empty() || !setNewReissueToRemove.empty() ||
+           !setNewOwnerAssetsToAdd.empty() || !setNewOwnerAssetsToRemove.empty() ||
+           !setNewTransferAssetsToAdd.empty() || !setNewTransferAssetsToRemove.empty();
 }
 
 //! Get an estimated size of the cache in bytes that will be needed inorder to save to database
@@ -3036,30 +3110,37 @@ size_t CAssetsCache::GetCacheSize() const
     return size;
 }
 
-//! Get an estimated size of the cache in bytes that will be needed inorder to save to database
-size_t CAssetsCache::GetCacheSizeV2() const
+//! Get the memory used by the dirty entries that will be written to the database on the next flush
+size_t CAssetsCache::GetDirtyCacheUsage() const
 {
-    // COutPoint: 32 bytes
-    // CNewAsset: Max 80 bytes
-    // CAssetTransfer: Asset Name, CAmount ( 40 bytes)
-    // CReissueAsset: Max 80 bytes
-    // CAmount: 8 bytes
-    // Asset Name: Max 32 bytes
-    // Address: 40 bytes
-    // Block hash: 32 bytes
-    // CTxOut: CAmount + CScript (105 + 8 = 113 bytes)
-
     size_t size = 0;
-    size += memusage::DynamicUsage(vUndoAssetAmount);
-    size += memusage::DynamicUsage(setNewTransferAssetsToRemove);
-    size += memusage::DynamicUsage(setNewTransferAssetsToAdd);
-    size += memusage::DynamicUsage(setNewOwnerAssetsToAdd);
-    size += memusage::DynamicUsage(setNewOwnerAssetsToRemove);
-    size += memusage::DynamicUsage(vSpentAssets);
-    size += memusage::DynamicUsage(setNewAssetsToAdd);
-    size += memusage::DynamicUsage(setNewAssetsToRemove);
-    size += memusage::DynamicUsage(setNewReissueToAdd);
-    size += memusage::DynamicUsage(setNewReissueToRemove);
+    size += DirtyCacheUsage(vUndoAssetAmount);
+    size += DirtyCacheUsage(vSpentAssets);
+    size += DirtyCacheUsage(setNewAssetsToAdd);
+    size += DirtyCacheUsage(setNewAssetsToRemove);
+    size += DirtyCacheUsage(setNewReissueToAdd);
+    size += DirtyCacheUsage(setNewReissueToRemove);
+    size += DirtyCacheUsage(setNewOwnerAssetsToAdd);
+    size += DirtyCacheUsage(setNewOwnerAssetsToRemove);
+    size += DirtyCacheUsage(setNewTransferAssetsToAdd);
+    size += DirtyCacheUsage(setNewTransferAssetsToRemove);
+    size += DirtyCacheUsage(setNewQualifierAddressToAdd);
+    size += DirtyCacheUsage(setNewQualifierAddressToRemove);
+    size += DirtyCacheUsage(setNewRestrictedAddressToAdd);
+    size += DirtyCacheUsage(setNewRestrictedAddressToRemove);
+    size += DirtyCacheUsage(setNewRestrictedGlobalToAdd);
+    size += DirtyCacheUsage(setNewRestrictedGlobalToRemove);
+    size += DirtyCacheUsage(setNewRestrictedVerifierToAdd);
+    size += DirtyCacheUsage(setNewRestrictedVerifierToRemove);
+
+    for (const auto* mapRootQualifier : {&mapRootQualifierAddressesAdd, &mapRootQualifierAddressesRemove}) {
+        size += memusage::DynamicUsage(*mapRootQualifier);
+        for (const auto& item : *mapRootQualifier) {
+            size += item.first.DynamicMemoryUsage() + memusage::DynamicUsage(item.second);
+            for (const auto& address : item.second)
+                size += memusage::DynamicUsage(address);
+        }
+    }
 
     return size;
 }
@@ -3573,6 +3654,45 @@ bool GetAssetData(const CScript& script, CAssetOutputEntry& data)
     return false;
 }
 
+/** The name and amount cached on the transaction for output n, nullptr if they can't be used in place of decoding
+ *  the script. Before the transfer script size fix, transfers were decoded from byte 31 whatever the script said */
+static const CTxOutAssetInfo* GetCachedAssetInfo(const CTransaction& tx, size_t n, const bool fTransferScriptsSizeDeployed)
+{
+    const CTxOutAssetInfo* info = tx.GetAssetOutInfo(n);
+    if (!info || !info->fHasNameAndAmount)
+        return nullptr;
+
+    if (info->nType == TX_TRANSFER_ASSET && info->nStartingIndex != 31 && !fTransferScriptsSizeDeployed)
+        return nullptr;
+
+    return info;
+}
+
+bool GetAssetData(const CTransaction& tx, size_t n, CAssetOutputEntry& data)
+{
+    const CTxOutAssetInfo* info = GetCachedAssetInfo(tx, n, AreTransferScriptsSizeDeployed());
+
+    // Transfers can carry a message and expire time after the amount, those are only read from the script. New
+    // assets and reissues are only valid if the whole asset decodes, so they are also left to the script decoder
+    if (!info || (info->nType == TX_TRANSFER_ASSET && info->fMoreData) || info->nType == TX_REISSUE_ASSET
+            || (info->nType == TX_NEW_ASSET && !info->fIsOwner))
+        return n < tx.vout.size() && GetAssetData(tx.vout[n].scriptPubKey, data);
+
+    CTxDestination destination;
+    ExtractDestination(tx.vout[n].scriptPubKey, destination);
+
+    data.type = txnouttype(info->nType);
+    data.nAmount = info->fIsOwner ? OWNER_ASSET_AMOUNT : info->nAmount;
+    data.destination = destination;
+    data.assetName = info->strName;
+    if (info->nType == TX_TRANSFER_ASSET) {
+        // Same as a transfer decoded from a script that ends after the amount
+        data.message = "";
+        data.expireTime = 0;
+    }
+    return true;
+}
+
 #ifdef ENABLE_WALLET
 void GetAllAdministrativeAssets(CWallet *pwallet, std::vector<std::string> &names, int nMinConf)
 {
@@ -3724,22 +3844,21 @@ std::string GetBurnAddress(const AssetType type)
 bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName, const std::string& address)
 {
     if (fAssetIndex) {
-        auto pair = make_pair(assetName, address);
-
         // If the caches map has the pair, return true because the map already contains the best dirty amount
-        if (cache.mapAssetsAddressAmount.count(pair))
+        if (cache.mapAssetsAddressAmount.Find(assetName, address))
             return true;
 
         // If the caches map has the pair, return true because the map already contains the best dirty amount
-        if (passets->mapAssetsAddressAmount.count(pair)) {
-            cache.mapAssetsAddressAmount[pair] = passets->mapAssetsAddressAmount.at(pair);
+        const CAmount* pAmount = passets->mapAssetsAddressAmount.Find(assetName, address);
+        if (pAmount) {
+            cache.mapAssetsAddressAmount.Get(assetName, address) = *pAmount;
             return true;
         }
 
         // If the database contains the assets address amount, insert it into the database and return true
         CAmount nDBAmount;
-        if (passetsdb->ReadAssetAddressQuantity(pair.first, pair.second, nDBAmount)) {
-            cache.mapAssetsAddressAmount.insert(make_pair(pair, nDBAmount));
+        if (passetsdb->ReadAssetAddressQuantity(assetName, address, nDBAmount)) {
+            cache.mapAssetsAddressAmount.Get(assetName, address) = nDBAmount;
             return true;
         }
     }
@@ -4439,7 +4558,29 @@ void GetTxOutAssetTypes(const std::vector<CTxOut>& vout, int& issues, int& reiss
     }
 }
 
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+bool ParseAssetScript(const CTransaction& tx, size_t n, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    return ParseAssetScript(tx, n, hashBytes, assetName, assetAmount, AreTransferScriptsSizeDeployed());
+}
+
+bool ParseAssetScript(const CTransaction& tx, size_t n, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount, const bool fTransferScriptsSizeDeployed) {
+    const CTxOutAssetInfo* info = GetCachedAssetInfo(tx, n, fTransferScriptsSizeDeployed);
+
+    // Same as GetAssetData(tx, n), new assets and reissues are left to the script decoder
+    if (!info || info->nType == TX_REISSUE_ASSET || (info->nType == TX_NEW_ASSET && !info->fIsOwner))
+        return n < tx.vout.size() && ParseAssetScript(tx.vout[n].scriptPubKey, hashBytes, assetName, assetAmount, fTransferScriptsSizeDeployed);
+
+    const CScript& scriptPubKey = tx.vout[n].scriptPubKey;
+    assetName = info->strName;
+    assetAmount = info->fIsOwner ? OWNER_ASSET_AMOUNT : info->nAmount;
+    hashBytes = uint160(std::vector <unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
+    return true;
+}
+
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    return ParseAssetScript(scriptPubKey, hashBytes, assetName, assetAmount, AreTransferScriptsSizeDeployed());
+}
+
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount, const bool fTransferScriptsSizeDeployed) {
     int nType;
     bool fIsOwner;
     int _nStartingPoint;
@@ -4475,7 +4616,7 @@ bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &ass
             }
         } else if (nType == TX_TRANSFER_ASSET) {
             CAssetTransfer asset;
-            if (TransferAssetFromScript(scriptPubKey, asset, _strAddress)) {
+            if (TransferAssetFromScript(scriptPubKey, asset, _strAddress, fTransferScriptsSizeDeployed)) {
                 assetName = asset.strName;
                 assetAmount = asset.nAmount;
                 isAsset = true;
@@ -4627,6 +4768,7 @@ bool CAssetsCache::GetAssetVerifierStringIfExists(const std::string &name, CNull
         std::string verifier;
         if (prestricteddb->ReadVerifier(name, verifier)) {
             verifierString.verifier_string = verifier;
+            verifierString.program = CompileVerifierString(verifier);
             if (passetsVerifierCache)
                 passetsVerifierCache->Put(name, verifierString);
             return true;
@@ -4707,6 +4849,21 @@ bool CAssetsCache::CheckForAddressQualifier(const std::string &qualifier_name, c
         }
     }
 
+    // Check the address qualifier index. The first time an address is looked up all of its qualifiers are read from
+    // database at once, after that every qualifier of a verifier string is answered from memory
+    if (passetsAddressQualifiersCache && prestricteddb) {
+        if (!passetsAddressQualifiersCache->Exists(address)) {
+            std::vector<std::string> vQualifiers;
+            if (prestricteddb->ReadAddressQualifiers(address, vQualifiers)) {
+                std::sort(vQualifiers.begin(), vQualifiers.end());
+                passetsAddressQualifiersCache->Put(address, vQualifiers);
+            }
+        }
+
+        if (passetsAddressQualifiersCache->Exists(address))
+            return HasQualifierOrSubQualifier(passetsAddressQualifiersCache->Get(address), qualifier_name);
+    }
+
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
     if (passetsQualifierCache) {
         if (passetsQualifierCache->Exists(cachedQualifierAddress.GetHash().GetHex())) {
@@ -4948,6 +5105,32 @@ bool CheckVerifierString(const std::string& verifier, std::set<std::string>& set
     }
 }
 
+std::shared_ptr<const CVerifierProgram> CompileVerifierString(const std::string& verifier, const std::set<std::string>& setFoundQualifiers)
+{
+    std::shared_ptr<const CVerifierProgram> program = CVerifierProgram::Compile(verifier);
+    if (!program || program->GetQualifiers().size() != setFoundQualifiers.size())
+        return nullptr;
+
+    // Only use the program if it refers to exactly the qualifiers CheckVerifierString found, LibBoolEE is used otherwise
+    auto it = setFoundQualifiers.begin();
+    for (const auto& qualifier : program->GetQualifiers()) {
+        if (qualifier.compare(1, std::string::npos, *it++) != 0)
+            return nullptr;
+    }
+
+    return program;
+}
+
+std::shared_ptr<const CVerifierProgram> CompileVerifierString(const std::string& verifier)
+{
+    std::set<std::string> setFoundQualifiers;
+    std::string strError;
+    if (verifier == "true" || !CheckVerifierString(verifier, setFoundQualifiers, strError))
+        return nullptr;
+
+    return CompileVerifierString(verifier, setFoundQualifiers);
+}
+
 bool VerifyNullAssetDataFlag(const int& flag, std::string& strError)
 {
     // Check the flag
@@ -5141,18 +5324,37 @@ bool ContextualCheckVerifierAssetTxOut(const CTxOut& txout, CAssetsCache* assetC
 
 bool ContextualCheckVerifierString(CAssetsCache* cache, const std::string& verifier, const std::string& check_address, std::string& strError, ErrorReport* errorReport)
 {
+    return ContextualCheckVerifierString(cache, CNullAssetTxVerifierString(verifier), check_address, strError, errorReport);
+}
+
+bool ContextualCheckVerifierString(CAssetsCache* cache, const CNullAssetTxVerifierString& verifierString, const std::string& check_address, std::string& strError, ErrorReport* errorReport)
+{
+    const std::string& verifier = verifierString.verifier_string;
+
     // If verifier is set to true, return true
     if (verifier == "true")
         return true;
 
-    // Check against the non contextual changes first
+    // Verifier strings read through the assets cache come compiled, and only strings that passed CheckVerifierString are
+    // compiled. Otherwise check against the non contextual changes first
+    std::shared_ptr<const CVerifierProgram> program = verifierString.program;
     std::set<std::string> setFoundQualifiers;
-    if (!CheckVerifierString(verifier, setFoundQualifiers, strError, errorReport))
-        return false;
+    if (!program) {
+        if (!CheckVerifierString(verifier, setFoundQualifiers, strError, errorReport))
+            return false;
+        program = CompileVerifierString(verifier, setFoundQualifiers);
+    }
+
+    // The qualifiers the program refers to are the ones CheckVerifierString found, with the '#' added back
+    std::vector<std::string> vFoundQualifiers;
+    if (!program) {
+        for (const auto& qualifier : setFoundQualifiers)
+            vFoundQualifiers.emplace_back(QUALIFIER_CHAR + qualifier);
+    }
+    const std::vector<std::string>& vQualifiers = program ? program->GetQualifiers() : vFoundQualifiers;
 
     // Loop through each qualifier and make sure that the asset exists
-    for(auto qualifier : setFoundQualifiers) {
-        std::string search = QUALIFIER_CHAR + qualifier;
+    for (const auto& search : vQualifiers) {
         if (!cache->CheckIfAssetExists(search, true)) {
             if (errorReport) {
                 errorReport->type = ErrorReport::ErrorType::AssetDoesntExist;
@@ -5169,22 +5371,31 @@ bool ContextualCheckVerifierString(CAssetsCache* cache, const std::string& verif
     if (check_address.empty())
         return true;
 
-    // Create an object that stores if an address contains a qualifier
-    LibBoolEE::Vals vals;
+    try {
+        bool ret;
+        if (program) {
+            // Check to see if the address contains each qualifier, and run the program on the result
+            ret = program->Evaluate([cache, &check_address](const std::string& search) {
+                return cache->CheckForAddressQualifier(search, check_address, true);
+            });
+        } else {
+            // Create an object that stores if an address contains a qualifier
+            LibBoolEE::Vals vals;
 
-    // Add the qualifiers into the vals object
-    for (auto qualifier : setFoundQualifiers) {
-        std::string search = QUALIFIER_CHAR + qualifier;
+            // Add the qualifiers into the vals object
+            for (const auto& qualifier : setFoundQualifiers) {
+                std::string search = QUALIFIER_CHAR + qualifier;
 
-        // Check to see if the address contains the qualifier
-        bool has_qualifier = cache->CheckForAddressQualifier(search, check_address, true);
+                // Check to see if the address contains the qualifier
+                bool has_qualifier = cache->CheckForAddressQualifier(search, check_address, true);
 
-        // Add the true or false value into the vals
-        vals.insert(std::make_pair(qualifier, has_qualifier));
-    }
+                // Add the true or false value into the vals
+                vals.insert(std::make_pair(qualifier, has_qualifier));
+            }
+
+            ret = LibBoolEE::resolve(verifier, vals, errorReport);
+        }
 
-    try {
-        bool ret = LibBoolEE::resolve(verifier, vals, errorReport);
         if (!ret) {
             if (errorReport) {
                 if (errorReport->type == ErrorReport::ErrorType::NotSetError) {
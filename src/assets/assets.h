@@ -73,7 +73,7 @@ extern std::map<std::string, uint256> mapReissuedAssets;
 
 class CAssets {
 public:
-    std::map<std::pair<std::string, std::string>, CAmount> mapAssetsAddressAmount; // pair < Asset Name , Address > -> Quantity of tokens in the address
+    CAssetAddressAmountMap mapAssetsAddressAmount; // pair < Asset Name , Address > -> Quantity of tokens in the address
 
     // Dirty, Gets wiped once flushed to database
     std::map<std::string, CNewAsset> mapReissuedAssetData; // Asset Name -> New Asset Data
@@ -123,6 +123,11 @@ struct ErrorReport {
 
 std::string GetUserErrorString(const ErrorReport& report);
 
+/** Dirty asset state for the chain tip (passets) or for a set of blocks being applied on top of it.
+ *  A default constructed cache is an empty layer over passets: lookups check this layer's dirty
+ *  entries first, then fall through to passets and the databases, and Flush() merges only this
+ *  layer's changes into passets. Prefer a new layer over copying passets, which is O(dirty state).
+ */
 class CAssetsCache : public CAssets
 {
 private:
@@ -314,12 +319,17 @@ public :
     //! Return true if the restricted asset is globally freezing trading
     bool CheckForGlobalRestriction(const std::string &restricted_name, bool fSkipTempCache = false);
 
-    //! Calculate the size of the CAssets (in bytes)
+    //! Calculate the size of the CAssets (in bytes), the address quantities and reissued asset data
     size_t DynamicMemoryUsage() const;
 
+    //! Returns true if there are address quantity changes that haven't been written to the database yet
+    bool HasDirtyAddressQuantities() const;
+
     //! Get the size of the none databased cache
     size_t GetCacheSize() const;
-    size_t GetCacheSizeV2() const;
+
+    //! Memory used by the dirty entries, counting the strings they hold
+    size_t GetDirtyCacheUsage() const;
 
     //! Flush all new cache entries into the passets global cache
     bool Flush();
@@ -327,6 +337,9 @@ public :
     //! Write asset cache data to database
     bool DumpCacheToDatabase();
 
+    //! Write the dirty entries to the database, DumpCacheToDatabase commits the address quantities afterwards
+    bool WriteCacheToDatabase();
+
     //! Clear all dirty cache sets, vetors, and maps
     void ClearDirtyCache() {
 
@@ -444,6 +457,8 @@ bool RestrictedAssetFromTransaction(const CTransaction& tx, CNewAsset& asset, st
 
 //! Get specific asset type metadata from the given scripts
 bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress);
+/** Same as above, decoding from where the transfer script size deployment says, active or not, instead of its state at the tip */
+bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress, const bool fTransferScriptsSizeDeployed);
 bool AssetFromScript(const CScript& scriptPubKey, CNewAsset& asset, std::string& strAddress);
 bool OwnerAssetFromScript(const CScript& scriptPubKey, std::string& assetName, std::string& strAddress);
 bool ReissueAssetFromScript(const CScript& scriptPubKey, CReissueAsset& reissue, std::string& strAddress);
@@ -515,6 +530,9 @@ bool GetAssetInfoFromCoin(const Coin& coin, std::string& strName, CAmount& nAmou
 bool GetAssetInfoFromScript(const CScript& scriptPubKey, std::string& strName, CAmount& nAmount);
 
 bool GetAssetData(const CScript& script, CAssetOutputEntry& data);
+/** Same as above for output n of tx, using the name and amount the transaction parsed when it was built for the
+ *  transfer and owner outputs. The other outputs are decoded from the script, so the results are always the same */
+bool GetAssetData(const CTransaction& tx, size_t n, CAssetOutputEntry& data);
 
 bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName, const std::string& address);
 
@@ -549,13 +567,22 @@ bool VerifyWalletHasAsset(const std::string& asset_name, std::pair<int, std::str
 #endif
 
 /** Helper method for extracting address bytes, asset name and amount from an asset script */
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+bool ParseAssetScript(const CTransaction& tx, size_t n, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+/** Same as above for the transfers of a block that isn't the next one, using the deployment state of that block */
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount, const bool fTransferScriptsSizeDeployed);
+bool ParseAssetScript(const CTransaction& tx, size_t n, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount, const bool fTransferScriptsSizeDeployed);
 
 /** Helper method for extracting #TAGS from a verifier string */
 void ExtractVerifierStringQualifiers(const std::string& verifier, std::set<std::string>& qualifiers);
 bool CheckVerifierString(const std::string& verifier, std::set<std::string>& setFoundQualifiers, std::string& strError, ErrorReport* errorReport = nullptr);
 std::string GetStrippedVerifierString(const std::string& verifier);
 
+/** Compile a verifier string for the cache, nullptr if it doesn't pass CheckVerifierString or can't be compiled */
+std::shared_ptr<const CVerifierProgram> CompileVerifierString(const std::string& verifier);
+/** Compile a verifier string that passed CheckVerifierString with the qualifiers it found */
+std::shared_ptr<const CVerifierProgram> CompileVerifierString(const std::string& verifier, const std::set<std::string>& setFoundQualifiers);
+
 /** Helper methods that validate changes to null asset data transaction databases */
 bool VerifyNullAssetDataFlag(const int& flag, std::string& strError);
 bool VerifyQualifierChange(CAssetsCache& cache, const CNullAssetTxData& data, const std::string& address, std::string& strError);
@@ -572,6 +599,8 @@ bool ContextualCheckNullAssetTxOut(const CTxOut& txout, CAssetsCache* assetCache
 bool ContextualCheckGlobalAssetTxOut(const CTxOut& txout, CAssetsCache* assetCache, std::string& strError);
 bool ContextualCheckVerifierAssetTxOut(const CTxOut& txout, CAssetsCache* assetCache, std::string& strError);
 bool ContextualCheckVerifierString(CAssetsCache* cache, const std::string& verifier, const std::string& check_address, std::string& strError, ErrorReport* errorReport = nullptr);
+/** Same as above, using the compiled program of the verifier string when it has one */
+bool ContextualCheckVerifierString(CAssetsCache* cache, const CNullAssetTxVerifierString& verifierString, const std::string& check_address, std::string& strError, ErrorReport* errorReport = nullptr);
 bool ContextualCheckNewAsset(CAssetsCache* assetCache, const CNewAsset& asset, std::string& strError, bool fCheckMempool = false);
 bool ContextualCheckTransferAsset(CAssetsCache* assetCache, const CAssetTransfer& transfer, const std::string& address, std::string& strError);
 bool ContextualCheckReissueAsset(CAssetsCache* assetCache, const CReissueAsset& reissue_asset, std::string& strError, const CTransaction& tx);
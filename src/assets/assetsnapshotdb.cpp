@@ -10,6 +10,12 @@
 #include <boost/thread.hpp>
 
 static const char SNAPSHOTCHECK_FLAG = 'C'; // Snapshot Check
+static const char SNAPSHOTDELTA_FLAG = 'D'; // Snapshot stored as a delta
+static const char SNAPSHOTHEIGHTS_FLAG = 'H'; // Snapshot heights of an asset
+static const char SNAPSHOTPAGE_FLAG = 'P'; // Page of owners of a full snapshot
+
+//  Longest chain of deltas behind a snapshot before the next one is stored in full
+static const int MAX_SNAPSHOT_DELTA_DEPTH = 16;
 
 CAssetSnapshotDBEntry::CAssetSnapshotDBEntry()
 {
@@ -35,6 +41,132 @@ CAssetSnapshotDBEntry::CAssetSnapshotDBEntry(
 CAssetSnapshotDB::CAssetSnapshotDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "rewards" / "assetsnapshot", nCacheSize, fMemory, fWipe) {
 }
 
+namespace {
+
+//  Writes the owners of a full snapshot, a page at a time
+class CSnapshotPageWriter
+{
+public:
+    CSnapshotPageWriter(CDBWrapper & p_db, const std::string & p_heightAndName) : db(p_db), heightAndName(p_heightAndName) {}
+
+    bool Add(const std::pair<std::string, CAmount> & p_owner)
+    {
+        page.push_back(p_owner);
+        nOwners++;
+        return (int)page.size() < SNAPSHOT_PAGE_SIZE || Flush();
+    }
+
+    bool Flush()
+    {
+        if (page.empty())
+            return true;
+        if (!db.Write(std::make_pair(SNAPSHOTPAGE_FLAG, std::make_pair(heightAndName, nPages)), page))
+            return false;
+        nPages++;
+        page.clear();
+        return true;
+    }
+
+    int nPages = 0;
+    int64_t nOwners = 0;
+
+private:
+    CDBWrapper & db;
+    std::string heightAndName;
+    std::vector<std::pair<std::string, CAmount>> page;
+};
+
+} // namespace
+
+bool CAssetSnapshotCursor::Open(const std::string & p_assetName, int p_height)
+{
+    baseHeightAndName = std::to_string(p_height) + p_assetName;
+    nPages = 0;
+    nNextPage = 0;
+    vPage.clear();
+    nPagePos = 0;
+    fPagesDone = false;
+    mapChanges.clear();
+    fValid = false;
+    fFailed = false;
+
+    CAssetSnapshotDelta snapshot;
+    if (!db.ReadSnapshotDelta(p_assetName, p_height, snapshot)) {
+        //  Snapshots written before the pages were introduced are a single value
+        CAssetSnapshotDBEntry snapshotEntry;
+        if (!db.ReadLegacySnapshot(baseHeightAndName, snapshotEntry))
+            return false;
+        vPage.assign(snapshotEntry.ownersAndAmounts.begin(), snapshotEntry.ownersAndAmounts.end());
+        Next();
+        return true;
+    }
+
+    //  Walk back to the full snapshot, the depth bounds how far that is
+    std::vector<CAssetSnapshotDelta> deltas;
+    while (snapshot.nBaseHeight != -1) {
+        CAssetSnapshotDelta baseSnapshot;
+        if ((int)deltas.size() >= MAX_SNAPSHOT_DELTA_DEPTH ||
+                !db.ReadSnapshotDelta(p_assetName, snapshot.nBaseHeight, baseSnapshot)) {
+            LogPrint(BCLog::REWARDS, "%s : Missing base snapshot at height %d for '%s'\n",
+                __func__, snapshot.nBaseHeight, p_assetName.c_str());
+            return false;
+        }
+        deltas.push_back(std::move(snapshot));
+        snapshot = std::move(baseSnapshot);
+    }
+
+    for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+        for (auto const & currPair : it->changedOwners)
+            mapChanges[currPair.first] = currPair.second;
+    }
+
+    baseHeightAndName = std::to_string(snapshot.height) + p_assetName;
+    nPages = snapshot.nPages;
+    Next();
+    return !fFailed;
+}
+
+void CAssetSnapshotCursor::Next()
+{
+    fValid = false;
+
+    while (!fPagesDone) {
+        if (nPagePos < vPage.size()) {
+            current = vPage[nPagePos++];
+            auto it = mapChanges.find(current.first);
+            if (it != mapChanges.end()) {
+                current.second = it->second;
+                mapChanges.erase(it);
+            }
+            if (current.second != 0) {
+                fValid = true;
+                return;
+            }
+        } else if (nNextPage < nPages) {
+            if (!db.ReadSnapshotPage(baseHeightAndName, nNextPage++, vPage)) {
+                LogPrint(BCLog::REWARDS, "%s : Failed to read page %d of snapshot '%s'\n",
+                    __func__, nNextPage - 1, baseHeightAndName.c_str());
+                fFailed = true;
+                return;
+            }
+            nPagePos = 0;
+        } else {
+            fPagesDone = true;
+            vPage.clear();
+            itAdded = mapChanges.begin();
+        }
+    }
+
+    //  Owners the deltas added
+    while (itAdded != mapChanges.end()) {
+        current = *itAdded++;
+        if (current.second != 0) {
+            fValid = true;
+            return;
+        }
+    }
+}
+
 bool CAssetSnapshotDB::AddAssetOwnershipSnapshot(
     const std::string & p_assetName, int p_height)
 {
@@ -47,66 +179,118 @@ bool CAssetSnapshotDB::AddAssetOwnershipSnapshot(
         return false;
     }
 
-    std::set<std::pair<std::string, CAmount>> ownersAndAmounts;
-    std::vector<std::pair<std::string, CAmount>> tempOwnersAndAmounts;
-    int totalEntryCount;
+    //  Make sure the database reflects any quantity changes still held in the asset cache
+    if (passets && passets->HasDirtyAddressQuantities())
+        FlushStateToDisk();
 
-    if (!passetsdb->AssetAddressDir(tempOwnersAndAmounts, totalEntryCount, true, p_assetName, INT_MAX, 0)) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to retrieve assets directory for '%s'\n", p_assetName.c_str());
+    //  The holder stats tell up front whether there is anything to read
+    CAssetHolderStats holderStats;
+    if (passetsdb->ReadAssetHolderStats(p_assetName, holderStats) && holderStats.nHolders == 0) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No owners exist for asset '%s'.\n", p_assetName.c_str());
         return false;
     }
 
-    //  Retrieve all of the addresses/amounts in batches
-    const int MAX_RETRIEVAL_COUNT = 100;
-    bool errorsOccurred = false;
+    std::set<int> heights;
+    if (!ReadSnapshotHeights(p_assetName, heights))
+        return false;
 
-    for (int retrievalOffset = 0; retrievalOffset < totalEntryCount; retrievalOffset += MAX_RETRIEVAL_COUNT) {
-        //  Retrieve the specified segment of addresses
-        if (!passetsdb->AssetAddressDir(tempOwnersAndAmounts, totalEntryCount, false, p_assetName, MAX_RETRIEVAL_COUNT, retrievalOffset)) {
-            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to retrieve assets directory for '%s'\n", p_assetName.c_str());
-            errorsOccurred = true;
-            break;
-        }
+    //  A snapshot that gets replaced (after a reorg) can't stay the base of later ones
+    if (heights.count(p_height)) {
+        if (!DetachDependentSnapshots(p_assetName, p_height, heights) || !EraseSnapshot(p_assetName, p_height))
+            return false;
+        heights.erase(p_height);
+        if (!Write(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName), heights))
+            return false;
+    }
 
-        //  Verify that some addresses were returned
-        if (tempOwnersAndAmounts.size() == 0) {
-            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No addresses were retrieved.\n");
-            continue;
+    std::string heightAndName = std::to_string(p_height) + p_assetName;
+    CAssetSnapshotDelta snapshot;
+    snapshot.height = p_height;
+    snapshot.assetName = p_assetName;
+
+    //  If the journal started at a snapshot we still have, only the addresses it lists need to be read
+    int journalHeight;
+    std::vector<std::string> changedAddresses;
+    CAssetSnapshotDelta baseSnapshot;
+    if (passetsdb->ReadOwnershipJournal(p_assetName, journalHeight, changedAddresses) && journalHeight != p_height &&
+            heights.count(journalHeight) && (int)changedAddresses.size() <= SNAPSHOT_PAGE_SIZE &&
+            ReadSnapshotDelta(p_assetName, journalHeight, baseSnapshot) && baseSnapshot.nDepth < MAX_SNAPSHOT_DELTA_DEPTH) {
+        for (auto const & address : changedAddresses) {
+            CAmount amount = 0;
+            passetsdb->ReadAssetAddressQuantity(p_assetName, address, amount);
+
+            if (IsValidDestination(DecodeDestination(address))) {
+                snapshot.changedOwners.insert(std::make_pair(address, amount));
+            }
         }
 
-        //  Move these into the main set
-        for (auto const & currPair : tempOwnersAndAmounts) {
-            //  Verify that the address is valid
-            CTxDestination dest = DecodeDestination(currPair.first);
-            if (IsValidDestination(dest)) {
-                ownersAndAmounts.insert(currPair);
+        snapshot.nBaseHeight = journalHeight;
+        snapshot.nDepth = baseSnapshot.nDepth + 1;
+    } else {
+        //  Retrieve all of the addresses/amounts in batches, resuming each batch where the previous one stopped,
+        //  and write them out a page at a time
+        CSnapshotPageWriter pageWriter(*this, heightAndName);
+        std::vector<std::pair<std::string, CAmount>> tempOwnersAndAmounts;
+        const int MAX_RETRIEVAL_COUNT = 100;
+        bool errorsOccurred = false;
+        std::string strStartKey;
+
+        do {
+            std::string strNextKey;
+            if (!passetsdb->AssetAddressDirPage(tempOwnersAndAmounts, strNextKey, p_assetName, strStartKey, MAX_RETRIEVAL_COUNT)) {
+                LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to retrieve assets directory for '%s'\n", p_assetName.c_str());
+                errorsOccurred = true;
+                break;
             }
-            else {
-                LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Address '%s' is invalid.\n", currPair.first.c_str());
+
+            for (auto const & currPair : tempOwnersAndAmounts) {
+                //  Verify that the address is valid
+                CTxDestination dest = DecodeDestination(currPair.first);
+                if (!IsValidDestination(dest)) {
+                    LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Address '%s' is invalid.\n", currPair.first.c_str());
+                }
+                else if (currPair.second != 0 && !pageWriter.Add(currPair)) {
+                    errorsOccurred = true;
+                    break;
+                }
             }
+
+            tempOwnersAndAmounts.clear();
+            strStartKey = strNextKey;
+        } while (!strStartKey.empty() && !errorsOccurred);
+
+        if (errorsOccurred || !pageWriter.Flush()) {
+            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Errors occurred while acquiring ownership info for asset '%s'.\n", p_assetName.c_str());
+            return false;
+        }
+        if (pageWriter.nOwners == 0) {
+            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No owners exist for asset '%s'.\n", p_assetName.c_str());
+            return false;
         }
 
-        tempOwnersAndAmounts.clear();
+        snapshot.nPages = pageWriter.nPages;
+        snapshot.nOwners = pageWriter.nOwners;
     }
 
-    if (errorsOccurred) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Errors occurred while acquiring ownership info for asset '%s'.\n", p_assetName.c_str());
-        return false;
-    }
-    if (ownersAndAmounts.size() == 0) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No owners exist for asset '%s'.\n", p_assetName.c_str());
-        return false;
-    }
+    //  Write the snapshot to the database, the pages of a full one are already there
+    heights.insert(p_height);
 
-    //  Write the snapshot to the database. We don't care if we overwrite, because it should be identical.
-    CAssetSnapshotDBEntry snapshotEntry(p_assetName, p_height, ownersAndAmounts);
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(SNAPSHOTDELTA_FLAG, heightAndName), snapshot);
+    batch.Write(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName), heights);
+    if (!WriteBatch(batch))
+        return false;
 
-    if (Write(std::make_pair(SNAPSHOTCHECK_FLAG, snapshotEntry.heightAndName), snapshotEntry)) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Successfully added snapshot for '%s' at height %d (ownerCount = %d).\n",
-            p_assetName.c_str(), p_height, ownersAndAmounts.size());
-        return true;
+    //  Changes from here on are relative to this snapshot
+    if (!passetsdb->StartOwnershipJournal(p_assetName, p_height)) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to start the ownership journal for '%s'.\n", p_assetName.c_str());
     }
-    return false;
+
+    LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Successfully added snapshot for '%s' at height %d (%s).\n",
+        p_assetName.c_str(), p_height, snapshot.nBaseHeight == -1 ?
+            strprintf("ownerCount = %d", snapshot.nOwners) :
+            strprintf("%d changes since height %d", snapshot.changedOwners.size(), snapshot.nBaseHeight));
+    return true;
 }
 
 bool CAssetSnapshotDB::RetrieveOwnershipSnapshot(
@@ -120,7 +304,15 @@ bool CAssetSnapshotDB::RetrieveOwnershipSnapshot(
         __func__,
         heightAndName.c_str());
 
-    bool succeeded = Read(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName), p_snapshotEntry);
+    std::set<std::pair<std::string, CAmount>> ownersAndAmounts;
+    CAssetSnapshotCursor cursor(*this);
+    bool succeeded = cursor.Open(p_assetName, p_height);
+    for (; succeeded && cursor.Valid(); cursor.Next())
+        ownersAndAmounts.insert(cursor.GetOwner());
+    succeeded = succeeded && !cursor.Failed();
+
+    if (succeeded)
+        p_snapshotEntry = CAssetSnapshotDBEntry(p_assetName, p_height, ownersAndAmounts);
 
     LogPrint(BCLog::REWARDS, "%s : Retrieval of snapshot for '%s' %s!\n",
         __func__,
@@ -130,6 +322,13 @@ bool CAssetSnapshotDB::RetrieveOwnershipSnapshot(
     return succeeded;
 }
 
+bool CAssetSnapshotDB::OwnershipSnapshotExists(
+    const std::string & p_assetName, int p_height)
+{
+    std::string heightAndName = std::to_string(p_height) + p_assetName;
+    return Exists(std::make_pair(SNAPSHOTDELTA_FLAG, heightAndName)) || Exists(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName));
+}
+
 bool CAssetSnapshotDB::RemoveOwnershipSnapshot(
     const std::string & p_assetName, int p_height)
 {
@@ -140,7 +339,32 @@ bool CAssetSnapshotDB::RemoveOwnershipSnapshot(
         __func__,
         heightAndName.c_str());
 
-    bool succeeded = Erase(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName), true);
+    std::set<int> heights;
+    bool succeeded = ReadSnapshotHeights(p_assetName, heights);
+
+    if (succeeded && heights.count(p_height)) {
+        succeeded = DetachDependentSnapshots(p_assetName, p_height, heights);
+        heights.erase(p_height);
+
+        //  Without snapshots left there is nothing for the journal to be relative to
+        if (succeeded && heights.empty() && passetsdb) {
+            LOCK(cs_main);
+            succeeded = passetsdb->StopOwnershipJournal(p_assetName);
+        }
+    }
+
+    if (succeeded)
+        succeeded = EraseSnapshot(p_assetName, p_height);
+
+    if (succeeded) {
+        CDBBatch batch(*this);
+        batch.Erase(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName));
+        if (heights.empty())
+            batch.Erase(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName));
+        else
+            batch.Write(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName), heights);
+        succeeded = WriteBatch(batch, true);
+    }
 
     LogPrint(BCLog::REWARDS, "%s : Removal of snapshot for '%s' %s!\n",
         __func__,
@@ -149,3 +373,83 @@ bool CAssetSnapshotDB::RemoveOwnershipSnapshot(
 
     return succeeded;
 }
+
+bool CAssetSnapshotDB::ReadSnapshotDelta(
+    const std::string & p_assetName, int p_height, CAssetSnapshotDelta & p_snapshot)
+{
+    return Read(std::make_pair(SNAPSHOTDELTA_FLAG, std::to_string(p_height) + p_assetName), p_snapshot);
+}
+
+bool CAssetSnapshotDB::ReadSnapshotPage(
+    const std::string & p_heightAndName, int p_page, std::vector<std::pair<std::string, CAmount>> & p_owners)
+{
+    return Read(std::make_pair(SNAPSHOTPAGE_FLAG, std::make_pair(p_heightAndName, p_page)), p_owners);
+}
+
+bool CAssetSnapshotDB::ReadLegacySnapshot(
+    const std::string & p_heightAndName, CAssetSnapshotDBEntry & p_snapshotEntry)
+{
+    return Read(std::make_pair(SNAPSHOTCHECK_FLAG, p_heightAndName), p_snapshotEntry);
+}
+
+bool CAssetSnapshotDB::ReadSnapshotHeights(
+    const std::string & p_assetName, std::set<int> & p_heights)
+{
+    p_heights.clear();
+    if (!Exists(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName)))
+        return true;
+
+    return Read(std::make_pair(SNAPSHOTHEIGHTS_FLAG, p_assetName), p_heights);
+}
+
+bool CAssetSnapshotDB::EraseSnapshot(
+    const std::string & p_assetName, int p_height)
+{
+    std::string heightAndName = std::to_string(p_height) + p_assetName;
+
+    //  The record goes first, so a snapshot is never left pointing at missing pages
+    CAssetSnapshotDelta snapshot;
+    if (!ReadSnapshotDelta(p_assetName, p_height, snapshot))
+        return true;
+    if (!Erase(std::make_pair(SNAPSHOTDELTA_FLAG, heightAndName)))
+        return false;
+
+    CDBBatch batch(*this);
+    for (int page = 0; page < snapshot.nPages; page++)
+        batch.Erase(std::make_pair(SNAPSHOTPAGE_FLAG, std::make_pair(heightAndName, page)));
+    return WriteBatch(batch);
+}
+
+bool CAssetSnapshotDB::DetachDependentSnapshots(
+    const std::string & p_assetName, int p_height, const std::set<int> & p_heights)
+{
+    for (int height : p_heights) {
+        CAssetSnapshotDelta snapshot;
+        if (height == p_height || !ReadSnapshotDelta(p_assetName, height, snapshot) || snapshot.nBaseHeight != p_height)
+            continue;
+
+        //  Write out the pages of this snapshot from the ones it is based on
+        std::string heightAndName = std::to_string(height) + p_assetName;
+        CSnapshotPageWriter pageWriter(*this, heightAndName);
+        CAssetSnapshotCursor cursor(*this);
+        if (!cursor.Open(p_assetName, height))
+            return false;
+        for (; cursor.Valid(); cursor.Next()) {
+            if (!pageWriter.Add(cursor.GetOwner()))
+                return false;
+        }
+        if (cursor.Failed() || !pageWriter.Flush())
+            return false;
+
+        //  Later deltas keep this height as their base, only how it is stored changes
+        snapshot.nBaseHeight = -1;
+        snapshot.nDepth = 0;
+        snapshot.nPages = pageWriter.nPages;
+        snapshot.nOwners = pageWriter.nOwners;
+        snapshot.changedOwners.clear();
+        if (!Write(std::make_pair(SNAPSHOTDELTA_FLAG, heightAndName), snapshot))
+            return false;
+    }
+
+    return true;
+}
@@ -5,7 +5,9 @@
 #ifndef ASSETSNAPSHOTDB_H
 #define ASSETSNAPSHOTDB_H
 
+#include <map>
 #include <set>
+#include <vector>
 
 #include <dbwrapper.h>
 #include "amount.h"
@@ -53,6 +55,94 @@ public:
     }
 };
 
+//  Owners per page of a full snapshot, and most changes a snapshot can be stored as
+static const int SNAPSHOT_PAGE_SIZE = 1000;
+
+/** How an ownership snapshot is stored: either in full (nBaseHeight == -1), with the owners in nPages pages of up to
+ *  SNAPSHOT_PAGE_SIZE, or as the owners whose amounts changed since the snapshot of the same asset at nBaseHeight,
+ *  with an amount of 0 for addresses that left */
+class CAssetSnapshotDelta
+{
+public:
+    int height;
+    std::string assetName;
+    int nBaseHeight;
+    int nDepth;             //  Number of deltas between this snapshot and a full one
+    int nPages;             //  Full snapshots only
+    int64_t nOwners;        //  Full snapshots only
+    std::set<std::pair<std::string, CAmount>> changedOwners;
+
+    CAssetSnapshotDelta()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        height = 0;
+        assetName = "";
+        nBaseHeight = -1;
+        nDepth = 0;
+        nPages = 0;
+        nOwners = 0;
+        changedOwners.clear();
+    }
+
+    // Serialization methods
+    ADD_SERIALIZE_METHODS;
+
+    template<typename Stream, typename Operation>
+    inline void SerializationOp(Stream &s, Operation ser_action)
+    {
+        READWRITE(height);
+        READWRITE(assetName);
+        READWRITE(nBaseHeight);
+        READWRITE(nDepth);
+        READWRITE(nPages);
+        READWRITE(nOwners);
+        READWRITE(changedOwners);
+    }
+};
+
+class CAssetSnapshotDB;
+
+/** Reads the owners of a snapshot one page at a time, applying the deltas stored on top of the full snapshot as it
+ *  goes, so memory use is bounded by the page size and the deltas. Owners come in the order of the asset address
+ *  index, followed by the owners the deltas added */
+class CAssetSnapshotCursor
+{
+public:
+    explicit CAssetSnapshotCursor(CAssetSnapshotDB & p_db) : db(p_db) {}
+
+    //  Position the cursor on the first owner of the snapshot. Returns false if there is no such snapshot
+    bool Open(const std::string & p_assetName, int p_height);
+
+    bool Valid() const { return fValid; }
+    void Next();
+    const std::pair<std::string, CAmount> & GetOwner() const { return current; }
+
+    //  Set if a page could not be read, the cursor stops there
+    bool Failed() const { return fFailed; }
+
+private:
+    CAssetSnapshotDB & db;
+
+    std::string baseHeightAndName;
+    int nPages = 0;
+    int nNextPage = 0;
+    std::vector<std::pair<std::string, CAmount>> vPage;
+    size_t nPagePos = 0;
+    bool fPagesDone = false;
+
+    //  Changes of all the deltas, erased as their addresses come up in the pages so the rest are the added owners
+    std::map<std::string, CAmount> mapChanges;
+    std::map<std::string, CAmount>::const_iterator itAdded;
+
+    std::pair<std::string, CAmount> current;
+    bool fValid = false;
+    bool fFailed = false;
+};
+
 class CAssetSnapshotDB  : public CDBWrapper {
 public:
     explicit CAssetSnapshotDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
@@ -64,14 +154,32 @@ public:
     bool AddAssetOwnershipSnapshot(
         const std::string & p_assetName, int p_height);
 
-    //  Read all of the entries at a specified height
+    //  Read all of the entries at a specified height. Use a CAssetSnapshotCursor to stream them instead
     bool RetrieveOwnershipSnapshot(
         const std::string & p_assetName, int p_height,
         CAssetSnapshotDBEntry & p_snapshotEntry);
 
+    //  Check whether there is a snapshot at the specified height
+    bool OwnershipSnapshotExists(
+        const std::string & p_assetName, int p_height);
+
     //  Remove the asset snapshot at the specified height
     bool RemoveOwnershipSnapshot(
         const std::string & p_assetName, int p_height);
+
+private:
+    friend class CAssetSnapshotCursor;
+
+    bool ReadSnapshotDelta(const std::string & p_assetName, int p_height, CAssetSnapshotDelta & p_snapshot);
+    bool ReadSnapshotPage(const std::string & p_heightAndName, int p_page, std::vector<std::pair<std::string, CAmount>> & p_owners);
+    bool ReadLegacySnapshot(const std::string & p_heightAndName, CAssetSnapshotDBEntry & p_snapshotEntry);
+    bool ReadSnapshotHeights(const std::string & p_assetName, std::set<int> & p_heights);
+
+    //  Erase a snapshot along with its pages
+    bool EraseSnapshot(const std::string & p_assetName, int p_height);
+
+    //  Store the snapshots based on the one at p_height as full ones, before it is replaced or removed
+    bool DetachDependentSnapshots(const std::string & p_assetName, int p_height, const std::set<int> & p_heights);
 };
 
 
@@ -5,6 +5,8 @@
 #include "assettypes.h"
 #include "hash.h"
 
+#include <stdexcept>
+
 int IntFromAssetType(AssetType type) {
     return (int)type;
 }
@@ -24,3 +26,108 @@ uint256 CAssetCacheRestrictedAddress::GetHash() {
 uint256 CAssetCacheRootQualifierChecker::GetHash() {
     return Hash(rootAssetName.begin(), rootAssetName.end(), address.begin(), address.end());
 }
+
+CStringInterner::CStringInterner(const CStringInterner& other) : mapIds(other.mapIds)
+{
+    vStrings.resize(mapIds.size());
+    for (const auto& item : mapIds)
+        vStrings[item.second] = &item.first;
+}
+
+CStringInterner& CStringInterner::operator=(const CStringInterner& other)
+{
+    if (this != &other) {
+        mapIds = other.mapIds;
+        vStrings.assign(mapIds.size(), nullptr);
+        for (const auto& item : mapIds)
+            vStrings[item.second] = &item.first;
+    }
+    return *this;
+}
+
+uint32_t CStringInterner::Intern(const std::string& str)
+{
+    auto ret = mapIds.emplace(str, (uint32_t)vStrings.size());
+    if (ret.second)
+        vStrings.push_back(&ret.first->first);
+    return ret.first->second;
+}
+
+bool CStringInterner::Find(const std::string& str, uint32_t& nId) const
+{
+    auto it = mapIds.find(str);
+    if (it == mapIds.end())
+        return false;
+    nId = it->second;
+    return true;
+}
+
+size_t CStringInterner::DynamicMemoryUsage() const
+{
+    size_t size = memusage::DynamicUsage(mapIds) + memusage::DynamicUsage(vStrings);
+    for (const auto& item : mapIds)
+        size += memusage::DynamicUsage(item.first);
+    return size;
+}
+
+bool CAssetAddressAmountMap::FindKey(const std::string& assetName, const std::string& address, uint64_t& nKey) const
+{
+    uint32_t nNameId, nAddressId;
+    if (!names.Find(assetName, nNameId) || !addresses.Find(address, nAddressId))
+        return false;
+    nKey = ((uint64_t)nNameId << 32) | nAddressId;
+    return true;
+}
+
+CAmount* CAssetAddressAmountMap::Find(const std::string& assetName, const std::string& address)
+{
+    uint64_t nKey;
+    if (!FindKey(assetName, address, nKey))
+        return nullptr;
+    auto it = mapAmounts.find(nKey);
+    return it == mapAmounts.end() ? nullptr : &it->second;
+}
+
+const CAmount* CAssetAddressAmountMap::Find(const std::string& assetName, const std::string& address) const
+{
+    uint64_t nKey;
+    if (!FindKey(assetName, address, nKey))
+        return nullptr;
+    auto it = mapAmounts.find(nKey);
+    return it == mapAmounts.end() ? nullptr : &it->second;
+}
+
+CAmount& CAssetAddressAmountMap::Get(const std::string& assetName, const std::string& address)
+{
+    uint64_t nKey = ((uint64_t)names.Intern(assetName) << 32) | addresses.Intern(address);
+    return mapAmounts[nKey];
+}
+
+CAmount& CAssetAddressAmountMap::at(const key_type& key)
+{
+    CAmount* pAmount = Find(key.first, key.second);
+    if (!pAmount)
+        throw std::out_of_range("CAssetAddressAmountMap::at");
+    return *pAmount;
+}
+
+const CAmount& CAssetAddressAmountMap::at(const key_type& key) const
+{
+    const CAmount* pAmount = Find(key.first, key.second);
+    if (!pAmount)
+        throw std::out_of_range("CAssetAddressAmountMap::at");
+    return *pAmount;
+}
+
+bool CAssetAddressAmountMap::insert(const std::pair<key_type, CAmount>& item)
+{
+    if (Find(item.first.first, item.first.second))
+        return false;
+    Get(item.first.first, item.first.second) = item.second;
+    return true;
+}
+
+size_t CAssetAddressAmountMap::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(mapAmounts) + names.DynamicMemoryUsage() + addresses.DynamicMemoryUsage();
+}
@@ -5,18 +5,23 @@
 #ifndef RAVENCOIN_NEWASSET_H
 #define RAVENCOIN_NEWASSET_H
 
+#include <memory>
 #include <string>
 #include <sstream>
 #include <list>
+#include <map>
 #include <unordered_map>
+#include <vector>
 #include "amount.h"
 #include "script/standard.h"
 #include "primitives/transaction.h"
+#include "memusage.h"
 
 #define MAX_UNIT 8
 #define MIN_UNIT 0
 
 class CAssetsCache;
+class CVerifierProgram;
 
 enum class AssetType
 {
@@ -309,6 +314,9 @@ class CNullAssetTxVerifierString {
 public:
     std::string verifier_string;
 
+    //! Compiled form of verifier_string, not serialized. Set when the string is read through the assets cache
+    std::shared_ptr<const CVerifierProgram> program;
+
     CNullAssetTxVerifierString()
     {
         SetNull();
@@ -317,6 +325,7 @@ public:
     void SetNull()
     {
         verifier_string ="";
+        program.reset();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -351,6 +360,11 @@ struct CAssetCacheNewAsset
     {
         return asset.strName < rhs.asset.strName;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(asset.strName) + memusage::DynamicUsage(asset.strIPFSHash) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheReissueAsset
@@ -376,6 +390,10 @@ struct CAssetCacheReissueAsset
         return out < rhs.out;
     }
 
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(reissue.strName) + memusage::DynamicUsage(reissue.strIPFSHash) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheNewTransfer
@@ -395,6 +413,11 @@ struct CAssetCacheNewTransfer
     {
         return out < rhs.out;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(transfer.strName) + memusage::DynamicUsage(transfer.message) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheNewOwner
@@ -413,6 +436,11 @@ struct CAssetCacheNewOwner
 
         return assetName < rhs.assetName;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheUndoAssetAmount
@@ -427,6 +455,11 @@ struct CAssetCacheUndoAssetAmount
         this->address = address;
         this->nAmount = nAmount;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheSpendAsset
@@ -441,6 +474,11 @@ struct CAssetCacheSpendAsset
         this->address = address;
         this->nAmount = nAmount;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheQualifierAddress {
@@ -459,6 +497,10 @@ struct CAssetCacheQualifierAddress {
     }
 
     uint256 GetHash();
+
+    size_t DynamicMemoryUsage() const {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheRootQualifierChecker {
@@ -475,6 +517,10 @@ struct CAssetCacheRootQualifierChecker {
     }
 
     uint256 GetHash();
+
+    size_t DynamicMemoryUsage() const {
+        return memusage::DynamicUsage(rootAssetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheRestrictedAddress
@@ -496,6 +542,11 @@ struct CAssetCacheRestrictedAddress
     }
 
     uint256 GetHash();
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(address);
+    }
 };
 
 struct CAssetCacheRestrictedGlobal
@@ -513,6 +564,11 @@ struct CAssetCacheRestrictedGlobal
     {
         return assetName < rhs.assetName;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName);
+    }
 };
 
 struct CAssetCacheRestrictedVerifiers
@@ -532,6 +588,125 @@ struct CAssetCacheRestrictedVerifiers
     {
         return assetName < rhs.assetName;
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(assetName) + memusage::DynamicUsage(verifier);
+    }
+};
+
+/** Gives every distinct string a 32 bit id, the first string added gets 0. Ids stay the same until clear() */
+class CStringInterner
+{
+public:
+    CStringInterner() {}
+    CStringInterner(const CStringInterner& other);
+    CStringInterner& operator=(const CStringInterner& other);
+
+    //! Get the id of str, adding it if it isn't in the table
+    uint32_t Intern(const std::string& str);
+
+    //! Get the id of str without adding it
+    bool Find(const std::string& str, uint32_t& nId) const;
+
+    const std::string& Get(uint32_t nId) const
+    {
+        return *vStrings[nId];
+    }
+
+    size_t size() const
+    {
+        return vStrings.size();
+    }
+
+    void clear()
+    {
+        mapIds.clear();
+        vStrings.clear();
+    }
+
+    size_t DynamicMemoryUsage() const;
+
+private:
+    std::unordered_map<std::string, uint32_t> mapIds;
+    std::vector<const std::string*> vStrings; // Point at the keys of mapIds
+};
+
+/** Quantity of each asset held by each address. Asset names and addresses are interned, so the entries are keyed
+ *  by a pair of ids packed into 64 bits rather than by two strings. Lookups that miss don't add to the tables */
+class CAssetAddressAmountMap
+{
+public:
+    typedef std::pair<std::string, std::string> key_type; // < Asset Name, Address >
+
+    //! Null if the pair has no entry
+    CAmount* Find(const std::string& assetName, const std::string& address);
+    const CAmount* Find(const std::string& assetName, const std::string& address) const;
+
+    //! Add the pair with a quantity of 0 if it has no entry
+    CAmount& Get(const std::string& assetName, const std::string& address);
+
+    //! std::map style access
+    size_t count(const key_type& key) const
+    {
+        return Find(key.first, key.second) ? 1 : 0;
+    }
+
+    CAmount& at(const key_type& key);
+    const CAmount& at(const key_type& key) const;
+
+    CAmount& operator[](const key_type& key)
+    {
+        return Get(key.first, key.second);
+    }
+
+    //! Like std::map::insert, an existing entry is left as it is
+    bool insert(const std::pair<key_type, CAmount>& item);
+
+    //! Call fn(assetName, address, nAmount) for every entry, in no particular order
+    template<typename Callable>
+    void ForEach(Callable fn) const
+    {
+        for (const auto& item : mapAmounts)
+            fn(names.Get(item.first >> 32), addresses.Get(item.first & 0xffffffff), item.second);
+    }
+
+    size_t size() const
+    {
+        return mapAmounts.size();
+    }
+
+    bool empty() const
+    {
+        return mapAmounts.empty();
+    }
+
+    void clear()
+    {
+        mapAmounts.clear();
+        names.clear();
+        addresses.clear();
+    }
+
+    size_t DynamicMemoryUsage() const;
+
+private:
+    struct KeyHasher
+    {
+        size_t operator()(uint64_t nKey) const
+        {
+            // The ids are small consecutive numbers, mix the bits so they spread over the buckets
+            nKey ^= nKey >> 31;
+            nKey *= 0x7fb5d329728ea185ULL;
+            return nKey ^ (nKey >> 27);
+        }
+    };
+
+    bool FindKey(const std::string& assetName, const std::string& address, uint64_t& nKey) const;
+
+    CStringInterner names;
+    CStringInterner addresses;
+    std::unordered_map<uint64_t, CAmount, KeyHasher> mapAmounts;
 };
 
 // Least Recently Used Cache
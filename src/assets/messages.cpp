@@ -10,6 +10,12 @@
 #include "messages.h"
 #include "myassetsdb.h"
 #include <primitives/block.h>
+#include <init.h>
+#include <util.h>
+
+#include <atomic>
+
+#include <boost/thread/thread.hpp>
 
 
 std::set<COutPoint> setDirtyMessagesRemove;
@@ -186,77 +192,187 @@ void OrphanMessage(const CMessage& message)
     mapDirtyMessagesAdd.erase(message.out);
 }
 
+std::atomic<bool> fMessageChannelScanRunning(false);
+std::atomic<int> nMessageChannelScanStartHeight(0);
+std::atomic<int> nMessageChannelScanEndHeight(-1);
+std::atomic<int> nMessageChannelScanBlocksDone(0);
+
+CMessageChannelScanProgress GetMessageChannelScanProgress()
+{
+    CMessageChannelScanProgress progress;
+    progress.fRunning = fMessageChannelScanRunning;
+    progress.nStartHeight = nMessageChannelScanStartHeight;
+    progress.nEndHeight = nMessageChannelScanEndHeight;
+    progress.nBlocksDone = nMessageChannelScanBlocksDone;
+    return progress;
+}
+
 #ifdef ENABLE_WALLET
-bool ScanForMessageChannels(std::string& strError)
+/** An asset output of the wallet found while scanning for message channels */
+struct CMessageChannelScanEntry
+{
+    txnouttype txType;
+    AssetType assetType;
+    bool fOwner;
+    std::string assetName;
+    std::string address;
+};
+
+/** Find the wallet's asset outputs in a block, this doesn't touch any of the message channel state */
+static void ScanBlockForMessageChannels(const CWallet* pwallet, const CBlock& block, std::vector<CMessageChannelScanEntry>& vEntries)
 {
-    LOCK2(cs_messaging, cs_main);
+    for (const auto& tx : block.vtx) {
+        for (size_t n = 0; n < tx->vout.size(); n++) {
+            const CTxOut& out = tx->vout[n];
+            // Only asset outputs can subscribe to a channel, so check that before looking in the wallet
+            const CTxOutAssetInfo* info = tx->GetAssetOutInfo(n);
+            if (!info)
+                continue;
+
+            if (pwallet->IsMine(out) != ISMINE_SPENDABLE) // Is the out mine
+                continue;
+
+            CAssetOutputEntry assetData;
+            // Get the asset data from the script
+            if (!GetAssetData(*tx, n, assetData)) {
+                LogPrintf("%s : Failed to get GetAssetData call\n", __func__);
+                continue;
+            }
 
+            CMessageChannelScanEntry entry;
+            entry.txType = assetData.type;
+            IsAssetNameValid(assetData.assetName, entry.assetType);
+            entry.fOwner = info->fIsOwner;
+            entry.assetName = assetData.assetName;
+            entry.address = EncodeDestination(assetData.destination);
+            vEntries.push_back(std::move(entry));
+        }
+    }
+}
+
+/** Subscribe to the channels of an asset output found by the scan, must be called in chain order */
+static void AddMessageChannelScanEntry(const CMessageChannelScanEntry& entry)
+{
+    if (entry.txType == TX_TRANSFER_ASSET) {
+        if (entry.assetType == AssetType::MSGCHANNEL || entry.assetType == AssetType::OWNER) { // Subscribe to any channels or owner tokens you own
+            AddChannel(entry.assetName);
+            AddAddressSeen(entry.address);
+        } else if (entry.assetType == AssetType::ROOT || entry.assetType == AssetType::SUB) { // Subscribe to any assets you are sent, if they are sent to a new address
+            if (!IsChannelSubscribed(entry.assetName + OWNER_TAG)) {
+                if (!IsAddressSeen(entry.address)) {
+                    AddChannel(entry.assetName + OWNER_TAG);
+                    AddAddressSeen(entry.address);
+                }
+            }
+        }
+    } else if (entry.txType == TX_NEW_ASSET || entry.txType == TX_REISSUE_ASSET) {
+        if (entry.fOwner || entry.assetType == AssetType::MSGCHANNEL) {
+            AddChannel(entry.assetName);
+            AddAddressSeen(entry.address);
+        } else if (entry.assetType == AssetType::ROOT || entry.assetType == AssetType::SUB || entry.assetType == AssetType::RESTRICTED) {
+            AddChannel(entry.assetName + "!");
+            AddAddressSeen(entry.address);
+        }
+    }
+}
+
+bool ScanForMessageChannels(std::string& strError)
+{
     LogPrintf("%s : Start Scanning For Message Channels\n", __func__);
 
     if (vpwallets.size() == 0) {
         strError = "Wallet isn't active on this client. Can't scan for MsgChannels";
         return false;
     }
+    const CWallet* pwallet = vpwallets[0];
+    const Consensus::Params& consensusParams = GetParams().GetConsensus();
+
+    // Blocks connected after this are subscribed to while they are connected
+    int nHeight = GetParams().GetAssetActivationHeight();
+    int nEndHeight;
+    {
+        LOCK(cs_main);
+        nEndHeight = chainActive.Height();
+    }
+
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_MESSAGE_CHANNEL_SCAN_THREADS));
+    nMessageChannelScanStartHeight = nHeight;
+    nMessageChannelScanEndHeight = nEndHeight;
+    nMessageChannelScanBlocksDone = 0;
+    fMessageChannelScanRunning = true;
+
+    bool fSuccess = true;
+    while (fSuccess && nHeight <= nEndHeight) {
+        // Look up where the next batch of blocks is stored, this is the only part that needs cs_main
+        std::vector<std::pair<CDiskBlockPos, uint256>> vBlocks;
+        {
+            LOCK(cs_main);
+            for (; nHeight <= nEndHeight && vBlocks.size() < MESSAGE_CHANNEL_SCAN_BATCH_SIZE; nHeight++) {
+                CBlockIndex* blockIndex = chainActive[nHeight];
+                if (!blockIndex) { // The chain got shorter since the scan started
+                    nEndHeight = nHeight - 1;
+                    break;
+                }
+                if (!(blockIndex->nStatus & BLOCK_HAVE_DATA)) {
+                    strError = "Block not found on disk";
+                    fSuccess = false;
+                    break;
+                }
+                vBlocks.emplace_back(blockIndex->GetBlockPos(), blockIndex->GetBlockHash());
+            }
+        }
+        if (!fSuccess)
+            break;
+
+        // Read and scan the blocks on the worker threads, each one keeps the entries of its blocks apart
+        std::vector<std::vector<CMessageChannelScanEntry>> vEntries(vBlocks.size());
+        std::atomic<size_t> nNext(0);
+        std::atomic<bool> fReadFailed(false);
+        auto scanBlocks = [&]() {
+            size_t i;
+            while (!fReadFailed && (i = nNext++) < vBlocks.size()) {
+                CBlock block;
+                if (!ReadBlockFromDisk(block, vBlocks[i].first, consensusParams) || block.GetHash() != vBlocks[i].second) {
+                    fReadFailed = true;
+                    return;
+                }
+                ScanBlockForMessageChannels(pwallet, block, vEntries[i]);
+            }
+        };
 
-    CBlockIndex* blockIndex = chainActive[GetParams().GetAssetActivationHeight()];
+        boost::thread_group threads;
+        for (int n = 1; n < nThreads; n++)
+            threads.create_thread(scanBlocks);
+        scanBlocks();
+        threads.join_all();
 
-    while (blockIndex) {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, blockIndex, GetParams().GetConsensus())) {
+        if (fReadFailed) {
             strError = "Block not found on disk";
-            return false;
+            fSuccess = false;
+            break;
         }
 
-        for (const auto& tx : block.vtx) {
-
-            auto ptx = tx.get();
-            if (!ptx) {
-                strError = "Failed to get transaction pointer";
-                return false;
+        // Merge in chain order, whether an asset subscribes depends on the outputs before it
+        {
+            LOCK(cs_messaging);
+            for (const auto& vBlockEntries : vEntries) {
+                for (const auto& entry : vBlockEntries)
+                    AddMessageChannelScanEntry(entry);
             }
+        }
+        nMessageChannelScanBlocksDone += vBlocks.size();
 
-            for (auto out : ptx->vout) {
-                int nType = -1;
-                bool fOwner = false;
-                if (vpwallets[0]->IsMine(out) == ISMINE_SPENDABLE) { // Is the out mine
-                    if (out.scriptPubKey.IsAssetScript(nType, fOwner)) {
-                        CAssetOutputEntry assetData;
-                        // Get the asset data from the script
-                        if (GetAssetData(out.scriptPubKey, assetData)) {
-                            AssetType type;
-                            IsAssetNameValid(assetData.assetName, type);
-
-                            if (assetData.type == TX_TRANSFER_ASSET) {
-                                if (type == AssetType::MSGCHANNEL || type == AssetType::OWNER) { // Subscribe to any channels or owner tokens you own
-                                    AddChannel(assetData.assetName);
-                                    AddAddressSeen(EncodeDestination(assetData.destination));
-                                } else if (type == AssetType::ROOT || type == AssetType::SUB) { // Subscribe to any assets you are sent, if they are sent to a new address
-                                    if (!IsChannelSubscribed(assetData.assetName + OWNER_TAG)) {
-                                        if (!IsAddressSeen(EncodeDestination(assetData.destination))) {
-                                            AddChannel(assetData.assetName + OWNER_TAG);
-                                            AddAddressSeen(EncodeDestination(assetData.destination));
-                                        }
-                                    }
-                                }
-                            } else if (assetData.type == TX_NEW_ASSET || assetData.type == TX_REISSUE_ASSET) {
-                                if (fOwner || type == AssetType::MSGCHANNEL) {
-                                    AddChannel(assetData.assetName);
-                                    AddAddressSeen(EncodeDestination(assetData.destination));
-                                } else if (type == AssetType::ROOT || type == AssetType::SUB || type == AssetType::RESTRICTED) {
-                                    AddChannel(assetData.assetName + "!");
-                                    AddAddressSeen(EncodeDestination(assetData.destination));
-                                }
-                            }
-                        } else {
-                            LogPrintf("%s : Failed to get GetAssetData call\n", __func__);
-                        }
-                    }
-                }
-            }
+        if (ShutdownRequested()) {
+            strError = "Shutdown requested";
+            fSuccess = false;
         }
-        blockIndex = chainActive[blockIndex->nHeight + 1];
     }
 
+    fMessageChannelScanRunning = false;
+    if (!fSuccess)
+        return false;
+
+    LOCK(cs_messaging);
     LogPrintf("%s : Finished Scanning For Message Channels. Subscribed Messages Channels Found: %u\n", __func__, setDirtyChannelsAdd.size());
     for (auto item : setDirtyChannelsAdd) {
         LogPrintf("%s, ",item);
@@ -8,6 +8,7 @@
 
 #include <uint256.h>
 #include <serialize.h>
+#include <sync.h>
 
 class CMessage;
 class COutPoint;
@@ -46,6 +47,22 @@ void RemoveMessage(const COutPoint &out);
 void OrphanMessage(const CMessage &message);
 void OrphanMessage(const COutPoint &out);
 
+/** Blocks read and scanned at once by ScanForMessageChannels */
+static const unsigned int MESSAGE_CHANNEL_SCAN_BATCH_SIZE = 1000;
+/** Most threads ScanForMessageChannels reads blocks with */
+static const int MAX_MESSAGE_CHANNEL_SCAN_THREADS = 8;
+
+struct CMessageChannelScanProgress
+{
+    bool fRunning;
+    int nStartHeight;
+    int nEndHeight;
+    int nBlocksDone;
+};
+
+/** Progress of the last (or current) ScanForMessageChannels run */
+CMessageChannelScanProgress GetMessageChannelScanProgress();
+
 #ifdef ENABLE_WALLET
 bool ScanForMessageChannels(std::string& strError);
 #endif
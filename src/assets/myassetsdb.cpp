@@ -6,9 +6,10 @@
 #include "messages.h"
 #include <boost/thread.hpp>
 
-#include <boost/thread.hpp>
+#include <limits>
 
 static const char MESSAGE_FLAG = 'Z'; // Message
+static const char MESSAGE_INDEX_FLAG = 'I'; // Message index by channel and time
 static const char MY_MESSAGE_CHANNEL = 'C'; // My followed Channels
 static const char MY_SEEN_ADDRESSES = 'S'; // Addresses that have been seen on the chain
 static const char DB_FLAG = 'D'; // Database Flags
@@ -16,12 +17,61 @@ static const char DB_FLAG = 'D'; // Database Flags
 static const char MY_TAGGED_ADDRESSES = 'T'; // Addresses that have been tagged
 static const char MY_RESTRICTED_ADDRESSES = 'R'; // Addresses that have been restricted
 
+static const size_t MAX_MESSAGE_BATCH_SIZE = 16 << 20;
+
+namespace {
+
+/** Key of the message index. The time is written big endian, so LevelDB keeps the messages of a channel in time order */
+struct CMessageIndexKey
+{
+    std::string strName;
+    int64_t time;
+    COutPoint out;
+
+    CMessageIndexKey() : time(0) {}
+    CMessageIndexKey(const std::string& strName, int64_t time, const COutPoint& out) : strName(strName), time(time), out(out) {}
+    explicit CMessageIndexKey(const CMessage& message) : strName(message.strName), time(message.time), out(message.out) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << strName;
+        uint64_t nTime = time < 0 ? 0 : time;
+        ser_writedata32be(s, nTime >> 32);
+        ser_writedata32be(s, nTime & 0xffffffff);
+        s << out;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> strName;
+        uint64_t nTime = uint64_t(ser_readdata32be(s)) << 32;
+        nTime |= ser_readdata32be(s);
+        time = nTime;
+        s >> out;
+    }
+};
+
+/** Index key as LevelDB orders it, for merging in the messages that are only in the dirty caches */
+std::string MessageIndexKeyBytes(const CMessageIndexKey& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return ss.str();
+}
+
+} // namespace
+
 CMessageDB::CMessageDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "messages" / "messages", nCacheSize, fMemory, fWipe) {
 }
 
 bool CMessageDB::WriteMessage(const CMessage &message)
 {
-    return Write(std::make_pair(MESSAGE_FLAG, message.out), message);
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(MESSAGE_FLAG, message.out), message);
+    batch.Write(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(message)), '1');
+    return WriteBatch(batch);
 }
 
 bool CMessageDB::ReadMessage(const COutPoint &out, CMessage &message)
@@ -31,78 +81,209 @@ bool CMessageDB::ReadMessage(const COutPoint &out, CMessage &message)
 
 bool CMessageDB::EraseMessage(const COutPoint &out)
 {
-    return Erase(std::make_pair(MESSAGE_FLAG, out));
+    CMessage message;
+    if (!ReadMessage(out, message))
+        return Erase(std::make_pair(MESSAGE_FLAG, out));
+
+    CDBBatch batch(*this);
+    batch.Erase(std::make_pair(MESSAGE_FLAG, out));
+    batch.Erase(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(message)));
+    return WriteBatch(batch);
 }
 
-bool CMessageDB::LoadMessages(std::set<CMessage>& setMessages)
+bool CMessageDB::LoadMessages(const std::string& strChannel, int64_t nFromTime, int64_t nToTime, int nSkip, int nCount, std::vector<CMessage>& vMessages)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    vMessages.clear();
+    if (nCount == 0 || nFromTime > nToTime)
+        return true;
+
+    LOCK(cs_messaging);
+
+    // The messages added, orphaned or removed since the last flush take the place of their database entries. The
+    // ones in range are merged in by index key, so the order and the paging are the same as after a flush
+    std::map<std::string, CMessage> mapDirty;
+    for (const auto& item : mapDirtyMessagesAdd) {
+        const CMessage& message = item.second;
+        if ((strChannel.empty() || message.strName == strChannel) && message.time >= nFromTime && message.time <= nToTime)
+            mapDirty.emplace(MessageIndexKeyBytes(CMessageIndexKey(message)), message);
+    }
+    for (const auto& item : mapDirtyMessagesOrphaned) {
+        CMessage message = item.second;
+        message.status = MessageStatus::ORPHAN;
+        if ((strChannel.empty() || message.strName == strChannel) && message.time >= nFromTime && message.time <= nToTime)
+            mapDirty.emplace(MessageIndexKeyBytes(CMessageIndexKey(message)), message);
+    }
 
-    pcursor->Seek(std::make_pair(MESSAGE_FLAG, COutPoint()));
+    auto fnIsDirty = [](const COutPoint& out) {
+        return setDirtyMessagesRemove.count(out) || mapDirtyMessagesAdd.count(out) || mapDirtyMessagesOrphaned.count(out);
+    };
+
+    // Returns true once nCount messages were taken
+    auto fnTake = [&](const CMessage& message) {
+        if (nSkip > 0) {
+            nSkip--;
+            return false;
+        }
+        vMessages.push_back(message);
+        return nCount > 0 && (int)vMessages.size() == nCount;
+    };
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(strChannel, nFromTime, COutPoint())));
 
-    // Load messages
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char, COutPoint> key;
-        if (pcursor->GetKey(key) && key.first == MESSAGE_FLAG) {
-            CMessage message;
-            if (pcursor->GetValue(message)) {
-                setMessages.insert(message);
+        std::pair<char, CMessageIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != MESSAGE_INDEX_FLAG)
+            break;
+
+        const CMessageIndexKey& index = key.second;
+        if (index.strName != strChannel) {
+            if (!strChannel.empty())
+                break;
+            // Another channel, skip to the start of the time range in it
+            if (index.time < nFromTime) {
+                pcursor->Seek(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(index.strName, nFromTime, COutPoint())));
+                continue;
+            }
+        }
+
+        if (index.time > nToTime) {
+            if (!strChannel.empty())
+                break;
+            // Past the time range of this channel, skip to the next one
+            pcursor->Seek(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(index.strName, std::numeric_limits<int64_t>::max(), COutPoint())));
+            while (pcursor->Valid() && pcursor->GetKey(key) && key.first == MESSAGE_INDEX_FLAG && key.second.strName == index.strName)
                 pcursor->Next();
+            continue;
+        }
+
+        if (!fnIsDirty(index.out)) {
+            // The dirty messages ordered before this one come first
+            auto itEnd = mapDirty.lower_bound(MessageIndexKeyBytes(index));
+            for (auto it = mapDirty.begin(); it != itEnd; it = mapDirty.erase(it)) {
+                if (fnTake(it->second))
+                    return true;
+            }
+
+            if (nSkip > 0) {
+                nSkip--;
             } else {
-                LogPrintf("%s: failed to read message\n", __func__);
-                pcursor->Next();
+                CMessage message;
+                if (ReadMessage(index.out, message)) {
+                    if (fnTake(message))
+                        return true;
+                } else {
+                    LogPrintf("%s: failed to read indexed message %s\n", __func__, index.out.ToString());
+                }
             }
-        } else {
-            break;
         }
+        pcursor->Next();
     }
+
+    for (const auto& item : mapDirty) {
+        if (fnTake(item.second))
+            break;
+    }
+
     return true;
 }
 
-bool CMessageDB::EraseAllMessages(int& count)
+bool CMessageDB::BuildMessageIndex()
 {
-    std::set<CMessage> setMessages;
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    bool fBuilt = false;
+    if (ReadFlag("messageindex", fBuilt) && fBuilt)
+        return true;
 
+    LogPrintf("%s: Indexing the messages by channel and time...\n", __func__);
+
+    CDBBatch batch(*this);
+    size_t nMessages = 0;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
     pcursor->Seek(std::make_pair(MESSAGE_FLAG, COutPoint()));
 
-    // Load messages
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, COutPoint> key;
-        if (pcursor->GetKey(key) && key.first == MESSAGE_FLAG) {
-            CMessage message;
-            if (pcursor->GetValue(message)) {
-                setMessages.insert(message);
-                pcursor->Next();
-            } else {
-                LogPrintf("%s: failed to read message\n", __func__);
-                pcursor->Next();
-            }
-        } else {
+        if (!pcursor->GetKey(key) || key.first != MESSAGE_FLAG)
             break;
+
+        CMessage message;
+        if (pcursor->GetValue(message)) {
+            batch.Write(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(message)), '1');
+            nMessages++;
+        } else {
+            LogPrintf("%s: failed to read message\n", __func__);
+        }
+
+        if (batch.SizeEstimate() > MAX_MESSAGE_BATCH_SIZE) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write the message index", __func__);
+            batch.Clear();
         }
+        pcursor->Next();
     }
 
-    count += setMessages.size();
-    for (auto message : setMessages)
-        EraseMessage(message.out);
+    batch.Write(std::make_pair(DB_FLAG, std::string("messageindex")), '1');
 
-    return true;
+    LogPrintf("%s: Indexed %u messages\n", __func__, nMessages);
+    return WriteBatch(batch);
+}
+
+bool CMessageDB::EraseAllMessages(int& count)
+{
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    // The messages and their index entries sit in two key ranges
+    for (char flag : {MESSAGE_FLAG, MESSAGE_INDEX_FLAG}) {
+        pcursor->Seek(flag);
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, COutPoint> key;
+            if (flag == MESSAGE_FLAG) {
+                if (!pcursor->GetKey(key) || key.first != MESSAGE_FLAG)
+                    break;
+                batch.Erase(key);
+                count++;
+            } else {
+                std::pair<char, CMessageIndexKey> indexKey;
+                if (!pcursor->GetKey(indexKey) || indexKey.first != MESSAGE_INDEX_FLAG)
+                    break;
+                batch.Erase(indexKey);
+            }
+
+            if (batch.SizeEstimate() > MAX_MESSAGE_BATCH_SIZE) {
+                if (!WriteBatch(batch))
+                    return error("%s: failed to erase messages", __func__);
+                batch.Clear();
+            }
+            pcursor->Next();
+        }
+    }
+
+    return WriteBatch(batch);
 }
 
 bool CMessageDB::Flush() {
     try {
+        CDBBatch batch(*this);
 
         for (auto messageRemove : setDirtyMessagesRemove) {
-            if (!EraseMessage(messageRemove))
-                return error("%s: failed to erase message %s", __func__, messageRemove.ToString());
+            CMessage message;
+            if (ReadMessage(messageRemove, message))
+                batch.Erase(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(message)));
+            batch.Erase(std::make_pair(MESSAGE_FLAG, messageRemove));
+            if (pMessagesCache)
+                pMessagesCache->Erase(messageRemove.ToSerializedString());
         }
 
         for (auto messageAdd : mapDirtyMessagesAdd) {
-            if (!WriteMessage(messageAdd.second))
-                return error("%s: failed to write message %s", __func__, messageAdd.second.ToString());
+            batch.Write(std::make_pair(MESSAGE_FLAG, messageAdd.first), messageAdd.second);
+            batch.Write(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(messageAdd.second)), '1');
+            // Keep the recent messages at hand for GetMessage
+            if (pMessagesCache)
+                pMessagesCache->Put(messageAdd.first.ToSerializedString(), messageAdd.second);
 
             mapDirtyMessagesOrphaned.erase(messageAdd.first);
         }
@@ -110,10 +291,15 @@ bool CMessageDB::Flush() {
         for (auto orphans : mapDirtyMessagesOrphaned) {
             CMessage msg = orphans.second;
             msg.status = MessageStatus::ORPHAN;
-            if (!WriteMessage(msg))
-                return error("%s: failed to write message orphan %s", __func__, msg.ToString());
+            batch.Write(std::make_pair(MESSAGE_FLAG, msg.out), msg);
+            batch.Write(std::make_pair(MESSAGE_INDEX_FLAG, CMessageIndexKey(msg)), '1');
+            if (pMessagesCache)
+                pMessagesCache->Put(msg.out.ToSerializedString(), msg);
         }
 
+        if (!WriteBatch(batch))
+            return error("%s: failed to write messages", __func__);
+
         setDirtyMessagesRemove.clear();
         mapDirtyMessagesAdd.clear();
         mapDirtyMessagesOrphaned.clear();
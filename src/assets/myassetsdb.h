@@ -7,6 +7,9 @@
 
 #include <dbwrapper.h>
 
+#include <string>
+#include <vector>
+
 class CMessage;
 class COutPoint;
 
@@ -18,13 +21,20 @@ public:
     CMessageDB(const CMessageDB&) = delete;
     CMessageDB& operator=(const CMessageDB&) = delete;
 
-    // Database of messages
+    // Database of messages, with an index ordered by channel, then time
     bool WriteMessage(const CMessage& message);
     bool ReadMessage(const COutPoint& out, CMessage& message);
     bool EraseMessage(const COutPoint& out);
-    bool LoadMessages(std::set<CMessage>& setMessages);
     bool EraseAllMessages(int& count);
 
+    // Messages of a channel (of all channels if strChannel is empty) with nFromTime <= time <= nToTime, in channel
+    // and time order. The first nSkip are left out, and at most nCount are returned unless nCount is negative
+    // The changes still in the dirty message caches are included, so no flush is needed first (takes cs_messaging)
+    bool LoadMessages(const std::string& strChannel, int64_t nFromTime, int64_t nToTime, int nSkip, int nCount, std::vector<CMessage>& vMessages);
+
+    // Index the messages written before the index existed, only does something the first time
+    bool BuildMessageIndex();
+
     // Write / Read Database flags
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
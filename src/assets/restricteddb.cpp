@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "restricteddb.h"
+#include "utxosnapshot.h"
 #include "validation.h"
 
 #include <boost/thread.hpp>
@@ -14,6 +15,9 @@ static const char QULAIFIER_ADDRESS_FLAG = 'Q';
 static const char RESTRICTED_ADDRESS_FLAG = 'R';
 static const char GLOBAL_RESTRICTION_FLAG = 'G';
 
+// The tables a UTXO snapshot carries, the flags stay with the node
+static const char SNAPSHOT_TABLES[] = {VERIFIER_FLAG, ADDRESS_QULAIFIER_FLAG, QULAIFIER_ADDRESS_FLAG, RESTRICTED_ADDRESS_FLAG, GLOBAL_RESTRICTION_FLAG};
+
 
 
 CRestrictedDB::CRestrictedDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets" / "restricted", nCacheSize, fMemory, fWipe) {
@@ -172,6 +176,11 @@ bool CRestrictedDB::GetAddressQualifiers(std::string& address, std::vector<std::
 {
     FlushStateToDisk();
 
+    return ReadAddressQualifiers(address, qualifiers);
+}
+
+bool CRestrictedDB::ReadAddressQualifiers(const std::string& address, std::vector<std::string>& qualifiers)
+{
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(ADDRESS_QULAIFIER_FLAG, std::make_pair(address, std::string())));
@@ -235,4 +244,24 @@ bool CRestrictedDB::GetGlobalRestrictions(std::vector<std::string>& restrictions
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+uint64_t CRestrictedDB::DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor)
+{
+    uint64_t nEntries = 0;
+    for (const char chTable : SNAPSHOT_TABLES)
+        nEntries += writer.WriteTable(cursor, chTable, SNAPSHOT_CONTENT_ASSETS);
+    return nEntries;
+}
+
+bool CRestrictedDB::LoadSnapshot(CUTXOSnapshotReader& reader, uint64_t& nEntries)
+{
+    nEntries = 0;
+    for (const char chTable : SNAPSHOT_TABLES) {
+        uint64_t nTableEntries = 0;
+        if (!reader.ReadTable(this, chTable, SNAPSHOT_CONTENT_ASSETS, nTableEntries))
+            return false;
+        nEntries += nTableEntries;
+    }
+    return true;
+}
@@ -8,6 +8,9 @@
 
 #include <dbwrapper.h>
 
+class CUTXOSnapshotReader;
+class CUTXOSnapshotWriter;
+
 class CRestrictedDB  : public CDBWrapper {
 
 public:
@@ -52,6 +55,13 @@ public:
 
     bool CheckForAddressRootQualifier(const std::string& address, const std::string& qualifier);
 
+    // Read every qualifier assigned to the address, without flushing the caches first
+    bool ReadAddressQualifiers(const std::string& address, std::vector<std::string>& qualifiers);
+
+    // Copy the verifier, qualifier and restriction tables to and from a UTXO snapshot
+    uint64_t DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor);
+    bool LoadSnapshot(CUTXOSnapshotReader& reader, uint64_t& nEntries);
+
     bool Flush();
 };
 
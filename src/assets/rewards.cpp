@@ -7,6 +7,7 @@
 #include <validation.h>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/bind/bind.hpp>
 #include <chainparams.h>
 #include <univalue/include/univalue.h>
 #include <core_io.h>
@@ -18,8 +19,17 @@
 #include "assets/rewards.h"
 #include "assetsnapshotdb.h"
 #include "wallet/wallet.h"
+#include "init.h"
+#include "scheduler.h"
 
+#include <algorithm>
+#include <atomic>
+
+//  Lock order is cs_main, then the wallet, then cs_rewardDistributions
+static CCriticalSection cs_rewardDistributions;
 std::map<uint256, CRewardSnapshot> mapRewardSnapshots;
+static CRewardDistributorStats rewardDistributorStats;
+static std::atomic<bool> fRewardDistributionsPending(false);
 
 uint256 CRewardSnapshot::GetHash() const
 {
@@ -35,20 +45,119 @@ bool AddDistributeRewardSnapshot(CRewardSnapshot& p_rewardSnapshot)
     }
 
     if (pDistributeSnapshotDb->AddDistributeSnapshot(hash, p_rewardSnapshot)) {
+        LOCK(cs_rewardDistributions);
         mapRewardSnapshots[hash] = p_rewardSnapshot;
     }
 
     return true;
 }
 
-bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vector<OwnerAndAmount>& vecDistributionList)
+void LoadDistributeRewardSnapshots()
 {
-    vecDistributionList.clear();
+    LOCK(cs_rewardDistributions);
+    mapRewardSnapshots.clear();
+    pDistributeSnapshotDb->LoadAllDistributeSnapshot(mapRewardSnapshots);
+}
 
-    if (passets == nullptr) {
-        LogPrint(BCLog::REWARDS, "%s: Invalid assets cache!\n", __func__);
-        return false;
+bool GetDistributeRewardStatus(const uint256& hash, CRewardSnapshot& p_rewardSnapshot, CRewardDistributionProgress& progress)
+{
+    {
+        LOCK(cs_rewardDistributions);
+        auto it = mapRewardSnapshots.find(hash);
+        if (it != mapRewardSnapshots.end())
+            p_rewardSnapshot = it->second;
+        else if (!pDistributeSnapshotDb->RetrieveDistributeSnapshotRequest(hash, p_rewardSnapshot))
+            return false;
+    }
+
+    if (!pDistributeSnapshotDb->ReadDistributeProgress(hash, progress))
+        progress.SetNull();
+    return true;
+}
+
+CRewardDistributorStats GetRewardDistributorStats()
+{
+    LOCK(cs_rewardDistributions);
+    return rewardDistributorStats;
+}
+
+void ScheduleRewardDistributions()
+{
+    fRewardDistributionsPending = true;
+}
+
+namespace {
+
+//  (a * b) / c rounded down for a <= c, without letting the product overflow
+uint64_t MulDiv(uint64_t a, uint64_t b, uint64_t c)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)a * b) / c);
+#else
+    //  Multiply in 32 bit halves, then divide one bit at a time. The remainder stays below c, so it never overflows
+    uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+    uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+    uint64_t loLo = aLo * bLo, hiLo = aHi * bLo, loHi = aLo * bHi, hiHi = aHi * bHi;
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffff) + (loHi & 0xffffffff);
+    uint64_t hi = hiHi + (hiLo >> 32) + (loHi >> 32) + (cross >> 32);
+    uint64_t lo = (cross << 32) | (loLo & 0xffffffff);
+
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+    for (int i = 127; i >= 0; i--) {
+        uint64_t bit = i >= 64 ? (hi >> (i - 64)) & 1 : (lo >> i) & 1;
+        remainder = (remainder << 1) | bit;
+        if (remainder >= c) {
+            remainder -= c;
+            if (i < 64)
+                quotient |= uint64_t(1) << i;
+        }
     }
+    return quotient;
+#endif
+}
+
+} // namespace
+
+CRewardCalculator::CRewardCalculator(CAmount p_nPayment, int p_nUnits, CAmount p_nTotalOwned)
+{
+    nUnitSize = 1;
+    for (int i = p_nUnits; i < MAX_UNIT; i++)
+        nUnitSize *= 10;
+
+    nPaymentUnits = p_nPayment > 0 ? p_nPayment / nUnitSize : 0;
+    nTotalOwned = p_nTotalOwned > 0 ? p_nTotalOwned : 0;
+}
+
+void CRewardCalculator::AddOwner(const std::string& address, CAmount nOwned)
+{
+    if (nOwned <= 0 || (uint64_t)nOwned > nTotalOwned)
+        return;
+
+    Share share;
+    share.address = address;
+    //  Rounded down, what is left over isn't paid out and stays with the sender
+    share.nUnits = MulDiv(nOwned, nPaymentUnits, nTotalOwned);
+    vShares.push_back(std::move(share));
+}
+
+void CRewardCalculator::GetPayments(std::vector<OwnerAndAmount>& vecPayments)
+{
+    std::sort(vShares.begin(), vShares.end(), [](const Share& a, const Share& b) {
+        return a.address < b.address;
+    });
+
+    vecPayments.reserve(vecPayments.size() + vShares.size());
+    for (const Share& share : vShares) {
+        if (share.nUnits > 0)
+            vecPayments.push_back(OwnerAndAmount(share.address, share.nUnits * nUnitSize));
+    }
+}
+
+bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vector<OwnerAndAmount>& vecDistributionList, bool fLegacyRounding)
+{
+    vecDistributionList.clear();
+
     if (pSnapshotRequestDb == nullptr) {
         LogPrint(BCLog::REWARDS, "%s: Invalid Snapshot Request cache!\n", __func__);
         return false;
@@ -58,8 +167,22 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
         return false;
     }
 
-    //  Get details on the specified source asset
+    //  Only the asset details need cs_main, the owners are read from the snapshot pages without it
     CNewAsset distributionAsset;
+    CNewAsset ownershipAsset;
+    bool fHaveDistributionAsset, fHaveOwnershipAsset;
+    {
+        LOCK(cs_main);
+        if (passets == nullptr) {
+            LogPrint(BCLog::REWARDS, "%s: Invalid assets cache!\n", __func__);
+            return false;
+        }
+        fHaveDistributionAsset = p_rewardSnapshot.strDistributionAsset == "RVN" ||
+            passets->GetAssetMetaDataIfExists(p_rewardSnapshot.strDistributionAsset, distributionAsset);
+        fHaveOwnershipAsset = passets->GetAssetMetaDataIfExists(p_rewardSnapshot.strOwnershipAsset, ownershipAsset);
+    }
+
+    //  Get details on the specified source asset
     UNUSED_VAR bool srcIsIndivisible = false;
     CAmount srcUnitDivisor = COIN;  //  Default to divisor for RVN
     const int8_t COIN_DIGITS_PAST_DECIMAL = 8;
@@ -68,7 +191,7 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
     CAmount modifiedPaymentInAssetUnits = p_rewardSnapshot.nDistributionAmount;
 
     if (p_rewardSnapshot.strDistributionAsset != "RVN") {
-        if (!passets->GetAssetMetaDataIfExists(p_rewardSnapshot.strDistributionAsset, distributionAsset)) {
+        if (!fHaveDistributionAsset) {
             LogPrint(BCLog::REWARDS, "%s: Failed to retrieve asset details for '%s'\n", __func__, p_rewardSnapshot.strDistributionAsset.c_str());
             return false;
         }
@@ -94,9 +217,8 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
              p_rewardSnapshot.strDistributionAsset.c_str(), modifiedPaymentInAssetUnits);
 
     //  Get details on the ownership asset
-    CNewAsset ownershipAsset;
     CAmount tgtUnitDivisor = 0;
-    if (!passets->GetAssetMetaDataIfExists(p_rewardSnapshot.strOwnershipAsset, ownershipAsset)) {
+    if (!fHaveOwnershipAsset) {
         LogPrint(BCLog::REWARDS, "%s: Failed to retrieve asset details for '%s'\n", __func__, p_rewardSnapshot.strOwnershipAsset.c_str());
         return false;
     }
@@ -111,29 +233,33 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
     std::set<std::string> exceptionAddressSet;
     boost::split(exceptionAddressSet, p_rewardSnapshot.strExceptionAddresses, boost::is_any_of(ADDRESS_COMMA_DELIMITER));
 
-    std::set<OwnerAndAmount> nonExceptionOwnerships;
-    CAmount totalAmtOwned = 0;
-
-    CAssetSnapshotDBEntry snapshotEntry;
-    if (!pAssetSnapshotDb->RetrieveOwnershipSnapshot(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight, snapshotEntry)) {
+    //  The owners are streamed from the snapshot twice, once for the total and once for the rewards
+    CAssetSnapshotCursor cursor(*pAssetSnapshotDb);
+    if (!cursor.Open(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight)) {
         LogPrint(BCLog::REWARDS, "%s: Failed to retrieve ownership snapshot list!\n", __func__);
         return false;
     }
 
-    for (auto const & currPair : snapshotEntry.ownersAndAmounts) {
-        //  Ignore exception and burn addresses
-        if (
-                exceptionAddressSet.find(currPair.first) == exceptionAddressSet.end()
-                && !GetParams().IsBurnAddress(currPair.first)
-                ) {
-            //  Address is valid so add it to the payment list
-            nonExceptionOwnerships.insert(OwnerAndAmount(currPair.first, currPair.second));
-            totalAmtOwned += currPair.second;
+    //  Ignore exception and burn addresses
+    auto isPayable = [&exceptionAddressSet](const std::string& address) {
+        return exceptionAddressSet.find(address) == exceptionAddressSet.end() && !GetParams().IsBurnAddress(address);
+    };
+
+    size_t nonExceptionOwnerCount = 0;
+    CAmount totalAmtOwned = 0;
+    for (; cursor.Valid(); cursor.Next()) {
+        if (isPayable(cursor.GetOwner().first)) {
+            nonExceptionOwnerCount++;
+            totalAmtOwned += cursor.GetOwner().second;
         }
     }
+    if (cursor.Failed()) {
+        LogPrint(BCLog::REWARDS, "%s: Failed to retrieve ownership snapshot list!\n", __func__);
+        return false;
+    }
 
     //  Make sure we have some addresses to pay to
-    if (nonExceptionOwnerships.size() == 0) {
+    if (nonExceptionOwnerCount == 0) {
         LogPrint(BCLog::REWARDS, "%s: Ownership of '%s' includes only exception/burn addresses.\n", __func__,
                  p_rewardSnapshot.strOwnershipAsset.c_str());
         return false;
@@ -145,9 +271,32 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
     LogPrint(BCLog::REWARDS, "%s: Total payout amount %d\n", __func__,
              modifiedPaymentInAssetUnits);
 
+    if (!fLegacyRounding) {
+        CRewardCalculator calculator(p_rewardSnapshot.nDistributionAmount, distributionAsset.units, totalAmtOwned);
+        for (cursor.Open(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight); cursor.Valid(); cursor.Next()) {
+            if (isPayable(cursor.GetOwner().first))
+                calculator.AddOwner(cursor.GetOwner().first, cursor.GetOwner().second);
+        }
+        if (cursor.Failed()) {
+            LogPrint(BCLog::REWARDS, "%s: Failed to retrieve ownership snapshot list!\n", __func__);
+            return false;
+        }
+
+        calculator.GetPayments(vecDistributionList);
+
+        LogPrint(BCLog::REWARDS, "%s: %u payments for '%s'\n", __func__,
+                 vecDistributionList.size(), p_rewardSnapshot.strOwnershipAsset.c_str());
+        return true;
+    }
+
+    //  Floating point shares, for distributions already part way through when CRewardCalculator came in
     CAmount totalSentAsRewards = 0;
     //  Loop through asset owners
-    for (auto & ownership : nonExceptionOwnerships) {
+    for (cursor.Open(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight); cursor.Valid(); cursor.Next()) {
+        if (!isPayable(cursor.GetOwner().first))
+            continue;
+        OwnerAndAmount ownership(cursor.GetOwner().first, cursor.GetOwner().second);
+
         // Get percentage of total ownership
         long double percent = (long double)ownership.amount / (long double)totalAmtOwned;
         // Caculate the reward with potentional unit inaccurancies e.g with units 4, 90054100 satoshis = 0.90054100
@@ -167,6 +316,14 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
         if (rewardAmt > 0)
             vecDistributionList.push_back(OwnerAndAmount(ownership.address, rewardAmt));
     }
+    if (cursor.Failed()) {
+        LogPrint(BCLog::REWARDS, "%s: Failed to retrieve ownership snapshot list!\n", __func__);
+        vecDistributionList.clear();
+        return false;
+    }
+
+    //  Payments are batched into transactions by position, keep them in address order
+    std::sort(vecDistributionList.begin(), vecDistributionList.end());
 
     CAmount change = totalAmtOwned - totalSentAsRewards;
     if (change > 0) {
@@ -176,8 +333,50 @@ bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vect
     return true;
 }
 
+void GetDistributionBatches(const CRewardSnapshot& p_rewardSnapshot, const std::vector<OwnerAndAmount>& p_payments, std::vector<int>& vBatchStarts)
+{
+    vBatchStarts.clear();
+
+    int nBatchPayments = 0;
+    size_t nBatchSize = 0;
+    for (int i = 0; i < (int)p_payments.size(); i++) {
+        //  Size the output the payment will get
+        CScript scriptPubKey = GetScriptForDestination(DecodeDestination(p_payments[i].address));
+        CAmount nValue = p_payments[i].amount;
+        if (p_rewardSnapshot.strDistributionAsset != "RVN") {
+            CAssetTransfer(p_rewardSnapshot.strDistributionAsset, p_payments[i].amount).ConstructTransaction(scriptPubKey);
+            nValue = 0;
+        }
+        size_t nOutputSize = ::GetSerializeSize(CTxOut(nValue, scriptPubKey), SER_NETWORK, PROTOCOL_VERSION);
+
+        if (vBatchStarts.empty() || nBatchPayments == MAX_PAYMENTS_PER_TRANSACTION || nBatchSize + nOutputSize > MAX_DISTRIBUTION_OUTPUTS_SIZE) {
+            vBatchStarts.push_back(i);
+            nBatchPayments = 0;
+            nBatchSize = 0;
+        }
+        nBatchPayments++;
+        nBatchSize += nOutputSize;
+    }
+}
+
 #ifdef ENABLE_WALLET
 
+//  Save a new status of a distribution, in memory and in the database
+static void SetDistributeRewardStatus(const uint256& hash, int nStatus)
+{
+    LOCK(cs_rewardDistributions);
+    auto it = mapRewardSnapshots.find(hash);
+    if (it == mapRewardSnapshots.end() || it->second.nStatus == nStatus)
+        return;
+    it->second.nStatus = nStatus;
+    pDistributeSnapshotDb->OverrideDistributeSnapshot(hash, it->second);
+}
+
+//  Payments of the distribution the background task worked on last. Batches go out one per run, this saves
+//  generating the whole list again for each of them
+static uint256 cachedPaymentsHash;
+static std::vector<OwnerAndAmount> vCachedPayments;
+
 void DistributeRewardSnapshot(CWallet * p_wallet, const CRewardSnapshot& p_rewardSnapshot)
 {
     if (p_wallet->IsLocked()) {
@@ -190,69 +389,141 @@ void DistributeRewardSnapshot(CWallet * p_wallet, const CRewardSnapshot& p_rewar
         return;
     }
 
-    //  Retrieve the asset snapshot entry for the target asset at the specified height
-    CAssetSnapshotDBEntry snapshotEntry;
+    //  The payments and batches are worked out without cs_main and the wallet lock, which are only taken below to check
+    //  the batches already sent and to create and commit the next one. Only this task writes the distribution progress
 
-    if (!pAssetSnapshotDb->RetrieveOwnershipSnapshot(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight, snapshotEntry)) {
+    //  Make sure there is an asset snapshot for the target asset at the specified height
+    if (!pAssetSnapshotDb->OwnershipSnapshotExists(p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.nHeight)) {
         LogPrint(BCLog::REWARDS, "Failed to retrieve ownership snapshot!\n");
         return;
     }
 
+    auto rewardSnapshotHash = p_rewardSnapshot.GetHash();
+    CRewardDistributionProgress progress;
+    if (!pDistributeSnapshotDb->ReadDistributeProgress(rewardSnapshotHash, progress))
+        progress.SetNull();
+
+    //  The batches are saved with the first transaction, so the payments of each batch stay the same until it is sent.
+    //  Distributions that got transactions out before the batches were saved keep their fixed size batches and rounding
+    std::vector<int> vBatchStarts;
+    uint256 firstTxid;
+    bool fHaveBatches = pDistributeSnapshotDb->GetDistributeBatches(rewardSnapshotHash, vBatchStarts);
+    bool fLegacy = !fHaveBatches && pDistributeSnapshotDb->GetDistributeTransaction(rewardSnapshotHash, 0, firstTxid);
+
     //  Generate payment transactions and store in the payments DB
-    std::vector<OwnerAndAmount> paymentDetails;
-    if (!GenerateDistributionList(p_rewardSnapshot, paymentDetails)) {
-        LogPrint(BCLog::REWARDS, "Failed to generate payment details!\n");
-        return;
+    if (cachedPaymentsHash != rewardSnapshotHash) {
+        cachedPaymentsHash.SetNull();
+        vCachedPayments.clear();
+        if (!GenerateDistributionList(p_rewardSnapshot, vCachedPayments, fLegacy)) {
+            LogPrint(BCLog::REWARDS, "Failed to generate payment details!\n");
+            vCachedPayments.clear();
+            return;
+        }
+        cachedPaymentsHash = rewardSnapshotHash;
     }
+    const std::vector<OwnerAndAmount>& paymentDetails = vCachedPayments;
+
+    if (!fHaveBatches) {
+        if (fLegacy) {
+            for (int start = 0; start <= (int)paymentDetails.size(); start += MAX_PAYMENTS_PER_TRANSACTION)
+                vBatchStarts.push_back(start);
+        } else {
+            GetDistributionBatches(p_rewardSnapshot, paymentDetails, vBatchStarts);
+        }
+
+        if (!pDistributeSnapshotDb->AddDistributeBatches(rewardSnapshotHash, vBatchStarts)) {
+            LogPrint(BCLog::REWARDS, "Failed to save the distribution batches!\n");
+            return;
+        }
+    }
+
+    int nNumberOfTransactions = vBatchStarts.size();
+    progress.nBatches = nNumberOfTransactions;
+    progress.nPayments = paymentDetails.size();
+
+    LOCK2(cs_main, p_wallet->cs_wallet);
+
+    //  Walk the batches from the first one that isn't known to be in a block. The ones already sent are checked,
+    //  and the first one without a transaction is built. The rest wait for the next run
+    for (int i = progress.nBatchesConfirmed; i < nNumberOfTransactions; i++) {
+        int start = vBatchStarts[i];
+        int stop = i + 1 < nNumberOfTransactions ? vBatchStarts[i + 1] : (int)paymentDetails.size();
 
-    int nNumberOfTransactions = ((int)paymentDetails.size() / MAX_PAYMENTS_PER_TRANSACTION) + 1;
-    CRewardSnapshot copyRewardSnapshot = p_rewardSnapshot;
-    for (int i = 0; i < nNumberOfTransactions; i++) {
         uint256 txid;
-        if (pDistributeSnapshotDb->GetDistributeTransaction(p_rewardSnapshot.GetHash(), i, txid)) {
-            CTransactionRef txRef;
-            uint256 hashBlock;
+        if (pDistributeSnapshotDb->GetDistributeTransaction(rewardSnapshotHash, i, txid)) {
+            if (i >= progress.nBatchesSent) {
+                progress.nBatchesSent = i + 1;
+                progress.nPaymentsSent = stop;
+            }
+
             auto walletTx = p_wallet->GetWalletTx(txid);
             if (walletTx) {
                 int depth = walletTx->GetDepthInMainChain();
                 if (depth < 0) {
                     LogPrint(BCLog::REWARDS, "Failed distribution: Tx conflict with another tx: %s: number of block back %d!\n", txid.GetHex(), depth);
-                    return;
+                    SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::STUCK_TX);
+                    break;
                 } else if (depth == 0) {
                     LogPrint(BCLog::REWARDS, "Tx is in the mempool! %s\n", txid.GetHex());
-                    return;
-                } else if (depth > 0) {
-                    LogPrint(BCLog::REWARDS, "Tx is in a block %s!\n", txid.GetHex());
                     continue;
+                } else {
+                    LogPrint(BCLog::REWARDS, "Tx is in a block %s!\n", txid.GetHex());
                 }
             } else {
                 LogPrint(BCLog::REWARDS, "Failed to get wallet Tx: %s\n", txid.GetHex());
             }
+            if (i == progress.nBatchesConfirmed)
+                progress.nBatchesConfirmed = i + 1;
         } else {
             LogPrint(BCLog::REWARDS, "Didn't find transaction in database creating new transaction: %s %s %d %d\n", p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.strDistributionAsset, p_rewardSnapshot.nDistributionAmount, i);
             // Create a new transaction and database it
-            int start = i * MAX_PAYMENTS_PER_TRANSACTION;
+            int64_t nStartTime = GetTimeMicros();
             uint256 retTxid;
             std::string change = "";
-            if (!BuildTransaction(p_wallet, p_rewardSnapshot, paymentDetails, start, change, retTxid)) {
+            if (!BuildTransaction(p_wallet, p_rewardSnapshot, paymentDetails, start, stop, change, retTxid)) {
                 LogPrint(BCLog::REWARDS, "Failed to build Tx: distribute: %s, amount: %d\n", p_rewardSnapshot.strDistributionAsset, p_rewardSnapshot.nDistributionAmount);
-                return;
+                break;
             }
-            pDistributeSnapshotDb->AddDistributeTransaction(p_rewardSnapshot.GetHash(), i, retTxid);
+            pDistributeSnapshotDb->AddDistributeTransaction(rewardSnapshotHash, i, retTxid);
+            progress.nBatchesSent = i + 1;
+            progress.nPaymentsSent = stop;
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::PROCESSING);
+
+            {
+                LOCK(cs_rewardDistributions);
+                rewardDistributorStats.nBatchesSent++;
+                rewardDistributorStats.nPaymentsSent += stop - start;
+                rewardDistributorStats.nSendTime += GetTimeMicros() - nStartTime;
+            }
+
+            //  Come back for the next batch without waiting for a block
+            if (i + 1 < nNumberOfTransactions)
+                ScheduleRewardDistributions();
+            break;
         }
     }
+
+    if (progress.nBatchesConfirmed == nNumberOfTransactions) {
+        LogPrint(BCLog::REWARDS, "Distribution complete: %s %s %d\n", p_rewardSnapshot.strOwnershipAsset, p_rewardSnapshot.strDistributionAsset, p_rewardSnapshot.nDistributionAmount);
+        SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::COMPLETE);
+        cachedPaymentsHash.SetNull();
+        vCachedPayments.clear();
+        vCachedPayments.shrink_to_fit();
+    }
+
+    if (!pDistributeSnapshotDb->WriteDistributeProgress(rewardSnapshotHash, progress))
+        LogPrint(BCLog::REWARDS, "Failed to save the distribution progress!\n");
 }
 
 bool BuildTransaction(
         CWallet * const p_walletPtr, const CRewardSnapshot& p_rewardSnapshot,
-        const std::vector<OwnerAndAmount> & p_pendingPayments,const int& start,
+        const std::vector<OwnerAndAmount> & p_pendingPayments, const int& start, const int& stop,
         std::string& change_address, uint256& retTxid)
 {
     int expectedCount = 0;
     int actualCount = 0;
     CValidationState state;
 
-    int stop = start + MAX_PAYMENTS_PER_TRANSACTION;
     CRewardSnapshot copyRewardSnapshot = p_rewardSnapshot;
     auto rewardSnapshotHash = p_rewardSnapshot.GetHash();
 
@@ -275,13 +546,13 @@ bool BuildTransaction(
         CAmount curBalance = p_walletPtr->GetBalance();
 
         if (p_walletPtr->GetBroadcastTransactions() && !g_connman) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::NETWORK_ERROR;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::NETWORK_ERROR);
             LogPrint(BCLog::REWARDS, "Error: Peer-to-peer functionality missing or disabled\n");
             return false;
         }
 
         std::vector<CRecipient> vDestinations;
+        vDestinations.reserve(stop - start);
 
         //  This should (due to external logic) only include pending payments
         for (int i = start; i < (int)p_pendingPayments.size() && i < stop; i++) {
@@ -299,8 +570,7 @@ bool BuildTransaction(
 
         //  Verify funds
         if (totalPaymentAmt > curBalance) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::LOW_FUNDS;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots[rewardSnapshotHash]);
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::LOW_FUNDS);
             LogPrint(BCLog::REWARDS, "Insufficient funds: total payment %lld > available balance %lld\n",
                      totalPaymentAmt, curBalance);
             return false;
@@ -312,13 +582,11 @@ bool BuildTransaction(
 
         if (!p_walletPtr->CreateTransaction(vDestinations, *txnPtr.get(), *reserveKeyPtr.get(), nFeeRequired, nChangePosRet, strError, ctrl)) {
             if (totalPaymentAmt + nFeeRequired > curBalance) {
-                mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::NOT_ENOUGH_FEE;
-                pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+                SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::NOT_ENOUGH_FEE);
                 strError = strprintf("Error: This transaction requires a transaction fee of at least %s",
                                      FormatMoney(nFeeRequired));
             } else {
-                mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::FAILED_CREATE_TRANSACTION;
-                pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+                SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::FAILED_CREATE_TRANSACTION);
             }
 
             LogPrint(BCLog::REWARDS, "%s\n", strError.c_str());
@@ -326,8 +594,7 @@ bool BuildTransaction(
         }
 
         if (!p_walletPtr->CommitTransaction(*txnPtr.get(), *reserveKeyPtr.get(), g_connman.get(), state)) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::FAILED_COMMIT_TRANSACTION;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::FAILED_COMMIT_TRANSACTION);
             LogPrint(BCLog::REWARDS, "%s\n", state.GetRejectReason());
             return false;
         }
@@ -335,6 +602,7 @@ bool BuildTransaction(
     else {
         std::pair<int, std::string> error;
         std::vector< std::pair<CAssetTransfer, std::string> > vDestinations;
+        vDestinations.reserve(stop - start);
         CAmount nTotalAssetAmount = 0;
 
         // Get the total amount of distribution assets this wallet has
@@ -353,8 +621,7 @@ bool BuildTransaction(
         }
 
         if (nTotalAssetAmount > totalAssetBalance) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::LOW_REWARDS;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots[rewardSnapshotHash]);
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::LOW_REWARDS);
             LogPrint(BCLog::REWARDS, "Insufficient asset funds: total payment %lld > available balance %lld\n",
                      nTotalAssetAmount, totalAssetBalance);
             return false;
@@ -362,15 +629,13 @@ bool BuildTransaction(
 
         // Create the Transaction (this also verifies dest address)
         if (!CreateTransferAssetTransaction(p_walletPtr, ctrl, vDestinations, "", error, *txnPtr.get(), *reserveKeyPtr.get(), nFeeRequired)) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::FAILED_CREATE_TRANSACTION;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::FAILED_CREATE_TRANSACTION);
             LogPrint(BCLog::REWARDS, "Failed to create transfer asset transaction: %s\n", error.second.c_str());
             return false;
         }
 
         if (!p_walletPtr->CommitTransaction(*txnPtr.get(), *reserveKeyPtr.get(), g_connman.get(), state)) {
-            mapRewardSnapshots[rewardSnapshotHash].nStatus = CRewardSnapshot::FAILED_COMMIT_TRANSACTION;
-            pDistributeSnapshotDb->OverrideDistributeSnapshot(rewardSnapshotHash, mapRewardSnapshots.at(rewardSnapshotHash));
+            SetDistributeRewardStatus(rewardSnapshotHash, CRewardSnapshot::FAILED_COMMIT_TRANSACTION);
             LogPrint(BCLog::REWARDS, "%s\n", state.GetRejectReason());
             return false;
         }
@@ -382,11 +647,55 @@ bool BuildTransaction(
     return true;
 }
 
-void CheckRewardDistributions(CWallet * p_wallet)
+void ProcessRewardDistributions()
 {
-    for (auto item : mapRewardSnapshots) {
-        DistributeRewardSnapshot(p_wallet, item.second);
+    if (!fRewardDistributionsPending.exchange(false))
+        return;
+
+    if (vpwallets.empty() || !pDistributeSnapshotDb || !pAssetSnapshotDb)
+        return;
+    CWallet * const pwallet = vpwallets[0];
+
+    //  Take a copy of the queue, so the locks are only held for one distribution at a time
+    std::vector<CRewardSnapshot> vQueue;
+    {
+        LOCK(cs_rewardDistributions);
+        for (const auto& item : mapRewardSnapshots) {
+            if (item.second.nStatus != CRewardSnapshot::COMPLETE)
+                vQueue.push_back(item.second);
+        }
+    }
+
+    int nQueueDepth = 0;
+    int64_t nPendingBatches = 0;
+    for (const CRewardSnapshot& rewardSnapshot : vQueue) {
+        if (ShutdownRequested())
+            return;
+
+        DistributeRewardSnapshot(pwallet, rewardSnapshot);
+
+        CRewardDistributionProgress progress;
+        if (!pDistributeSnapshotDb->ReadDistributeProgress(rewardSnapshot.GetHash(), progress) || progress.nBatchesConfirmed < progress.nBatches) {
+            nQueueDepth++;
+            nPendingBatches += progress.nBatches - progress.nBatchesConfirmed;
+        }
     }
+
+    LOCK(cs_rewardDistributions);
+    rewardDistributorStats.nQueueDepth = nQueueDepth;
+    rewardDistributorStats.nPendingBatches = nPendingBatches;
+    rewardDistributorStats.nLastRun = GetTime();
+}
+
+static void RewardDistributionTask(CScheduler& scheduler)
+{
+    ProcessRewardDistributions();
+    scheduler.scheduleFromNow(boost::bind(&RewardDistributionTask, boost::ref(scheduler)), REWARD_DISTRIBUTION_INTERVAL);
+}
+
+void StartRewardDistributions(CScheduler& scheduler)
+{
+    scheduler.scheduleFromNow(boost::bind(&RewardDistributionTask, boost::ref(scheduler)), REWARD_DISTRIBUTION_INTERVAL);
 }
 
 #endif //ENABLE_WALLET
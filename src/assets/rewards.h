@@ -14,10 +14,12 @@
 #include <map>
 #include <unordered_map>
 #include <list>
+#include <vector>
 
 
 class CRewardSnapshot;
 class CWallet;
+class CScheduler;
 class CRewardSnapshot;
 
 extern std::map<uint256, CRewardSnapshot> mapRewardSnapshots;
@@ -25,6 +27,10 @@ extern std::map<uint256, CRewardSnapshot> mapRewardSnapshots;
 //  Addresses are delimited by commas
 static const std::string ADDRESS_COMMA_DELIMITER = ",";
 const int MAX_PAYMENTS_PER_TRANSACTION = 1000;
+//  Bytes of payment outputs in one distribution transaction, the rest of a standard transaction is left for inputs and change
+const unsigned int MAX_DISTRIBUTION_OUTPUTS_SIZE = 50000;
+//  Milliseconds between runs of the background task that sends out distribution batches
+static const int64_t REWARD_DISTRIBUTION_INTERVAL = 1000;
 
 //  Individual payment record
 struct OwnerAndAmount
@@ -141,23 +147,119 @@ public:
     }
 };
 
+//  How far a distribution has got. It is saved after every batch, so a restart picks up at the same batch
+class CRewardDistributionProgress {
+public:
+    int nBatches;               //  Transactions the distribution is split into, 0 until its payments are generated
+    int nBatchesSent;           //  Batches that have a transaction
+    int nBatchesConfirmed;      //  Leading batches whose transaction is in a block
+    int64_t nPayments;
+    int64_t nPaymentsSent;
+
+    CRewardDistributionProgress() {
+        SetNull();
+    }
+
+    void SetNull() {
+        nBatches = 0;
+        nBatchesSent = 0;
+        nBatchesConfirmed = 0;
+        nPayments = 0;
+        nPaymentsSent = 0;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nBatches);
+        READWRITE(nBatchesSent);
+        READWRITE(nBatchesConfirmed);
+        READWRITE(nPayments);
+        READWRITE(nPaymentsSent);
+    }
+};
+
+//  Counters of the background distribution task since startup
+struct CRewardDistributorStats {
+    int nQueueDepth;            //  Distributions with batches left to send or confirm, as of the last run
+    int64_t nPendingBatches;    //  Batches of those distributions that are not in a block yet
+    int64_t nBatchesSent;
+    int64_t nPaymentsSent;
+    int64_t nSendTime;          //  Microseconds spent building and sending batches
+    int64_t nLastRun;
+
+    CRewardDistributorStats() : nQueueDepth(0), nPendingBatches(0), nBatchesSent(0), nPaymentsSent(0), nSendTime(0), nLastRun(0) {}
+};
+
+/** Splits a payment over the owners of an asset in proportion to the amounts they own, in integer arithmetic with a
+ *  128-bit intermediate product. Shares are rounded down to the units of the distribution asset, as the floating
+ *  point shares were, so what rounding leaves over stays with the sender. The same snapshot always gives the same
+ *  amounts */
+class CRewardCalculator
+{
+public:
+    //  p_nPayment is in satoshis, p_nUnits are the units of the distribution asset (MAX_UNIT for RVN)
+    CRewardCalculator(CAmount p_nPayment, int p_nUnits, CAmount p_nTotalOwned);
+
+    void AddOwner(const std::string& address, CAmount nOwned);
+
+    //  The non-zero payments, in address order
+    void GetPayments(std::vector<OwnerAndAmount>& vecPayments);
+
+private:
+    struct Share {
+        std::string address;
+        uint64_t nUnits;
+    };
+
+    CAmount nUnitSize;
+    uint64_t nPaymentUnits;
+    uint64_t nTotalOwned;
+    std::vector<Share> vShares;
+};
+
 enum {
     FAILED_GETTING_DISTRIBUTION_LIST = 1,
     FAILED_
 };
 
-bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vector<OwnerAndAmount>& vecDistributionList);
+//  fLegacyRounding reproduces the floating point shares of distributions started before CRewardCalculator
+bool GenerateDistributionList(const CRewardSnapshot& p_rewardSnapshot, std::vector<OwnerAndAmount>& vecDistributionList, bool fLegacyRounding = false);
+
+//  Split the payments into transactions of at most MAX_PAYMENTS_PER_TRANSACTION payments and MAX_DISTRIBUTION_OUTPUTS_SIZE
+//  bytes of outputs, giving the index of the first payment of each
+void GetDistributionBatches(const CRewardSnapshot& p_rewardSnapshot, const std::vector<OwnerAndAmount>& p_payments, std::vector<int>& vBatchStarts);
 bool AddDistributeRewardSnapshot(CRewardSnapshot& p_rewardSnapshot);
 
+//  Load the distributions saved in pDistributeSnapshotDb, so the ones in progress carry on
+void LoadDistributeRewardSnapshots();
+
+//  Look up a distribution and its progress
+bool GetDistributeRewardStatus(const uint256& hash, CRewardSnapshot& p_rewardSnapshot, CRewardDistributionProgress& progress);
+
+CRewardDistributorStats GetRewardDistributorStats();
+
+//  Have the next run of ProcessRewardDistributions() go through the distributions
+void ScheduleRewardDistributions();
+
 #ifdef ENABLE_WALLET
+//  Confirm the batches of the distribution that made it into a block and send out the next one
 void DistributeRewardSnapshot(CWallet * p_wallet, const CRewardSnapshot& p_rewardSnapshot);
 
 bool BuildTransaction(
         CWallet * const p_walletPtr, const CRewardSnapshot& p_rewardSnapshot,
-        const std::vector<OwnerAndAmount> & p_pendingPayments, const int& start,
+        const std::vector<OwnerAndAmount> & p_pendingPayments, const int& start, const int& stop,
         std::string& change_address, uint256& retTxid);
 
-void CheckRewardDistributions(CWallet * p_wallet);
+//  Goes through the distributions if ScheduleRewardDistributions() was called since the last run, and does nothing
+//  otherwise. The payments are read from the ownership snapshot without cs_main, which is only taken with the wallet
+//  lock to check and send the batches of one distribution at a time
+void ProcessRewardDistributions();
+
+//  Scheduler task that runs ProcessRewardDistributions() and schedules itself again REWARD_DISTRIBUTION_INTERVAL later
+void StartRewardDistributions(CScheduler& scheduler);
 #endif //ENABLE_WALLET
 
 
@@ -11,6 +11,8 @@ static const char SNAPSHOTREQUEST_FLAG = 'S';
 
 static const char DISTRIBUTEREQUEST_FLAG = 'D';
 static const char DISTRIBUTETRANSACTION_FLAG = 'T';
+static const char DISTRIBUTEBATCHES_FLAG = 'B';
+static const char DISTRIBUTEPROGRESS_FLAG = 'P';
 
 CSnapshotRequestDBEntry::CSnapshotRequestDBEntry()
 {
@@ -186,6 +188,30 @@ bool CDistributeSnapshotRequestDB::GetDistributeTransaction(const uint256& hash,
     return Read(std::make_pair(DISTRIBUTETRANSACTION_FLAG, std::make_pair(hash, nBatchNumber)), txid);
 }
 
+// Save how a distribution is split into transactions
+bool CDistributeSnapshotRequestDB::AddDistributeBatches(const uint256& hash, const std::vector<int>& vBatchStarts)
+{
+    return Write(std::make_pair(DISTRIBUTEBATCHES_FLAG, hash), vBatchStarts);
+}
+
+// Find how a distribution is split into transactions
+bool CDistributeSnapshotRequestDB::GetDistributeBatches(const uint256& hash, std::vector<int>& vBatchStarts)
+{
+    return Read(std::make_pair(DISTRIBUTEBATCHES_FLAG, hash), vBatchStarts);
+}
+
+// Save how far a distribution has got
+bool CDistributeSnapshotRequestDB::WriteDistributeProgress(const uint256& hash, const CRewardDistributionProgress& progress)
+{
+    return Write(std::make_pair(DISTRIBUTEPROGRESS_FLAG, hash), progress);
+}
+
+// Find how far a distribution has got
+bool CDistributeSnapshotRequestDB::ReadDistributeProgress(const uint256& hash, CRewardDistributionProgress& progress)
+{
+    return Read(std::make_pair(DISTRIBUTEPROGRESS_FLAG, hash), progress);
+}
+
 //  Find a distribute snapshot request
 bool CDistributeSnapshotRequestDB::RetrieveDistributeSnapshotRequest(const uint256& hash, CRewardSnapshot& p_rewardSnapshot)
 {
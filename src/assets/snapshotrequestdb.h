@@ -107,6 +107,14 @@ public:
     bool AddDistributeTransaction(const uint256& hash, const int& nBatchNumber, const uint256& txid);
     bool GetDistributeTransaction(const uint256& hash, const int& nBatchNumber, uint256& txid);
 
+    //  Index of the first payment of each transaction of a distribution
+    bool AddDistributeBatches(const uint256& hash, const std::vector<int>& vBatchStarts);
+    bool GetDistributeBatches(const uint256& hash, std::vector<int>& vBatchStarts);
+
+    //  Batches sent and confirmed so far, updated after every batch
+    bool WriteDistributeProgress(const uint256& hash, const CRewardDistributionProgress& progress);
+    bool ReadDistributeProgress(const uint256& hash, CRewardDistributionProgress& progress);
+
     void LoadAllDistributeSnapshot(std::map<uint256, CRewardSnapshot>& mapRewardSnapshots);
 
 
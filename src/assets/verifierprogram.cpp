@@ -0,0 +1,202 @@
+// Copyright (c) 2017-2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "assets/verifierprogram.h"
+#include "assets/assets.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <utility>
+
+namespace {
+
+/** Same characters as LibBoolEE::belongsToName() */
+bool BelongsToName(const char ch)
+{
+    return isalnum(ch) || ch == '_' || ch == '#' || ch == '.';
+}
+
+/** Qualifier names the way ExtractVerifierStringQualifiers() finds them */
+bool IsQualifierToken(const std::string& verifier, size_t nBegin, size_t nEnd)
+{
+    for (size_t i = nBegin; i < nEnd; i++) {
+        const char ch = verifier[i];
+        if (!((ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '.'))
+            return false;
+    }
+    return nBegin < nEnd;
+}
+
+/** LibBoolEE::singleParse() on verifier[nBegin, nEnd), returning the subexpressions as ranges */
+bool SingleParse(const std::string& verifier, size_t nBegin, size_t nEnd, const char op, std::vector<std::pair<size_t, size_t>>& vRanges)
+{
+    vRanges.clear();
+    bool fStarted = false;
+    size_t nStart = 0;
+    int nParity = 0;
+    for (size_t i = nBegin; i < nEnd; i++) {
+        const char ch = verifier[i];
+        if (ch == ')') {
+            nParity--;
+        } else if (ch == '(') {
+            nParity++;
+            if (!fStarted) {
+                fStarted = true;
+                nStart = i;
+            }
+        } else if (nParity == 0) {
+            if (!fStarted) {
+                if (BelongsToName(ch) || ch == '!') {
+                    fStarted = true;
+                    nStart = i;
+                }
+            } else if (!(BelongsToName(ch) || ch == '!')) {
+                if (ch == op) {
+                    vRanges.emplace_back(nStart, i);
+                    nStart = i + 1;
+                } else if (ch != '&' && ch != '|') {
+                    return false;
+                }
+            }
+        }
+    }
+    if (fStarted)
+        vRanges.emplace_back(nStart, nEnd);
+
+    return nParity == 0;
+}
+
+} // namespace
+
+bool CVerifierProgram::CompileRec(const std::string& verifier, size_t nBegin, size_t nEnd, std::vector<std::string>& vNames)
+{
+    if (nBegin >= nEnd)
+        return false;
+
+    uint8_t nOp = OP_OR;
+    std::vector<std::pair<size_t, size_t>> vRanges;
+    if (!SingleParse(verifier, nBegin, nEnd, '|', vRanges))
+        return false;
+    if (vRanges.size() == 1) {
+        nOp = OP_AND;
+        if (!SingleParse(verifier, nBegin, nEnd, '&', vRanges))
+            return false;
+    }
+
+    if (vRanges.empty())
+        return false;
+
+    if (vRanges.size() == 1) {
+        Instruction instruction{OP_QUALIFIER, 0};
+        if (verifier[nBegin] == '!') {
+            if (!CompileRec(verifier, nBegin + 1, nEnd, vNames))
+                return false;
+            instruction.nOp = OP_NOT;
+        } else if (verifier[nBegin] == '(') {
+            if (nEnd - nBegin < 2)
+                return false;
+            return CompileRec(verifier, nBegin + 1, nEnd - 1, vNames);
+        } else if (nEnd - nBegin == 1 && verifier[nBegin] == '1') {
+            instruction.nOp = OP_TRUE;
+        } else if (nEnd - nBegin == 1 && verifier[nBegin] == '0') {
+            instruction.nOp = OP_FALSE;
+        } else {
+            if (!IsQualifierToken(verifier, nBegin, nEnd))
+                return false;
+            std::string name = verifier.substr(nBegin, nEnd - nBegin);
+            auto it = std::find(vNames.begin(), vNames.end(), name);
+            if (it == vNames.end()) {
+                if (vNames.size() == MAX_QUALIFIERS)
+                    return false;
+                it = vNames.insert(vNames.end(), std::move(name));
+            }
+            instruction.nArg = uint8_t(it - vNames.begin());
+        }
+        if (vInstructions.size() == MAX_INSTRUCTIONS)
+            return false;
+        vInstructions.push_back(instruction);
+        return true;
+    }
+
+    if (vRanges.size() > MAX_INSTRUCTIONS)
+        return false;
+    for (const auto& range : vRanges) {
+        if (!CompileRec(verifier, range.first, range.second, vNames))
+            return false;
+    }
+    if (vInstructions.size() == MAX_INSTRUCTIONS)
+        return false;
+    vInstructions.push_back(Instruction{nOp, uint8_t(vRanges.size())});
+    return true;
+}
+
+std::shared_ptr<const CVerifierProgram> CVerifierProgram::Compile(const std::string& verifier)
+{
+    // Stripped verifier strings are at most 80 characters, longer ones are left to LibBoolEE
+    if (verifier.size() > MAX_INSTRUCTIONS)
+        return nullptr;
+
+    std::shared_ptr<CVerifierProgram> program(new CVerifierProgram());
+    std::vector<std::string> vNames;
+    if (!program->CompileRec(verifier, 0, verifier.size(), vNames))
+        return nullptr;
+
+    // Renumber the qualifiers so the ids follow the sorted names
+    std::vector<std::string> vSorted(vNames);
+    std::sort(vSorted.begin(), vSorted.end());
+    std::vector<uint8_t> vIds(vNames.size());
+    for (size_t i = 0; i < vNames.size(); i++)
+        vIds[i] = uint8_t(std::lower_bound(vSorted.begin(), vSorted.end(), vNames[i]) - vSorted.begin());
+    for (Instruction& instruction : program->vInstructions) {
+        if (instruction.nOp == OP_QUALIFIER)
+            instruction.nArg = vIds[instruction.nArg];
+    }
+
+    program->vQualifiers.reserve(vSorted.size());
+    for (const std::string& name : vSorted)
+        program->vQualifiers.emplace_back(QUALIFIER_CHAR + name);
+    program->vInstructions.shrink_to_fit();
+
+    return program;
+}
+
+bool CVerifierProgram::Evaluate(uint64_t qualifierBits) const
+{
+    // Every instruction pushes at most one value
+    bool stack[MAX_INSTRUCTIONS];
+    size_t nSize = 0;
+
+    for (const Instruction& instruction : vInstructions) {
+        switch (instruction.nOp) {
+            case OP_FALSE:
+                stack[nSize++] = false;
+                break;
+            case OP_TRUE:
+                stack[nSize++] = true;
+                break;
+            case OP_QUALIFIER:
+                stack[nSize++] = (qualifierBits >> instruction.nArg) & 1;
+                break;
+            case OP_NOT:
+                stack[nSize - 1] = !stack[nSize - 1];
+                break;
+            case OP_AND: {
+                bool fResult = true;
+                for (uint8_t i = 0; i < instruction.nArg; i++)
+                    fResult &= stack[--nSize];
+                stack[nSize++] = fResult;
+                break;
+            }
+            case OP_OR: {
+                bool fResult = false;
+                for (uint8_t i = 0; i < instruction.nArg; i++)
+                    fResult |= stack[--nSize];
+                stack[nSize++] = fResult;
+                break;
+            }
+        }
+    }
+
+    return nSize == 1 && stack[0];
+}
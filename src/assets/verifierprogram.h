@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_ASSETS_VERIFIERPROGRAM_H
+#define RAVEN_ASSETS_VERIFIERPROGRAM_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A restricted asset verifier string compiled into postfix form.
+ *
+ * The string is split up exactly the way LibBoolEE::resolve() reads it, but only once. Every qualifier it mentions
+ * gets an id, which is its position in GetQualifiers() (sorted, the same order CheckVerifierString() finds them in).
+ * Evaluating the program against the qualifiers an address holds then runs on a fixed size stack.
+ */
+class CVerifierProgram
+{
+public:
+    /** Most qualifiers a program can refer to, one bit each in the valuation passed to Evaluate() */
+    static const size_t MAX_QUALIFIERS = 64;
+    /** Most instructions a program can have */
+    static const size_t MAX_INSTRUCTIONS = 255;
+
+    /** Compile a verifier string without whitespaces or '#'. Returns nullptr if LibBoolEE would reject it or if
+     *  it goes over the limits above */
+    static std::shared_ptr<const CVerifierProgram> Compile(const std::string& verifier);
+
+    /** The qualifier asset names (with the '#') the program refers to, indexed by id */
+    const std::vector<std::string>& GetQualifiers() const { return vQualifiers; }
+
+    /** Evaluate the program, bit i of qualifierBits tells if the address has qualifier i */
+    bool Evaluate(uint64_t qualifierBits) const;
+
+    /** Evaluate the program, calling hasQualifier once for each qualifier name to build the valuation */
+    template <typename Callable>
+    bool Evaluate(Callable hasQualifier) const
+    {
+        uint64_t qualifierBits = 0;
+        for (size_t i = 0; i < vQualifiers.size(); i++) {
+            if (hasQualifier(vQualifiers[i]))
+                qualifierBits |= uint64_t(1) << i;
+        }
+        return Evaluate(qualifierBits);
+    }
+
+private:
+    enum OpCode : uint8_t {
+        OP_FALSE,
+        OP_TRUE,
+        OP_QUALIFIER,   // push the value of qualifier nArg
+        OP_NOT,         // negate the top of the stack
+        OP_AND,         // replace the top nArg values by their conjunction
+        OP_OR,          // replace the top nArg values by their disjunction
+    };
+
+    struct Instruction {
+        uint8_t nOp;
+        uint8_t nArg;
+    };
+
+    std::vector<Instruction> vInstructions;
+    std::vector<std::string> vQualifiers;
+
+    CVerifierProgram() {}
+
+    bool CompileRec(const std::string& verifier, size_t nBegin, size_t nEnd, std::vector<std::string>& vNames);
+};
+
+#endif // RAVEN_ASSETS_VERIFIERPROGRAM_H
@@ -6,6 +6,8 @@
 #include <chainparamsbase.h>
 #include <chainparams.h>
 #include "bench.h"
+#include "algo/sph_multi.h"
+#include "crypto/ethash/include/ethash/progpow.hpp"
 #include "crypto/sha256.h"
 #include "key.h"
 #include "validation.h"
@@ -16,6 +18,8 @@ int
 main(int argc, char **argv)
 {
     SHA256AutoDetect();
+    SphMultiAutoDetect();
+    progpow::autodetect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
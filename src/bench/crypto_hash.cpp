@@ -10,15 +10,27 @@
 #include "hash.h"
 #include "random.h"
 #include "uint256.h"
+#include "util.h"
 #include "utiltime.h"
+#include "validation.h"
+#include "algo/sph_multi.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
+#include "primitives/block.h"
+
+#include <boost/thread/thread.hpp>
 
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
 
+/* Number of 64 byte X16R links hashed per iteration */
+static const size_t MULTI_INPUTS = 1024;
+
+/* Number of headers in a full headers message */
+static const size_t HEADERS_BATCH_SIZE = 2000;
+
 static void RIPEMD160(benchmark::State& state)
 {
     uint8_t hash[CRIPEMD160::OUTPUT_SIZE];
@@ -93,6 +105,131 @@ static void FastRandom_1bit(benchmark::State& state)
     }
 }
 
+static std::vector<CBlockHeader> MakeX16RHeaders()
+{
+    FastRandomContext rng(true);
+    std::vector<CBlockHeader> headers(HEADERS_BATCH_SIZE);
+    for (auto& header : headers) {
+        // nTime 0 keeps every header on the X16R path
+        header.nVersion = 0x20000000;
+        header.hashPrevBlock = rng.rand256();
+        header.hashMerkleRoot = rng.rand256();
+        header.nBits = 0x1e00ffff;
+        header.nNonce = rng.rand32();
+    }
+    return headers;
+}
+
+static void X16R_Headers_Serial(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = MakeX16RHeaders();
+    std::vector<uint256> hashes(headers.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < headers.size(); i++)
+            hashes[i] = headers[i].GetHash();
+    }
+}
+
+static void X16R_Headers_Batch(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = MakeX16RHeaders();
+    std::vector<uint256> hashes;
+
+    int nOldScriptCheckThreads = nScriptCheckThreads;
+    nScriptCheckThreads = std::max(GetNumCores(), 2);
+    boost::thread_group tg;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        tg.create_thread(&ThreadHeaderHash);
+
+    while (state.KeepRunning())
+        HashBlockHeaders(headers, hashes);
+
+    tg.interrupt_all();
+    tg.join_all();
+    nScriptCheckThreads = nOldScriptCheckThreads;
+}
+
+static void SphMultiBench(benchmark::State& state, bool fKeccak, bool fMulti)
+{
+    std::vector<unsigned char> in(MULTI_INPUTS * 64, 0), out(MULTI_INPUTS * 64);
+    std::vector<const unsigned char*> vIn;
+    std::vector<unsigned char*> vOut;
+    for (size_t i = 0; i < MULTI_INPUTS; i++) {
+        vIn.push_back(&in[i * 64]);
+        vOut.push_back(&out[i * 64]);
+    }
+    while (state.KeepRunning()) {
+        if (fMulti) {
+            if (fKeccak)
+                sph_keccak512_multi(vIn.data(), 64, vOut.data(), MULTI_INPUTS);
+            else
+                sph_sha512_multi(vIn.data(), 64, vOut.data(), MULTI_INPUTS);
+            continue;
+        }
+        for (size_t i = 0; i < MULTI_INPUTS; i++) {
+            if (fKeccak) {
+                sph_keccak512_context ctx;
+                sph_keccak512_init(&ctx);
+                sph_keccak512(&ctx, vIn[i], 64);
+                sph_keccak512_close(&ctx, vOut[i]);
+            } else {
+                sph_sha512_context ctx;
+                sph_sha512_init(&ctx);
+                sph_sha512(&ctx, vIn[i], 64);
+                sph_sha512_close(&ctx, vOut[i]);
+            }
+        }
+    }
+}
+
+static void Keccak512_64b_Scalar(benchmark::State& state) { SphMultiBench(state, true, false); }
+static void Keccak512_64b_Multi(benchmark::State& state) { SphMultiBench(state, true, true); }
+static void SHA512_64b_Scalar(benchmark::State& state) { SphMultiBench(state, false, false); }
+static void SHA512_64b_Multi(benchmark::State& state) { SphMultiBench(state, false, true); }
+
+// X16R_Single and X16R_Multi hash the same inputs, one chain at a time and as one batch. Only the Keccak-512 and
+// SHA-512 steps run multi-buffer, so the difference between them is the whole gain the batch path gives.
+static void X16R_Batch(benchmark::State& state, bool fMulti)
+{
+    std::vector<CBlockHeader> headers = MakeX16RHeaders();
+    std::vector<const unsigned char*> vInputs;
+    std::vector<uint256> vPrevBlockHashes;
+    for (const auto& header : headers) {
+        vInputs.push_back((const unsigned char*)BEGIN(header.nVersion));
+        vPrevBlockHashes.push_back(header.hashPrevBlock);
+    }
+    std::vector<uint256> hashes(vInputs.size());
+    while (state.KeepRunning()) {
+        if (fMulti) {
+            HashX16RMulti(vInputs, 80, vPrevBlockHashes, false, hashes);
+            continue;
+        }
+        for (size_t i = 0; i < vInputs.size(); i++)
+            hashes[i] = HashX16R(vInputs[i], vInputs[i] + 80, vPrevBlockHashes[i]);
+    }
+}
+
+static void X16R_Single(benchmark::State& state) { X16R_Batch(state, false); }
+static void X16R_Multi(benchmark::State& state) { X16R_Batch(state, true); }
+
+static void X16R_Nonces(benchmark::State& state, bool fSchedule)
+{
+    CBlockHeader header = MakeX16RHeaders()[0];
+    uint256 hash;
+    CX16RSchedule x16r(header.hashPrevBlock, false);
+    x16r.SetPrefix(BEGIN(header.nVersion), BEGIN(header.nNonce) - BEGIN(header.nVersion));
+    while (state.KeepRunning()) {
+        ++header.nNonce;
+        if (fSchedule)
+            hash = x16r.HashSuffix(BEGIN(header.nNonce), sizeof(header.nNonce));
+        else
+            hash = header.GetX16RHash();
+    }
+}
+
+static void X16R_Nonces_Header(benchmark::State& state) { X16R_Nonces(state, false); }
+static void X16R_Nonces_Schedule(benchmark::State& state) { X16R_Nonces(state, true); }
+
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
 BENCHMARK(SHA256);
@@ -102,3 +239,14 @@ BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
+
+BENCHMARK(X16R_Headers_Serial);
+BENCHMARK(X16R_Headers_Batch);
+BENCHMARK(X16R_Single);
+BENCHMARK(X16R_Multi);
+BENCHMARK(X16R_Nonces_Header);
+BENCHMARK(X16R_Nonces_Schedule);
+BENCHMARK(Keccak512_64b_Scalar);
+BENCHMARK(Keccak512_64b_Multi);
+BENCHMARK(SHA512_64b_Scalar);
+BENCHMARK(SHA512_64b_Multi);
@@ -0,0 +1,28 @@
+// Copyright (c) 2017-2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <crypto/ethash/include/ethash/progpow.hpp>
+
+/* What a node does for every KAWPOW header: the dataset items are derived from the light cache */
+static void KAWPOW_Light(benchmark::State& state)
+{
+    static const ethash::epoch_context_ptr context = ethash::create_epoch_context(0);
+    uint64_t nonce = 0;
+    while (state.KeepRunning())
+        progpow::hash(*context, 0, {}, nonce++);
+}
+
+/* The mix loop on its own: a few nonces are cycled so their dataset items stay filled in */
+static void KAWPOW_Mix(benchmark::State& state)
+{
+    static const ethash::epoch_context_full_ptr context = ethash::create_epoch_context_full(0);
+    uint64_t nonce = 0;
+    while (state.KeepRunning())
+        progpow::hash(*context, 0, {}, nonce++ % 16);
+}
+
+BENCHMARK(KAWPOW_Light);
+BENCHMARK(KAWPOW_Mix);
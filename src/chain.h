@@ -433,7 +433,7 @@ public:
 
     }
 
-    uint256 GetBlockHash() const
+    CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
         block.nVersion        = nVersion;
@@ -446,7 +446,12 @@ public:
         block.nHeight         = nHeight;
         block.nNonce64        = nNonce64;
         block.mix_hash        = mix_hash;
-        return block.GetHash();
+        return block;
+    }
+
+    uint256 GetBlockHash() const
+    {
+        return GetBlockHeader().GetHash();
     }
 
 
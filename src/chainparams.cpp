@@ -66,6 +66,11 @@ void CChainParams::UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64
     consensus.vDeployments[d].nTimeout = nTimeout;
 }
 
+void CChainParams::UpdateAssumeutxoParameters(int nHeight, const AssumeutxoData& data)
+{
+    mapAssumeutxo[nHeight] = data;
+}
+
 void CChainParams::TurnOffSegwit() {
 	consensus.nSegwitEnabled = false;
 }
@@ -223,6 +228,9 @@ public:
             0.0         // * estimated number of transactions per second
         };
 
+        // UTXO snapshots loadtxoutset accepts, by height, with the hashes dumptxoutset reports. None yet
+        mapAssumeutxo = {};
+
         /** RVN Start **/
         // Burn Amounts
         nIssueAssetBurnAmount = 500 * COIN;
@@ -725,6 +733,11 @@ void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime,
     globalChainParams->UpdateVersionBitsParameters(d, nStartTime, nTimeout);
 }
 
+void UpdateAssumeutxoParameters(int nHeight, const AssumeutxoData& data)
+{
+    globalChainParams->UpdateAssumeutxoParameters(nHeight, data);
+}
+
 void TurnOffSegwit(){
 	globalChainParams->TurnOffSegwit();
 }
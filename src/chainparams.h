@@ -38,6 +38,21 @@ struct ChainTxData {
     double dTxRate;
 };
 
+/** The chainstate at one height a UTXO snapshot must hold to be loaded, as reported by dumptxoutset */
+struct AssumeutxoData {
+    uint256 hashBlock;
+    //! Transactions in the chain up to and including hashBlock
+    uint64_t nChainTx;
+    //! hash_serialized_2 of the coins
+    uint256 hashSerialized;
+    //! The asset and restricted asset tables
+    uint256 hashAssets;
+    //! The address quantity tables of -assetindex, null if snapshots at this height can't be loaded with it
+    uint256 hashAssetHolders;
+};
+
+typedef std::map<int, AssumeutxoData> MapAssumeutxo;
+
 /**
  * CChainParams defines various tweakable parameters of a given instance of the
  * Raven system. There are three: the main network on which people trade goods
@@ -79,7 +94,10 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
     const ChainTxData& TxData() const { return chainTxData; }
+    /** The UTXO snapshots loadtxoutset accepts, by height */
+    const MapAssumeutxo& Assumeutxo() const { return mapAssumeutxo; }
     void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
+    void UpdateAssumeutxoParameters(int nHeight, const AssumeutxoData& data);
     void TurnOffSegwit();
     void TurnOffCSV();
     void TurnOffBIP34();
@@ -163,6 +181,7 @@ protected:
     bool fMiningRequiresPeers;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    MapAssumeutxo mapAssumeutxo;
 
     /** RVN Start **/
     // Burn Amounts
@@ -228,6 +247,11 @@ void SelectParams(const std::string& chain, bool fForceBlockNetwork = false);
  */
 void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
 
+/**
+ * Allows pinning the UTXO snapshot of a height on regtest.
+ */
+void UpdateAssumeutxoParameters(int nHeight, const AssumeutxoData& data);
+
 void TurnOffSegwit();
 
 void TurnOffBIP34();
@@ -186,8 +186,9 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
     bool fContainsRestrictedAssetReissue = false;
     bool fContainsNullAssetVerifierTx = false;
     int nCountAddTagOuts = 0;
-    for (const auto& txout : tx.vout)
+    for (size_t n = 0; n < tx.vout.size(); n++)
     {
+        const CTxOut& txout = tx.vout[n];
         if (txout.nValue < 0)
             return state.DoS(100, false, REJECT_INVALID, "bad-txns-vout-negative");
         if (txout.nValue > MAX_MONEY)
@@ -254,11 +255,9 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
         /** RVN END */
 
         /** RVN START */
-        bool isAsset = false;
-        int nType;
-        bool fIsOwner;
-        if (txout.scriptPubKey.IsAssetScript(nType, fIsOwner))
-            isAsset = true;
+        const CTxOutAssetInfo* info = tx.GetAssetOutInfo(n);
+        bool isAsset = info != nullptr;
+        int nType = isAsset ? info->nType : 0;
         
         // Check for transfers that don't meet the assets units only if the assetCache is not null
         if (isAsset) {
@@ -380,8 +379,8 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-length");
 
         if (AreCoinbaseCheckAssetsDeployed()) {
-            for (auto vout : tx.vout) {
-                if (vout.scriptPubKey.IsAssetScript() || vout.scriptPubKey.IsNullAsset()) {
+            for (size_t n = 0; n < tx.vout.size(); n++) {
+                if (tx.GetAssetOutInfo(n) || tx.vout[n].scriptPubKey.IsNullAsset()) {
                     return state.DoS(0, error("%s: coinbase contains asset transaction", __func__),
                                      REJECT_INVALID, "bad-txns-coinbase-contains-asset-txes");
                 }
@@ -526,11 +525,11 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state, bool fChe
     else {
         // Fail if transaction contains any non-transfer asset scripts and hasn't conformed to one of the
         // above transaction types.  Also fail if it contains OP_RVN_ASSET opcode but wasn't a valid script.
-        for (auto out : tx.vout) {
-            int nType;
-            bool _isOwner;
-            if (out.scriptPubKey.IsAssetScript(nType, _isOwner)) {
-                if (nType != TX_TRANSFER_ASSET) {
+        for (size_t n = 0; n < tx.vout.size(); n++) {
+            const CTxOut& out = tx.vout[n];
+            const CTxOutAssetInfo* info = tx.GetAssetOutInfo(n);
+            if (info) {
+                if (info->nType != TX_TRANSFER_ASSET) {
                     return state.DoS(100, false, REJECT_INVALID, "bad-txns-bad-asset-transaction");
                 }
             } else {
@@ -652,12 +651,10 @@ bool Consensus::CheckTxAssets(const CTransaction& tx, CValidationState& state, c
     std::string strError = "";
     int i = 0;
     for (const auto& txout : tx.vout) {
+        const CTxOutAssetInfo* info = tx.GetAssetOutInfo(i);
         i++;
-        bool fIsAsset = false;
-        int nType = 0;
-        bool fIsOwner = false;
-        if (txout.scriptPubKey.IsAssetScript(nType, fIsOwner))
-            fIsAsset = true;
+        bool fIsAsset = info != nullptr;
+        int nType = fIsAsset ? info->nType : 0;
 
         if (assetCache) {
             if (fIsAsset && !AreAssetsDeployed())
@@ -826,11 +823,11 @@ bool Consensus::CheckTxAssets(const CTransaction& tx, CValidationState& state, c
                 return state.DoS(100, false, REJECT_INVALID, strError, false, "", tx.GetHash());
 
         } else {
-            for (auto out : tx.vout) {
-                int nType;
-                bool _isOwner;
-                if (out.scriptPubKey.IsAssetScript(nType, _isOwner)) {
-                    if (nType != TX_TRANSFER_ASSET) {
+            for (size_t n = 0; n < tx.vout.size(); n++) {
+                const CTxOut& out = tx.vout[n];
+                const CTxOutAssetInfo* info = tx.GetAssetOutInfo(n);
+                if (info) {
+                    if (info->nType != TX_TRANSFER_ASSET) {
                         return state.DoS(100, false, REJECT_INVALID, "bad-txns-bad-asset-transaction", false, "", tx.GetHash());
                     }
                 } else {
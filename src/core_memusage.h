@@ -38,6 +38,12 @@ static inline size_t RecursiveDynamicUsage(const CTransaction& tx) {
     for (std::vector<CTxOut>::const_iterator it = tx.vout.begin(); it != tx.vout.end(); it++) {
         mem += RecursiveDynamicUsage(*it);
     }
+    /** RVN START */
+    mem += memusage::DynamicUsage(tx.GetAssetOutInfo());
+    for (const auto& info : tx.GetAssetOutInfo()) {
+        mem += memusage::DynamicUsage(info.strName);
+    }
+    /** RVN END */
     return mem;
 }
 
@@ -114,6 +114,24 @@ const struct ethash_epoch_context* ethash_get_global_epoch_context(int epoch_num
 const struct ethash_epoch_context_full* ethash_get_global_epoch_context_full(
     int epoch_number) NOEXCEPT;
 
+/**
+ * Set the directory where the global epoch contexts keep their light caches.
+ *
+ * When set, a light cache is mapped from its file instead of being generated,
+ * and a newly generated one is written there for the next start. An empty or
+ * null directory disables the files.
+ */
+void ethash_set_light_cache_dir(const char* dir) NOEXCEPT;
+
+/**
+ * Build, or load, the global epoch context ahead of time.
+ *
+ * The context is held aside and handed over the first time the epoch is asked
+ * for by ethash_get_global_epoch_context(), so a caller on a background thread
+ * can move the cost out of block validation at an epoch switch.
+ */
+void ethash_prepare_global_epoch_context(int epoch_number) NOEXCEPT;
+
 
 struct ethash_result ethash_hash(const struct ethash_epoch_context* context,
     const union ethash_hash256* header_hash, uint64_t nonce) NOEXCEPT;
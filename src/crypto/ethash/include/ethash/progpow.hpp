@@ -10,6 +10,8 @@
 
 #include <crypto/ethash/include/ethash/ethash.hpp>
 
+#include <string>
+
 namespace progpow
 {
 using namespace ethash;  // Include ethash namespace.
@@ -38,6 +40,10 @@ bool verify(const epoch_context& context, int block_number, const hash256& heade
 hash256 hash_no_verify(const int& block_number, const hash256& header_hash,
     const hash256& mix_hash, const uint64_t& nonce) noexcept;
 
+/// Select the fastest mix kernel supported by the CPU and return its name.
+/// Call it once at startup, before any hashing threads are running.
+std::string autodetect();
+
 search_result search_light(const epoch_context& context, int block_number,
     const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
     size_t iterations) noexcept;
@@ -8,6 +8,10 @@
 
 #pragma once
 
+#if defined(HAVE_CONFIG_H)
+#include "config/raven-config.h"
+#endif
+
 #include <crypto/ethash/include/ethash/ethash.hpp>
 
 #include "endianness.hpp"
@@ -15,6 +19,12 @@
 #include <memory>
 #include <vector>
 
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+/// The AVX2 ProgPoW mix kernel is compiled next to the generic one and picked at runtime
+/// by progpow::autodetect().
+#define ETHASH_AVX2_KERNELS 1
+#endif
+
 extern "C" struct ethash_epoch_context_full : ethash_epoch_context
 {
     ethash_hash1024* full_dataset;
@@ -63,6 +73,12 @@ void build_light_cache(
 epoch_context_full* create_epoch_context(
     build_light_cache_fn build_fn, int epoch_number, bool full) noexcept;
 
+/// Creates an epoch context around a light cache owned by the caller, e.g. one
+/// mapped from disk. Only the context itself and the L1 cache are allocated;
+/// the light cache must outlive the context.
+epoch_context_full* create_epoch_context_with_light_cache(
+    const hash512* light_cache, int epoch_number) noexcept;
+
 }  // namespace generic
 
 }  // namespace ethash
@@ -98,6 +98,16 @@ int find_epoch_number(const hash256& seed) noexcept
 
 namespace generic
 {
+namespace
+{
+void build_l1_cache(const epoch_context& context, uint32_t* l1_cache) noexcept
+{
+    auto* full_dataset_2048 = reinterpret_cast<hash2048*>(l1_cache);
+    for (uint32_t i = 0; i < progpow::l1_cache_size / sizeof(full_dataset_2048[0]); ++i)
+        full_dataset_2048[i] = calculate_dataset_item_2048(context, i);
+}
+}  // namespace
+
 void build_light_cache(
     hash_fn_512 hash_fn, hash512 cache[], int num_items, const hash256& seed) noexcept
 {
@@ -165,9 +175,35 @@ epoch_context_full* create_epoch_context(
         full_dataset,
     };
 
-    auto* full_dataset_2048 = reinterpret_cast<hash2048*>(l1_cache);
-    for (uint32_t i = 0; i < progpow::l1_cache_size / sizeof(full_dataset_2048[0]); ++i)
-        full_dataset_2048[i] = calculate_dataset_item_2048(*context, i);
+    build_l1_cache(*context, l1_cache);
+    return context;
+}
+
+epoch_context_full* create_epoch_context_with_light_cache(
+    const hash512* light_cache, int epoch_number) noexcept
+{
+    static constexpr size_t context_alloc_size = sizeof(hash512);
+
+    const int light_cache_num_items = calculate_light_cache_num_items(epoch_number);
+    const int full_dataset_num_items = calculate_full_dataset_num_items(epoch_number);
+
+    char* const alloc_data =
+        static_cast<char*>(std::calloc(1, context_alloc_size + progpow::l1_cache_size));
+    if (!alloc_data)
+        return nullptr;  // Signal out-of-memory by returning null pointer.
+
+    uint32_t* const l1_cache = reinterpret_cast<uint32_t*>(alloc_data + context_alloc_size);
+
+    epoch_context_full* const context = new (alloc_data) epoch_context_full{
+        epoch_number,
+        light_cache_num_items,
+        light_cache,
+        l1_cache,
+        full_dataset_num_items,
+        nullptr,
+    };
+
+    build_l1_cache(*context, l1_cache);
     return context;
 }
 }  // namespace generic
@@ -3,9 +3,21 @@
 // Licensed under the Apache License, Version 2.0.
 
 #include "crypto/ethash/lib/ethash/ethash-internal.hpp"
+#include <crypto/ethash/include/ethash/keccak.hpp>
 #include "sync.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <string>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if !defined(__has_cpp_attribute)
 #define __has_cpp_attribute(x) 0
@@ -28,10 +40,149 @@ CCriticalSection shared_context_cs;
 std::shared_ptr<epoch_context> shared_context;
 thread_local std::shared_ptr<epoch_context> thread_local_context;
 
+/// Context built ahead of time by ethash_prepare_global_epoch_context(), taken
+/// over by update_local_context() once the epoch is reached.
+CCriticalSection next_context_cs;
+std::shared_ptr<epoch_context> next_context;
+
 CCriticalSection shared_context_full_cs;
 std::shared_ptr<epoch_context_full> shared_context_full;
 thread_local std::shared_ptr<epoch_context_full> thread_local_context_full;
 
+CCriticalSection light_cache_dir_cs;
+std::string light_cache_dir;
+
+/// Header of a light cache file. The checksum covers the light cache items
+/// that follow it, a file that does not match is rebuilt.
+struct light_cache_file_header
+{
+    char magic[8];
+    int32_t epoch_number;
+    int32_t num_items;
+    hash256 checksum;
+};
+
+constexpr char light_cache_file_magic[8] = {'k', 'a', 'w', 'l', 'c', 'v', '1', '\0'};
+
+std::string get_light_cache_dir()
+{
+    LOCK(light_cache_dir_cs);
+    return light_cache_dir;
+}
+
+std::string light_cache_path(const std::string& dir, int epoch_number)
+{
+    return dir + "/epoch-" + std::to_string(epoch_number) + ".lc";
+}
+
+void destroy_context(epoch_context* context) noexcept
+{
+    if (context)
+        ethash_destroy_epoch_context(context);
+}
+
+/// Maps the light cache file of the epoch, if there is a valid one.
+std::shared_ptr<epoch_context> load_light_cache(const std::string& dir, int epoch_number)
+{
+    const std::string path = light_cache_path(dir, epoch_number);
+    const int num_items = calculate_light_cache_num_items(epoch_number);
+    const size_t cache_size = get_light_cache_size(num_items);
+    const size_t file_size = sizeof(light_cache_file_header) + cache_size;
+
+#ifndef WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != file_size)
+    {
+        close(fd);
+        return nullptr;
+    }
+    void* map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return nullptr;
+    std::shared_ptr<char> data(static_cast<char*>(map),
+        [file_size](char* p) { munmap(p, file_size); });
+#else
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return nullptr;
+    std::shared_ptr<char> data(static_cast<char*>(std::malloc(file_size)), std::free);
+    const bool read_ok = data && std::fread(data.get(), 1, file_size, file) == file_size &&
+                         std::fgetc(file) == EOF;
+    std::fclose(file);
+    if (!read_ok)
+        return nullptr;
+#endif
+
+    light_cache_file_header header;
+    std::memcpy(&header, data.get(), sizeof(header));
+    const auto* light_cache =
+        reinterpret_cast<const hash512*>(data.get() + sizeof(light_cache_file_header));
+    if (std::memcmp(header.magic, light_cache_file_magic, sizeof(header.magic)) != 0 ||
+        header.epoch_number != epoch_number || header.num_items != num_items ||
+        !is_equal(header.checksum,
+            keccak256(reinterpret_cast<const uint8_t*>(light_cache), cache_size)))
+        return nullptr;
+
+    epoch_context* context = generic::create_epoch_context_with_light_cache(light_cache, epoch_number);
+    if (!context)
+        return nullptr;
+
+    // The mapping lives as long as the context does.
+    return std::shared_ptr<epoch_context>(context, [data](epoch_context* c) { destroy_context(c); });
+}
+
+/// Writes the light cache of the context, replacing the file atomically, and
+/// drops the file of the epoch before the previous one.
+void store_light_cache(const std::string& dir, const epoch_context& context)
+{
+    const size_t cache_size = get_light_cache_size(context.light_cache_num_items);
+
+    light_cache_file_header header{};
+    std::memcpy(header.magic, light_cache_file_magic, sizeof(header.magic));
+    header.epoch_number = context.epoch_number;
+    header.num_items = context.light_cache_num_items;
+    header.checksum =
+        keccak256(reinterpret_cast<const uint8_t*>(context.light_cache), cache_size);
+
+    const std::string path = light_cache_path(dir, context.epoch_number);
+    const std::string tmp_path = path + ".tmp";
+    FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file)
+        return;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(context.light_cache, 1, cache_size, file) == cache_size;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp_path.c_str());
+        return;
+    }
+
+    if (context.epoch_number >= 2)
+        std::remove(light_cache_path(dir, context.epoch_number - 2).c_str());
+}
+
+/// Builds the context of the epoch, going through the light cache file when a
+/// light cache directory is set.
+std::shared_ptr<epoch_context> build_context(int epoch_number)
+{
+    const std::string dir = get_light_cache_dir();
+    if (!dir.empty())
+    {
+        if (auto context = load_light_cache(dir, epoch_number))
+            return context;
+    }
+
+    std::shared_ptr<epoch_context> context(ethash_create_epoch_context(epoch_number), destroy_context);
+    if (context && !dir.empty())
+        store_light_cache(dir, *context);
+    return context;
+}
+
 /// Update thread local epoch context.
 ///
 /// This function is on the slow path. It's separated to allow inlining the fast
@@ -52,8 +203,14 @@ void update_local_context(int epoch_number)
         // Release the shared pointer of the obsoleted context.
         shared_context.reset();
 
-        // Build new context.
-        shared_context = create_epoch_context(epoch_number);
+        // Take the prepared context if it is for this epoch, build it otherwise.
+        {
+            LOCK(next_context_cs);
+            if (next_context && next_context->epoch_number == epoch_number)
+                shared_context = std::move(next_context);
+        }
+        if (!shared_context)
+            shared_context = build_context(epoch_number);
     }
 
     thread_local_context = shared_context;
@@ -98,3 +255,29 @@ const ethash_epoch_context_full* ethash_get_global_epoch_context_full(int epoch_
 
     return thread_local_context_full.get();
 }
+
+void ethash_set_light_cache_dir(const char* dir) noexcept
+{
+    LOCK(light_cache_dir_cs);
+    light_cache_dir = dir ? dir : "";
+}
+
+void ethash_prepare_global_epoch_context(int epoch_number) noexcept
+{
+    {
+        LOCK(shared_context_cs);
+        if (shared_context && shared_context->epoch_number == epoch_number)
+            return;
+    }
+    {
+        LOCK(next_context_cs);
+        if (next_context && next_context->epoch_number == epoch_number)
+            return;
+    }
+
+    // Built without holding any lock, validation keeps using the current epoch meanwhile.
+    std::shared_ptr<epoch_context> context = build_context(epoch_number);
+
+    LOCK(next_context_cs);
+    next_context = std::move(context);
+}
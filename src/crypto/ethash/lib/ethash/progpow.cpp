@@ -12,6 +12,11 @@
 
 #include <array>
 
+#if defined(ETHASH_AVX2_KERNELS)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 namespace progpow
 {
 namespace
@@ -244,6 +249,60 @@ void round(
     }
 }
 
+/// The operations of a ProgPoW period in the order round() draws them.
+///
+/// round() gets its own copy of mix_rng_state, so every round of a hash runs the same
+/// sequence and it can be drawn once per hash instead of once per round.
+struct kernel_program
+{
+    static constexpr size_t num_words_per_lane = sizeof(hash2048) / (sizeof(uint32_t) * num_lanes);
+
+    struct cache_op
+    {
+        uint32_t src, dst, sel;
+    };
+    struct math_op
+    {
+        uint32_t src1, src2, sel1, dst, sel2;
+    };
+
+    cache_op cache_ops[num_cache_accesses];
+    math_op math_ops[num_math_operations];
+    uint32_t dag_dsts[num_words_per_lane];
+    uint32_t dag_sels[num_words_per_lane];
+
+    explicit kernel_program(mix_rng_state state) noexcept
+    {
+        constexpr int max_operations =
+            num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+        for (int i = 0; i < max_operations; ++i)
+        {
+            if (i < num_cache_accesses)
+            {
+                cache_ops[i].src = state.next_src();
+                cache_ops[i].dst = state.next_dst();
+                cache_ops[i].sel = state.rng();
+            }
+            if (i < num_math_operations)
+            {
+                const auto src_rnd = state.rng() % (num_regs * (num_regs - 1));
+                math_ops[i].src1 = src_rnd % num_regs;
+                math_ops[i].src2 = src_rnd / num_regs;
+                if (math_ops[i].src2 >= math_ops[i].src1)
+                    ++math_ops[i].src2;
+                math_ops[i].sel1 = state.rng();
+                math_ops[i].dst = state.next_dst();
+                math_ops[i].sel2 = state.rng();
+            }
+        }
+        for (size_t i = 0; i < num_words_per_lane; ++i)
+        {
+            dag_dsts[i] = i == 0 ? 0 : state.next_dst();
+            dag_sels[i] = state.rng();
+        }
+    }
+};
+
 mix_array init_mix(uint32_t* hash_seed)
 {
     const uint32_t z = fnv1a(fnv_offset_basis, static_cast<uint32_t>(hash_seed[0]));
@@ -262,9 +321,259 @@ mix_array init_mix(uint32_t* hash_seed)
     return mix;
 }
 
+#if defined(ETHASH_AVX2_KERNELS)
+/// ProgPoW mix loop with the 16 lanes spread over two AVX2 vectors.
+///
+/// The mix is kept register-major, so every operation of the program is applied to all lanes
+/// at once. Selectors are the same for every lane and pick the operation outside the vector
+/// code; the l1 cache and DAG reads are gathers.
+namespace avx2
+{
+#define PROGPOW_AVX2 __attribute__((target("avx2")))
+#define PROGPOW_AVX2_INLINE inline __attribute__((always_inline, target("avx2")))
+
+static_assert(num_lanes == 16, "two vectors of 8 lanes");
+static_assert((l1_cache_num_items & (l1_cache_num_items - 1)) == 0, "l1 cache index is masked");
+
+/// One mix register of all lanes: lanes 0-7 and 8-15.
+struct lanes
+{
+    __m256i v[2];
+};
+
+PROGPOW_AVX2_INLINE __m256i rotl(__m256i a, uint32_t n)
+{
+    return _mm256_or_si256(_mm256_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n))),
+        _mm256_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(32 - n))));
+}
+
+PROGPOW_AVX2_INLINE __m256i popcount(__m256i x)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+        1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i counts =
+        _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, nibble)),
+            _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+    // Add up the 4 byte counts of every 32-bit lane.
+    return _mm256_madd_epi16(
+        _mm256_maddubs_epi16(counts, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+PROGPOW_AVX2_INLINE __m256i clz(__m256i x)
+{
+    // Set every bit below the highest one, the leading zeros are what is left unset.
+    x = _mm256_or_si256(x, _mm256_srli_epi32(x, 1));
+    x = _mm256_or_si256(x, _mm256_srli_epi32(x, 2));
+    x = _mm256_or_si256(x, _mm256_srli_epi32(x, 4));
+    x = _mm256_or_si256(x, _mm256_srli_epi32(x, 8));
+    x = _mm256_or_si256(x, _mm256_srli_epi32(x, 16));
+    return _mm256_sub_epi32(_mm256_set1_epi32(32), popcount(x));
+}
+
+PROGPOW_AVX2_INLINE __m256i mul_hi(__m256i a, __m256i b)
+{
+    const __m256i even = _mm256_mul_epu32(a, b);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+PROGPOW_AVX2_INLINE void random_math(
+    lanes& out, const lanes& a, const lanes& b, uint32_t selector)
+{
+    const __m256i mask = _mm256_set1_epi32(31);
+    const __m256i width = _mm256_set1_epi32(32);
+    for (int h = 0; h < 2; ++h)
+    {
+        const __m256i x = a.v[h];
+        const __m256i y = b.v[h];
+        __m256i r;
+        switch (selector % 11)
+        {
+        default:
+        case 0:
+            r = _mm256_add_epi32(x, y);
+            break;
+        case 1:
+            r = _mm256_mullo_epi32(x, y);
+            break;
+        case 2:
+            r = mul_hi(x, y);
+            break;
+        case 3:
+            r = _mm256_min_epu32(x, y);
+            break;
+        case 4:
+        {
+            // A shift by 32 gives 0, so a rotation by 0 comes out right.
+            const __m256i n = _mm256_and_si256(y, mask);
+            r = _mm256_or_si256(
+                _mm256_sllv_epi32(x, n), _mm256_srlv_epi32(x, _mm256_sub_epi32(width, n)));
+            break;
+        }
+        case 5:
+        {
+            const __m256i n = _mm256_and_si256(y, mask);
+            r = _mm256_or_si256(
+                _mm256_srlv_epi32(x, n), _mm256_sllv_epi32(x, _mm256_sub_epi32(width, n)));
+            break;
+        }
+        case 6:
+            r = _mm256_and_si256(x, y);
+            break;
+        case 7:
+            r = _mm256_or_si256(x, y);
+            break;
+        case 8:
+            r = _mm256_xor_si256(x, y);
+            break;
+        case 9:
+            r = _mm256_add_epi32(clz(x), clz(y));
+            break;
+        case 10:
+            r = _mm256_add_epi32(popcount(x), popcount(y));
+            break;
+        }
+        out.v[h] = r;
+    }
+}
+
+PROGPOW_AVX2_INLINE __m256i random_merge(__m256i a, __m256i b, uint32_t selector)
+{
+    const uint32_t x = (selector >> 16) % 31 + 1;
+    switch (selector % 4)
+    {
+    default:
+    case 0:
+        return _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(a, 5), a), b);
+    case 1:
+    {
+        const __m256i t = _mm256_xor_si256(a, b);
+        return _mm256_add_epi32(_mm256_slli_epi32(t, 5), t);
+    }
+    case 2:
+        return _mm256_xor_si256(rotl(a, x), b);
+    case 3:
+        return _mm256_xor_si256(rotl(a, 32 - x), b);
+    }
+}
+
+PROGPOW_AVX2 hash256 hash_mix(const epoch_context& context, int block_number, uint32_t* seed,
+    lookup_fn lookup) noexcept
+{
+    constexpr size_t num_words_per_lane = kernel_program::num_words_per_lane;
+
+    const auto number = uint64_t(block_number / period_length);
+    uint32_t new_state[2];
+    new_state[0] = static_cast<uint32_t>(number);
+    new_state[1] = static_cast<uint32_t>(number >> 32);
+    const kernel_program program{mix_rng_state{new_state}};
+
+    lanes mix[num_regs];
+    {
+        const mix_array init = init_mix(seed);
+        alignas(32) uint32_t column[num_lanes];
+        for (uint32_t i = 0; i < num_regs; ++i)
+        {
+            for (size_t l = 0; l < num_lanes; ++l)
+                column[l] = init[l][i];
+            mix[i].v[0] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&column[0]));
+            mix[i].v[1] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&column[8]));
+        }
+    }
+
+    const int* l1_cache = reinterpret_cast<const int*>(context.l1_cache);
+    const __m256i l1_mask = _mm256_set1_epi32(l1_cache_num_items - 1);
+    const __m256i lane_ids[2] = {
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15)};
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+
+    constexpr int max_operations =
+        num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+
+    for (uint32_t r = 0; r < 64; ++r)
+    {
+        alignas(32) uint32_t reg0[num_lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&reg0[0]), mix[0].v[0]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&reg0[8]), mix[0].v[1]);
+        const hash2048 item = lookup(context, reg0[r % num_lanes] % num_items);
+
+        for (int i = 0; i < max_operations; ++i)
+        {
+            if (i < num_cache_accesses)
+            {
+                const auto& op = program.cache_ops[i];
+                for (int h = 0; h < 2; ++h)
+                {
+                    const __m256i offset = _mm256_and_si256(mix[op.src].v[h], l1_mask);
+                    const __m256i data = _mm256_i32gather_epi32(l1_cache, offset, 4);
+                    mix[op.dst].v[h] = random_merge(mix[op.dst].v[h], data, op.sel);
+                }
+            }
+            if (i < num_math_operations)
+            {
+                const auto& op = program.math_ops[i];
+                lanes data;
+                random_math(data, mix[op.src1], mix[op.src2], op.sel1);
+                for (int h = 0; h < 2; ++h)
+                    mix[op.dst].v[h] = random_merge(mix[op.dst].v[h], data.v[h], op.sel2);
+            }
+        }
+
+        // Lane l reads its words of the item starting at ((l ^ r) % num_lanes) * num_words_per_lane.
+        const int* words = reinterpret_cast<const int*>(item.word32s);
+        for (int h = 0; h < 2; ++h)
+        {
+            const __m256i base = _mm256_slli_epi32(
+                _mm256_and_si256(_mm256_xor_si256(lane_ids[h], _mm256_set1_epi32(static_cast<int>(r))),
+                    _mm256_set1_epi32(num_lanes - 1)),
+                2);
+            for (size_t i = 0; i < num_words_per_lane; ++i)
+            {
+                const __m256i word = _mm256_i32gather_epi32(
+                    words, _mm256_add_epi32(base, _mm256_set1_epi32(static_cast<int>(i))), 4);
+                const uint32_t dst = program.dag_dsts[i];
+                mix[dst].v[h] = random_merge(mix[dst].v[h], word, program.dag_sels[i]);
+            }
+        }
+    }
+
+    // Reduce mix data to a single per-lane result.
+    alignas(32) uint32_t lane_hash[num_lanes];
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(fnv_prime));
+    for (int h = 0; h < 2; ++h)
+    {
+        __m256i acc = _mm256_set1_epi32(static_cast<int>(fnv_offset_basis));
+        for (uint32_t i = 0; i < num_regs; ++i)
+            acc = _mm256_mullo_epi32(_mm256_xor_si256(acc, mix[i].v[h]), prime);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&lane_hash[h * 8]), acc);
+    }
+
+    // Reduce all lanes to a single 256-bit result.
+    static constexpr size_t num_words = sizeof(hash256) / sizeof(uint32_t);
+    hash256 mix_hash;
+    for (uint32_t& w : mix_hash.word32s)
+        w = fnv_offset_basis;
+    for (size_t l = 0; l < num_lanes; ++l)
+        mix_hash.word32s[l % num_words] = fnv1a(mix_hash.word32s[l % num_words], lane_hash[l]);
+    return le::uint32s(mix_hash);
+}
+
+#undef PROGPOW_AVX2
+#undef PROGPOW_AVX2_INLINE
+}  // namespace avx2
+
+bool use_avx2 = false;
+#endif
+
 hash256 hash_mix(
     const epoch_context& context, int block_number, uint32_t * seed, lookup_fn lookup) noexcept
 {
+#if defined(ETHASH_AVX2_KERNELS)
+    if (use_avx2)
+        return avx2::hash_mix(context, block_number, seed, lookup);
+#endif
+
     auto mix = init_mix(seed);
     auto number = uint64_t(block_number / period_length);
     uint32_t new_state[2];
@@ -550,6 +859,27 @@ hash256 hash_no_verify(const int& block_number, const hash256& header_hash,
 }
 
 
+std::string autodetect()
+{
+#if defined(ETHASH_AVX2_KERNELS)
+    use_avx2 = false;
+    uint32_t eax, ebx, ecx, edx;
+    // AVX needs both the CPU flag and OS support for saving the YMM state
+    if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        !((ecx >> 27) & 1) || !((ecx >> 28) & 1))
+        return "generic";
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if ((xcr0_lo & 0x6) == 0x6 && ((ebx >> 5) & 1))
+    {
+        use_avx2 = true;
+        return "avx2";
+    }
+#endif
+    return "generic";
+}
+
 search_result search_light(const epoch_context& context, int block_number,
     const hash256& header_hash, const hash256& boundary, uint64_t start_nonce,
     size_t iterations) noexcept
@@ -172,6 +172,16 @@ public:
         return piter->value().size();
     }
 
+    /** The key and the deobfuscated value of the current entry as they are serialized, to copy entries between databases */
+    void GetRawEntry(std::vector<unsigned char>& key, std::vector<unsigned char>& value) {
+        leveldb::Slice slKey = piter->key();
+        key.assign(slKey.data(), slKey.data() + slKey.size());
+        leveldb::Slice slValue = piter->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        value.assign(ssValue.begin(), ssValue.end());
+    }
+
 };
 
 class CDBWrapper
@@ -7,11 +7,14 @@
 #include "hash.h"
 #include "crypto/common.h"
 #include "crypto/hmac_sha512.h"
+#include "algo/sph_multi.h"
 #include "pubkey.h"
 #include "util.h"
 
 #include <crypto/ethash/include/ethash/progpow.hpp>
 
+#include <memory>
+
 //TODO remove these
 double algoHashTotal[16];
 int algoHashHits[16];
@@ -255,22 +258,326 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     return v0 ^ v1 ^ v2 ^ v3;
 }
 
-uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash)
+void HashX16RStep(int hashSelection, bool fV2, const void* toHash, int lenToHash, uint512& out)
 {
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
+    void* pout = static_cast<void*>(&out);
+
+    // X16RV2 runs Tiger ahead of Keccak, Luffa and SHA-512 and feeds them the padded digest
+    if (fV2 && (hashSelection == 4 || hashSelection == 6 || hashSelection == 15)) {
+        sph_tiger_context ctx_tiger;
+        sph_tiger_init(&ctx_tiger);
+        sph_tiger (&ctx_tiger, toHash, lenToHash);
+        sph_tiger_close(&ctx_tiger, pout);
+
+        toHash = pout;
+        lenToHash = 64;
+    }
 
-    // Get the context from the block height
-    const auto epoch_number = ethash::get_epoch_number(blockHeader.nHeight);
+    switch(hashSelection) {
+        case 0: {
+            sph_blake512_context ctx_blake;
+            sph_blake512_init(&ctx_blake);
+            sph_blake512 (&ctx_blake, toHash, lenToHash);
+            sph_blake512_close(&ctx_blake, pout);
+            break;
+        }
+        case 1: {
+            sph_bmw512_context ctx_bmw;
+            sph_bmw512_init(&ctx_bmw);
+            sph_bmw512 (&ctx_bmw, toHash, lenToHash);
+            sph_bmw512_close(&ctx_bmw, pout);
+            break;
+        }
+        case 2: {
+            sph_groestl512_context ctx_groestl;
+            sph_groestl512_init(&ctx_groestl);
+            sph_groestl512 (&ctx_groestl, toHash, lenToHash);
+            sph_groestl512_close(&ctx_groestl, pout);
+            break;
+        }
+        case 3: {
+            sph_jh512_context ctx_jh;
+            sph_jh512_init(&ctx_jh);
+            sph_jh512 (&ctx_jh, toHash, lenToHash);
+            sph_jh512_close(&ctx_jh, pout);
+            break;
+        }
+        case 4: {
+            sph_keccak512_context ctx_keccak;
+            sph_keccak512_init(&ctx_keccak);
+            sph_keccak512 (&ctx_keccak, toHash, lenToHash);
+            sph_keccak512_close(&ctx_keccak, pout);
+            break;
+        }
+        case 5: {
+            sph_skein512_context ctx_skein;
+            sph_skein512_init(&ctx_skein);
+            sph_skein512 (&ctx_skein, toHash, lenToHash);
+            sph_skein512_close(&ctx_skein, pout);
+            break;
+        }
+        case 6: {
+            sph_luffa512_context ctx_luffa;
+            sph_luffa512_init(&ctx_luffa);
+            sph_luffa512 (&ctx_luffa, toHash, lenToHash);
+            sph_luffa512_close(&ctx_luffa, pout);
+            break;
+        }
+        case 7: {
+            sph_cubehash512_context ctx_cubehash;
+            sph_cubehash512_init(&ctx_cubehash);
+            sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
+            sph_cubehash512_close(&ctx_cubehash, pout);
+            break;
+        }
+        case 8: {
+            sph_shavite512_context ctx_shavite;
+            sph_shavite512_init(&ctx_shavite);
+            sph_shavite512(&ctx_shavite, toHash, lenToHash);
+            sph_shavite512_close(&ctx_shavite, pout);
+            break;
+        }
+        case 9: {
+            sph_simd512_context ctx_simd;
+            sph_simd512_init(&ctx_simd);
+            sph_simd512 (&ctx_simd, toHash, lenToHash);
+            sph_simd512_close(&ctx_simd, pout);
+            break;
+        }
+        case 10: {
+            sph_echo512_context ctx_echo;
+            sph_echo512_init(&ctx_echo);
+            sph_echo512 (&ctx_echo, toHash, lenToHash);
+            sph_echo512_close(&ctx_echo, pout);
+            break;
+        }
+        case 11: {
+            sph_hamsi512_context ctx_hamsi;
+            sph_hamsi512_init(&ctx_hamsi);
+            sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
+            sph_hamsi512_close(&ctx_hamsi, pout);
+            break;
+        }
+        case 12: {
+            sph_fugue512_context ctx_fugue;
+            sph_fugue512_init(&ctx_fugue);
+            sph_fugue512 (&ctx_fugue, toHash, lenToHash);
+            sph_fugue512_close(&ctx_fugue, pout);
+            break;
+        }
+        case 13: {
+            sph_shabal512_context ctx_shabal;
+            sph_shabal512_init(&ctx_shabal);
+            sph_shabal512 (&ctx_shabal, toHash, lenToHash);
+            sph_shabal512_close(&ctx_shabal, pout);
+            break;
+        }
+        case 14: {
+            sph_whirlpool_context ctx_whirlpool;
+            sph_whirlpool_init(&ctx_whirlpool);
+            sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
+            sph_whirlpool_close(&ctx_whirlpool, pout);
+            break;
+        }
+        case 15: {
+            sph_sha512_context ctx_sha512;
+            sph_sha512_init(&ctx_sha512);
+            sph_sha512 (&ctx_sha512, toHash, lenToHash);
+            sph_sha512_close(&ctx_sha512, pout);
+            break;
+        }
+    }
+}
+
+namespace {
+struct X16RAlgo
+{
+    size_t nContextSize;
+    void (*init)(void* cc);
+    CX16RSchedule::UpdateFn update;
+    CX16RSchedule::CloseFn close;
+};
+
+#define X16R_ALGO(name) {sizeof(sph_##name##_context), sph_##name##_init, sph_##name, sph_##name##_close}
+#define X16R_ALGO512(name) {sizeof(sph_##name##512_context), sph_##name##512_init, sph_##name##512, sph_##name##512_close}
+
+/** Indexed by GetHashSelection(), in the order of HashX16RStep */
+const X16RAlgo x16rAlgos[16] = {
+    X16R_ALGO512(blake),
+    X16R_ALGO512(bmw),
+    X16R_ALGO512(groestl),
+    X16R_ALGO512(jh),
+    X16R_ALGO512(keccak),
+    X16R_ALGO512(skein),
+    X16R_ALGO512(luffa),
+    X16R_ALGO512(cubehash),
+    X16R_ALGO512(shavite),
+    X16R_ALGO512(simd),
+    X16R_ALGO512(echo),
+    X16R_ALGO512(hamsi),
+    X16R_ALGO512(fugue),
+    X16R_ALGO512(shabal),
+    X16R_ALGO(whirlpool),
+    X16R_ALGO512(sha),
+};
+
+#undef X16R_ALGO
+#undef X16R_ALGO512
+} // namespace
+
+CX16RSchedule::CX16RSchedule(const uint256& hashPrevBlockIn, bool fV2In) : fV2(fV2In)
+{
+    sph_tiger_init(&tigerMidstate);
+    Resolve(hashPrevBlockIn);
+}
+
+void CX16RSchedule::Resolve(const uint256& hashPrevBlockIn)
+{
+    hashPrevBlock = hashPrevBlockIn;
+    for (int i = 0; i < 16; i++) {
+        int hashSelection = GetHashSelection(hashPrevBlock, i);
+        const X16RAlgo& algo = x16rAlgos[hashSelection];
+        Link& link = links[i];
+        link.nContextSize = algo.nContextSize;
+        link.update = algo.update;
+        link.close = algo.close;
+        link.fTiger = fV2 && (hashSelection == 4 || hashSelection == 6 || hashSelection == 15);
+        algo.init(&link.midstate);
+    }
+    prefixMidstate = links[0].fTiger ? tigerMidstate : links[0].midstate;
+}
 
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+void CX16RSchedule::SetPrefix(const void* data, size_t len)
+{
+    if (links[0].fTiger) {
+        prefixMidstate = tigerMidstate;
+        sph_tiger(&prefixMidstate, data, len);
+    } else {
+        prefixMidstate = links[0].midstate;
+        links[0].update(&prefixMidstate, data, len);
+    }
+}
+
+uint256 CX16RSchedule::Hash(const void* data, size_t len) const
+{
+    return Run(links[0].fTiger ? tigerMidstate : links[0].midstate, data, len);
+}
+
+uint256 CX16RSchedule::HashSuffix(const void* data, size_t len) const
+{
+    return Run(prefixMidstate, data, len);
+}
+
+uint256 CX16RSchedule::Run(const X16RContext& first, const void* data, size_t len) const
+{
+    X16RContext ctx;
+    uint512 hash;
+    unsigned char* pout = hash.begin();
+
+    // Every link reads the previous digest from hash and writes its own over it
+    for (int i = 0; i < 16; i++) {
+        const Link& link = links[i];
+        if (link.fTiger) {
+            memcpy(&ctx, i == 0 ? &first : &tigerMidstate, sizeof(sph_tiger_context));
+            sph_tiger(&ctx, data, len);
+            sph_tiger_close(&ctx, pout);
+            memset(pout + 24, 0, 40);
+            data = pout;
+            len = 64;
+            memcpy(&ctx, &link.midstate, link.nContextSize);
+        } else {
+            memcpy(&ctx, i == 0 ? &first : &link.midstate, link.nContextSize);
+        }
+        link.update(&ctx, data, len);
+        link.close(&ctx, pout);
+        data = pout;
+        len = 64;
+    }
+
+    return hash.trim256();
+}
+
+const CX16RSchedule& GetX16RSchedule(const uint256& hashPrevBlock, bool fV2)
+{
+    // One per algorithm so that headers on both sides of the X16RV2 switch don't evict each other
+    static thread_local std::unique_ptr<CX16RSchedule> schedules[2];
+    std::unique_ptr<CX16RSchedule>& schedule = schedules[fV2 ? 1 : 0];
+    if (!schedule) {
+        schedule.reset(new CX16RSchedule(hashPrevBlock, fV2));
+    } else if (schedule->GetPrevBlockHash() != hashPrevBlock) {
+        schedule->Resolve(hashPrevBlock);
+    }
+    return *schedule;
+}
+
+void HashX16RMulti(const std::vector<const unsigned char*>& vInputs, size_t nLen, const std::vector<uint256>& vPrevBlockHashes, bool fV2, std::vector<uint256>& vHashes)
+{
+    assert(vInputs.size() == vPrevBlockHashes.size());
+    static unsigned char pblank[1];
+
+    const size_t nCount = vInputs.size();
+    std::vector<uint512> vPrev(nCount), vNext(nCount);
+
+    // Inputs that picked Keccak-512 or SHA-512 this step, hashed together once the step is laid out
+    std::vector<const unsigned char*> vKeccakIn, vSHA512In;
+    std::vector<unsigned char*> vKeccakOut, vSHA512Out;
+
+    for (int i = 0; i < 16; i++) {
+        vKeccakIn.clear();
+        vKeccakOut.clear();
+        vSHA512In.clear();
+        vSHA512Out.clear();
+
+        size_t nStepLen = i == 0 ? nLen : 64;
+        for (size_t n = 0; n < nCount; n++) {
+            const unsigned char* toHash = i == 0 ? (nLen == 0 ? pblank : vInputs[n]) : vPrev[n].begin();
+            int hashSelection = GetHashSelection(vPrevBlockHashes[n], i);
+
+            vNext[n].SetNull();
+            if (hashSelection == 4 || hashSelection == 15) {
+                if (fV2) {
+                    sph_tiger_context ctx_tiger;
+                    sph_tiger_init(&ctx_tiger);
+                    sph_tiger (&ctx_tiger, toHash, nStepLen);
+                    sph_tiger_close(&ctx_tiger, vNext[n].begin());
+                    toHash = vNext[n].begin();
+                }
+                if (hashSelection == 4) {
+                    vKeccakIn.push_back(toHash);
+                    vKeccakOut.push_back(vNext[n].begin());
+                } else {
+                    vSHA512In.push_back(toHash);
+                    vSHA512Out.push_back(vNext[n].begin());
+                }
+            } else {
+                HashX16RStep(hashSelection, fV2, toHash, nStepLen, vNext[n]);
+            }
+        }
+
+        // Under X16RV2 these inputs are all 64 byte Tiger digests
+        size_t nMultiLen = fV2 ? 64 : nStepLen;
+        sph_keccak512_multi(vKeccakIn.data(), nMultiLen, vKeccakOut.data(), vKeccakIn.size());
+        sph_sha512_multi(vSHA512In.data(), nMultiLen, vSHA512Out.data(), vSHA512In.size());
+
+        vPrev.swap(vNext);
+    }
+
+    vHashes.resize(nCount);
+    for (size_t n = 0; n < nCount; n++)
+        vHashes[n] = vPrev[n].trim256();
+}
+
+uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash)
+{
+    // Get the context from the block height, shared by all threads verifying the same epoch
+    const auto& context = ethash::get_global_epoch_context(ethash::get_epoch_number(blockHeader.nHeight));
 
     // Build the header_hash
     uint256 nHeaderHash = blockHeader.GetKAWPOWHeaderHash();
     const auto header_hash = to_hash256(nHeaderHash.GetHex());
 
     // ProgPow hash
-    const auto result = progpow::hash(*context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
+    const auto result = progpow::hash(context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
 
     mix_hash = uint256S(to_hex(result.mix_hash));
     return uint256S(to_hex(result.final_hash));
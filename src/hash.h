@@ -331,280 +331,117 @@ extern int algoHashHits[16];
 
 
 
-template<typename T1>
-inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+/**
+ * Run one link of the X16R chain: hash toHash with the algorithm picked by hashSelection
+ * and write the 512-bit result to out. With fV2 set, Keccak, Luffa and SHA-512 are
+ * preceded by Tiger as in X16RV2. out must start zeroed, Tiger only fills 24 bytes.
+ */
+void HashX16RStep(int hashSelection, bool fV2, const void* toHash, int lenToHash, uint512& out);
+
+/** Storage for the context of any algorithm an X16R or X16RV2 chain can run. */
+union X16RContext
+{
+    sph_blake512_context blake;
+    sph_bmw512_context bmw;
+    sph_groestl512_context groestl;
+    sph_jh512_context jh;
+    sph_keccak512_context keccak;
+    sph_skein512_context skein;
+    sph_luffa512_context luffa;
+    sph_cubehash512_context cubehash;
+    sph_shavite512_context shavite;
+    sph_simd512_context simd;
+    sph_echo512_context echo;
+    sph_hamsi512_context hamsi;
+    sph_fugue512_context fugue;
+    sph_shabal512_context shabal;
+    sph_whirlpool_context whirlpool;
+    sph_sha512_context sha512;
+    sph_tiger_context tiger;
+};
+
+/**
+ * The X16R or X16RV2 chain of one previous block hash, resolved once.
+ *
+ * Every link keeps the functions of its algorithm and an initialised context, so hashing
+ * copies the midstates instead of looking up the algorithm and initialising a context at
+ * each of the 16 steps. SetPrefix() also absorbs input that does not change between calls,
+ * such as a block header up to its nonce, into the first link.
+ */
+class CX16RSchedule
 {
-//      static std::chrono::duration<double>[16];
-    int hashSelection;
-
-    sph_blake512_context     ctx_blake;      //0
-    sph_bmw512_context       ctx_bmw;        //1
-    sph_groestl512_context   ctx_groestl;    //2
-    sph_jh512_context        ctx_jh;         //3
-    sph_keccak512_context    ctx_keccak;     //4
-    sph_skein512_context     ctx_skein;      //5
-    sph_luffa512_context     ctx_luffa;      //6
-    sph_cubehash512_context  ctx_cubehash;   //7
-    sph_shavite512_context   ctx_shavite;    //8
-    sph_simd512_context      ctx_simd;       //9
-    sph_echo512_context      ctx_echo;       //A
-    sph_hamsi512_context     ctx_hamsi;      //B
-    sph_fugue512_context     ctx_fugue;      //C
-    sph_shabal512_context    ctx_shabal;     //D
-    sph_whirlpool_context    ctx_whirlpool;  //E
-    sph_sha512_context       ctx_sha512;     //F
+public:
+    typedef void (*UpdateFn)(void* cc, const void* data, size_t len);
+    typedef void (*CloseFn)(void* cc, void* dst);
 
+    CX16RSchedule(const uint256& hashPrevBlockIn, bool fV2In);
 
+    /** Resolve the chain of another previous block hash, dropping any prefix. */
+    void Resolve(const uint256& hashPrevBlockIn);
 
-    static unsigned char pblank[1];
+    const uint256& GetPrevBlockHash() const { return hashPrevBlock; }
+    bool IsV2() const { return fV2; }
+
+    /** Same result as HashX16R/HashX16RV2 over len bytes at data with this previous block hash. */
+    uint256 Hash(const void* data, size_t len) const;
 
-    uint512 hash[16];
+    /** Absorb the first len bytes of the input into the first link. */
+    void SetPrefix(const void* data, size_t len);
 
-    for (int i=0;i<16;i++)
+    /** Hash the prefix given to SetPrefix() followed by len bytes at data. */
+    uint256 HashSuffix(const void* data, size_t len) const;
+
+private:
+    struct Link
     {
-        const void *toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i-1]);
-            lenToHash = 64;
-        }
+        size_t nContextSize;
+        UpdateFn update;
+        CloseFn close;
+        //! X16RV2 runs Tiger ahead of this link
+        bool fTiger;
+        X16RContext midstate;
+    };
+
+    uint256 hashPrevBlock;
+    bool fV2;
+    Link links[16];
+    X16RContext tigerMidstate;
+    //! The context the first link (or its Tiger) starts HashSuffix() from
+    X16RContext prefixMidstate;
+
+    uint256 Run(const X16RContext& first, const void* data, size_t len) const;
+};
 
-        hashSelection = GetHashSelection(PrevBlockHash, i);
-
-        switch(hashSelection) {
-            case 0:
-                sph_blake512_init(&ctx_blake);
-                sph_blake512 (&ctx_blake, toHash, lenToHash);
-                sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[i]));
-                break;
-            case 1:
-                sph_bmw512_init(&ctx_bmw);
-                sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-                sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[i]));
-                break;
-            case 2:
-                sph_groestl512_init(&ctx_groestl);
-                sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-                sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[i]));
-                break;
-            case 3:
-                sph_jh512_init(&ctx_jh);
-                sph_jh512 (&ctx_jh, toHash, lenToHash);
-                sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[i]));
-                break;
-            case 4:
-                sph_keccak512_init(&ctx_keccak);
-                sph_keccak512 (&ctx_keccak, toHash, lenToHash);
-                sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[i]));
-                break;
-            case 5:
-                sph_skein512_init(&ctx_skein);
-                sph_skein512 (&ctx_skein, toHash, lenToHash);
-                sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[i]));
-                break;
-            case 6:
-                sph_luffa512_init(&ctx_luffa);
-                sph_luffa512 (&ctx_luffa, toHash, lenToHash);
-                sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[i]));
-                break;
-            case 7:
-                sph_cubehash512_init(&ctx_cubehash);
-                sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-                sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[i]));
-                break;
-            case 8:
-                sph_shavite512_init(&ctx_shavite);
-                sph_shavite512(&ctx_shavite, toHash, lenToHash);
-                sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[i]));
-                break;
-            case 9:
-                sph_simd512_init(&ctx_simd);
-                sph_simd512 (&ctx_simd, toHash, lenToHash);
-                sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[i]));
-                break;
-            case 10:
-                sph_echo512_init(&ctx_echo);
-                sph_echo512 (&ctx_echo, toHash, lenToHash);
-                sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[i]));
-                break;
-            case 11:
-                sph_hamsi512_init(&ctx_hamsi);
-                sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-                sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[i]));
-                break;
-            case 12:
-                sph_fugue512_init(&ctx_fugue);
-                sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-                sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[i]));
-                break;
-            case 13:
-                sph_shabal512_init(&ctx_shabal);
-                sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-                sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[i]));
-                break;
-            case 14:
-                sph_whirlpool_init(&ctx_whirlpool);
-                sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-                sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[i]));
-                break;
-            case 15:
-                sph_sha512_init(&ctx_sha512);
-                sph_sha512 (&ctx_sha512, toHash, lenToHash);
-                sph_sha512_close(&ctx_sha512, static_cast<void*>(&hash[i]));
-                break;
-        }
-    }
+/**
+ * The schedule of hashPrevBlock kept by the calling thread. Consecutive headers on the same
+ * parent, like a miner walking the nonce or repeated GetHash() calls, reuse it.
+ */
+const CX16RSchedule& GetX16RSchedule(const uint256& hashPrevBlock, bool fV2);
 
-    return hash[15].trim256();
+template<typename T1>
+inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+{
+    static unsigned char pblank[1];
+    const void* toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
+    return GetX16RSchedule(PrevBlockHash, false).Hash(toHash, (pend - pbegin) * sizeof(pbegin[0]));
 }
 
 template<typename T1>
 inline uint256 HashX16RV2(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
 {
-//      static std::chrono::duration<double>[16];
-    int hashSelection;
-
-    sph_blake512_context     ctx_blake;      //0
-    sph_bmw512_context       ctx_bmw;        //1
-    sph_groestl512_context   ctx_groestl;    //2
-    sph_jh512_context        ctx_jh;         //3
-    sph_keccak512_context    ctx_keccak;     //4
-    sph_skein512_context     ctx_skein;      //5
-    sph_luffa512_context     ctx_luffa;      //6
-    sph_cubehash512_context  ctx_cubehash;   //7
-    sph_shavite512_context   ctx_shavite;    //8
-    sph_simd512_context      ctx_simd;       //9
-    sph_echo512_context      ctx_echo;       //A
-    sph_hamsi512_context     ctx_hamsi;      //B
-    sph_fugue512_context     ctx_fugue;      //C
-    sph_shabal512_context    ctx_shabal;     //D
-    sph_whirlpool_context    ctx_whirlpool;  //E
-
-    sph_sha512_context        ctx_sha512;
-    sph_tiger_context         ctx_tiger;
-
-
-
     static unsigned char pblank[1];
-
-    uint512 hash[16];
-
-    for (int i=0;i<16;i++)
-    {
-        const void *toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i-1]);
-            lenToHash = 64;
-        }
-
-        hashSelection = GetHashSelection(PrevBlockHash, i);
-
-        switch(hashSelection) {
-            case 0:
-                sph_blake512_init(&ctx_blake);
-                sph_blake512 (&ctx_blake, toHash, lenToHash);
-                sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[i]));
-                break;
-            case 1:
-                sph_bmw512_init(&ctx_bmw);
-                sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-                sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[i]));
-                break;
-            case 2:
-                sph_groestl512_init(&ctx_groestl);
-                sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-                sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[i]));
-                break;
-            case 3:
-                sph_jh512_init(&ctx_jh);
-                sph_jh512 (&ctx_jh, toHash, lenToHash);
-                sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[i]));
-                break;
-            case 4:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_keccak512_init(&ctx_keccak);
-                sph_keccak512 (&ctx_keccak, static_cast<const void*>(&hash[i]), 64);
-                sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[i]));
-                break;
-            case 5:
-                sph_skein512_init(&ctx_skein);
-                sph_skein512 (&ctx_skein, toHash, lenToHash);
-                sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[i]));
-                break;
-            case 6:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_luffa512_init(&ctx_luffa);
-                sph_luffa512 (&ctx_luffa, static_cast<const void*>(&hash[i]), 64);
-                sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[i]));
-                break;
-            case 7:
-                sph_cubehash512_init(&ctx_cubehash);
-                sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-                sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[i]));
-                break;
-            case 8:
-                sph_shavite512_init(&ctx_shavite);
-                sph_shavite512(&ctx_shavite, toHash, lenToHash);
-                sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[i]));
-                break;
-            case 9:
-                sph_simd512_init(&ctx_simd);
-                sph_simd512 (&ctx_simd, toHash, lenToHash);
-                sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[i]));
-                break;
-            case 10:
-                sph_echo512_init(&ctx_echo);
-                sph_echo512 (&ctx_echo, toHash, lenToHash);
-                sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[i]));
-                break;
-            case 11:
-                sph_hamsi512_init(&ctx_hamsi);
-                sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-                sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[i]));
-                break;
-            case 12:
-                sph_fugue512_init(&ctx_fugue);
-                sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-                sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[i]));
-                break;
-            case 13:
-                sph_shabal512_init(&ctx_shabal);
-                sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-                sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[i]));
-                break;
-            case 14:
-                sph_whirlpool_init(&ctx_whirlpool);
-                sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-                sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[i]));
-                break;
-            case 15:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_sha512_init(&ctx_sha512);
-                sph_sha512 (&ctx_sha512, static_cast<const void*>(&hash[i]), 64);
-                sph_sha512_close(&ctx_sha512, static_cast<void*>(&hash[i]));
-                break;
-        }
-    }
-
-    return hash[15].trim256();
+    const void* toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
+    return GetX16RSchedule(PrevBlockHash, true).Hash(toHash, (pend - pbegin) * sizeof(pbegin[0]));
 }
 
+/**
+ * Hash a batch of equal-length inputs with X16R, or X16RV2 when fV2 is set, each chained
+ * on its own previous block hash. The chains are advanced one step at a time so that
+ * inputs landing on Keccak-512 or SHA-512 in the same step can be hashed together by the
+ * multi-buffer code in algo/sph_multi.h. The results match HashX16R/HashX16RV2.
+ */
+void HashX16RMulti(const std::vector<const unsigned char*>& vInputs, size_t nLen, const std::vector<uint256>& vPrevBlockHashes, bool fV2, std::vector<uint256>& vHashes);
+
 uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash);
 uint256 KAWPOWHash_OnlyMix(const CBlockHeader& blockHeader);
 
@@ -0,0 +1,576 @@
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/addressindexes.h"
+
+#include "assets/assets.h"
+#include "chain.h"
+#include "coins.h"
+#include "hash.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <tuple>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCE = 'b';
+static const char DB_ADDRESSINDEX_VERSION = 'V';
+static const char DB_TIMESTAMPINDEX = 's';
+static const char DB_BLOCKHASHINDEX = 'z';
+static const char DB_SPENTINDEX = 'p';
+
+/** Format of the address index database, databases from before the balance table (version 1) are rebuilt */
+static const int ADDRESSINDEX_VERSION = 1;
+
+std::unique_ptr<CAddressIndexer> paddressindexer;
+std::unique_ptr<CSpentIndexer> pspentindexer;
+std::unique_ptr<CTimestampIndexer> ptimestampindexer;
+
+/** The changes a connected block makes to the address index */
+struct CAddressIndexChanges
+{
+    /** Balance changes of every address the block touches */
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+    /** Unspent outputs the block spends, with the values they had */
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vSpentOutputs;
+    /** Unspent outputs the block creates */
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vCreatedOutputs;
+};
+
+static bool GetAddressIndexChanges(const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex, CAddressIndexChanges& changes)
+{
+    if (undo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    // The block may be far behind the tip, transfers are decoded the way they were when it was connected
+    const int nHeight = pindex->nHeight;
+    const bool fTransferScriptsSizeDeployed = AreTransferScriptsSizeDeployed(pindex);
+
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& txundo = undo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = txundo.vprevout[j];
+                uint160 hashBytes;
+                std::string assetName;
+                CAmount assetAmount;
+
+                if (int addressType = GetScriptAddress(coin.out.scriptPubKey, hashBytes)) {
+                    // record spending activity and remove the output from the unspent index
+                    changes.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), coin.out.nValue * -1));
+                    changes.vSpentOutputs.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, prevout.hash, prevout.n), CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight)));
+                } else if (ParseAssetScript(coin.out.scriptPubKey, hashBytes, assetName, assetAmount, fTransferScriptsSizeDeployed)) {
+                    changes.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, nHeight, i, txhash, j, true), assetAmount * -1));
+                    changes.vSpentOutputs.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, prevout.hash, prevout.n), CAddressUnspentValue(assetAmount, coin.out.scriptPubKey, coin.nHeight)));
+                }
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            uint160 hashBytes;
+            std::string assetName;
+            CAmount assetAmount;
+
+            if (int addressType = GetScriptAddress(out.scriptPubKey, hashBytes)) {
+                // record receiving activity and the new unspent output
+                changes.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+                changes.vCreatedOutputs.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+            } else if (ParseAssetScript(tx, k, hashBytes, assetName, assetAmount, fTransferScriptsSizeDeployed)) {
+                changes.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, nHeight, i, txhash, k, false), assetAmount));
+                changes.vCreatedOutputs.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k), CAddressUnspentValue(assetAmount, out.scriptPubKey, nHeight)));
+            }
+        }
+    }
+
+    return true;
+}
+
+CAddressIndexer::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex::DB(GetDataDir() / "indexes" / "addressindex", nCacheSize, fMemory, fWipe)
+{
+    int nVersion = 0;
+    if (!Read(DB_ADDRESSINDEX_VERSION, nVersion) || nVersion != ADDRESSINDEX_VERSION) {
+        if (!IsEmpty())
+            LogPrintf("Address index has an old format, rebuilding it\n");
+        EraseAll();
+        Write(DB_ADDRESSINDEX_VERSION, ADDRESSINDEX_VERSION, true);
+    }
+}
+
+bool CAddressIndexer::DB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                                  size_t nLimit, CAddressUnspentKey *pkeyCursor)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pkeyCursor && !pkeyCursor->IsNull()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pkeyCursor));
+        pkeyCursor->SetNull();
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    }
+
+    size_t nCount = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash && (assetName.empty() || key.second.asset == assetName)) {
+            if (nLimit > 0 && nCount == nLimit) {
+                if (pkeyCursor)
+                    *pkeyCursor = key.second;
+                break;
+            }
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                nCount++;
+                pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CAddressIndexer::DB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                                  size_t nLimit, CAddressUnspentKey *pkeyCursor)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pkeyCursor && !pkeyCursor->IsNull()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pkeyCursor));
+        pkeyCursor->SetNull();
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    size_t nCount = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash) {
+            // RVN outputs are not asset outputs, skip over all of them at once
+            if (key.second.asset == RVN) {
+                uint256 hashLast;
+                std::fill(hashLast.begin(), hashLast.end(), 0xff);
+                pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, RVN, hashLast, std::numeric_limits<uint32_t>::max())));
+                if (pcursor->Valid() && pcursor->GetKey(key) && key.second.asset == RVN)
+                    pcursor->Next();
+                continue;
+            }
+            if (nLimit > 0 && nCount == nLimit) {
+                if (pkeyCursor)
+                    *pkeyCursor = key.second;
+                break;
+            }
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                nCount++;
+                pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CAddressIndexer::DB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                           int start, int end, size_t nLimit, CAddressIndexKey *pkeyCursor)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pkeyCursor && !pkeyCursor->IsNull()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *pkeyCursor));
+        pkeyCursor->SetNull();
+    } else if (!assetName.empty() && start > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
+                                     CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
+    } else if (!assetName.empty()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    size_t nCount = 0;
+    uint256 lastTx;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash && (assetName.empty() || key.second.asset == assetName)) {
+            // Entries are sorted by height within each asset, so the parts of an asset's history
+            // outside of the range are skipped with a seek instead of being read
+            if (start > 0 && key.second.blockHeight < start) {
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
+                                             CAddressIndexIteratorHeightKey(type, addressHash, key.second.asset, start)));
+                continue;
+            }
+            if (end > 0 && key.second.blockHeight > end) {
+                if (!assetName.empty())
+                    break;
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
+                                             CAddressIndexIteratorHeightKey(type, addressHash, key.second.asset, std::numeric_limits<int>::max())));
+                continue;
+            }
+            // A page never ends inside a transaction, so that its entries are always returned together
+            if (nLimit > 0 && nCount >= nLimit && key.second.txhash != lastTx) {
+                if (pkeyCursor)
+                    *pkeyCursor = key.second;
+                break;
+            }
+            CAmount nValue;
+            if (pcursor->GetValue(nValue)) {
+                addressIndex.push_back(std::make_pair(key.second, nValue));
+                lastTx = key.second.txhash;
+                nCount++;
+                pcursor->Next();
+            } else {
+                return error("failed to get address index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CAddressIndexer::DB::ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance)
+{
+    // An address without an entry has never held the asset
+    if (!Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorAssetKey(type, addressHash, assetName)), balance))
+        balance.SetNull();
+    return true;
+}
+
+bool CAddressIndexer::DB::ReadAddressBalances(uint160 addressHash, int type,
+                                              std::vector<std::pair<std::string, CAddressBalanceValue> > &balances)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexIteratorAssetKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSBALANCE && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash) {
+            CAddressBalanceValue value;
+            if (pcursor->GetValue(value)) {
+                balances.push_back(std::make_pair(key.second.asset, value));
+                pcursor->Next();
+            } else {
+                return error("failed to get address balance value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CAddressIndexer::DB::UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fUndo)
+{
+    struct CBalanceChange {
+        CAddressBalanceValue value;
+        uint256 lastTx;
+    };
+
+    // Sum up the entries per address and asset first so that every balance is read and written once.
+    // The entries of a transaction are next to each other, so counting hash changes counts transactions.
+    std::map<std::tuple<unsigned int, uint160, std::string>, CBalanceChange> mapChanges;
+    for (const auto& entry : addressIndex) {
+        const CAddressIndexKey& key = entry.first;
+        CBalanceChange& change = mapChanges[std::make_tuple(key.type, key.hashBytes, key.asset)];
+        change.value.balance += entry.second;
+        if (entry.second > 0)
+            change.value.received += entry.second;
+        if (change.value.txCount == 0 || change.lastTx != key.txhash) {
+            change.value.txCount++;
+            change.lastTx = key.txhash;
+        }
+    }
+
+    for (const auto& item : mapChanges) {
+        const CAddressIndexIteratorAssetKey key(std::get<0>(item.first), std::get<1>(item.first), std::get<2>(item.first));
+        const CAddressBalanceValue& change = item.second.value;
+
+        CAddressBalanceValue value;
+        if (!Read(std::make_pair(DB_ADDRESSBALANCE, key), value))
+            value.SetNull();
+
+        if (fUndo) {
+            value.balance -= change.balance;
+            value.received -= change.received;
+            value.txCount -= change.txCount;
+            if (value.txCount < 0)
+                return error("%s: balance of %s in %s does not include the block being removed", __func__, key.asset, key.hashBytes.GetHex());
+        } else {
+            value.balance += change.balance;
+            value.received += change.received;
+            value.txCount += change.txCount;
+        }
+
+        if (value.IsNull())
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCE, key));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, key), value);
+    }
+
+    return true;
+}
+
+CAddressIndexer::CAddressIndexer(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(new CAddressIndexer::DB(nCacheSize, fMemory, fWipe))
+{
+}
+
+CAddressIndexer::~CAddressIndexer()
+{
+    Stop();
+}
+
+bool CAddressIndexer::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    CAddressIndexChanges changes;
+    if (!GetAddressIndexChanges(block, undo, pindex, changes))
+        return false;
+
+    for (const auto& entry : changes.vAddressIndex)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+    if (!db->UpdateAddressBalances(batch, changes.vAddressIndex, false))
+        return false;
+
+    // Outputs created and spent within the block have to end up absent, so the spends go last
+    for (const auto& entry : changes.vCreatedOutputs)
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+    for (const auto& entry : changes.vSpentOutputs)
+        batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+
+    return true;
+}
+
+bool CAddressIndexer::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    CAddressIndexChanges changes;
+    if (!GetAddressIndexChanges(block, undo, pindex, changes))
+        return false;
+
+    for (const auto& entry : changes.vAddressIndex)
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+    if (!db->UpdateAddressBalances(batch, changes.vAddressIndex, true))
+        return false;
+
+    // Mirror of WriteBlock: restore the spent outputs first so that outputs created and spent
+    // within the block are removed again by the erases of the created outputs
+    for (const auto& entry : changes.vSpentOutputs)
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+    for (const auto& entry : changes.vCreatedOutputs)
+        batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+
+    return true;
+}
+
+bool CAddressIndexer::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                              std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                              size_t nLimit, CAddressUnspentKey *pkeyCursor)
+{
+    return db->ReadAddressUnspentIndex(addressHash, type, assetName, vect, nLimit, pkeyCursor);
+}
+
+bool CAddressIndexer::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                              std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                              size_t nLimit, CAddressUnspentKey *pkeyCursor)
+{
+    return db->ReadAddressUnspentIndex(addressHash, type, vect, nLimit, pkeyCursor);
+}
+
+bool CAddressIndexer::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                                       std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                       int start, int end, size_t nLimit, CAddressIndexKey *pkeyCursor)
+{
+    return db->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end, nLimit, pkeyCursor);
+}
+
+bool CAddressIndexer::ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance)
+{
+    return db->ReadAddressBalance(addressHash, type, assetName, balance);
+}
+
+bool CAddressIndexer::ReadAddressBalances(uint160 addressHash, int type,
+                                          std::vector<std::pair<std::string, CAddressBalanceValue> > &balances)
+{
+    return db->ReadAddressBalances(addressHash, type, balances);
+}
+
+CSpentIndexer::CSpentIndexer(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(new CBaseIndex::DB(GetDataDir() / "indexes" / "spentindex", nCacheSize, fMemory, fWipe))
+{
+}
+
+CSpentIndexer::~CSpentIndexer()
+{
+    Stop();
+}
+
+bool CSpentIndexer::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    if (undo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    const bool fTransferScriptsSizeDeployed = AreTransferScriptsSizeDeployed(pindex);
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        const CTxUndo& txundo = undo.vtxundo[i-1];
+        if (txundo.vprevout.size() != tx.vin.size())
+            return error("%s: transaction and undo data inconsistent", __func__);
+
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const CTxOut& prevout = txundo.vprevout[j].out;
+            uint160 hashBytes;
+            int addressType = GetScriptAddress(prevout.scriptPubKey, hashBytes);
+            if (!addressType) {
+                std::string assetName;
+                CAmount assetAmount;
+                hashBytes.SetNull();
+                if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount, fTransferScriptsSizeDeployed))
+                    addressType = 1;
+            }
+
+            // the txid and input that spent the output, and the amount and address it held
+            batch.Write(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(tx.vin[j].prevout.hash, tx.vin[j].prevout.n)),
+                        CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes));
+        }
+    }
+
+    return true;
+}
+
+bool CSpentIndexer::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        for (const CTxIn& txin : block.vtx[i]->vin)
+            batch.Erase(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(txin.prevout.hash, txin.prevout.n)));
+    }
+
+    return true;
+}
+
+bool CSpentIndexer::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value)
+{
+    return db->Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+CTimestampIndexer::DB::DB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CTimestampIndexer::DB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
+            if (fActiveOnly) {
+                if (HashOnchainActive(key.second.blockHash)) {
+                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+                }
+            } else {
+                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+            }
+
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CTimestampIndexer::DB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp)
+{
+    CTimestampBlockIndexValue lts;
+    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+        return false;
+
+    ltimestamp = lts.ltimestamp;
+    return true;
+}
+
+CTimestampIndexer::CTimestampIndexer(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(new CTimestampIndexer::DB(nCacheSize, fMemory, fWipe))
+{
+}
+
+CTimestampIndexer::~CTimestampIndexer()
+{
+    Stop();
+}
+
+bool CTimestampIndexer::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    unsigned int logicalTS = pindex->nTime;
+    unsigned int prevLogicalTS = 0;
+
+    // retrieve logical timestamp of the previous block, the genesis block has none
+    if (pindex->pprev->pprev && !db->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+        LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+        LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    }
+
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(logicalTS, pindex->GetBlockHash())), 0);
+    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(pindex->GetBlockHash())), CTimestampBlockIndexValue(logicalTS));
+    return true;
+}
+
+bool CTimestampIndexer::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex)
+{
+    // Entries of disconnected blocks are kept, ReadTimestampIndex filters them with fActiveOnly
+    return true;
+}
+
+bool CTimestampIndexer::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect)
+{
+    return db->ReadTimestampIndex(high, low, fActiveOnly, vect);
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_INDEX_ADDRESSINDEXES_H
+#define RAVEN_INDEX_ADDRESSINDEXES_H
+
+#include "addressindex.h"
+#include "index/base.h"
+#include "spentindex.h"
+#include "timestampindex.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The address index (-addressindex): the balance changes and unspent outputs of every address,
+ * kept in indexes/addressindex/, together with a running balance per address and asset so that
+ * totals do not require summing the whole history.
+ */
+class CAddressIndexer final : public CBaseIndex
+{
+protected:
+    class DB : public CBaseIndex::DB
+    {
+    public:
+        explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+        bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                     size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
+        bool ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                     size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
+        bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                              int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pkeyCursor = nullptr);
+        bool ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance);
+        bool ReadAddressBalances(uint160 addressHash, int type,
+                                 std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
+
+        /** Add the balance table updates for the given index entries to a batch, subtracting them if fUndo */
+        bool UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, bool fUndo);
+    };
+
+private:
+    const std::unique_ptr<DB> db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    CBaseIndex::DB& GetDB() const override { return *db; }
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    explicit CAddressIndexer(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CAddressIndexer() override;
+
+    /**
+     * Reads of unspent outputs and balance changes. At most nLimit entries (0 for no limit) are read,
+     * starting at *pkeyCursor if that is set. When more entries remain *pkeyCursor is set to the next
+     * one, otherwise it is set to null. Balance changes are returned per asset in height order and a
+     * page of them never ends inside a transaction, so it can exceed nLimit.
+     */
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                 size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                 size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
+    bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pkeyCursor = nullptr);
+    bool ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance);
+    bool ReadAddressBalances(uint160 addressHash, int type,
+                             std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
+};
+
+/** The spent index (-spentindex): which input spent an outpoint, kept in indexes/spentindex/ */
+class CSpentIndexer final : public CBaseIndex
+{
+private:
+    const std::unique_ptr<CBaseIndex::DB> db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    CBaseIndex::DB& GetDB() const override { return *db; }
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    explicit CSpentIndexer(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CSpentIndexer() override;
+
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+};
+
+/**
+ * The timestamp index (-timestampindex): block hashes by logical timestamp, kept in
+ * indexes/timestampindex/. As before, entries of disconnected blocks are left in place and
+ * filtered out by fActiveOnly when reading.
+ */
+class CTimestampIndexer final : public CBaseIndex
+{
+protected:
+    class DB : public CBaseIndex::DB
+    {
+    public:
+        explicit DB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+        bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+        bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    };
+
+private:
+    const std::unique_ptr<DB> db;
+
+protected:
+    bool NeedsBlockData() const override { return false; }
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) override;
+    CBaseIndex::DB& GetDB() const override { return *db; }
+    const char* GetName() const override { return "timestampindex"; }
+
+public:
+    explicit CTimestampIndexer(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CTimestampIndexer() override;
+
+    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+};
+
+/** Global indexers, only set while the corresponding -addressindex/-spentindex/-timestampindex is enabled */
+extern std::unique_ptr<CAddressIndexer> paddressindexer;
+extern std::unique_ptr<CSpentIndexer> pspentindexer;
+extern std::unique_ptr<CTimestampIndexer> ptimestampindexer;
+
+#endif // RAVEN_INDEX_ADDRESSINDEXES_H
@@ -0,0 +1,321 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/base.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "init.h"
+#include "tinyformat.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+#include "warnings.h"
+
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_BEST_BLOCK = 'B';
+
+/** Log the catch up progress at most this often (seconds) */
+static const int64_t SYNC_LOG_INTERVAL = 30;
+
+namespace {
+
+/** Key type that reads back whatever bytes are stored, used to erase keys of every type */
+struct CRawKey
+{
+    std::vector<char> vch;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write(vch.data(), vch.size());
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        vch.assign(s.begin(), s.end());
+        s.ignore(s.size());
+    }
+};
+
+bool FatalError(const std::string& strMessage)
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                                     "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+/** Locator for pindex built from the skip list only, so that it can be taken without cs_main */
+CBlockLocator GetLocator(const CBlockIndex* pindex)
+{
+    return CChain().GetLocator(pindex);
+}
+
+} // namespace
+
+CBaseIndex::DB::DB(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe) :
+    CDBWrapper(path, nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CBaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool fSuccess = Read(DB_BEST_BLOCK, locator);
+    if (!fSuccess)
+        locator.SetNull();
+    return fSuccess;
+}
+
+void CBaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
+{
+    batch.Write(DB_BEST_BLOCK, locator);
+}
+
+bool CBaseIndex::DB::EraseAll()
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    pcursor->SeekToFirst();
+    while (pcursor->Valid()) {
+        CRawKey key;
+        if (!pcursor->GetKey(key))
+            return error("%s: failed to read key", __func__);
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize)) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    return WriteBatch(batch, true);
+}
+
+CBaseIndex::CBaseIndex() : fSynced(false), pindexBest(nullptr), fRegistered(false)
+{
+}
+
+CBaseIndex::~CBaseIndex()
+{
+    Stop();
+}
+
+bool CBaseIndex::Init()
+{
+    CBlockLocator locator;
+    if (!GetDB().ReadBestBlock(locator) || locator.IsNull()) {
+        pindexBest = nullptr;
+        return true;
+    }
+
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(locator.vHave.front());
+    if (it != mapBlockIndex.end() && it->second->nStatus & BLOCK_HAVE_DATA) {
+        pindexBest = it->second;
+        return true;
+    }
+
+    // The stored entries belong to a block we know nothing about (for example after the block
+    // index was rebuilt), so there is no way to roll them back: start over
+    LogPrintf("%s: best block %s of the %s is unknown, rebuilding it\n", __func__,
+              locator.vHave.front().GetHex(), GetName());
+    pindexBest = nullptr;
+    return GetDB().EraseAll();
+}
+
+bool CBaseIndex::Commit(CDBBatch& batch, const CBlockIndex* pindexNewBest)
+{
+    GetDB().WriteBestBlock(batch, GetLocator(pindexNewBest));
+    if (!GetDB().WriteBatch(batch))
+        return FatalError(strprintf("%s: failed to write to the %s database", __func__, GetName()));
+
+    pindexBest = pindexNewBest;
+    return true;
+}
+
+bool CBaseIndex::AppendBlock(const CBlockIndex* pindex, const CBlock* pblock)
+{
+    CDBBatch batch(GetDB());
+
+    if (pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockundo;
+        if (NeedsBlockData()) {
+            if (!pblock) {
+                if (!ReadBlockFromDisk(block, pindex, GetParams().GetConsensus()))
+                    return FatalError(strprintf("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString()));
+                pblock = &block;
+            }
+            if (!UndoReadFromDisk(blockundo, pindex))
+                return FatalError(strprintf("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString()));
+        }
+
+        if (!WriteBlock(batch, pblock ? *pblock : block, blockundo, pindex))
+            return FatalError(strprintf("%s: failed to index block %s in the %s", __func__, pindex->GetBlockHash().ToString(), GetName()));
+    }
+
+    return Commit(batch, pindex);
+}
+
+bool CBaseIndex::RewindBlock(const CBlockIndex* pindex, const CBlock* pblock)
+{
+    CDBBatch batch(GetDB());
+
+    if (pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockundo;
+        if (NeedsBlockData()) {
+            if (!pblock) {
+                if (!ReadBlockFromDisk(block, pindex, GetParams().GetConsensus()))
+                    return FatalError(strprintf("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString()));
+                pblock = &block;
+            }
+            if (!UndoReadFromDisk(blockundo, pindex))
+                return FatalError(strprintf("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString()));
+        }
+
+        if (!EraseBlock(batch, pblock ? *pblock : block, blockundo, pindex))
+            return FatalError(strprintf("%s: failed to roll back block %s in the %s", __func__, pindex->GetBlockHash().ToString(), GetName()));
+    }
+
+    return Commit(batch, pindex->pprev);
+}
+
+void CBaseIndex::ThreadSync()
+{
+    const CBlockIndex* pindex = pindexBest.load();
+    int64_t nLastLogTime = 0;
+
+    while (!fSynced) {
+        if (interrupt)
+            return;
+
+        const CBlockIndex* pindexNext = nullptr;
+        bool fRewind = false;
+        {
+            LOCK(cs_main);
+            if (pindex && !chainActive.Contains(pindex)) {
+                fRewind = true;
+            } else {
+                pindexNext = pindex ? chainActive.Next(pindex) : chainActive.Genesis();
+                if (!pindexNext) {
+                    // Caught up: blocks connected from now on are delivered through BlockConnected,
+                    // which is signalled under cs_main after this point
+                    fSynced = true;
+                    break;
+                }
+            }
+        }
+
+        if (fRewind) {
+            if (!RewindBlock(pindex))
+                return;
+            pindex = pindex->pprev;
+        } else {
+            if (!AppendBlock(pindexNext))
+                return;
+            pindex = pindexNext;
+        }
+
+        int64_t nNow = GetTime();
+        if (nLastLogTime + SYNC_LOG_INTERVAL < nNow) {
+            LogPrintf("Syncing %s with block chain from height %d\n", GetName(), pindex ? pindex->nHeight : -1);
+            nLastLogTime = nNow;
+        }
+    }
+
+    LogPrintf("%s is enabled at height %d\n", GetName(), GetBestHeight());
+}
+
+void CBaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
+                                const std::vector<CTransactionRef>& txnConflicted)
+{
+    if (!fSynced)
+        return;
+
+    const CBlockIndex* pindexPrev = pindexBest.load();
+    if (pindex->pprev != pindexPrev) {
+        // Notifications queued before the sync thread caught up can refer to blocks it has already indexed
+        if (pindexPrev && pindexPrev->GetAncestor(pindex->nHeight) == pindex)
+            return;
+
+        LogPrintf("%s: WARNING: block %s does not connect to the best block of the %s (%s), not updating it\n", __func__,
+                  pindex->GetBlockHash().ToString(), GetName(), pindexPrev ? pindexPrev->GetBlockHash().ToString() : "none");
+        return;
+    }
+
+    AppendBlock(pindex, block.get());
+}
+
+void CBaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    if (!fSynced)
+        return;
+
+    // Only the block the index currently ends with can be rolled back, anything else was never indexed
+    const CBlockIndex* pindex = pindexBest.load();
+    if (!pindex || pindex->GetBlockHash() != block->GetHash())
+        return;
+
+    RewindBlock(pindex, block.get());
+}
+
+bool CBaseIndex::Start()
+{
+    if (!Init())
+        return error("%s: failed to initialise the %s", __func__, GetName());
+
+    // Register before the sync thread starts so that no block connected while it catches up is missed
+    RegisterValidationInterface(this);
+    fRegistered = true;
+
+    threadSync = std::thread(&TraceThread<std::function<void()>>, GetName(), std::bind(&CBaseIndex::ThreadSync, this));
+    return true;
+}
+
+void CBaseIndex::Stop()
+{
+    if (fRegistered) {
+        UnregisterValidationInterface(this);
+        fRegistered = false;
+    }
+
+    interrupt();
+    if (threadSync.joinable())
+        threadSync.join();
+}
+
+bool CBaseIndex::BlockUntilSyncedToCurrentChain()
+{
+    if (!fSynced)
+        return false;
+
+    {
+        // Skip the round trip through the notification queue if the index already has the tip
+        LOCK(cs_main);
+        const CBlockIndex* pindexTip = chainActive.Tip();
+        const CBlockIndex* pindex = pindexBest.load();
+        if (!pindexTip || (pindex && pindex->GetAncestor(pindexTip->nHeight) == pindexTip))
+            return true;
+    }
+
+    SyncWithValidationInterfaceQueue();
+    return true;
+}
+
+int CBaseIndex::GetBestHeight() const
+{
+    const CBlockIndex* pindex = pindexBest.load();
+    return pindex ? pindex->nHeight : -1;
+}
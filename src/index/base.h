@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_INDEX_BASE_H
+#define RAVEN_INDEX_BASE_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "threadinterrupt.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+class CBlockIndex;
+class CBlockUndo;
+
+/**
+ * Base class for the optional indexes that are built from the block files in the background
+ * instead of inside ConnectBlock/DisconnectBlock.
+ *
+ * Each index keeps its own database together with a locator of the block its contents
+ * correspond to. On Start() a thread walks from that block to the active chain tip (rolling back
+ * any blocks that were reorganised away while the node was down), after which the index follows
+ * the chain through the BlockConnected/BlockDisconnected notifications. Every block is written
+ * in a single batch together with the new locator, so the database never holds a partial block.
+ */
+class CBaseIndex : public CValidationInterface
+{
+protected:
+    class DB : public CDBWrapper
+    {
+    public:
+        DB(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+        /** Read the locator of the block the index is in sync with */
+        bool ReadBestBlock(CBlockLocator& locator) const;
+
+        /** Add the locator of the block the index is in sync with to a batch */
+        void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+
+        /** Remove every entry, used when the stored data no longer matches a known block */
+        bool EraseAll();
+    };
+
+private:
+    /** Whether the sync thread has caught up with the active chain and notifications are being applied */
+    std::atomic<bool> fSynced;
+
+    /** The last block the index holds data for */
+    std::atomic<const CBlockIndex*> pindexBest;
+
+    /** Whether the index is registered for validation notifications */
+    bool fRegistered;
+
+    std::thread threadSync;
+    CThreadInterrupt interrupt;
+
+    /** Load the best block from the database, wiping it if that block is unknown */
+    bool Init();
+
+    /** Catch up with the active chain from the best block, then mark the index as synced */
+    void ThreadSync();
+
+    /** Read the data of pindex from disk and add it to the index */
+    bool AppendBlock(const CBlockIndex* pindex, const CBlock* pblock = nullptr);
+
+    /** Remove pindex, which must be the best block, from the index */
+    bool RewindBlock(const CBlockIndex* pindex, const CBlock* pblock = nullptr);
+
+    /** Write a batch holding one block's changes together with the new best block */
+    bool Commit(CDBBatch& batch, const CBlockIndex* pindexNewBest);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex,
+                        const std::vector<CTransactionRef>& txnConflicted) override;
+
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
+    /** Whether WriteBlock/EraseBlock need the block and its undo data, or only the block index entry */
+    virtual bool NeedsBlockData() const { return true; }
+
+    /**
+     * Add the entries of a connected block to the batch. The genesis block is never passed in, as its
+     * outputs are not spendable, and block and undo are left empty if NeedsBlockData() is false.
+     */
+    virtual bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) = 0;
+
+    /** Add the changes that undo WriteBlock for the same block to the batch */
+    virtual bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& undo, const CBlockIndex* pindex) = 0;
+
+    virtual DB& GetDB() const = 0;
+
+    /** Name of the index, used in log messages and for the thread name */
+    virtual const char* GetName() const = 0;
+
+public:
+    CBaseIndex();
+    virtual ~CBaseIndex();
+
+    /** Start following the chain and catching up in the background */
+    bool Start();
+
+    /** Stop the sync thread and stop receiving notifications */
+    void Stop();
+
+    /** Whether the index has caught up with the active chain, i.e. whether its contents can be served */
+    bool IsSynced() const { return fSynced; }
+
+    /**
+     * Wait until the index has applied the notifications for the current chain tip, so that reads
+     * reflect it. Returns false while the index is still catching up. Must not be called with cs_main held.
+     */
+    bool BlockUntilSyncedToCurrentChain();
+
+    /** Height of the last indexed block, or -1 if nothing has been indexed yet */
+    int GetBestHeight() const;
+};
+
+#endif // RAVEN_INDEX_BASE_H
@@ -11,15 +11,19 @@
 #include "init.h"
 
 #include "addrman.h"
+#include "algo/sph_multi.h"
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/ethash/include/ethash/ethash.h"
+#include "crypto/ethash/include/ethash/progpow.hpp"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/addressindexes.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -240,6 +244,11 @@ void PrepareShutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // The indexers take cs_main while catching up, so they are stopped before the chain state goes away
+    paddressindexer.reset();
+    pspentindexer.reset();
+    ptimestampindexer.reset();
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -297,6 +306,9 @@ void PrepareShutdown()
         delete passetsQualifierCache;
         passetsQualifierCache = nullptr;
 
+        delete passetsAddressQualifiersCache;
+        passetsAddressQualifiersCache = nullptr;
+
         delete passetsRestrictionCache;
         passetsRestrictionCache = nullptr;
 
@@ -472,6 +484,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-kawpowlightcache", strprintf(_("Keep the KAWPOW light caches in <datadir>/kawpow so they are not rebuilt after a restart (default: %u)"), DEFAULT_KAWPOW_LIGHT_CACHE));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
 #ifndef WIN32
@@ -544,6 +557,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblockindexpow", strprintf("Re-hash every stored block header on startup, using all cores, instead of trusting the hash it is stored under (default: %u)", DEFAULT_CHECKBLOCKINDEXPOW));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
@@ -559,6 +573,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-vbparams=deployment:start:end", "Use given start/end times for specified version bits deployment (regtest-only)");
+        strUsage += HelpMessageOpt("-assumeutxo=height:blockhash:nchaintx:coinshash:assetshash[:assetholdershash]", "Accept the UTXO snapshot with the given hashes, as reported by dumptxoutset, at the given height (regtest-only)");
     }
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + ListLogCategories() + ".");
@@ -1014,6 +1029,14 @@ bool AppInitParameterInteraction()
             return InitError(_("Prune mode is incompatible with -txindex."));
     }
 
+    // The address, spent and timestamp indexes are built in the background from the block files,
+    // so they can be switched on and off without a reindex
+    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    if (gArgs.GetArg("-prune", 0) && (fAddressIndex || fSpentIndex))
+        return InitError(_("Prune mode is incompatible with -addressindex and -spentindex."));
+
     // -bind and -whitebind can't be set when not listening
     size_t nUserBind = gArgs.GetArgs("-bind").size() + gArgs.GetArgs("-whitebind").size();
     if (nUserBind != 0 && !gArgs.GetBoolArg("-listen", DEFAULT_LISTEN)) {
@@ -1264,6 +1287,43 @@ bool AppInitParameterInteraction()
             }
         }
     }
+
+    if (gArgs.IsArgSet("-assumeutxo")) {
+        // Allow pinning UTXO snapshots for testing
+        if (!chainparams.MineBlocksOnDemand()) {
+            return InitError("UTXO snapshots may only be pinned on regtest.");
+        }
+        for (const std::string& strSnapshot : gArgs.GetArgs("-assumeutxo")) {
+            std::vector<std::string> vSnapshotParams;
+            boost::split(vSnapshotParams, strSnapshot, boost::is_any_of(":"));
+            if (vSnapshotParams.size() != 5 && vSnapshotParams.size() != 6) {
+                return InitError("UTXO snapshot parameters malformed, expecting height:blockhash:nchaintx:coinshash:assetshash[:assetholdershash]");
+            }
+            int32_t nHeight;
+            int64_t nChainTx;
+            if (!ParseInt32(vSnapshotParams[0], &nHeight) || nHeight < 0) {
+                return InitError(strprintf("Invalid UTXO snapshot height (%s)", vSnapshotParams[0]));
+            }
+            if (!ParseInt64(vSnapshotParams[2], &nChainTx) || nChainTx <= 0) {
+                return InitError(strprintf("Invalid UTXO snapshot nChainTx (%s)", vSnapshotParams[2]));
+            }
+            for (size_t j = 1; j < vSnapshotParams.size(); j++) {
+                if (j != 2 && (vSnapshotParams[j].size() != 64 || !IsHex(vSnapshotParams[j]))) {
+                    return InitError(strprintf("Invalid UTXO snapshot hash (%s)", vSnapshotParams[j]));
+                }
+            }
+            AssumeutxoData data;
+            data.hashBlock = uint256S(vSnapshotParams[1]);
+            data.nChainTx = nChainTx;
+            data.hashSerialized = uint256S(vSnapshotParams[3]);
+            data.hashAssets = uint256S(vSnapshotParams[4]);
+            if (vSnapshotParams.size() == 6) {
+                data.hashAssetHolders = uint256S(vSnapshotParams[5]);
+            }
+            UpdateAssumeutxoParameters(nHeight, data);
+            LogPrintf("Pinning the UTXO snapshot at height %d to block %s\n", nHeight, data.hashBlock.ToString());
+        }
+    }
     return true;
 }
 
@@ -1297,6 +1357,10 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string sph_multi_algo = SphMultiAutoDetect();
+    LogPrintf("Using the '%s' multi-buffer X16R implementation\n", sph_multi_algo);
+    std::string progpow_algo = progpow::autodetect();
+    LogPrintf("Using the '%s' KAWPOW mix implementation\n", progpow_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1351,8 +1415,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadHeaderHash);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1498,6 +1564,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         nMaxOutboundLimit = gArgs.GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET)*1024*1024;
     }
 
+    if (gArgs.GetBoolArg("-kawpowlightcache", DEFAULT_KAWPOW_LIGHT_CACHE)) {
+        fs::path pathLightCache = GetDataDir() / "kawpow";
+        TryCreateDirectories(pathLightCache);
+        ethash_set_light_cache_dir(pathLightCache.string().c_str());
+    }
+
     // ********************************************************* Step 7: load block chain
 
     fReindex = gArgs.GetBoolArg("-reindex", false);
@@ -1516,6 +1588,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int nIndexes = fAddressIndex + fSpentIndex + fTimestampIndex;
+    int64_t nIndexDBCache = nIndexes ? std::min(nTotalCache / 8, nMaxIndexDBCache << 20) / nIndexes : 0;
+    nTotalCache -= nIndexDBCache * nIndexes;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1523,6 +1598,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nIndexes)
+        LogPrintf("* Using %.1fMiB for each of the %d address, spent and timestamp index databases\n", nIndexDBCache * (1.0 / 1024 / 1024), nIndexes);
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1564,6 +1641,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     delete prestricteddb;
                     delete passetsVerifierCache;
                     delete passetsQualifierCache;
+                    delete passetsAddressQualifiersCache;
                     delete passetsRestrictionCache;
                     delete passetsGlobalRestrictionCache;
 
@@ -1592,6 +1670,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     passetsVerifierCache = new CLRUCache<std::string, CNullAssetTxVerifierString>(
                             MAX_CACHE_ASSETS_SIZE);
                     passetsQualifierCache = new CLRUCache<std::string, int8_t>(MAX_CACHE_ASSETS_SIZE);
+                    passetsAddressQualifiersCache = new CLRUCache<std::string, std::vector<std::string>>(MAX_CACHE_ASSETS_SIZE);
                     passetsRestrictionCache = new CLRUCache<std::string, int8_t>(MAX_CACHE_ASSETS_SIZE);
                     passetsGlobalRestrictionCache = new CLRUCache<std::string, int8_t>(MAX_CACHE_ASSETS_SIZE);
 
@@ -1599,6 +1678,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     pSnapshotRequestDb = new CSnapshotRequestDB(nBlockTreeDBCache, false, false);
                     pAssetSnapshotDb = new CAssetSnapshotDB(nBlockTreeDBCache, false, false);
                     pDistributeSnapshotDb = new CDistributeSnapshotRequestDB(nBlockTreeDBCache, false, false);
+                    LoadDistributeRewardSnapshots();
 
                     // Read for fAssetIndex to make sure that we only load asset address balances if it if true
                     pblocktree->ReadFlag("assetindex", fAssetIndex);
@@ -1622,6 +1702,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     } else {
                         LogPrintf("Messaging is enabled\n");
                     }
+
+                    if (fMessaging && !pmessagedb->BuildMessageIndex()) {
+                        strLoadError = _("Failed to build the message index");
+                        break;
+                    }
                 }
                 /** RVN END */
 
@@ -1655,24 +1740,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -addressindex");
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -spentindex");
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -timestampindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1721,6 +1788,15 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     assert(chainActive.Tip() != nullptr);
                 }
 
+                /** RVN START */
+                // Count the asset holders of databases written before the holder stats existed
+                if (fAssetIndex && !passetsdb->BuildAssetHolderStats(chainActive.Height())) {
+                    strLoadError = _("Failed to count asset holders in the assets database");
+                    break;
+                }
+                passetsdb->SetHolderStatsHeight(chainActive.Height());
+                /** RVN END */
+
                 if (!fReset) {
                     // Note that RewindBlockIndex MUST run even if we're about to -reindex-chainstate.
                     // It both disconnects blocks based on chainActive, and drops block data in
@@ -1798,6 +1874,27 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    // The blocks below a UTXO snapshot were never downloaded, so the indexers can't catch up with the loaded chain
+    if (IsSnapshotChainstate() && (fAddressIndex || fSpentIndex || fTimestampIndex))
+        return InitError(_("The chainstate was loaded from a UTXO snapshot, -addressindex, -spentindex and -timestampindex can't be built on it."));
+
+    // Start the background indexers, they catch up with the loaded chain on their own threads
+    if (fAddressIndex) {
+        paddressindexer.reset(new CAddressIndexer(nIndexDBCache, false, fReindex));
+        if (!paddressindexer->Start())
+            return InitError(_("Failed to start the address index"));
+    }
+    if (fSpentIndex) {
+        pspentindexer.reset(new CSpentIndexer(nIndexDBCache, false, fReindex));
+        if (!pspentindexer->Start())
+            return InitError(_("Failed to start the spent index"));
+    }
+    if (fTimestampIndex) {
+        ptimestampindexer.reset(new CTimestampIndexer(nIndexDBCache, false, fReindex));
+        if (!ptimestampindexer->Start())
+            return InitError(_("Failed to start the timestamp index"));
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1826,6 +1923,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    // the blocks below a UTXO snapshot were never downloaded, so don't offer the full chain either
+    if (IsSnapshotChainstate()) {
+        LogPrintf("Unsetting NODE_NETWORK on a chainstate loaded from a UTXO snapshot\n");
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
+
     if(chainparams.GetConsensus().nSegwitEnabled) {
     		nLocalServices = ServiceFlags(nLocalServices | NODE_WITNESS);
     }
@@ -1852,6 +1955,15 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    // Keep the KAWPOW epoch context of the coming blocks ready off the validation path
+    threadGroup.create_thread(&ThreadPrepareKAWPOWEpoch);
+
+#ifdef ENABLE_WALLET
+    // Send out reward distributions a batch at a time, starting with the ones left over from the last run
+    ScheduleRewardDistributions();
+    StartRewardDistributions(scheduler);
+#endif
+
     // Wait for genesis block to be processed
     {
         boost::unique_lock<boost::mutex> lock(cs_GenesisWait);
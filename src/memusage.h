@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include <map>
+#include <string>
 #include <set>
 #include <vector>
 #include <unordered_map>
@@ -61,6 +62,16 @@ static inline size_t MallocUsage(size_t alloc)
 
 // STL data structures
 
+/** Short strings are stored inside the object itself, only longer ones allocate */
+static inline size_t DynamicUsage(const std::string& s)
+{
+    const char* data = s.data();
+    const char* object = reinterpret_cast<const char*>(&s);
+    if (data >= object && data < object + sizeof(s))
+        return 0;
+    return MallocUsage(s.capacity() + 1);
+}
+
 template<typename X>
 struct stl_tree_node
 {
@@ -25,6 +25,7 @@
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
+#include "utilstrencodings.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 
@@ -34,6 +35,7 @@
 
 #include <boost/thread.hpp>
 #include <algorithm>
+#include <memory>
 #include <queue>
 #include <utility>
 
@@ -627,14 +629,27 @@ void static RavenMiner(const CChainParams& chainparams)
             //
             int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+            std::unique_ptr<CX16RSchedule> x16r;
             while (true)
             {
+                // Before KAWPOW only the nonce changes below, resolve the X16R chain of the
+                // parent once and absorb the header up to the nonce
+                bool fX16R = pblock->nTime < nKAWPOWActivationTime;
+                if (fX16R) {
+                    bool fV2 = pblock->nTime >= GetX16RV2ActivationTime();
+                    if (!x16r || x16r->IsV2() != fV2)
+                        x16r.reset(new CX16RSchedule(pblock->hashPrevBlock, fV2));
+                    x16r->SetPrefix(BEGIN(pblock->nVersion), BEGIN(pblock->nNonce) - BEGIN(pblock->nVersion));
+                }
 
                 uint256 hash;
                 uint256 mix_hash;
                 while (true)
                 {
-                    hash = pblock->GetHashFull(mix_hash);
+                    if (fX16R)
+                        hash = x16r->HashSuffix(BEGIN(pblock->nNonce), sizeof(pblock->nNonce));
+                    else
+                        hash = pblock->GetHashFull(mix_hash);
                     if (UintToArith256(hash) <= hashTarget)
                     {
                         pblock->mix_hash = mix_hash;
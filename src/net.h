@@ -285,6 +285,8 @@ public:
     bool DisconnectNode(NodeId id);
 
     ServiceFlags GetLocalServices() const;
+    //! Stop offering services to the peers that connect from now on
+    void RemoveLocalServices(ServiceFlags services) { nLocalServices = ServiceFlags(nLocalServices & ~services); }
 
     //!set the max outbound target in bytes
     void SetMaxOutboundTarget(uint64_t limit);
@@ -408,7 +410,7 @@ private:
     std::atomic<NodeId> nLastNodeId;
 
     /** Services this instance offers */
-    ServiceFlags nLocalServices;
+    std::atomic<ServiceFlags> nLocalServices;
 
     CSemaphore *semOutbound;
     CSemaphore *semAddnode;
@@ -81,5 +81,7 @@ struct CNodeStateStats {
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
+/** Forget the last block each peer has in common with us, after the active chain was replaced by a UTXO snapshot */
+void ResetLastCommonBlocks();
 
 #endif // RAVEN_NET_PROCESSING_H
@@ -35,16 +35,20 @@ void BlockNetwork::SetNetwork(const std::string& net)
     }
 }
 
+uint32_t GetX16RV2ActivationTime()
+{
+    if (bNetwork.fOnTestnet) {
+        return TESTNET_X16RV2ACTIVATIONTIME;
+    } else if (bNetwork.fOnRegtest) {
+        return REGTEST_X16RV2ACTIVATIONTIME;
+    }
+    return MAINNET_X16RV2ACTIVATIONTIME;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
     if (nTime < nKAWPOWActivationTime) {
-        uint32_t nTimeToUse = MAINNET_X16RV2ACTIVATIONTIME;
-        if (bNetwork.fOnTestnet) {
-            nTimeToUse = TESTNET_X16RV2ACTIVATIONTIME;
-        } else if (bNetwork.fOnRegtest) {
-            nTimeToUse = REGTEST_X16RV2ACTIVATIONTIME;
-        }
-        if (nTime >= nTimeToUse) {
+        if (nTime >= GetX16RV2ActivationTime()) {
             return HashX16RV2(BEGIN(nVersion), END(nNonce), hashPrevBlock);
         }
 
@@ -57,13 +61,7 @@ uint256 CBlockHeader::GetHash() const
 uint256 CBlockHeader::GetHashFull(uint256& mix_hash) const
 {
     if (nTime < nKAWPOWActivationTime) {
-        uint32_t nTimeToUse = MAINNET_X16RV2ACTIVATIONTIME;
-        if (bNetwork.fOnTestnet) {
-            nTimeToUse = TESTNET_X16RV2ACTIVATIONTIME;
-        } else if (bNetwork.fOnRegtest) {
-            nTimeToUse = REGTEST_X16RV2ACTIVATIONTIME;
-        }
-        if (nTime >= nTimeToUse) {
+        if (nTime >= GetX16RV2ActivationTime()) {
             return HashX16RV2(BEGIN(nVersion), END(nNonce), hashPrevBlock);
         }
 
@@ -74,7 +72,39 @@ uint256 CBlockHeader::GetHashFull(uint256& mix_hash) const
 }
 
 
+void GetBlockHeaderHashes(const CBlockHeader* pheaders, size_t nCount, uint256* phashes)
+{
+    if (nCount == 0)
+        return;
+
+    const uint32_t nX16RV2Time = GetX16RV2ActivationTime();
+
+    // Split the pre-KAWPOW headers by algorithm, they are hashed over the same 80 bytes as GetHash()
+    std::vector<size_t> vIndex[2];
+    std::vector<const unsigned char*> vInputs[2];
+    std::vector<uint256> vPrevBlockHashes[2];
+    for (size_t i = 0; i < nCount; i++) {
+        const CBlockHeader& header = pheaders[i];
+        if (header.nTime >= nKAWPOWActivationTime) {
+            phashes[i] = header.GetHash();
+            continue;
+        }
+        int nAlgo = header.nTime >= nX16RV2Time ? 1 : 0;
+        vIndex[nAlgo].push_back(i);
+        vInputs[nAlgo].push_back((const unsigned char*)BEGIN(header.nVersion));
+        vPrevBlockHashes[nAlgo].push_back(header.hashPrevBlock);
+    }
 
+    const size_t nLen = END(pheaders[0].nNonce) - BEGIN(pheaders[0].nVersion);
+    std::vector<uint256> vHashes;
+    for (int nAlgo = 0; nAlgo < 2; nAlgo++) {
+        if (vIndex[nAlgo].empty())
+            continue;
+        HashX16RMulti(vInputs[nAlgo], nLen, vPrevBlockHashes[nAlgo], nAlgo == 1, vHashes);
+        for (size_t j = 0; j < vIndex[nAlgo].size(); j++)
+            phashes[vIndex[nAlgo][j]] = vHashes[j];
+    }
+}
 
 uint256 CBlockHeader::GetX16RHash() const
 {
@@ -21,6 +21,9 @@
 
 extern uint32_t nKAWPOWActivationTime;
 
+/** Time from which pre-KAWPOW headers are hashed with X16RV2 on the selected network */
+uint32_t GetX16RV2ActivationTime();
+
 class BlockNetwork
 {
 public:
@@ -112,6 +115,13 @@ public:
 };
 
 
+/**
+ * Compute GetHash() for nCount consecutive headers. X16R and X16RV2 headers are
+ * hashed as a batch through HashX16RMulti, KAWPOW headers one at a time.
+ */
+void GetBlockHeaderHashes(const CBlockHeader* pheaders, size_t nCount, uint256* phashes);
+
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -84,22 +84,60 @@ uint256 CTransaction::GetWitnessHash() const
     return SerializeHash(*this, SER_GETHASH, 0);
 }
 
+/** RVN START */
+std::vector<CTxOutAssetInfo> CTransaction::ComputeAssetOutInfo() const
+{
+    std::vector<CTxOutAssetInfo> vInfo;
+    for (size_t i = 0; i < vout.size(); i++) {
+        const CScript& script = vout[i].scriptPubKey;
+        int nType = 0;
+        bool fIsOwner = false;
+        int nStartingIndex = 0;
+        if (!script.IsAssetScript(nType, fIsOwner, nStartingIndex))
+            continue;
+
+        if (vInfo.empty())
+            vInfo.resize(vout.size());
+        CTxOutAssetInfo& info = vInfo[i];
+        info.nType = nType;
+        info.fIsOwner = fIsOwner;
+        info.nStartingIndex = nStartingIndex;
+
+        // Every asset object starts with the name, and all but the owner asset follow it with the amount. The data is
+        // pushed before an OP_DROP, so that byte is always left over
+        try {
+            CDataStream ssAsset((const char*)script.data() + nStartingIndex, (const char*)script.data() + script.size(), SER_NETWORK, PROTOCOL_VERSION);
+            ssAsset >> info.strName;
+            if (!fIsOwner)
+                ssAsset >> info.nAmount;
+            info.fHasNameAndAmount = true;
+            info.fMoreData = ssAsset.size() > 1;
+        } catch (const std::exception&) {
+            info.strName.clear();
+            info.nAmount = 0;
+        }
+    }
+    return vInfo;
+}
+/** RVN END */
+
 /* For backward compatibility, the hash is initialized to 0. TODO: remove the need for this default constructor entirely. */
-CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash() {}
-CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
-CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()) {}
+CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash(), vAssetOutInfo() {}
+CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()), vAssetOutInfo(ComputeAssetOutInfo()) {}
+CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(ComputeHash()), vAssetOutInfo(ComputeAssetOutInfo()) {}
 
 CAmount CTransaction::GetValueOut(const bool fAreEnforcedValues) const
 {
     CAmount nValueOut = 0;
-    for (const auto& tx_out : vout) {
+    for (size_t i = 0; i < vout.size(); i++) {
+        const CTxOut& tx_out = vout[i];
 
         // Stop doing this check after Enforced Values BIP goes active
         if (!fAreEnforcedValues) {
             // Because we don't want to deal with assets messing up this calculation
             // If this is an asset tx, we should move onto the next output in the transaction
             // This will also help with processing speed of transaction that contain a large amounts of asset outputs in a transaction
-            if (tx_out.scriptPubKey.IsAssetScript())
+            if (GetAssetOutInfo(i))
                 continue;
         }
         
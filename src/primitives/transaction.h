@@ -267,6 +267,22 @@ inline void SerializeTransaction(const TxType& tx, Stream& s) {
 /** The basic transaction that is broadcasted on the network and contained in
  * blocks.  A transaction can contain multiple inputs and outputs.
  */
+/** RVN START */
+/** The asset an output carries, read from its scriptPubKey once when the CTransaction is built */
+struct CTxOutAssetInfo
+{
+    int nType;                  // TX_NEW_ASSET, TX_TRANSFER_ASSET or TX_REISSUE_ASSET, 0 if the output isn't an asset script
+    bool fIsOwner;
+    int nStartingIndex;         // Where the serialized asset data begins in the script
+    bool fHasNameAndAmount;     // The name (and the amount, owner assets have none) could be read from the data
+    bool fMoreData;             // More than the name and amount, e.g. the message of a transfer
+    std::string strName;
+    CAmount nAmount;
+
+    CTxOutAssetInfo() : nType(0), fIsOwner(false), nStartingIndex(0), fHasNameAndAmount(false), fMoreData(false), nAmount(0) {}
+};
+/** RVN END */
+
 class CTransaction
 {
 public:
@@ -292,8 +308,11 @@ public:
 private:
     /** Memory only. */
     const uint256 hash;
+    /** Memory only. One entry per output when any output is an asset script, empty otherwise */
+    const std::vector<CTxOutAssetInfo> vAssetOutInfo;
 
     uint256 ComputeHash() const;
+    std::vector<CTxOutAssetInfo> ComputeAssetOutInfo() const;
 
 public:
     /** Construct a CTransaction that qualifies as IsNull() */
@@ -324,6 +343,20 @@ public:
     // Compute a hash that includes both transaction and witness data
     uint256 GetWitnessHash() const;
 
+    /** RVN START */
+    /** The asset output n carries, nullptr if its script isn't an asset script */
+    const CTxOutAssetInfo* GetAssetOutInfo(size_t n) const
+    {
+        if (n >= vAssetOutInfo.size() || vAssetOutInfo[n].nType == 0)
+            return nullptr;
+        return &vAssetOutInfo[n];
+    }
+
+    const std::vector<CTxOutAssetInfo>& GetAssetOutInfo() const {
+        return vAssetOutInfo;
+    }
+    /** RVN END */
+
     // Return sum of txouts.
     CAmount GetValueOut(const bool fAreEnforcedValues = true) const;
     // GetValueIn() is a method on CCoinsViewCache, because
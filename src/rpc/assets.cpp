@@ -835,6 +835,10 @@ UniValue getassetdata(const JSONRPCRequest& request)
                 "  ipfs_hash: (hash), (only if has_ipfs = 1 and that data is a ipfs hash)\n"
                 "  txid_hash: (hash), (only if has_ipfs = 1 and that data is a txid hash)\n"
                 "  verifier_string: (string)\n"
+                "  holders: (number), (only with -assetindex) addresses holding the asset\n"
+                "  circulating: (number), (only with -assetindex) amount held outside of the burn addresses\n"
+                "  holders_changed_height: (number), (only with -assetindex) height at which the holdings last changed\n"
+                "  holders_as_of_height: (number), (only with -assetindex) the holder stats are those of the last chainstate flush, at this height\n"
                 "}\n"
 
                 "\nExamples:\n"
@@ -873,6 +877,18 @@ UniValue getassetdata(const JSONRPCRequest& request)
             result.push_back(Pair("verifier_string", verifier.verifier_string));
         }
 
+        if (fAssetIndex && passetsdb) {
+            // The stats are kept with the address quantities in the database, so they lag the tip until the next
+            // chainstate flush. Flushing here would make a read write out the whole chainstate
+            CAssetHolderStats stats;
+            if (passetsdb->ReadAssetHolderStats(asset.strName, stats)) {
+                result.push_back(Pair("holders", stats.nHolders));
+                result.push_back(Pair("circulating", UnitValueFromAmount(stats.nCirculating, asset.strName)));
+                result.push_back(Pair("holders_changed_height", stats.nLastChangedHeight));
+                result.push_back(Pair("holders_as_of_height", passetsdb->GetHolderStatsHeight()));
+            }
+        }
+
         return result;
     }
 
@@ -1789,6 +1805,7 @@ UniValue getcacheinfo(const JSONRPCRequest& request)
                 "  asset metadata map:\n"
                 "  asset metadata list (est):\n"
                 "  dirty cache (est):\n"
+                "  dirty cache:\n"
 
 
                 "]\n"
@@ -1816,7 +1833,7 @@ UniValue getcacheinfo(const JSONRPCRequest& request)
 
     UniValue descendants(UniValue::VOBJ);
 
-    descendants.push_back(Pair("asset address balance",   (int)memusage::DynamicUsage(currentActiveAssetCache->mapAssetsAddressAmount)));
+    descendants.push_back(Pair("asset address balance",   (int)currentActiveAssetCache->mapAssetsAddressAmount.DynamicMemoryUsage()));
     descendants.push_back(Pair("reissue data",   (int)memusage::DynamicUsage(currentActiveAssetCache->mapReissuedAssetData)));
 
     info.push_back(Pair("reissue tracking (memory only)", (int)memusage::DynamicUsage(mapReissuedAssets) + (int)memusage::DynamicUsage(mapReissuedTx)));
@@ -1824,7 +1841,7 @@ UniValue getcacheinfo(const JSONRPCRequest& request)
     info.push_back(Pair("asset metadata map",  (int)memusage::DynamicUsage(passetsCache->GetItemsMap())));
     info.push_back(Pair("asset metadata list (est)",  (int)passetsCache->GetItemsList().size() * (32 + 80))); // Max 32 bytes for asset name, 80 bytes max for asset data
     info.push_back(Pair("dirty cache (est)",  (int)currentActiveAssetCache->GetCacheSize()));
-    info.push_back(Pair("dirty cache V2 (est)",  (int)currentActiveAssetCache->GetCacheSizeV2()));
+    info.push_back(Pair("dirty cache",  (int)currentActiveAssetCache->GetDirtyCacheUsage()));
 
     result.push_back(info);
     return result;
@@ -2925,15 +2942,17 @@ UniValue isvalidverifierstring(const JSONRPCRequest& request)
 
 UniValue getsnapshot(const JSONRPCRequest& request)
 {
-    if (request.fHelp || !AreAssetsDeployed() || request.params.size() < 2)
+    if (request.fHelp || !AreAssetsDeployed() || request.params.size() < 2 || request.params.size() > 4)
         throw std::runtime_error(
-                "getsnapshot \"asset_name\" block_height\n"
+                "getsnapshot \"asset_name\" block_height (count) (start)\n"
                 + AssetActivationWarning() +
                 "\nReturns details for the asset snapshot, at the specified height\n"
 
                 "\nArguments:\n"
                 "1. \"asset_name\"               (string, required) the name of the asset\n"
                 "2. block_height                 (int, required) the block height of the snapshot\n"
+                "3. \"count\"                    (integer, optional, default=all) truncates results to include only the first _count_ owners\n"
+                "4. \"start\"                    (integer, optional, default=0) results skip over the first _start_ owners\n"
 
                 "\nResult:\n"
                 "{\n"
@@ -2947,6 +2966,7 @@ UniValue getsnapshot(const JSONRPCRequest& request)
                 "}\n"
 
                 "\nExamples:\n"
+                + HelpExampleCli("getsnapshot", "\"ASSET_NAME\" 28546 1000 2000")
                 + HelpExampleRpc("getsnapshot", "\"ASSET_NAME\" 28546")
         );
 
@@ -2954,27 +2974,47 @@ UniValue getsnapshot(const JSONRPCRequest& request)
     std::string asset_name = request.params[0].get_str();
     int block_height = request.params[1].get_int();
 
+    size_t count = SIZE_MAX;
+    if (request.params.size() > 2) {
+        if (request.params[2].get_int() < 1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be greater than 1.");
+        count = request.params[2].get_int();
+    }
+
+    size_t start = 0;
+    if (request.params.size() > 3) {
+        if (request.params[3].get_int() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "start must not be negative.");
+        start = request.params[3].get_int();
+    }
+
     if (!pAssetSnapshotDb)
         throw JSONRPCError(RPC_DATABASE_ERROR, std::string("Asset Snapshot database is not setup. Please restart wallet to try again"));
 
     LOCK(cs_main);
     UniValue result (UniValue::VOBJ);
 
-    CAssetSnapshotDBEntry snapshotDbEntry;
+    //  Stream the owners, only the requested ones are kept
+    CAssetSnapshotCursor cursor(*pAssetSnapshotDb);
 
-    if (pAssetSnapshotDb->RetrieveOwnershipSnapshot(asset_name, block_height, snapshotDbEntry)) {
-        result.push_back(Pair("name", snapshotDbEntry.assetName));
-        result.push_back(Pair("height", snapshotDbEntry.height));
+    if (cursor.Open(asset_name, block_height)) {
+        result.push_back(Pair("name", asset_name));
+        result.push_back(Pair("height", block_height));
 
         UniValue entries(UniValue::VARR);
-        for (auto const & ownerAndAmt : snapshotDbEntry.ownersAndAmounts) {
+        for (size_t i = 0; cursor.Valid() && entries.size() < count; cursor.Next(), i++) {
+            if (i < start)
+                continue;
+
             UniValue entry(UniValue::VOBJ);
 
-            entry.push_back(Pair("address", ownerAndAmt.first));
-            entry.push_back(Pair("amount_owned", UnitValueFromAmount(ownerAndAmt.second, snapshotDbEntry.assetName)));
+            entry.push_back(Pair("address", cursor.GetOwner().first));
+            entry.push_back(Pair("amount_owned", UnitValueFromAmount(cursor.GetOwner().second, asset_name)));
 
             entries.push_back(entry);
         }
+        if (cursor.Failed())
+            throw JSONRPCError(RPC_DATABASE_ERROR, std::string("Failed to read the asset snapshot"));
 
         result.push_back(Pair("owners", entries));
 
@@ -3074,7 +3114,7 @@ static const CRPCCommand commands[] =
     { "restricted assets",   "checkglobalrestriction",     &checkglobalrestriction,     {"restricted_name"}},
     { "restricted assets",   "isvalidverifierstring",      &isvalidverifierstring,      {"verifier_string"}},
 
-    { "assets",   "getsnapshot",                &getsnapshot,                {"asset_name", "block_height"}},
+    { "assets",   "getsnapshot",                &getsnapshot,                {"asset_name", "block_height", "count", "start"}},
     { "assets",   "purgesnapshot",              &purgesnapshot,              {"asset_name", "block_height"}},
 };
 
@@ -29,7 +29,10 @@
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "hash.h"
+#include "net.h"
+#include "net_processing.h"
 #include "warnings.h"
 
 #include <stdint.h>
@@ -1073,22 +1076,17 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
 };
 
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+static void ApplyStats(CCoinsStats &stats, CCoinsHasher& hasher, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     assert(!outputs.empty());
-    ss << hash;
-    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
     stats.nTransactions++;
     for (const auto output : outputs) {
-        ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT(output.second.out.nValue);
+        hasher.Add(COutPoint(hash, output.first), output.second);
         stats.nTransactionOutputs++;
         stats.nTotalAmount += output.second.out.nValue;
         stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
                            2 /* scriptPubKey len */ + output.second.out.scriptPubKey.size() /* scriptPubKey */;
     }
-    ss << VARINT(0);
 }
 
 //! Calculate statistics about the unspent transaction output set
@@ -1097,13 +1095,13 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
     std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
     assert(pcursor);
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = pcursor->GetBestBlock();
     {
         LOCK(cs_main);
         stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
     }
-    ss << stats.hashBlock;
+    // The same hash a UTXO snapshot's coins are checked against
+    CCoinsHasher hasher(stats.hashBlock);
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
     while (pcursor->Valid()) {
@@ -1112,7 +1110,7 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         Coin coin;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
             if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
+                ApplyStats(stats, hasher, prevkey, outputs);
                 outputs.clear();
             }
             prevkey = key.hash;
@@ -1123,9 +1121,9 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         pcursor->Next();
     }
     if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
+        ApplyStats(stats, hasher, prevkey, outputs);
     }
-    stats.hashSerialized = ss.GetHash();
+    stats.hashSerialized = hasher.GetHash();
     stats.nDiskSize = view->EstimateSize();
     return true;
 }
@@ -1875,6 +1873,105 @@ UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue UTXOSnapshotToJSON(const fs::path& path, const CUTXOSnapshotMetadata& metadata, const CUTXOSnapshotStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("path", path.string()));
+    ret.push_back(Pair("base_hash", metadata.hashBlock.GetHex()));
+    ret.push_back(Pair("base_height", metadata.nHeight));
+    ret.push_back(Pair("nchaintx", (int64_t)metadata.nChainTx));
+    ret.push_back(Pair("assetindex", metadata.fAssetIndex));
+    ret.push_back(Pair("coins", (int64_t)stats.nCoins));
+    ret.push_back(Pair("asset_entries", (int64_t)stats.nAssetEntries));
+    ret.push_back(Pair("restricted_entries", (int64_t)stats.nRestrictedEntries));
+    ret.push_back(Pair("coins_hash", stats.hashCoins.GetHex()));
+    ret.push_back(Pair("assets_hash", stats.hashAssets.GetHex()));
+    if (metadata.fAssetIndex)
+        ret.push_back(Pair("asset_holders_hash", stats.hashAssetHolders.GetHex()));
+    return ret;
+}
+
+static const std::string UTXO_SNAPSHOT_RESULT_HELP =
+    "{\n"
+    "  \"path\": \"path\",           (string) The absolute path of the snapshot file\n"
+    "  \"base_hash\": \"hash\",      (string) The block the snapshot was taken at\n"
+    "  \"base_height\": n,          (numeric) The height of that block\n"
+    "  \"nchaintx\": n,             (numeric) The number of transactions in the chain up to that block\n"
+    "  \"assetindex\": true|false,  (boolean) Whether the snapshot has the asset holder tables of -assetindex\n"
+    "  \"coins\": n,                (numeric) The number of unspent transaction outputs\n"
+    "  \"asset_entries\": n,        (numeric) The number of asset database entries\n"
+    "  \"restricted_entries\": n,   (numeric) The number of restricted asset database entries\n"
+    "  \"coins_hash\": \"hash\",     (string) The hash_serialized_2 of the unspent transaction outputs\n"
+    "  \"assets_hash\": \"hash\",    (string) The hash of the asset and restricted asset tables\n"
+    "  \"asset_holders_hash\": \"hash\" (string) The hash of the asset holder tables, with assetindex only\n"
+    "}\n";
+
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the unspent transaction output set and the asset databases at the tip to a UTXO snapshot file,\n"
+            "which loadtxoutset can load into a new node.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) The file to write, relative to the data directory unless absolute\n"
+            "\nResult:\n"
+            + UTXO_SNAPSHOT_RESULT_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    CUTXOSnapshotMetadata metadata;
+    CUTXOSnapshotStats stats;
+    std::string strError;
+    if (!DumpUTXOSnapshot(GetParams(), path, metadata, stats, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    return UTXOSnapshotToJSON(path, metadata, stats);
+}
+
+UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "loadtxoutset \"path\"\n"
+            "\nReplaces the chainstate with a UTXO snapshot file written by dumptxoutset and makes the snapshot block the tip.\n"
+            "The header of the snapshot block must be known, so let the headers sync first, and the active chain must\n"
+            "still be below it. The blocks up to the snapshot block are not downloaded or checked, and the wallet is not\n"
+            "rescanned. It can't be used with -txindex, -addressindex, -spentindex or -timestampindex.\n"
+            "Only a snapshot whose hashes are pinned for its height in the chain params is loaded.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) The file to load, relative to the data directory unless absolute\n"
+            "\nResult:\n"
+            + UTXO_SNAPSHOT_RESULT_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+
+    CUTXOSnapshotMetadata metadata;
+    CUTXOSnapshotStats stats;
+    std::string strError;
+    if (!LoadUTXOSnapshot(GetParams(), path, metadata, stats, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    // Download the blocks on top of the snapshot, and stop offering the full chain like prune mode does
+    ResetLastCommonBlocks();
+    if (g_connman)
+        g_connman->RemoveLocalServices(NODE_NETWORK);
+
+    return UTXOSnapshotToJSON(path, metadata, stats);
+}
+
 UniValue clearmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -1919,6 +2016,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           {"path"} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
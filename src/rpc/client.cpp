@@ -180,6 +180,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressutxos", 0, "addresses"},
     { "getaddressmempool", 0, "addresses"},
     { "getaddressmempool", 1, "includeAssets"},
+    { "waitforaddressmempool", 0, "addresses"},
+    { "waitforaddressmempool", 1, "includeAssets"},
     { "bumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
@@ -204,6 +206,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "listassetbalancesbyaddress", 2, "count"},
     { "listassetbalancesbyaddress", 3, "start"},
     { "sendmessage", 2, "expire_time"},
+    { "viewallmessages", 1, "from_time"},
+    { "viewallmessages", 2, "to_time"},
+    { "viewallmessages", 3, "count"},
+    { "viewallmessages", 4, "start"},
     { "requestsnapshot", 1, "block_height"},
     { "getsnapshotrequest", 1, "block_height"},
     { "listsnapshotrequests", 1, "block_height"},
@@ -213,6 +219,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getdistributestatus", 1, "snapshot_height"},
     { "getdistributestatus", 3, "gross_distribution_amount"},
     { "getsnapshot", 1, "block_height"},
+    { "getsnapshot", 2, "count"},
+    { "getsnapshot", 3, "start"},
     { "purgesnapshot", 1, "block_height"},
     { "stop", 0, "wait"},
     { "getkawpowhash", 3, "height"},
@@ -6,6 +6,7 @@
 #include "assets/assetdb.h"
 #include "assets/messages.h"
 #include "assets/myassetsdb.h"
+#include <limits>
 #include <map>
 #include "tinyformat.h"
 
@@ -39,11 +40,18 @@ std::string MessageActivationWarning()
 }
 
 UniValue viewallmessages(const JSONRPCRequest& request) {
-    if (request.fHelp || !AreMessagesDeployed() || request.params.size() != 0)
+    if (request.fHelp || !AreMessagesDeployed() || request.params.size() > 5)
         throw std::runtime_error(
-                "viewallmessages \n"
+                "viewallmessages ( \"channel_name\" from_time to_time count start )\n"
                 + MessageActivationWarning() +
-                "\nView all messages that the wallet contains\n"
+                "\nView all messages that the wallet contains, ordered by channel and time\n"
+
+                "\nArguments:\n"
+                "1. \"channel_name\"     (string, optional, default=\"\") Only show the messages of this channel, all channels if empty\n"
+                "2. from_time          (integer, optional, default=0) Only show messages sent at or after this time, in seconds since epoch\n"
+                "3. to_time            (integer, optional) Only show messages sent at or before this time, in seconds since epoch\n"
+                "4. count              (integer, optional) The number of messages to show, all of them if not given\n"
+                "5. start              (integer, optional, default=0) The number of messages to skip\n"
 
                 "\nResult:\n"
                 "\"Asset Name:\"                     (string) The name of the asset the message was sent on\n"
@@ -57,7 +65,9 @@ UniValue viewallmessages(const JSONRPCRequest& request) {
 
                 "\nExamples:\n"
                 + HelpExampleCli("viewallmessages", "")
+                + HelpExampleCli("viewallmessages", "\"CHANNEL~NEWS\" 1577836800 1580515200 50")
                 + HelpExampleRpc("viewallmessages", "")
+                + HelpExampleRpc("viewallmessages", "\"CHANNEL~NEWS\" 0 1580515200 50 100")
         );
 
     if (!fMessaging) {
@@ -72,32 +82,38 @@ UniValue viewallmessages(const JSONRPCRequest& request) {
         return ret;
     }
 
-    std::set<CMessage> setMessages;
+    std::string channel_name = "";
+    if (request.params.size() > 0)
+        channel_name = request.params[0].get_str();
 
-    pmessagedb->LoadMessages(setMessages);
+    int64_t from_time = 0;
+    if (request.params.size() > 1 && !request.params[1].isNull())
+        from_time = request.params[1].get_int64();
 
-    for (auto pair : mapDirtyMessagesOrphaned) {
-        CMessage message = pair.second;
-        message.status = MessageStatus::ORPHAN;
-        if (setMessages.count(message))
-            setMessages.erase(message);
-        setMessages.insert(message);
-    }
+    int64_t to_time = std::numeric_limits<int64_t>::max();
+    if (request.params.size() > 2 && !request.params[2].isNull())
+        to_time = request.params[2].get_int64();
 
-    for (auto out : setDirtyMessagesRemove) {
-        CMessage message;
-        message.out = out;
-        setMessages.erase(message);
+    int count = -1;
+    if (request.params.size() > 3 && !request.params[3].isNull()) {
+        count = request.params[3].get_int();
+        if (count < 1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be greater than 0.");
     }
 
-    for (auto pair : mapDirtyMessagesAdd) {
-        setMessages.erase(pair.second);
-        setMessages.insert(pair.second);
+    int start = 0;
+    if (request.params.size() > 4) {
+        start = request.params[4].get_int();
+        if (start < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "start must be 0 or greater.");
     }
 
+    std::vector<CMessage> vMessages;
+    pmessagedb->LoadMessages(channel_name, from_time, to_time, start, count, vMessages);
+
     UniValue messages(UniValue::VARR);
 
-    for (auto message : setMessages) {
+    for (const auto& message : vMessages) {
         UniValue obj(UniValue::VOBJ);
 
         obj.push_back(Pair("Asset Name", message.strName));
@@ -170,6 +186,39 @@ UniValue viewallmessagechannels(const JSONRPCRequest& request) {
     return channels;
 }
 
+UniValue getchannelscanstatus(const JSONRPCRequest& request) {
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+                "getchannelscanstatus \n"
+                + MessageActivationWarning() +
+                "\nShow the progress of the scan for message channels the wallet owns, which runs the first time messaging starts\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"scanning\" : true|false,          (boolean) If the scan is running\n"
+                "  \"start_height\" : n,              (numeric) The first block height scanned\n"
+                "  \"end_height\" : n,                (numeric) The last block height scanned\n"
+                "  \"blocks_scanned\" : n,            (numeric) The number of blocks scanned so far\n"
+                "  \"progress\" : x.xxx,              (numeric) The fraction of blocks scanned\n"
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleCli("getchannelscanstatus", "")
+                + HelpExampleRpc("getchannelscanstatus", "")
+        );
+
+    CMessageChannelScanProgress progress = GetMessageChannelScanProgress();
+    int nBlocks = progress.nEndHeight - progress.nStartHeight + 1;
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("scanning", progress.fRunning));
+    result.push_back(Pair("start_height", progress.nStartHeight));
+    result.push_back(Pair("end_height", progress.nEndHeight));
+    result.push_back(Pair("blocks_scanned", progress.nBlocksDone));
+    result.push_back(Pair("progress", nBlocks > 0 ? (double)progress.nBlocksDone / nBlocks : 1.0));
+
+    return result;
+}
+
 UniValue subscribetochannel(const JSONRPCRequest& request) {
     if (request.fHelp || request.params.size() != 1)
         throw std::runtime_error(
@@ -488,10 +537,11 @@ UniValue viewmyrestrictedaddresses(const JSONRPCRequest& request) {
 static const CRPCCommand commands[] =
     {           //  category    name                          actor (function)             argNames
                 //  ----------- ------------------------      -----------------------      ----------
-            { "messages",       "viewallmessages",            &viewallmessages,            {}},
+            { "messages",       "viewallmessages",            &viewallmessages,            {"channel_name", "from_time", "to_time", "count", "start"}},
             { "messages",       "viewallmessagechannels",     &viewallmessagechannels,     {}},
             { "messages",       "subscribetochannel",         &subscribetochannel,         {"channel_name"}},
             { "messages",       "unsubscribefromchannel",     &unsubscribefromchannel,     {"channel_name"}},
+            { "messages",       "getchannelscanstatus",       &getchannelscanstatus,       {}},
 #ifdef ENABLE_WALLET
             { "messages",       "sendmessage",                &sendmessage,                {"channel", "ipfs_hash", "expire_time"}},
             {"restricted",        "viewmytaggedaddresses",      &viewmytaggedaddresses,       {}},
@@ -12,6 +12,7 @@
 #include "consensus/params.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "miner.h"
@@ -137,7 +138,16 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
         uint256 mix_hash;
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetHashFull(mix_hash), pblock->nBits,
+        // Before KAWPOW only nNonce changes while searching, so the X16R chain and the header up to it are set up once
+        std::unique_ptr<CX16RSchedule> x16r;
+        if (pblock->nTime < nKAWPOWActivationTime) {
+            x16r.reset(new CX16RSchedule(pblock->hashPrevBlock, pblock->nTime >= GetX16RV2ActivationTime()));
+            x16r->SetPrefix(BEGIN(pblock->nVersion), BEGIN(pblock->nNonce) - BEGIN(pblock->nVersion));
+        }
+        auto hashBlock = [&]() {
+            return x16r ? x16r->HashSuffix(BEGIN(pblock->nNonce), sizeof(pblock->nNonce)) : pblock->GetHashFull(mix_hash);
+        };
+        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(hashBlock(), pblock->nBits,
                                                                                       GetParams().GetConsensus())) {
             if (pblock->nTime < nKAWPOWActivationTime) {
                 ++pblock->nNonce;
@@ -795,15 +805,11 @@ static UniValue getkawpowhash(const JSONRPCRequest& request) {
         fCheckTarget = true;
     }
 
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
-
     // Get the context from the block height
-    const auto epoch_number = ethash::get_epoch_number(nHeight);
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+    const auto& context = ethash::get_global_epoch_context(ethash::get_epoch_number(nHeight));
 
     // ProgPow hash
-    const auto result = progpow::hash(*context, nHeight, header_hash, nNonce);
+    const auto result = progpow::hash(context, nHeight, header_hash, nNonce);
 
     uint256 mined_mix_hash = uint256S(to_hex(result.mix_hash));
     uint256 mined_final_hash = uint256S(to_hex(result.final_hash));
@@ -8,6 +8,7 @@
 #include "chain.h"
 #include "clientversion.h"
 #include "core_io.h"
+#include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "httpserver.h"
@@ -26,6 +27,9 @@
 #endif
 #include "warnings.h"
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
@@ -704,9 +708,129 @@ bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
     return a.second.blockHeight < b.second.blockHeight;
 }
 
-bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
-                   std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> b) {
-    return a.second.time < b.second.time;
+static UniValue getAddressMempoolDeltas(const std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &indexes)
+{
+    UniValue result(UniValue::VARR);
+
+    for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::const_iterator it = indexes.begin();
+         it != indexes.end(); it++) {
+
+        std::string address;
+        if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+        }
+
+        UniValue delta(UniValue::VOBJ);
+        delta.push_back(Pair("address", address));
+        delta.push_back(Pair("assetName", it->first.asset));
+        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
+        delta.push_back(Pair("index", (int)it->first.index));
+        delta.push_back(Pair("satoshis", it->second.amount));
+        delta.push_back(Pair("timestamp", it->second.time));
+        if (it->second.amount < 0) {
+            delta.push_back(Pair("prevtxid", it->second.prevhash.GetHex()));
+            delta.push_back(Pair("prevout", (int)it->second.prevout));
+        }
+        result.push_back(delta);
+    }
+
+    return result;
+}
+
+/**
+ * Read the "limit" and "cursor" paging options of an address index call. The cursor is the hex
+ * encoded index key a previous page stopped at. Returns whether the call asks for paged results.
+ */
+template <typename Key>
+static bool getPagingFromParams(const UniValue& params, size_t& nLimit, Key& cursor)
+{
+    nLimit = 0;
+    cursor.SetNull();
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (!limitValue.isNull()) {
+        int limit = limitValue.get_int();
+        if (limit <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+        }
+        nLimit = limit;
+    }
+
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (!cursorValue.isNull()) {
+        std::string strCursor = cursorValue.get_str();
+        if (!IsHex(strCursor)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor must be hexadecimal");
+        }
+        CDataStream ssCursor(ParseHex(strCursor), SER_DISK, CLIENT_VERSION);
+        try {
+            ssCursor >> cursor;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (!ssCursor.empty() || cursor.IsNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+    }
+
+    return nLimit > 0 || !cursor.IsNull();
+}
+
+template <typename Key>
+static std::string getCursorString(const Key& cursor)
+{
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << cursor;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+/** The first key of an address (and asset, if given) in the address index */
+static void getAddressStartKey(const std::pair<uint160, int>& address, const std::string& assetName, CAddressIndexKey& key)
+{
+    key = CAddressIndexKey(address.second, address.first, assetName, 0, 0, uint256(), 0, false);
+}
+
+/** The first key of an address (and asset, if given) in the unspent index */
+static void getAddressStartKey(const std::pair<uint160, int>& address, const std::string& assetName, CAddressUnspentKey& key)
+{
+    key = CAddressUnspentKey(address.second, address.first, assetName, uint256(), 0);
+}
+
+/**
+ * Read one page of index entries for a list of addresses, address after address. read(address, nLimit, cursor)
+ * appends the entries of one address to entries like the index readers do. On return cursor is the key to
+ * continue from, or null once every address has been read.
+ */
+template <typename Key, typename Entry, typename Reader>
+static void readAddressPage(const std::vector<std::pair<uint160, int> >& addresses, const std::string& assetName,
+                            size_t nLimit, Key& cursor, const std::vector<Entry>& entries, Reader read)
+{
+    size_t nFirst = 0;
+    if (!cursor.IsNull()) {
+        while (nFirst < addresses.size() && (addresses[nFirst].first != cursor.hashBytes ||
+                                             (unsigned int)addresses[nFirst].second != cursor.type)) {
+            nFirst++;
+        }
+        if (nFirst == addresses.size()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not belong to any of the addresses");
+        }
+    }
+
+    for (size_t i = nFirst; i < addresses.size(); i++) {
+        if (nLimit > 0 && entries.size() >= nLimit) {
+            // The page is full, the next one starts with this address
+            getAddressStartKey(addresses[i], assetName, cursor);
+            return;
+        }
+        if (!read(addresses[i], nLimit > 0 ? nLimit - entries.size() : 0, cursor)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (!cursor.IsNull()) {
+            return;
+        }
+    }
 }
 
 UniValue getaddressmempool(const JSONRPCRequest& request)
@@ -771,32 +895,158 @@ UniValue getaddressmempool(const JSONRPCRequest& request)
         }
     }
 
-    std::sort(indexes.begin(), indexes.end(), timestampSort);
+    return getAddressMempoolDeltas(indexes);
+}
 
-    UniValue result(UniValue::VARR);
+/** Token for the mempool deltas returned by waitforaddressmempool. Passed back in the next call, it tells whether the
+ *  deltas changed in between */
+static std::string GetAddressMempoolState(const std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >& indexes)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    for (const auto& entry : indexes) {
+        const CMempoolAddressDeltaKey& key = entry.first;
+        ss << key.type << key.addressBytes << key.asset << key.txhash << key.index << key.spending << entry.second.amount;
+    }
+    return ss.GetHash().GetHex();
+}
 
-    for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
-         it != indexes.end(); it++) {
+/** State shared between a waitforaddressmempool call and its mempool subscription, which can outlive the call */
+struct CAddressMempoolWatch
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    std::set<std::pair<uint160, int> > setAddresses;
+    bool fIncludeAssets = false;
+    bool fChanged = false;
+};
 
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+UniValue waitforaddressmempool(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "waitforaddressmempool\n"
+            "\nWaits until a transaction paying to or spending from one of the addresses enters or leaves the mempool,\n"
+            "then returns the mempool deltas of the addresses like getaddressmempool (requires addressindex to be enabled).\n"
+            "\nReturns the current deltas on timeout or exit.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ],\n"
+            "  \"timeout\"  (number, optional, default=0) Time in milliseconds to wait, 0 indicates no timeout\n"
+            "  \"state\"  (string, optional) The state returned by the previous call, returns right away if the deltas\n"
+            "             changed since that call\n"
+            "},\n"
+            "\"includeAssets\" (boolean, optional, default false)  If true asset deltas are watched and returned as well\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"changed\"  (boolean) Whether the mempool deltas of the addresses changed\n"
+            "  \"deltas\"  (array) The mempool deltas, as returned by getaddressmempool\n"
+            "  \"state\"  (string) Pass it to the next call to not miss the changes made between the two calls\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("waitforaddressmempool", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"], \"timeout\": 60000}'")
+            + HelpExampleRpc("waitforaddressmempool", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"], \"timeout\": 60000}")
+        );
+
+    if (!fAddressIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled");
+    }
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(request.params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    int64_t timeout = 0;
+    std::string strState;
+    if (request.params[0].isObject()) {
+        UniValue timeoutValue = find_value(request.params[0].get_obj(), "timeout");
+        if (!timeoutValue.isNull()) {
+            timeout = timeoutValue.get_int64();
+            if (timeout < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Timeout can't be negative");
+            }
+        }
+        UniValue stateValue = find_value(request.params[0].get_obj(), "state");
+        if (!stateValue.isNull()) {
+            strState = stateValue.get_str();
         }
+    }
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("address", address));
-        delta.push_back(Pair("assetName", it->first.asset));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("satoshis", it->second.amount));
-        delta.push_back(Pair("timestamp", it->second.time));
-        if (it->second.amount < 0) {
-            delta.push_back(Pair("prevtxid", it->second.prevhash.GetHex()));
-            delta.push_back(Pair("prevout", (int)it->second.prevout));
+    bool includeAssets = false;
+    if (request.params.size() > 1) {
+        includeAssets = request.params[1].get_bool();
+    }
+
+    if (includeAssets)
+        if (!AreAssetsDeployed())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
+
+    std::shared_ptr<CAddressMempoolWatch> watch = std::make_shared<CAddressMempoolWatch>();
+    watch->setAddresses.insert(addresses.begin(), addresses.end());
+    watch->fIncludeAssets = includeAssets;
+
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > indexes;
+    auto fnGetDeltas = [&]() {
+        indexes.clear();
+        if (includeAssets) {
+            if (!mempool.getAddressIndex(addresses, indexes)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        } else {
+            if (!mempool.getAddressIndex(addresses, RVN, indexes)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+    };
+
+    bool fChanged;
+    {
+        boost::signals2::scoped_connection connection(mempool.NotifyAddressDeltasChanged.connect(
+            [watch](const std::vector<CMempoolAddressDeltaKey>& keys, bool fAdded) {
+                for (const CMempoolAddressDeltaKey& key : keys) {
+                    if ((watch->fIncludeAssets || key.asset == RVN) &&
+                            watch->setAddresses.count(std::make_pair(key.addressBytes, key.type))) {
+                        std::lock_guard<std::mutex> lock(watch->cs);
+                        watch->fChanged = true;
+                        watch->cond.notify_all();
+                        return;
+                    }
+                }
+            }));
+
+        // Subscribed first, so a change made after this read still ends the wait
+        fnGetDeltas();
+        fChanged = !strState.empty() && strState != GetAddressMempoolState(indexes);
+
+        std::unique_lock<std::mutex> lock(watch->cs);
+        const int64_t nDeadline = GetTimeMillis() + timeout;
+        // Nothing signals this wait when the RPC server stops, so wake up regularly to check
+        while (!fChanged && !watch->fChanged && IsRPCRunning()) {
+            int64_t nWait = 1000;
+            if (timeout) {
+                int64_t nRemaining = nDeadline - GetTimeMillis();
+                if (nRemaining <= 0)
+                    break;
+                nWait = std::min(nWait, nRemaining);
+            }
+            watch->cond.wait_for(lock, std::chrono::milliseconds(nWait));
+        }
+        if (watch->fChanged) {
+            fChanged = true;
+            lock.unlock();
+            fnGetDeltas();
         }
-        result.push_back(delta);
     }
 
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("changed", fChanged));
+    result.push_back(Pair("deltas", getAddressMempoolDeltas(indexes)));
+    result.push_back(Pair("state", GetAddressMempoolState(indexes)));
     return result;
 }
 
@@ -815,6 +1065,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    ],\n"
             "  \"chainInfo\",  (boolean, optional, default false) Include chain info with results\n"
             "  \"assetName\"   (string, optional) Get UTXOs for a particular asset instead of RVN ('*' for all assets).\n"
+            "  \"limit\"  (number, optional) Return at most this many outputs, in index order instead of by height\n"
+            "  \"cursor\"  (string, optional) Continue where the page that returned this cursor stopped\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -828,6 +1080,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nWith chainInfo, limit or cursor the outputs are returned as \"utxos\" in an object, together with\n"
+            "\"cursor\" (string) to pass to the next call while more outputs remain.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -856,21 +1110,24 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t nLimit;
+    CAddressUnspentKey cursor;
+    bool fPaged = getPagingFromParams(request.params, nLimit, cursor);
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+    readAddressPage(addresses, assetName == "*" ? "" : assetName, nLimit, cursor, unspentOutputs,
+                    [&](const std::pair<uint160, int>& address, size_t nPageLimit, CAddressUnspentKey& pageCursor) -> bool {
         if (assetName == "*") {
-            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+            return GetAddressUnspent(address.first, address.second, unspentOutputs, nPageLimit, &pageCursor);
         }
-    }
+        return GetAddressUnspent(address.first, address.second, assetName, unspentOutputs, nPageLimit, &pageCursor);
+    });
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    // Pages keep the index order so that they line up, only complete results are sorted
+    if (!fPaged) {
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue utxos(UniValue::VARR);
 
@@ -899,13 +1156,18 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || fPaged) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
+        if (!cursor.IsNull()) {
+            result.push_back(Pair("cursor", getCursorString(cursor)));
+        }
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (includeChainInfo) {
+            LOCK(cs_main);
+            result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", (int)chainActive.Height()));
+        }
         return result;
     } else {
         return utxos;
@@ -929,6 +1191,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"assetName\"   (string, optional) Get deltas for a particular asset instead of RVN.\n"
+            "  \"limit\"  (number, optional) Return about this many deltas, a page always holds all deltas of a transaction\n"
+            "  \"cursor\"  (string, optional) Continue where the page that returned this cursor stopped\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -941,6 +1205,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nWith chainInfo, limit or cursor the deltas are returned as \"deltas\" in an object, together with\n"
+            "\"cursor\" (string) to pass to the next call while more deltas remain.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -986,19 +1252,16 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t nLimit;
+    CAddressIndexKey cursor;
+    bool fPaged = getPagingFromParams(request.params, nLimit, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
+    readAddressPage(addresses, assetName, nLimit, cursor, addressIndex,
+                    [&](const std::pair<uint160, int>& address, size_t nPageLimit, CAddressIndexKey& pageCursor) -> bool {
+        return GetAddressIndex(address.first, address.second, assetName, addressIndex, start, end, nPageLimit, &pageCursor);
+    });
 
     UniValue deltas(UniValue::VARR);
 
@@ -1041,9 +1304,19 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         endInfo.push_back(Pair("height", end));
 
         result.push_back(Pair("deltas", deltas));
+        if (!cursor.IsNull()) {
+            result.push_back(Pair("cursor", getCursorString(cursor)));
+        }
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
 
+        return result;
+    } else if (fPaged) {
+        result.push_back(Pair("deltas", deltas));
+        if (!cursor.IsNull()) {
+            result.push_back(Pair("cursor", getCursorString(cursor)));
+        }
+
         return result;
     } else {
         return deltas;
@@ -1070,6 +1343,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions that changed the balance, counted per address\n"
             "}\n"
             "OR\n"
             "[\n"
@@ -1077,6 +1351,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "    \"assetName\"  (string) The asset associated with the balance (RVN for Ravencoin)\n"
             "    \"balance\"  (string) The current balance in satoshis\n"
             "    \"received\"  (string) The total number of satoshis received (including change)\n"
+            "    \"txcount\"  (number) The number of transactions that changed the balance, counted per address\n"
             "  },...\n"
             "\n]"
             "\nExamples:\n"
@@ -1101,65 +1376,56 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        //assetName -> (balance, received, txcount)
+        std::map<std::string, CAddressBalanceValue> balances;
 
         for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            std::vector<std::pair<std::string, CAddressBalanceValue> > addressBalances;
+            if (!GetAddressBalances((*it).first, (*it).second, addressBalances)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-        }
-
-        //assetName -> (received, balance)
-        std::map<std::string, std::pair<CAmount, CAmount>> balances;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            std::string assetName = it->first.asset;
-            if (balances.count(assetName) == 0) {
-                balances[assetName] = std::make_pair(0, 0);
-            }
-            if (it->second > 0) {
-                balances[assetName].first += it->second;
+            for (const auto& entry : addressBalances) {
+                CAddressBalanceValue& balance = balances[entry.first];
+                balance.balance += entry.second.balance;
+                balance.received += entry.second.received;
+                balance.txCount += entry.second.txCount;
             }
-            balances[assetName].second += it->second;
         }
 
         UniValue result(UniValue::VARR);
 
-        for (std::map<std::string, std::pair<CAmount, CAmount>>::const_iterator it = balances.begin();
+        for (std::map<std::string, CAddressBalanceValue>::const_iterator it = balances.begin();
                 it != balances.end(); it++) {
             UniValue balance(UniValue::VOBJ);
             balance.push_back(Pair("assetName", it->first));
-            balance.push_back(Pair("balance", it->second.second));
-            balance.push_back(Pair("received", it->second.first));
+            balance.push_back(Pair("balance", it->second.balance));
+            balance.push_back(Pair("received", it->second.received));
+            balance.push_back(Pair("txcount", it->second.txCount));
             result.push_back(balance);
         }
 
         return result;
 
     } else {
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-
         CAmount balance = 0;
         CAmount received = 0;
+        int64_t txCount = 0;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            if (it->second > 0) {
-                received += it->second;
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            CAddressBalanceValue addressBalance;
+            if (!GetAddressBalance((*it).first, (*it).second, RVN, addressBalance)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-            balance += it->second;
+            balance += addressBalance.balance;
+            received += addressBalance.received;
+            txCount += addressBalance.txCount;
         }
 
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("balance", balance));
         result.push_back(Pair("received", received));
+        result.push_back(Pair("txcount", txCount));
 
         return result;
     }
@@ -1181,6 +1447,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"limit\" (number, optional) Read about this many index entries, a page always holds all entries of a transaction\n"
+            "  \"cursor\" (string, optional) Continue where the page that returned this cursor stopped\n"
             "},\n"
             "\"includeAssets\" (boolean, optional, default false)  If true this will return an expanded result which includes asset transactions\n"
             "\nResult:\n"
@@ -1188,6 +1456,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nWith limit or cursor the txids of each address are returned in index order as \"txids\" in an object,\n"
+            "together with \"cursor\" (string) to pass to the next call while more remain.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -1211,6 +1481,10 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             end = endValue.get_int();
         }
     }
+    if (start <= 0 || end <= 0) {
+        start = 0;
+        end = 0;
+    }
 
     bool includeAssets = false;
     if (request.params.size() > 1) {
@@ -1221,31 +1495,17 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
+    size_t nLimit;
+    CAddressIndexKey cursor;
+    bool fPaged = getPagingFromParams(request.params, nLimit, cursor);
+
+    std::string assetName = includeAssets ? "" : RVN;
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (includeAssets) {
-            if (start > 0 && end > 0) {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            } else {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            }
-        } else {
-            if (start > 0 && end > 0) {
-                if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex, start, end)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            } else {
-                if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            }
-        }
-    }
+    readAddressPage(addresses, assetName, nLimit, cursor, addressIndex,
+                    [&](const std::pair<uint160, int>& address, size_t nPageLimit, CAddressIndexKey& pageCursor) -> bool {
+        return GetAddressIndex(address.first, address.second, assetName, addressIndex, start, end, nPageLimit, &pageCursor);
+    });
 
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
@@ -1254,7 +1514,7 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
 
-        if (addresses.size() > 1) {
+        if (addresses.size() > 1 && !fPaged) {
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
@@ -1263,12 +1523,21 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
-    if (addresses.size() > 1) {
+    if (addresses.size() > 1 && !fPaged) {
         for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
             result.push_back(it->second);
         }
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", result));
+        if (!cursor.IsNull()) {
+            page.push_back(Pair("cursor", getCursorString(cursor)));
+        }
+        return page;
+    }
+
     return result;
 
 }
@@ -1333,6 +1602,7 @@ static const CRPCCommand commands[] =
 
     /* Address index */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      {"addresses","includeAssets"} },
+    { "addressindex",       "waitforaddressmempool",  &waitforaddressmempool,  {"addresses","includeAssets"} },
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        {"addresses"} },
     { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       {"addresses"} },
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        {"addresses","includeAssets"} },
@@ -412,8 +412,8 @@ UniValue distributereward(const JSONRPCRequest& request) {
     if (!AddDistributeRewardSnapshot(distribRewardSnapshotData))
         throw JSONRPCError(RPC_INVALID_REQUEST, std::string("Distribution of reward has already be created. You must remove the distribution before creating another one"));
 
-    // Trigger the distribution
-    DistributeRewardSnapshot(walletPtr, distribRewardSnapshotData);
+    // Trigger the distribution, the batches are sent out in the background
+    ScheduleRewardDistributions();
 
     return "Created reward distribution";
 }
@@ -431,6 +431,28 @@ UniValue getdistributestatus(const JSONRPCRequest& request) {
                 "4. \"gross_distribution_amount\"  (number, required) The amount of the distribution asset that will be split amongst all owners\n"
                 "5. \"exception_addresses\"        (string, optional) Ownership addresses that should be excluded\n"
 
+                "\nResult:\n"
+                "{\n"
+                "  \"Asset Name\": \"asset_name\",\n"
+                "  \"Height\": \"snapshot_height\",\n"
+                "  \"Distribution Name\": \"distribution_asset_name\",\n"
+                "  \"Distribution Amount\": n,          (numeric) The gross distribution amount\n"
+                "  \"Status\": n,                       (numeric) 1 processing, 2 complete, higher values are errors\n"
+                "  \"Batches\": n,                      (numeric) Transactions the distribution is split into\n"
+                "  \"Batches Sent\": n,\n"
+                "  \"Batches Confirmed\": n,\n"
+                "  \"Payments\": n,\n"
+                "  \"Payments Sent\": n,\n"
+                "  \"Distributor\": {                  Background task sending out all distributions, since startup\n"
+                "    \"Queue Depth\": n,                (numeric) Distributions with batches left to send or confirm\n"
+                "    \"Pending Batches\": n,            (numeric) Their batches that are not in a block yet\n"
+                "    \"Batches Sent\": n,\n"
+                "    \"Payments Sent\": n,\n"
+                "    \"Payments Per Second\": n,        (numeric) Payments sent per second of building and sending batches\n"
+                "    \"Last Run\": n                    (numeric) Time of the last run, in seconds since epoch\n"
+                "  }\n"
+                "}\n"
+
                 "\nExamples:\n"
                 + HelpExampleCli("getdistributestatus", "\"TRONCO\" 12345 \"RVN\" 1000")
                 + HelpExampleCli("getdistributestatus", "\"PHATSTACKS\" 12345 \"DIVIDENDS\" 1000 \"mwN7xC3yomYdvJuVXkVC7ymY9wNBjWNduD,n4Rf18edydDaRBh7t6gHUbuByLbWEoWUTg\"")
@@ -463,7 +485,8 @@ UniValue getdistributestatus(const JSONRPCRequest& request) {
     auto hash = distribRewardSnapshotData.GetHash();
 
     CRewardSnapshot temp;
-    if (!pDistributeSnapshotDb->RetrieveDistributeSnapshotRequest(hash, temp)) {
+    CRewardDistributionProgress progress;
+    if (!GetDistributeRewardStatus(hash, temp, progress)) {
         return "Distribution not found";
     }
 
@@ -474,6 +497,21 @@ UniValue getdistributestatus(const JSONRPCRequest& request) {
     responseObj.push_back(std::make_pair("Distribution Name", temp.strDistributionAsset));
     responseObj.push_back(std::make_pair("Distribution Amount", ValueFromAmount(temp.nDistributionAmount)));
     responseObj.push_back(std::make_pair("Status", temp.nStatus));
+    responseObj.push_back(std::make_pair("Batches", progress.nBatches));
+    responseObj.push_back(std::make_pair("Batches Sent", progress.nBatchesSent));
+    responseObj.push_back(std::make_pair("Batches Confirmed", progress.nBatchesConfirmed));
+    responseObj.push_back(std::make_pair("Payments", progress.nPayments));
+    responseObj.push_back(std::make_pair("Payments Sent", progress.nPaymentsSent));
+
+    CRewardDistributorStats stats = GetRewardDistributorStats();
+    UniValue distributorObj(UniValue::VOBJ);
+    distributorObj.push_back(std::make_pair("Queue Depth", stats.nQueueDepth));
+    distributorObj.push_back(std::make_pair("Pending Batches", stats.nPendingBatches));
+    distributorObj.push_back(std::make_pair("Batches Sent", stats.nBatchesSent));
+    distributorObj.push_back(std::make_pair("Payments Sent", stats.nPaymentsSent));
+    distributorObj.push_back(std::make_pair("Payments Per Second", stats.nSendTime > 0 ? stats.nPaymentsSent * 1000000.0 / stats.nSendTime : 0.0));
+    distributorObj.push_back(std::make_pair("Last Run", stats.nLastRun));
+    responseObj.push_back(std::make_pair("Distributor", distributorObj));
 
     return responseObj;
 }
@@ -261,6 +261,112 @@ BOOST_FIXTURE_TEST_SUITE(asset_tests, BasicTestingSetup)
         BOOST_CHECK_MESSAGE(coin.IsAsset(), "New Asset Coin isn't as asset");
     }
 
+    BOOST_AUTO_TEST_CASE(asset_out_info_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Out Info Test");
+
+        SelectParams(CBaseChainParams::MAIN);
+
+        CScript burnScript = GetScriptForDestination(DecodeDestination(GetParams().GlobalBurnAddress()));
+        CMutableTransaction mtx;
+        mtx.vout.resize(6);
+
+        // Plain RVN output
+        mtx.vout[0].scriptPubKey = burnScript;
+
+        CNewAsset asset("RAVEN", 1000, 8, 1, 0, "");
+        mtx.vout[1].scriptPubKey = burnScript;
+        asset.ConstructTransaction(mtx.vout[1].scriptPubKey);
+        mtx.vout[2].scriptPubKey = burnScript;
+        asset.ConstructOwnerTransaction(mtx.vout[2].scriptPubKey);
+
+        CAssetTransfer transfer("RAVEN", 500);
+        mtx.vout[3].scriptPubKey = burnScript;
+        transfer.ConstructTransaction(mtx.vout[3].scriptPubKey);
+
+        CAssetTransfer transferMessage("RAVEN", 300, DecodeAssetData("QmacSRmrkVmvJfbCpmU6pK72furJ8E8fbKHindrLxmYMQo"), 1600000000);
+        mtx.vout[4].scriptPubKey = burnScript;
+        transferMessage.ConstructTransaction(mtx.vout[4].scriptPubKey);
+
+        CReissueAsset reissue("RAVEN", 200, 8, 1, "");
+        mtx.vout[5].scriptPubKey = burnScript;
+        reissue.ConstructTransaction(mtx.vout[5].scriptPubKey);
+
+        CTransaction tx(mtx);
+
+        BOOST_CHECK(tx.GetAssetOutInfo(0) == nullptr);
+        BOOST_CHECK(tx.GetAssetOutInfo(6) == nullptr);
+
+        const CTxOutAssetInfo* info = tx.GetAssetOutInfo(1);
+        BOOST_REQUIRE(info);
+        BOOST_CHECK(info->nType == TX_NEW_ASSET && !info->fIsOwner && info->fHasNameAndAmount);
+        BOOST_CHECK(info->strName == "RAVEN" && info->nAmount == 1000);
+
+        info = tx.GetAssetOutInfo(2);
+        BOOST_REQUIRE(info);
+        BOOST_CHECK(info->nType == TX_NEW_ASSET && info->fIsOwner && !info->fMoreData);
+        BOOST_CHECK(info->strName == "RAVEN!");
+
+        info = tx.GetAssetOutInfo(3);
+        BOOST_REQUIRE(info);
+        BOOST_CHECK(info->nType == TX_TRANSFER_ASSET && !info->fMoreData && info->nAmount == 500);
+
+        info = tx.GetAssetOutInfo(4);
+        BOOST_REQUIRE(info);
+        BOOST_CHECK(info->nType == TX_TRANSFER_ASSET && info->fMoreData && info->nAmount == 300);
+
+        info = tx.GetAssetOutInfo(5);
+        BOOST_REQUIRE(info);
+        BOOST_CHECK(info->nType == TX_REISSUE_ASSET && info->nAmount == 200);
+
+        // The cached data has to give the same results as decoding the script
+        for (size_t n = 1; n < tx.vout.size(); n++) {
+            CAssetOutputEntry fromScript, fromTx;
+            BOOST_CHECK(GetAssetData(tx.vout[n].scriptPubKey, fromScript));
+            BOOST_CHECK(GetAssetData(tx, n, fromTx));
+            BOOST_CHECK(fromScript.type == fromTx.type);
+            BOOST_CHECK_EQUAL(fromScript.assetName, fromTx.assetName);
+            BOOST_CHECK_EQUAL(fromScript.nAmount, fromTx.nAmount);
+            BOOST_CHECK(fromScript.destination == fromTx.destination);
+            if (fromScript.type == TX_TRANSFER_ASSET) {
+                // Only transfers carry a message, expireTime is left unset for the other types
+                BOOST_CHECK_EQUAL(fromScript.message, fromTx.message);
+                BOOST_CHECK_EQUAL(fromScript.expireTime, fromTx.expireTime);
+            }
+
+            uint160 hashScript, hashTx;
+            std::string nameScript, nameTx;
+            CAmount amountScript, amountTx;
+            BOOST_CHECK(ParseAssetScript(tx.vout[n].scriptPubKey, hashScript, nameScript, amountScript));
+            BOOST_CHECK(ParseAssetScript(tx, n, hashTx, nameTx, amountTx));
+            BOOST_CHECK(hashScript == hashTx);
+            BOOST_CHECK_EQUAL(nameScript, nameTx);
+            BOOST_CHECK_EQUAL(amountScript, amountTx);
+        }
+
+        // A new asset that ends after the amount has a cached name and amount, but doesn't decode as a CNewAsset
+        CDataStream ssShort(SER_NETWORK, PROTOCOL_VERSION);
+        ssShort << std::string("RAVEN") << CAmount(1000);
+        std::vector<unsigned char> vchShort = {RVN_R, RVN_V, RVN_N, RVN_Q};
+        vchShort.insert(vchShort.end(), ssShort.begin(), ssShort.end());
+        mtx.vout.resize(7);
+        mtx.vout[6].scriptPubKey = burnScript;
+        mtx.vout[6].scriptPubKey << OP_RVN_ASSET << vchShort << OP_DROP;
+        CTransaction txShort(mtx);
+        CAssetOutputEntry shortData;
+        BOOST_CHECK(!GetAssetData(txShort.vout[6].scriptPubKey, shortData));
+        BOOST_CHECK(!GetAssetData(txShort, 6, shortData));
+        uint160 shortHash;
+        std::string shortName;
+        CAmount shortAmount;
+        BOOST_CHECK(!ParseAssetScript(txShort.vout[6].scriptPubKey, shortHash, shortName, shortAmount));
+        BOOST_CHECK(!ParseAssetScript(txShort, 6, shortHash, shortName, shortAmount));
+
+        // Nothing is kept for transactions without asset outputs
+        mtx.vout.resize(1);
+        BOOST_CHECK(CTransaction(mtx).GetAssetOutInfo().empty());
+    }
+
     BOOST_AUTO_TEST_CASE(new_asset_is_null_test)
     {
         BOOST_TEST_MESSAGE("Running Asset Coin is Null Test");
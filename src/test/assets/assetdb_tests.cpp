@@ -0,0 +1,348 @@
+// Copyright (c) 2019 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assets/assets.h>
+#include <assets/assetdb.h>
+#include <assets/assetsnapshotdb.h>
+#include <base58.h>
+#include <chainparams.h>
+#include <validation.h>
+#include <test/test_raven.h>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(assetdb_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(asset_address_dir_page_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Address Dir Page Test");
+
+        CAssetsDB db(1 << 20, true);
+
+        // Rows for neighbouring assets must never leak into the page results
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSE", "addr", 1));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET2", "addr", 1));
+
+        const int nHolders = 25;
+        for (int i = 0; i < nHolders; i++) {
+            BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr" + std::to_string(i), i + 1));
+            BOOST_CHECK(db.WriteAddressAssetQuantity("addr0", "ASSET" + std::to_string(i), i + 1));
+        }
+
+        std::vector<std::pair<std::string, CAmount> > vecAll;
+        std::string strStartKey;
+        int nPages = 0;
+        do {
+            std::vector<std::pair<std::string, CAmount> > vecPage;
+            std::string strNextKey;
+            BOOST_CHECK(db.AssetAddressDirPage(vecPage, strNextKey, "ASSET", strStartKey, 10));
+            BOOST_CHECK(vecPage.size() <= 10);
+            vecAll.insert(vecAll.end(), vecPage.begin(), vecPage.end());
+            strStartKey = strNextKey;
+            nPages++;
+        } while (!strStartKey.empty());
+
+        BOOST_CHECK_EQUAL(nPages, 3);
+        BOOST_CHECK_EQUAL(vecAll.size(), (size_t)nHolders);
+
+        CAmount nTotal = 0;
+        std::set<std::string> setAddresses;
+        for (const auto& pair : vecAll) {
+            nTotal += pair.second;
+            setAddresses.insert(pair.first);
+        }
+        BOOST_CHECK_EQUAL(setAddresses.size(), (size_t)nHolders);
+        BOOST_CHECK_EQUAL(nTotal, nHolders * (nHolders + 1) / 2);
+
+        // A page size matching the row count must still report the end of the table
+        std::vector<std::pair<std::string, CAmount> > vecExact;
+        std::string strNextKey;
+        BOOST_CHECK(db.AddressDirPage(vecExact, strNextKey, "addr0", "", nHolders));
+        BOOST_CHECK_EQUAL(vecExact.size(), (size_t)nHolders);
+        BOOST_CHECK(strNextKey.empty());
+
+        // Unknown assets return an empty page
+        std::vector<std::pair<std::string, CAmount> > vecNone;
+        BOOST_CHECK(db.AssetAddressDirPage(vecNone, strNextKey, "NOTHERE", "", 10));
+        BOOST_CHECK(vecNone.empty());
+        BOOST_CHECK(strNextKey.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_name_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Name Index Test");
+
+        std::vector<std::string> vNames = {"RAVEN", "RAVEN1", "RAVEN2", "RAVEN3", "RAVEN/SUB", "RAVEN!", "RAV", "RAVENCOIN",
+                                           "ASSET", "ASSET!", "ASSET/SUB1", "ASSET/SUB2", "ASSET#UNIQUE", "MY_ASSET", "ZZZ"};
+
+        CAssetNameIndex index;
+        for (const auto& name : vNames)
+            index.Add(name);
+        index.Add("RAVEN");
+        index.Add("REMOVED");
+        index.Remove("REMOVED");
+        index.Remove("MISSING");
+        BOOST_CHECK(index.Size() == vNames.size());
+
+        // The database orders the ASSET_FLAG keys by length first
+        std::sort(vNames.begin(), vNames.end(), [](const std::string& a, const std::string& b) {
+            return a.size() != b.size() ? a.size() < b.size() : a < b;
+        });
+
+        for (const std::string& filter : {"*", "RAVEN*", "RAVEN", "ASSET/*", "A*", "RAVEN1*", "NONE*", "NONE", "RAVEN/SUB"}) {
+            std::string prefix = filter;
+            bool fWildcard = prefix.back() == '*';
+            if (fWildcard)
+                prefix.pop_back();
+
+            std::vector<std::string> vExpected;
+            for (const auto& name : vNames) {
+                if (prefix.empty() || (fWildcard && name.find(prefix) == 0) || (!fWildcard && name == prefix))
+                    vExpected.push_back(name);
+            }
+            BOOST_CHECK_EQUAL(index.Count(filter), vExpected.size());
+
+            for (size_t nSkip = 0; nSkip <= vExpected.size() + 1; nSkip++) {
+                for (size_t count = 1; count <= vExpected.size() + 1; count++) {
+                    std::vector<std::string> vPage;
+                    index.Get(filter, nSkip, count, vPage);
+                    size_t nBegin = std::min(nSkip, vExpected.size());
+                    size_t nEnd = std::min(nSkip + count, vExpected.size());
+                    BOOST_CHECK(vPage == std::vector<std::string>(vExpected.begin() + nBegin, vExpected.begin() + nEnd));
+                }
+            }
+        }
+
+        // AssetDir resolves its offsets through the index
+        CAssetsDB db(1 << 20, true);
+        for (const auto& name : {"RAVEN1", "RAVEN2", "RAVEN3", "RAVENCOIN", "OTHER"})
+            BOOST_CHECK(db.WriteAssetData(CNewAsset(name, 1000 * COIN), 1, uint256()));
+
+        std::vector<CDatabasedAssetData> assets;
+        BOOST_CHECK(db.AssetDir(assets, "RAVEN*", 2, -2));
+        BOOST_CHECK_EQUAL(assets.size(), 2);
+        BOOST_CHECK_EQUAL(assets[0].asset.strName, "RAVEN3");
+        BOOST_CHECK_EQUAL(assets[1].asset.strName, "RAVENCOIN");
+
+        db.AddAssetName("RAVEN4");
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("RAVEN4", 1000 * COIN), 2, uint256()));
+        db.RemoveAssetName("RAVEN1");
+        BOOST_CHECK(db.EraseAssetData("RAVEN1"));
+
+        assets.clear();
+        BOOST_CHECK(db.AssetDir(assets, "RAVEN*", 10, 0));
+        BOOST_CHECK_EQUAL(assets.size(), 4);
+        BOOST_CHECK_EQUAL(assets[0].asset.strName, "RAVEN2");
+        BOOST_CHECK_EQUAL(assets[2].asset.strName, "RAVEN4");
+
+        assets.clear();
+        BOOST_CHECK(db.AssetDir(assets, "RAVEN*", 10, -10));
+        BOOST_CHECK(assets.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_holder_stats_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Holder Stats Test");
+
+        CAssetsDB db(1 << 20, true);
+        const std::string burnAddress = GetParams().IssueAssetBurnAddress();
+
+        CAssetHolderStats stats;
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 0);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, -1);
+
+        // Rows written before the stats existed are counted once, burn addresses hold but don't circulate
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr1", 10));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", burnAddress, 5));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET2", "addr1", 7));
+        BOOST_CHECK(db.BuildAssetHolderStats(100));
+
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2);
+        BOOST_CHECK_EQUAL(stats.nCirculating, 10);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 100);
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET2", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 1);
+        BOOST_CHECK_EQUAL(stats.nCirculating, 7);
+
+        // Building again is a no-op
+        BOOST_CHECK(db.BuildAssetHolderStats(200));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 100);
+
+        // Later writes keep the stats in step with the rows
+        db.SetHolderStatsHeight(101);
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 3));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr1", 4));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 3);
+        BOOST_CHECK_EQUAL(stats.nCirculating, 7);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 101);
+
+        // Rewriting a row with the same quantity changes nothing
+        db.SetHolderStatsHeight(102);
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 3));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 101);
+
+        BOOST_CHECK(db.EraseAssetAddressQuantity("ASSET", "addr1"));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", burnAddress, 8));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2);
+        BOOST_CHECK_EQUAL(stats.nCirculating, 3);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 102);
+
+        // The other asset is untouched
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET2", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 1);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 100);
+
+        // A flush writes its rows together with the stats, which only see the net change of each row
+        CAmount nQuantity = 0;
+        db.BeginAddressQuantities(103);
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET2", "addr2", 1));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 9));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 3));
+        BOOST_CHECK(!db.ReadAssetAddressQuantity("ASSET2", "addr2", nQuantity));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET2", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 1);
+        BOOST_CHECK(db.CommitAddressQuantities());
+
+        BOOST_CHECK(db.ReadAssetAddressQuantity("ASSET2", "addr2", nQuantity));
+        BOOST_CHECK_EQUAL(nQuantity, 1);
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET2", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2);
+        BOOST_CHECK_EQUAL(stats.nCirculating, 8);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 103);
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET", stats));
+        BOOST_CHECK_EQUAL(stats.nCirculating, 3);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 102);
+
+        // A flush that fails writes nothing
+        db.BeginAddressQuantities(104);
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET2", "addr3", 5));
+        db.AbortAddressQuantities();
+        BOOST_CHECK(!db.ReadAssetAddressQuantity("ASSET2", "addr3", nQuantity));
+        BOOST_CHECK(db.ReadAssetHolderStats("ASSET2", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2);
+        BOOST_CHECK_EQUAL(stats.nLastChangedHeight, 103);
+    }
+    BOOST_AUTO_TEST_CASE(asset_ownership_journal_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Ownership Journal Test");
+
+        CAssetsDB db(1 << 20, true);
+        int nSnapshotHeight = 0;
+        std::vector<std::string> vAddresses;
+
+        // Only assets with a journal have their changes recorded
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr1", 10));
+        BOOST_CHECK(!db.ReadOwnershipJournal("ASSET", nSnapshotHeight, vAddresses));
+
+        BOOST_CHECK(db.StartOwnershipJournal("ASSET", 100));
+        BOOST_CHECK(db.ReadOwnershipJournal("ASSET", nSnapshotHeight, vAddresses));
+        BOOST_CHECK_EQUAL(nSnapshotHeight, 100);
+        BOOST_CHECK(vAddresses.empty());
+
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 5));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr1", 10)); // unchanged
+        BOOST_CHECK(db.EraseAssetAddressQuantity("ASSET", "addr3"));     // never held any
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSETB", "addr4", 1));
+        BOOST_CHECK(db.EraseAssetAddressQuantity("ASSET", "addr1"));
+        BOOST_CHECK(db.ReadOwnershipJournal("ASSET", nSnapshotHeight, vAddresses));
+        BOOST_CHECK(vAddresses == std::vector<std::string>({"addr1", "addr2"}));
+
+        // Restarting the journal at the next snapshot forgets the changes
+        BOOST_CHECK(db.StartOwnershipJournal("ASSET", 110));
+        BOOST_CHECK(db.ReadOwnershipJournal("ASSET", nSnapshotHeight, vAddresses));
+        BOOST_CHECK_EQUAL(nSnapshotHeight, 110);
+        BOOST_CHECK(vAddresses.empty());
+
+        BOOST_CHECK(db.StopOwnershipJournal("ASSET"));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("ASSET", "addr2", 6));
+        BOOST_CHECK(!db.ReadOwnershipJournal("ASSET", nSnapshotHeight, vAddresses));
+    }
+    BOOST_AUTO_TEST_CASE(asset_snapshot_cursor_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Snapshot Cursor Test");
+
+        CAssetsDB* pOldAssetsDb = passetsdb;
+        passetsdb = new CAssetsDB(1 << 20, true);
+        CAssetSnapshotDB snapshotDb(1 << 20, true);
+
+        auto address = [](int i) {
+            uint160 hash;
+            *(uint32_t*)hash.begin() = i;
+            return EncodeDestination(CKeyID(hash));
+        };
+
+        auto readSnapshot = [&snapshotDb](int nHeight, std::map<std::string, CAmount>& owners) {
+            owners.clear();
+            CAssetSnapshotCursor cursor(snapshotDb);
+            if (!cursor.Open("ASSET", nHeight))
+                return false;
+            for (; cursor.Valid(); cursor.Next())
+                BOOST_CHECK(owners.insert(cursor.GetOwner()).second);
+            return !cursor.Failed();
+        };
+
+        // Enough holders for a few pages
+        std::map<std::string, CAmount> expected10;
+        for (int i = 0; i < 2 * SNAPSHOT_PAGE_SIZE + 10; i++) {
+            BOOST_CHECK(passetsdb->WriteAssetAddressQuantity("ASSET", address(i), i + 1));
+            expected10[address(i)] = i + 1;
+        }
+        BOOST_CHECK(snapshotDb.AddAssetOwnershipSnapshot("ASSET", 10));
+
+        std::map<std::string, CAmount> owners;
+        BOOST_CHECK(readSnapshot(10, owners));
+        BOOST_CHECK(owners == expected10);
+
+        // The next snapshot only records what changed
+        std::map<std::string, CAmount> expected11 = expected10;
+        BOOST_CHECK(passetsdb->EraseAssetAddressQuantity("ASSET", address(0)));
+        expected11.erase(address(0));
+        BOOST_CHECK(passetsdb->WriteAssetAddressQuantity("ASSET", address(5), 1000));
+        expected11[address(5)] = 1000;
+        BOOST_CHECK(passetsdb->WriteAssetAddressQuantity("ASSET", address(5000), 7));
+        expected11[address(5000)] = 7;
+        BOOST_CHECK(snapshotDb.AddAssetOwnershipSnapshot("ASSET", 11));
+
+        BOOST_CHECK(readSnapshot(11, owners));
+        BOOST_CHECK(owners == expected11);
+        BOOST_CHECK(readSnapshot(10, owners));
+        BOOST_CHECK(owners == expected10);
+
+        CAssetSnapshotDBEntry snapshotEntry;
+        BOOST_CHECK(snapshotDb.RetrieveOwnershipSnapshot("ASSET", 11, snapshotEntry));
+        BOOST_CHECK((snapshotEntry.ownersAndAmounts == std::set<std::pair<std::string, CAmount>>(expected11.begin(), expected11.end())));
+
+        // Replacing the base keeps the snapshots built on it intact
+        BOOST_CHECK(passetsdb->WriteAssetAddressQuantity("ASSET", address(6), 2000));
+        std::map<std::string, CAmount> expectedNew10 = expected11;
+        expectedNew10[address(6)] = 2000;
+        BOOST_CHECK(snapshotDb.AddAssetOwnershipSnapshot("ASSET", 10));
+        BOOST_CHECK(readSnapshot(10, owners));
+        BOOST_CHECK(owners == expectedNew10);
+        BOOST_CHECK(readSnapshot(11, owners));
+        BOOST_CHECK(owners == expected11);
+
+        // And so does removing it
+        BOOST_CHECK(passetsdb->WriteAssetAddressQuantity("ASSET", address(7), 3000));
+        std::map<std::string, CAmount> expected12 = expectedNew10;
+        expected12[address(7)] = 3000;
+        BOOST_CHECK(snapshotDb.AddAssetOwnershipSnapshot("ASSET", 12));
+        BOOST_CHECK(snapshotDb.RemoveOwnershipSnapshot("ASSET", 10));
+        BOOST_CHECK(!snapshotDb.OwnershipSnapshotExists("ASSET", 10));
+        BOOST_CHECK(readSnapshot(12, owners));
+        BOOST_CHECK(owners == expected12);
+        BOOST_CHECK(readSnapshot(11, owners));
+        BOOST_CHECK(owners == expected11);
+
+        delete passetsdb;
+        passetsdb = pOldAssetsDb;
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -37,5 +37,45 @@ BOOST_AUTO_TEST_CASE(cache_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(address_amount_map_test)
+{
+    BOOST_TEST_MESSAGE("Running Address Amount Map Test");
+
+    CAssetAddressAmountMap map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(!map.Find("ASSET", "ADDRESS"));
+
+    map.Get("ASSET", "ADDRESS1") = 10;
+    map.Get("ASSET", "ADDRESS2") = 20;
+    map.Get("OTHER", "ADDRESS1") += 5;
+    BOOST_CHECK_EQUAL(map.size(), 3U);
+    BOOST_CHECK(map.count(std::make_pair("ASSET", "ADDRESS1")));
+    BOOST_CHECK(!map.count(std::make_pair("OTHER", "ADDRESS2")));
+    BOOST_CHECK_EQUAL(map.at(std::make_pair("ASSET", "ADDRESS2")), 20);
+    BOOST_CHECK_EQUAL(*map.Find("OTHER", "ADDRESS1"), 5);
+    BOOST_CHECK_THROW(map.at(std::make_pair("OTHER", "ADDRESS2")), std::out_of_range);
+
+    // Inserting doesn't overwrite, like std::map
+    BOOST_CHECK(!map.insert(std::make_pair(std::make_pair("ASSET", "ADDRESS1"), 99)));
+    BOOST_CHECK_EQUAL(map.at(std::make_pair("ASSET", "ADDRESS1")), 10);
+    BOOST_CHECK(map.insert(std::make_pair(std::make_pair("OTHER", "ADDRESS2"), 7)));
+    map[std::make_pair("OTHER", "ADDRESS2")] += 1;
+    BOOST_CHECK_EQUAL(map.at(std::make_pair("OTHER", "ADDRESS2")), 8);
+
+    // A copy has its own tables
+    CAssetAddressAmountMap copy = map;
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(copy.size(), 4U);
+
+    CAmount nTotal = 0;
+    copy.ForEach([&nTotal, &copy](const std::string& assetName, const std::string& address, const CAmount& nAmount) {
+        BOOST_CHECK_EQUAL(*copy.Find(assetName, address), nAmount);
+        nTotal += nAmount;
+    });
+    BOOST_CHECK_EQUAL(nTotal, 43);
+    BOOST_CHECK(copy.DynamicMemoryUsage() > 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <assets/assets.h>
+#include <assets/messages.h>
+#include <assets/myassetsdb.h>
 
 #include <test/test_raven.h>
 
@@ -13,6 +15,8 @@
 #include <chainparams.h>
 #include "consensus/consensus.h"
 
+#include <limits>
+
 
 BOOST_FIXTURE_TEST_SUITE(messaging_tests, BasicTestingSetup)
 
@@ -78,4 +82,89 @@ BOOST_FIXTURE_TEST_SUITE(messaging_tests, BasicTestingSetup)
     }
 
 
+    BOOST_AUTO_TEST_CASE(message_index_test)
+    {
+        CMessageDB db(1 << 20, true);
+        const int64_t nMaxTime = std::numeric_limits<int64_t>::max();
+
+        auto message = [](const std::string& channel, int64_t time, uint32_t n) {
+            return CMessage(COutPoint(uint256S("01"), n), channel, "", 0, time);
+        };
+        auto times = [](const std::vector<CMessage>& vMessages) {
+            std::vector<int64_t> vTimes;
+            for (const auto& message : vMessages)
+                vTimes.push_back(message.time);
+            return vTimes;
+        };
+
+        // Written out of order, 256 and 1 would swap if the time was little endian
+        BOOST_CHECK(db.WriteMessage(message("ASSET~NEWS", 300, 0)));
+        BOOST_CHECK(db.WriteMessage(message("ASSET~NEWS", 256, 1)));
+        BOOST_CHECK(db.WriteMessage(message("ASSET~NEWS", 1, 2)));
+        BOOST_CHECK(db.WriteMessage(message("ASSET!", 100, 3)));
+        BOOST_CHECK(db.WriteMessage(message("OTHER~NEWS", 150, 4)));
+        BOOST_CHECK(db.WriteMessage(message("OTHER~NEWS", int64_t(1) << 33, 5)));
+        BOOST_CHECK(db.BuildMessageIndex());
+
+        std::vector<CMessage> vMessages;
+        BOOST_CHECK(db.LoadMessages("ASSET~NEWS", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{1, 256, 300}));
+
+        // Time range of one channel
+        BOOST_CHECK(db.LoadMessages("ASSET~NEWS", 2, 299, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{256}));
+
+        // Time range over all channels skips the messages outside of it in each channel
+        BOOST_CHECK(db.LoadMessages("", 100, 300, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{100, 256, 300, 150}));
+
+        // Pages
+        BOOST_CHECK(db.LoadMessages("", 0, nMaxTime, 2, 3, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{256, 300, 150}));
+        BOOST_CHECK(db.LoadMessages("", 0, nMaxTime, 5, 3, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{int64_t(1) << 33}));
+        BOOST_CHECK(db.LoadMessages("NONE~NEWS", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK(vMessages.empty());
+
+        // Writing a message again (orphaned) keeps one index entry, erasing it removes the entry
+        CMessage orphan = message("ASSET~NEWS", 256, 1);
+        orphan.status = MessageStatus::ORPHAN;
+        BOOST_CHECK(db.WriteMessage(orphan));
+        BOOST_CHECK(db.LoadMessages("ASSET~NEWS", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK_EQUAL(vMessages.size(), 3U);
+        BOOST_CHECK(vMessages[1].status == MessageStatus::ORPHAN);
+
+        BOOST_CHECK(db.EraseMessage(orphan.out));
+        BOOST_CHECK(db.LoadMessages("ASSET~NEWS", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{1, 300}));
+
+        // Messages in the dirty caches are merged in without a flush, in index order
+        {
+            LOCK(cs_messaging);
+            AddMessage(message("ASSET~NEWS", 200, 6));
+            AddMessage(message("ZED~NEWS", 5, 7));
+            RemoveMessage(message("OTHER~NEWS", 150, 4));
+            OrphanMessage(message("ASSET~NEWS", 300, 0));
+        }
+        BOOST_CHECK(db.LoadMessages("", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{100, 5, 1, 200, 300, int64_t(1) << 33}));
+        BOOST_CHECK(vMessages[4].status == MessageStatus::ORPHAN);
+        BOOST_CHECK(db.LoadMessages("", 0, nMaxTime, 2, 2, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{1, 200}));
+        BOOST_CHECK(db.LoadMessages("ASSET~NEWS", 2, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK((times(vMessages) == std::vector<int64_t>{200, 300}));
+        {
+            LOCK(cs_messaging);
+            setDirtyMessagesRemove.clear();
+            mapDirtyMessagesAdd.clear();
+            mapDirtyMessagesOrphaned.clear();
+        }
+
+        int count = 0;
+        BOOST_CHECK(db.EraseAllMessages(count));
+        BOOST_CHECK_EQUAL(count, 5);
+        BOOST_CHECK(db.LoadMessages("", 0, nMaxTime, 0, -1, vMessages));
+        BOOST_CHECK(vMessages.empty());
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
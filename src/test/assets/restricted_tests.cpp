@@ -9,6 +9,8 @@
 #include <amount.h>
 #include <base58.h>
 #include <chainparams.h>
+#include <validation.h>
+#include <assets/restricteddb.h>
 
 BOOST_FIXTURE_TEST_SUITE(restricted_tests, BasicTestingSetup)
 
@@ -184,4 +186,61 @@ BOOST_FIXTURE_TEST_SUITE(restricted_tests, BasicTestingSetup)
     }
 
 
+    // Swaps in an empty restricted database, asset cache and qualifier cache, and puts the previous ones back when it
+    // goes out of scope, also when a check throws
+    struct AddressQualifierIndexSetup
+    {
+        CRestrictedDB* prestricteddbSaved;
+        CAssetsCache* passetsSaved;
+        CLRUCache<std::string, std::vector<std::string>>* pqualifiersCacheSaved;
+
+        AddressQualifierIndexSetup() : prestricteddbSaved(prestricteddb), passetsSaved(passets), pqualifiersCacheSaved(passetsAddressQualifiersCache)
+        {
+            prestricteddb = new CRestrictedDB(1 << 20, true, true);
+            passets = new CAssetsCache();
+            passetsAddressQualifiersCache = new CLRUCache<std::string, std::vector<std::string>>(MAX_CACHE_ASSETS_SIZE);
+        }
+
+        ~AddressQualifierIndexSetup()
+        {
+            delete passetsAddressQualifiersCache;
+            passetsAddressQualifiersCache = pqualifiersCacheSaved;
+            delete passets;
+            passets = passetsSaved;
+            delete prestricteddb;
+            prestricteddb = prestricteddbSaved;
+        }
+    };
+
+    BOOST_AUTO_TEST_CASE(address_qualifier_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Address Qualifier Index Test");
+
+        std::string address = "mfe7MqgYZgBuXzrT2QTFqZwBXwRDqagHTp";
+        std::string other_address = "n3BQLpXP8TykwH1uBWEgD1tDpJRFMjDCXJ";
+
+        AddressQualifierIndexSetup setup;
+
+        BOOST_CHECK(prestricteddb->WriteAddressQualifier(address, "#KYC"));
+        BOOST_CHECK(prestricteddb->WriteAddressQualifier(address, "#TAG/SUB"));
+        BOOST_CHECK(prestricteddb->WriteAddressQualifier(other_address, "#OTHER"));
+
+        // The first lookup loads every qualifier of the address
+        BOOST_CHECK(passets->CheckForAddressQualifier("#KYC", address));
+        BOOST_CHECK(passetsAddressQualifiersCache->Exists(address));
+        BOOST_CHECK(passetsAddressQualifiersCache->Get(address).size() == 2);
+        BOOST_CHECK(!passetsAddressQualifiersCache->Exists(other_address));
+
+        // Sub qualifiers count for their root qualifier, same as CRestrictedDB::CheckForAddressRootQualifier
+        BOOST_CHECK(passets->CheckForAddressQualifier("#TAG/SUB", address));
+        BOOST_CHECK(passets->CheckForAddressQualifier("#TAG", address));
+        BOOST_CHECK(prestricteddb->CheckForAddressRootQualifier(address, "#TAG"));
+        BOOST_CHECK(!passets->CheckForAddressQualifier("#TA", address));
+        BOOST_CHECK(!passets->CheckForAddressQualifier("#KY", address));
+        BOOST_CHECK(!passets->CheckForAddressQualifier("#TAG/SU", address));
+        BOOST_CHECK(!passets->CheckForAddressQualifier("#OTHER", address));
+        BOOST_CHECK(passets->CheckForAddressQualifier("#OTHER", other_address));
+    }
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assets/rewards.h>
+#include <test/test_raven.h>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(rewards_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(reward_calculator_test)
+    {
+        BOOST_TEST_MESSAGE("Running Reward Calculator Test");
+
+        // Three equal owners of 10 RVN: shares are rounded down, the satoshi left over isn't paid
+        {
+            CRewardCalculator calculator(10 * COIN, MAX_UNIT, 3 * COIN);
+            calculator.AddOwner("c", COIN);
+            calculator.AddOwner("a", COIN);
+            calculator.AddOwner("b", COIN);
+
+            std::vector<OwnerAndAmount> payments;
+            calculator.GetPayments(payments);
+            BOOST_CHECK_EQUAL(payments.size(), 3);
+            BOOST_CHECK_EQUAL(payments[0].address, "a");
+            BOOST_CHECK_EQUAL(payments[0].amount, 333333333);
+            BOOST_CHECK_EQUAL(payments[1].address, "b");
+            BOOST_CHECK_EQUAL(payments[1].amount, 333333333);
+            BOOST_CHECK_EQUAL(payments[2].amount, 333333333);
+        }
+
+        // Payments are whole units of the distribution asset
+        {
+            CRewardCalculator calculator(10 * COIN + 12345, 0, 100);
+            calculator.AddOwner("a", 15);
+            calculator.AddOwner("b", 24);
+            calculator.AddOwner("c", 61);
+
+            std::vector<OwnerAndAmount> payments;
+            calculator.GetPayments(payments);
+            BOOST_CHECK_EQUAL(payments.size(), 3);
+            BOOST_CHECK_EQUAL(payments[0].amount, 1 * COIN); // 1.5
+            BOOST_CHECK_EQUAL(payments[1].amount, 2 * COIN); // 2.4
+            BOOST_CHECK_EQUAL(payments[2].amount, 6 * COIN); // 6.1
+        }
+
+        // Owners whose share rounds to nothing are left out
+        {
+            CRewardCalculator calculator(2 * COIN, 0, 1000);
+            calculator.AddOwner("a", 999);
+            calculator.AddOwner("b", 1);
+
+            std::vector<OwnerAndAmount> payments;
+            calculator.GetPayments(payments);
+            BOOST_CHECK_EQUAL(payments.size(), 1);
+            BOOST_CHECK_EQUAL(payments[0].address, "a");
+            BOOST_CHECK_EQUAL(payments[0].amount, COIN); // 1.998
+        }
+
+        // Products beyond 64 bits are exact, shares that divide evenly add up to the whole payment
+        {
+            const CAmount nSupply = 21000000000 * COIN;
+            CRewardCalculator calculator(nSupply, MAX_UNIT, nSupply);
+            CAmount nOwned = 0;
+            for (int i = 0; i < 1000; i++) {
+                CAmount nAmount = (nSupply / 1000) + (i % 2 ? 7 : -7);
+                calculator.AddOwner("addr" + std::to_string(1000 + i), nAmount);
+                nOwned += nAmount;
+            }
+            BOOST_CHECK_EQUAL(nOwned, nSupply);
+
+            std::vector<OwnerAndAmount> payments;
+            calculator.GetPayments(payments);
+            CAmount nPaid = 0;
+            for (const auto& payment : payments)
+                nPaid += payment.amount;
+            BOOST_CHECK_EQUAL(nPaid, nSupply);
+            BOOST_CHECK_EQUAL(payments[0].amount, nSupply / 1000 - 7);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include <chainparams.h>
 
 #include "LibBoolEE.h"
+#include "assets/verifierprogram.h"
 
 BOOST_FIXTURE_TEST_SUITE(verifier_string_tests, BasicTestingSetup)
 
@@ -367,4 +368,57 @@ BOOST_FIXTURE_TEST_SUITE(verifier_string_tests, BasicTestingSetup)
     }
 
 
+    BOOST_AUTO_TEST_CASE(verifier_program_test)
+    {
+        BOOST_TEST_MESSAGE("Running Verifier Program Test");
+
+        std::vector<std::string> vValid = {
+                "KYC",
+                "KYC&!TEST",
+                "(KYC&!TEST&YMC|TAG&SKIP)|(TAG&KYC&TEST)",
+                "((KYC&!ABC)|DEF&GHI&RET)|(TEST)",
+                "!(ABC.D|!CC_DD)&(EEE|FFF)&!!GGG",
+                "KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KYC&KY80",
+                "((((((((((((((((((((((((((((((((((((TTT))))))))))))))))))))))))))))))))))))",
+                "TEST&!TEST",
+                "AAA|BBB&CCC|(DDD|EEE)&FFF",
+        };
+
+        for (const auto& verifier : vValid) {
+            std::set<std::string> setFoundQualifiers;
+            std::string error;
+            BOOST_CHECK_MESSAGE(CheckVerifierString(verifier, setFoundQualifiers, error), verifier + " - " + error);
+
+            auto program = CompileVerifierString(verifier);
+            BOOST_REQUIRE_MESSAGE(program, "Failed to compile " + verifier);
+
+            // Qualifiers are indexed in the same order CheckVerifierString finds them
+            std::vector<std::string> vQualifiers;
+            for (const auto& qualifier : setFoundQualifiers)
+                vQualifiers.emplace_back(QUALIFIER_CHAR + qualifier);
+            BOOST_CHECK(program->GetQualifiers() == vQualifiers);
+
+            // Every valuation gives the same result as LibBoolEE
+            for (int i = 0; i < 64; i++) {
+                uint64_t bits = InsecureRandBits(vQualifiers.size());
+                LibBoolEE::Vals vals;
+                size_t n = 0;
+                for (const auto& qualifier : setFoundQualifiers)
+                    vals.insert(std::make_pair(qualifier, (bits >> n++) & 1));
+
+                bool expected = LibBoolEE::resolve(verifier, vals);
+                BOOST_CHECK_MESSAGE(program->Evaluate(bits) == expected, verifier);
+                BOOST_CHECK(program->Evaluate([&vals](const std::string& name) { return vals.at(name.substr(1)); }) == expected);
+            }
+        }
+
+        // Strings LibBoolEE rejects don't compile
+        std::vector<std::string> vInvalid = {"", "KYC&", "(KYC", "KYC)", "KYC#XXX~", "!", "()", "KYC&&TEST|", "kyc"};
+        for (const auto& verifier : vInvalid) {
+            BOOST_CHECK_MESSAGE(!CVerifierProgram::Compile(verifier), "Compiled " + verifier);
+            BOOST_CHECK(!CompileVerifierString(verifier));
+        }
+    }
+
+
 BOOST_AUTO_TEST_SUITE_END()
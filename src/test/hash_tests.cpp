@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "algo/sph_multi.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 #include "test/test_raven.h"
 #include "consensus/merkle.h"
@@ -107,6 +109,122 @@ BOOST_FIXTURE_TEST_SUITE(hash_tests, BasicTestingSetup)
 
     };
 
+    BOOST_AUTO_TEST_CASE(sph_multi_test)
+    {
+        BOOST_TEST_MESSAGE("Running sph multi-buffer Test (" << SphMultiAutoDetect() << ")");
+
+        // Lengths around the Keccak-512 (72) and SHA-512 (128) block sizes, counts that leave a scalar remainder
+        const size_t lengths[] = {0, 1, 64, 71, 72, 73, 80, 111, 112, 127, 128, 129, 200};
+        for (size_t len : lengths) {
+            for (size_t count = 1; count <= 19; count++) {
+                std::vector<std::vector<unsigned char>> vData(count), vMulti(count, std::vector<unsigned char>(64));
+                std::vector<const unsigned char*> vIn;
+                std::vector<unsigned char*> vOut;
+                for (size_t i = 0; i < count; i++) {
+                    vData[i] = insecure_rand_ctx.randbytes(len + 1);
+                    vIn.push_back(vData[i].data());
+                    vOut.push_back(vMulti[i].data());
+                }
+
+                unsigned char scalar[64];
+                sph_keccak512_multi(vIn.data(), len, vOut.data(), count);
+                for (size_t i = 0; i < count; i++) {
+                    sph_keccak512_context ctx;
+                    sph_keccak512_init(&ctx);
+                    sph_keccak512(&ctx, vIn[i], len);
+                    sph_keccak512_close(&ctx, scalar);
+                    BOOST_CHECK(memcmp(scalar, vOut[i], 64) == 0);
+                }
+
+                sph_sha512_multi(vIn.data(), len, vOut.data(), count);
+                for (size_t i = 0; i < count; i++) {
+                    sph_sha512_context ctx;
+                    sph_sha512_init(&ctx);
+                    sph_sha512(&ctx, vIn[i], len);
+                    sph_sha512_close(&ctx, scalar);
+                    BOOST_CHECK(memcmp(scalar, vOut[i], 64) == 0);
+                }
+            }
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(hashx16r_multi_test)
+    {
+        BOOST_TEST_MESSAGE("Running HashX16RMulti Test");
+
+        // Enough chains that every algorithm, Keccak and SHA-512 included, is picked at every step
+        const size_t count = 300;
+        std::vector<std::vector<unsigned char>> vData(count);
+        std::vector<const unsigned char*> vInputs;
+        std::vector<uint256> vPrevBlockHashes;
+        for (size_t i = 0; i < count; i++) {
+            vData[i] = insecure_rand_ctx.randbytes(80);
+            vInputs.push_back(vData[i].data());
+            vPrevBlockHashes.push_back(InsecureRand256());
+        }
+
+        std::vector<uint256> vHashes;
+        HashX16RMulti(vInputs, 80, vPrevBlockHashes, false, vHashes);
+        BOOST_CHECK_EQUAL(vHashes.size(), count);
+        for (size_t i = 0; i < count; i++)
+            BOOST_CHECK(vHashes[i] == HashX16R(vData[i].begin(), vData[i].end(), vPrevBlockHashes[i]));
+
+        HashX16RMulti(vInputs, 80, vPrevBlockHashes, true, vHashes);
+        BOOST_CHECK_EQUAL(vHashes.size(), count);
+        for (size_t i = 0; i < count; i++)
+            BOOST_CHECK(vHashes[i] == HashX16RV2(vData[i].begin(), vData[i].end(), vPrevBlockHashes[i]));
+
+        // Headers from all three eras hash the same way in a batch as one by one
+        std::vector<CBlockHeader> vHeaders(count);
+        for (size_t i = 0; i < count; i++) {
+            CBlockHeader& header = vHeaders[i];
+            header.nVersion = 0x20000000;
+            header.hashPrevBlock = vPrevBlockHashes[i];
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = i % 3 == 0 ? 1569945600 - 1 : i % 3 == 1 ? 1569945600 : nKAWPOWActivationTime;
+            header.nBits = 0x1e00ffff;
+            header.nNonce = InsecureRand32();
+            header.nHeight = 1219736;
+            header.nNonce64 = InsecureRandBits(64);
+            header.mix_hash = InsecureRand256();
+        }
+        std::vector<uint256> vHeaderHashes(count);
+        GetBlockHeaderHashes(vHeaders.data(), count, vHeaderHashes.data());
+        for (size_t i = 0; i < count; i++)
+            BOOST_CHECK(vHeaderHashes[i] == vHeaders[i].GetHash());
+    }
+
+    BOOST_AUTO_TEST_CASE(x16r_schedule_test)
+    {
+        BOOST_TEST_MESSAGE("Running X16R Schedule Test");
+
+        for (int n = 0; n < 100; n++) {
+            uint256 hashPrevBlock = InsecureRand256();
+            std::vector<unsigned char> vData = insecure_rand_ctx.randbytes(80);
+            for (bool fV2 : {false, true}) {
+                // Chain the links by hand as the reference
+                uint512 hash[16];
+                for (int i = 0; i < 16; i++)
+                    HashX16RStep(GetHashSelection(hashPrevBlock, i), fV2, i == 0 ? (const void*)vData.data() : (const void*)&hash[i - 1], i == 0 ? 80 : 64, hash[i]);
+                uint256 expected = hash[15].trim256();
+
+                CX16RSchedule x16r(hashPrevBlock, fV2);
+                BOOST_CHECK(x16r.Hash(vData.data(), 80) == expected);
+                BOOST_CHECK(x16r.HashSuffix(vData.data(), 80) == expected);
+                for (size_t nPrefix : {1, 63, 64, 65, 76, 80}) {
+                    x16r.SetPrefix(vData.data(), nPrefix);
+                    BOOST_CHECK(x16r.HashSuffix(vData.data() + nPrefix, 80 - nPrefix) == expected);
+                    BOOST_CHECK(x16r.Hash(vData.data(), 80) == expected);
+                }
+
+                // Resolving another parent must not leave anything of the old one behind
+                uint256 hashOther = InsecureRand256();
+                x16r.Resolve(hashOther);
+                BOOST_CHECK(x16r.Hash(vData.data(), 80) == (fV2 ? HashX16RV2(vData.begin(), vData.end(), hashOther) : HashX16R(vData.begin(), vData.end(), hashOther)));
+            }
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(siphash_test)
     {
         BOOST_TEST_MESSAGE("Running SipHash Test");
@@ -13,7 +13,12 @@
 #include "crypto/ethash/helpers.hpp"
 #include "crypto/ethash/progpow_test_vectors.hpp"
 
+#include "fs.h"
+#include "random.h"
+#include "tinyformat.h"
+
 #include <array>
+#include <cstring>
 
 BOOST_FIXTURE_TEST_SUITE(kawpow_tests, BasicTestingSetup)
 
@@ -139,4 +144,53 @@ BOOST_AUTO_TEST_CASE(kawpow_search)
     BOOST_CHECK(sr.mix_hash == r.mix_hash);
 }
 
+static bool SameLightCache(const ethash::epoch_context& a, const ethash::epoch_context& b)
+{
+    return a.epoch_number == b.epoch_number && a.light_cache_num_items == b.light_cache_num_items &&
+           std::memcmp(a.light_cache, b.light_cache, ethash::get_light_cache_size(a.light_cache_num_items)) == 0 &&
+           std::memcmp(a.l1_cache, b.l1_cache, progpow::l1_cache_size) == 0;
+}
+
+BOOST_AUTO_TEST_CASE(kawpow_light_cache_file)
+{
+    fs::path pathCache = fs::temp_directory_path() / strprintf("test_raven_kawpow_%lu", (unsigned long)insecure_rand_ctx.rand32());
+    fs::create_directories(pathCache);
+    ethash_set_light_cache_dir(pathCache.string().c_str());
+
+    auto context1 = ethash::create_epoch_context(1);
+    const auto header = to_hash256("ffeeddccbbaa9988776655443322110000112233445566778899aabbccddeeff");
+
+    // Preparing an epoch builds it once and writes its light cache out
+    ethash_prepare_global_epoch_context(1);
+    BOOST_CHECK(fs::exists(pathCache / "epoch-1.lc"));
+    const auto& global1 = ethash::get_global_epoch_context(1);
+    BOOST_CHECK(SameLightCache(global1, *context1));
+    BOOST_CHECK(progpow::hash(global1, 7500, header, 42).final_hash == progpow::hash(*context1, 7500, header, 42).final_hash);
+
+    // Move on to epoch 0 so that epoch 1 is read back from its file
+    ethash_prepare_global_epoch_context(0);
+    BOOST_CHECK(fs::exists(pathCache / "epoch-0.lc"));
+    BOOST_CHECK(SameLightCache(ethash::get_global_epoch_context(0), get_ethash_epoch_context_0()));
+    ethash_prepare_global_epoch_context(1);
+    BOOST_CHECK(SameLightCache(ethash::get_global_epoch_context(1), *context1));
+
+    // A damaged file is not trusted, the epoch is rebuilt instead
+    {
+        FILE* file = fsbridge::fopen(pathCache / "epoch-0.lc", "r+b");
+        BOOST_REQUIRE(file);
+        std::fseek(file, -1, SEEK_END);
+        int c = std::fgetc(file);
+        std::fseek(file, -1, SEEK_END);
+        std::fputc(c ^ 0x5a, file);
+        std::fclose(file);
+    }
+    ethash_prepare_global_epoch_context(0);
+    const auto& global0 = ethash::get_global_epoch_context(0);
+    BOOST_CHECK(SameLightCache(global0, get_ethash_epoch_context_0()));
+    BOOST_CHECK(progpow::hash(global0, 0, header, 42).final_hash == progpow::hash(get_ethash_epoch_context_0(), 0, header, 42).final_hash);
+
+    ethash_set_light_cache_dir("");
+    fs::remove_all(pathCache);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
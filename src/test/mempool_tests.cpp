@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "policy/policy.h"
+#include "script/standard.h"
 #include "txmempool.h"
 #include "util.h"
 
@@ -597,4 +598,71 @@ BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
         SetMockTime(0);
     }
 
+    BOOST_AUTO_TEST_CASE(mempool_address_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Address Index Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+        CCoinsView viewBase;
+        CCoinsViewCache view(&viewBase);
+
+        int nAdded = 0, nRemoved = 0;
+        boost::signals2::scoped_connection connection(pool.NotifyAddressDeltasChanged.connect(
+            [&](const std::vector<CMempoolAddressDeltaKey>& keys, bool fAdded) {
+                (fAdded ? nAdded : nRemoved) += keys.size();
+            }));
+
+        uint160 hash1, hash2;
+        hash1.begin()[0] = 1;
+        hash2.begin()[0] = 2;
+        CScript script1 = GetScriptForDestination(CKeyID(hash1));
+        CScript script2 = GetScriptForDestination(CKeyID(hash2));
+
+        // Added out of time order, and one transaction pays both addresses
+        CMutableTransaction tx1 = CMutableTransaction();
+        tx1.vin.resize(1);
+        tx1.vout.resize(1);
+        tx1.vout[0].scriptPubKey = script1;
+        tx1.vout[0].nValue = 1 * COIN;
+        CMutableTransaction tx2 = CMutableTransaction();
+        tx2.vin.resize(1);
+        tx2.vout.resize(1);
+        tx2.vout[0].scriptPubKey = script2;
+        tx2.vout[0].nValue = 2 * COIN;
+        CMutableTransaction tx3 = CMutableTransaction();
+        tx3.vin.resize(1);
+        tx3.vout.resize(2);
+        tx3.vout[0].scriptPubKey = script1;
+        tx3.vout[0].nValue = 3 * COIN;
+        tx3.vout[1].scriptPubKey = script2;
+        tx3.vout[1].nValue = 4 * COIN;
+
+        pool.addAddressIndex(entry.Time(300).FromTx(tx1), view);
+        pool.addAddressIndex(entry.Time(100).FromTx(tx2), view);
+        pool.addAddressIndex(entry.Time(200).FromTx(tx3), view);
+        BOOST_CHECK_EQUAL(nAdded, 4);
+
+        std::vector<std::pair<uint160, int> > addresses;
+        addresses.push_back(std::make_pair(hash1, 1));
+        addresses.push_back(std::make_pair(hash2, 1));
+
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > deltas;
+        BOOST_CHECK(pool.getAddressIndex(addresses, RVN, deltas));
+        BOOST_CHECK_EQUAL(deltas.size(), 4);
+        for (size_t i = 1; i < deltas.size(); i++)
+            BOOST_CHECK(deltas[i-1].second.time <= deltas[i].second.time);
+        BOOST_CHECK(deltas.front().first.txhash == tx2.GetHash());
+        BOOST_CHECK(deltas.back().first.txhash == tx1.GetHash());
+
+        // Removing a transaction drops all of its deltas
+        BOOST_CHECK(pool.removeAddressIndex(tx3.GetHash()));
+        BOOST_CHECK_EQUAL(nRemoved, 2);
+        deltas.clear();
+        BOOST_CHECK(pool.getAddressIndex(addresses, deltas));
+        BOOST_CHECK_EQUAL(deltas.size(), 2);
+        BOOST_CHECK(deltas[0].first.txhash == tx2.GetHash());
+        BOOST_CHECK(deltas[1].first.txhash == tx1.GetHash());
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "test_raven.h"
+#include "algo/sph_multi.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/ethash/include/ethash/progpow.hpp"
 #include "crypto/sha256.h"
 #include "fs.h"
 #include "key.h"
@@ -34,6 +36,8 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string &chainName)
 {
     SHA256AutoDetect();
+    SphMultiAutoDetect();
+    progpow::autodetect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "dbwrapper.h"
+#include "fs.h"
+#include "random.h"
+#include "utxosnapshot.h"
+#include "test/test_raven.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, BasicTestingSetup)
+
+static bool ReadSnapshot(const fs::path& path, CDBWrapper* pdb, bool fVerifyOnly, CUTXOSnapshotMetadata& metadata, std::vector<uint64_t>& vEntries, CUTXOSnapshotStats& stats)
+{
+    CUTXOSnapshotReader reader(fsbridge::fopen(path, "rb"), fVerifyOnly);
+    if (!reader.ReadMetadata(metadata))
+        return false;
+    vEntries.assign(2, 0);
+    if (!reader.ReadTable(pdb, 'a', SNAPSHOT_CONTENT_ASSETS, vEntries[0]) || !reader.ReadTable(pdb, 'b', SNAPSHOT_CONTENT_ASSET_HOLDERS, vEntries[1]) || !reader.Finish())
+        return false;
+    reader.GetContentHashes(stats);
+    return true;
+}
+
+static void WriteSnapshot(const fs::path& path, CDBWrapper& db, const CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats)
+{
+    CUTXOSnapshotWriter writer(fsbridge::fopen(path, "wb"));
+    writer.WriteMetadata(metadata);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    BOOST_CHECK_EQUAL(writer.WriteTable(*pcursor, 'a', SNAPSHOT_CONTENT_ASSETS), 100U);
+    BOOST_CHECK_EQUAL(writer.WriteTable(*pcursor, 'b', SNAPSHOT_CONTENT_ASSET_HOLDERS), 100U);
+    writer.Finish();
+    writer.GetContentHashes(stats);
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_roundtrip_test)
+{
+    fs::path dir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(dir);
+    fs::path path = dir / "utxo.dat";
+
+    {
+        CDBWrapper dbSource(dir / "source", 1 << 20, true, false, true);
+        CDBWrapper dbTarget(dir / "target", 1 << 20, true, false, true);
+
+        std::vector<uint256> vValues;
+        for (uint32_t i = 0; i < 100; i++) {
+            vValues.push_back(InsecureRand256());
+            BOOST_CHECK(dbSource.Write(std::make_pair('a', i), vValues.back()));
+            BOOST_CHECK(dbSource.Write(std::make_pair('b', i), i * 2));
+        }
+        BOOST_CHECK(dbSource.Write(std::make_pair('c', 0), 1));
+
+        // A stale entry the load replaces, and an entry of a table the snapshot doesn't carry
+        BOOST_CHECK(dbTarget.Write(std::make_pair('a', 1000u), 1));
+        BOOST_CHECK(dbTarget.Write(std::make_pair('c', 0), 2));
+
+        CUTXOSnapshotMetadata metadata(GetParams().MessageStart(), InsecureRand256(), 10, 11, true);
+        CUTXOSnapshotStats stats;
+        WriteSnapshot(path, dbSource, metadata, stats);
+        BOOST_CHECK(stats.hashAssets != stats.hashAssetHolders);
+
+        for (bool fVerifyOnly : {true, false}) {
+            CUTXOSnapshotMetadata metadataRead;
+            CUTXOSnapshotStats statsRead;
+            std::vector<uint64_t> vEntries;
+            BOOST_CHECK(ReadSnapshot(path, &dbTarget, fVerifyOnly, metadataRead, vEntries, statsRead));
+            BOOST_CHECK(statsRead.hashCoins == stats.hashCoins);
+            BOOST_CHECK(statsRead.hashAssets == stats.hashAssets);
+            BOOST_CHECK(statsRead.hashAssetHolders == stats.hashAssetHolders);
+            BOOST_CHECK(metadataRead.hashBlock == metadata.hashBlock);
+            BOOST_CHECK_EQUAL(metadataRead.nHeight, 10);
+            BOOST_CHECK_EQUAL(metadataRead.nChainTx, 11U);
+            BOOST_CHECK(metadataRead.fAssetIndex);
+            BOOST_CHECK_EQUAL(vEntries[0], 100U);
+            BOOST_CHECK_EQUAL(vEntries[1], 100U);
+            BOOST_CHECK_EQUAL(dbTarget.Exists(std::make_pair('a', 1000u)), fVerifyOnly);
+        }
+
+        // The entries come out of the other database's obfuscation as they went in
+        for (uint32_t i = 0; i < 100; i++) {
+            uint256 value;
+            uint32_t n = 0;
+            BOOST_CHECK(dbTarget.Read(std::make_pair('a', i), value));
+            BOOST_CHECK(value == vValues[i]);
+            BOOST_CHECK(dbTarget.Read(std::make_pair('b', i), n));
+            BOOST_CHECK_EQUAL(n, i * 2);
+        }
+        int nOther = 0;
+        BOOST_CHECK(dbTarget.Read(std::make_pair('c', 0), nOther));
+        BOOST_CHECK_EQUAL(nOther, 2);
+
+        // The content hashes only depend on the entries, not on the database they were written from
+        {
+            CUTXOSnapshotStats statsTarget;
+            WriteSnapshot(dir / "target.dat", dbTarget, metadata, statsTarget);
+            BOOST_CHECK(statsTarget.hashAssets == stats.hashAssets);
+            BOOST_CHECK(statsTarget.hashAssetHolders == stats.hashAssetHolders);
+
+            BOOST_CHECK(dbTarget.Write(std::make_pair('b', 0u), 1u));
+            WriteSnapshot(dir / "changed.dat", dbTarget, metadata, statsTarget);
+            BOOST_CHECK(statsTarget.hashAssets == stats.hashAssets);
+            BOOST_CHECK(statsTarget.hashAssetHolders != stats.hashAssetHolders);
+        }
+
+        // Tables must come in the order they are asked for
+        {
+            CUTXOSnapshotReader reader(fsbridge::fopen(path, "rb"), true);
+            CUTXOSnapshotMetadata metadataRead;
+            uint64_t nEntries;
+            BOOST_CHECK(reader.ReadMetadata(metadataRead));
+            BOOST_CHECK(!reader.ReadTable(&dbTarget, 'b', SNAPSHOT_CONTENT_ASSETS, nEntries));
+        }
+    }
+
+    // A damaged file fails the checksum
+    {
+        FILE* file = fsbridge::fopen(path, "r+b");
+        BOOST_CHECK(file != nullptr);
+        BOOST_CHECK_EQUAL(fseek(file, 40, SEEK_SET), 0);
+        int ch = fgetc(file);
+        BOOST_CHECK_EQUAL(fseek(file, 40, SEEK_SET), 0);
+        fputc(ch ^ 0x01, file);
+        fclose(file);
+
+        CUTXOSnapshotMetadata metadataRead;
+        CUTXOSnapshotStats statsRead;
+        std::vector<uint64_t> vEntries;
+        BOOST_CHECK(!ReadSnapshot(path, nullptr, true, metadataRead, vEntries, statsRead));
+    }
+
+    fs::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,17 +6,24 @@
 
 #include "txdb.h"
 
+#include "addressindex.h"
 #include "chainparams.h"
 #include "hash.h"
 #include "random.h"
 #include "pow.h"
+#include "spentindex.h"
+#include "timestampindex.h"
 #include "uint256.h"
 #include "util.h"
 #include "ui_interface.h"
 #include "init.h"
+#include "utxosnapshot.h"
 #include "validation.h"
 
+#include <algorithm>
+#include <atomic>
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
@@ -36,6 +43,7 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_SNAPSHOT_BLOCK = 'S';
 
 namespace {
 
@@ -154,6 +162,33 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+uint64_t CCoinsViewDB::DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor)
+{
+    return writer.WriteTable(cursor, DB_COIN, SNAPSHOT_CONTENT_COINS);
+}
+
+bool CCoinsViewDB::LoadSnapshot(CUTXOSnapshotReader& reader, const uint256& hashBlock, uint64_t& nCoins)
+{
+    if (!reader.VerifyOnly()) {
+        // Mark the database as being in transition to hashBlock until every coin is written, like BatchWrite does
+        CDBBatch batch(db);
+        batch.Erase(DB_BEST_BLOCK);
+        batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, GetBestBlock()});
+        db.WriteBatch(batch);
+    }
+
+    if (!reader.ReadTable(&db, DB_COIN, SNAPSHOT_CONTENT_COINS, nCoins))
+        return false;
+
+    if (!reader.VerifyOnly()) {
+        CDBBatch batch(db);
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+        return db.WriteBatch(batch, true);
+    }
+    return true;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, maxFileSize) {
 }
 
@@ -254,207 +289,117 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+/** Erase every entry of one of the legacy address, timestamp or spent index prefixes */
+template <typename K>
+static bool EraseLegacyIndex(CDBWrapper& db, char chPrefix)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch(db);
 
+    pcursor->Seek(chPrefix);
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
+        std::pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != chPrefix)
             break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize)) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
         }
+        pcursor->Next();
     }
 
-    return true;
+    return db.WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                if (key.second.asset != "RVN") {
-                    unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                }
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
+bool CBlockTreeDB::EraseLegacyIndexes() {
+    bool fEnabled = false;
+    if (ReadFlag("addressindex", fEnabled) && fEnabled) {
+        LogPrintf("Removing the address index from the block index database, it has its own database now\n");
+        if (!EraseLegacyIndex<CAddressIndexKey>(*this, DB_ADDRESSINDEX) ||
+            !EraseLegacyIndex<CAddressUnspentKey>(*this, DB_ADDRESSUNSPENTINDEX) ||
+            !WriteFlag("addressindex", false))
+            return false;
     }
 
-    return true;
-}
-
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (!assetName.empty() && start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
-                                     CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
-    } else if (!assetName.empty()) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    fEnabled = false;
+    if (ReadFlag("timestampindex", fEnabled) && fEnabled) {
+        LogPrintf("Removing the timestamp index from the block index database, it has its own database now\n");
+        if (!EraseLegacyIndex<CTimestampIndexKey>(*this, DB_TIMESTAMPINDEX) ||
+            !EraseLegacyIndex<CTimestampBlockIndexKey>(*this, DB_BLOCKHASHINDEX) ||
+            !WriteFlag("timestampindex", false))
+            return false;
     }
 
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
-        } else {
-            break;
-        }
+    fEnabled = false;
+    if (ReadFlag("spentindex", fEnabled) && fEnabled) {
+        LogPrintf("Removing the spent index from the block index database, it has its own database now\n");
+        if (!EraseLegacyIndex<CSpentIndexKey>(*this, DB_SPENTINDEX) ||
+            !WriteFlag("spentindex", false))
+            return false;
     }
 
     return true;
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
-}
-
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (HashOnchainActive(key.second.blockHash)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-                }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
-
-            pcursor->Next();
-        } else {
-            break;
-        }
-    }
-
+bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+    char ch;
+    if (!Read(std::make_pair(DB_FLAG, name), ch))
+        return false;
+    fValue = ch == '1';
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+bool CBlockTreeDB::WriteSnapshotBlock(const uint256 &hash, uint64_t nChainTx) {
+    return Write(DB_SNAPSHOT_BLOCK, std::make_pair(hash, nChainTx), true);
 }
 
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
-
-    CTimestampBlockIndexValue lts;
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-	return false;
-
-    ltimestamp = lts.ltimestamp;
+bool CBlockTreeDB::ReadSnapshotBlock(uint256 &hash, uint64_t &nChainTx) {
+    std::pair<uint256, uint64_t> value;
+    if (!Read(DB_SNAPSHOT_BLOCK, value))
+        return false;
+    hash = value.first;
+    nChainTx = value.second;
     return true;
 }
 
-bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
-    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
-}
+// Re-hash the given headers across all cores and make sure each one hashes to the key it was stored under
+static bool VerifyBlockIndexPoW(const std::vector<std::pair<uint256, CBlockHeader> >& vHeaders, const Consensus::Params& consensusParams)
+{
+    int nThreads = std::max(GetNumCores(), 1);
+    std::atomic<size_t> nNext(0);
+    std::atomic<bool> fFailed(false);
+
+    auto worker = [&]() {
+        size_t i;
+        while (!fFailed && (i = nNext++) < vHeaders.size()) {
+            const uint256& hashStored = vHeaders[i].first;
+            const CBlockHeader& header = vHeaders[i].second;
+
+            uint256 mix_hash;
+            uint256 hash = header.GetHashFull(mix_hash);
+            bool fMixMatches = header.nTime < nKAWPOWActivationTime || mix_hash == header.mix_hash;
+            if (hash != hashStored || !fMixMatches || !CheckProofOfWork(hash, header.nBits, consensusParams)) {
+                LogPrintf("%s: block index entry %s failed proof of work verification\n", __func__, hashStored.ToString());
+                fFailed = true;
+            }
+        }
+    };
 
-bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
-    char ch;
-    if (!Read(std::make_pair(DB_FLAG, name), ch))
-        return false;
-    fValue = ch == '1';
-    return true;
+    std::vector<std::thread> vThreads;
+    for (int i = 1; i < nThreads; i++)
+        vThreads.emplace_back(worker);
+    worker();
+    for (auto& thread : vThreads)
+        thread.join();
+
+    return !fFailed;
 }
 
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
@@ -463,6 +408,10 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // The entries are keyed by block hash, so the headers don't need to be hashed again unless asked to
+    bool fCheckPoW = gArgs.GetBoolArg("-checkblockindexpow", DEFAULT_CHECKBLOCKINDEXPOW);
+    std::vector<std::pair<uint256, CBlockHeader> > vHeadersToCheck;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -471,7 +420,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(key.second);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -491,6 +440,9 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
                     return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
 
+                if (fCheckPoW)
+                    vHeadersToCheck.emplace_back(key.second, diskindex.GetBlockHeader());
+
                 pcursor->Next();
             } else {
                 return error("%s: failed to read value", __func__);
@@ -500,6 +452,18 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         }
     }
 
+    if (fCheckPoW) {
+        // The cursor returns the entries in hash order. Checking them in height order keeps the workers on the same
+        // KAWPOW epoch, so they share one epoch context instead of rebuilding it for nearly every header
+        std::sort(vHeadersToCheck.begin(), vHeadersToCheck.end(), [](const std::pair<uint256, CBlockHeader>& a, const std::pair<uint256, CBlockHeader>& b) {
+            return a.second.nHeight < b.second.nHeight;
+        });
+
+        LogPrintf("%s: verifying proof of work of %u block index entries\n", __func__, vHeadersToCheck.size());
+        if (!VerifyBlockIndexPoW(vHeadersToCheck, consensusParams))
+            return error("%s: block index proof of work verification failed", __func__);
+    }
+
     return true;
 }
 
@@ -10,9 +10,6 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
-#include "addressindex.h"
-#include "spentindex.h"
-#include "timestampindex.h"
 
 #include <map>
 #include <string>
@@ -21,6 +18,8 @@
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CUTXOSnapshotReader;
+class CUTXOSnapshotWriter;
 class uint256;
 
 //! No need to periodic flush if at least this much space still available.
@@ -39,8 +38,12 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+//! Max memory allocated to the address, spent and timestamp index databases together (MiB)
+static const int64_t nMaxIndexDBCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -checkblockindexpow default
+static const bool DEFAULT_CHECKBLOCKINDEXPOW = false;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -85,6 +88,13 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    //! Iterator over the raw database, for the UTXO snapshot functions
+    CDBIterator *NewIterator() { return db.NewIterator(); }
+    //! Write the coins to a UTXO snapshot, returns how many there were
+    uint64_t DumpSnapshot(CUTXOSnapshotWriter& writer, CDBIterator& cursor);
+    //! Replace the coins with those of a UTXO snapshot taken at hashBlock, and make hashBlock the best block
+    bool LoadSnapshot(CUTXOSnapshotReader& reader, const uint256& hashBlock, uint64_t& nCoins);
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -125,27 +135,13 @@ public:
     bool ReadReindexing(bool &fReindexing);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
-                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
-    bool ReadAddressIndex(uint160 addressHash, int type,
-                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
-    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    /** Remove the address, timestamp and spent index entries older versions kept in this database */
+    bool EraseLegacyIndexes();
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    /** The block a UTXO snapshot was loaded at and the chain's transaction count there, kept as blocks up to it have no data */
+    bool WriteSnapshotBlock(const uint256 &hash, uint64_t nChainTx);
+    bool ReadSnapshotBlock(uint256 &hash, uint64_t &nChainTx);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
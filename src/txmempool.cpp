@@ -422,39 +422,27 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
+    const int64_t nTime = entry.GetTime();
     std::vector<CMempoolAddressDeltaKey> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
         const CTxIn input = tx.vin[j];
         const CTxOut &prevout = view.AccessCoin(input.prevout).out;
-        if (prevout.scriptPubKey.IsPayToScriptHash()) {
-            std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-            CMempoolAddressDeltaKey key(2, uint160(hashBytes), RVN, txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
-        } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-            std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-            CMempoolAddressDeltaKey key(1, uint160(hashBytes), RVN, txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
-        } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-            uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-            CMempoolAddressDeltaKey key(1, hashBytes, RVN, txhash, j, 1);
-            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
+        uint160 hashBytes;
+        if (int addressType = GetScriptAddress(prevout.scriptPubKey, hashBytes)) {
+            CMempoolAddressDeltaKey key(addressType, hashBytes, RVN, nTime, txhash, j, 1);
+            CMempoolAddressDelta delta(nTime, prevout.nValue * -1, input.prevout.hash, input.prevout.n);
             mapAddress.insert(std::make_pair(key, delta));
             inserted.push_back(key);
         } else {
             /** RVN START */
             if (AreAssetsDeployed()) {
-                uint160 hashBytes;
                 std::string assetName;
                 CAmount assetAmount;
                 if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                    CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, j, 1);
-                    CMempoolAddressDelta delta(entry.GetTime(), assetAmount * -1, input.prevout.hash, input.prevout.n);
+                    CMempoolAddressDeltaKey key(1, hashBytes, assetName, nTime, txhash, j, 1);
+                    CMempoolAddressDelta delta(nTime, assetAmount * -1, input.prevout.hash, input.prevout.n);
                     mapAddress.insert(std::make_pair(key, delta));
                     inserted.push_back(key);
                 }
@@ -465,33 +453,19 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 
     for (unsigned int k = 0; k < tx.vout.size(); k++) {
         const CTxOut &out = tx.vout[k];
-        if (out.scriptPubKey.IsPayToScriptHash()) {
-            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-            CMempoolAddressDeltaKey key(2, uint160(hashBytes), RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
-        } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
-            CMempoolAddressDeltaKey key(1, uint160(hashBytes), RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
-        } else if (out.scriptPubKey.IsPayToPublicKey()) {
-            uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
-            CMempoolAddressDeltaKey key(1, hashBytes, RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+        uint160 hashBytes;
+        if (int addressType = GetScriptAddress(out.scriptPubKey, hashBytes)) {
+            CMempoolAddressDeltaKey key(addressType, hashBytes, RVN, nTime, txhash, k, 0);
+            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(nTime, out.nValue)));
             inserted.push_back(key);
         } else {
             /** RVN START */
             if (AreAssetsDeployed()) {
-                uint160 hashBytes;
                 std::string assetName;
                 CAmount assetAmount;
-                if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                    std::pair<addressDeltaMap::iterator, bool> ret;
-                    CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, k, 0);
-                    mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), assetAmount)));
+                if (ParseAssetScript(tx, k, hashBytes, assetName, assetAmount)) {
+                    CMempoolAddressDeltaKey key(1, hashBytes, assetName, nTime, txhash, k, 0);
+                    mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(nTime, assetAmount)));
                     inserted.push_back(key);
                 }
             }
@@ -499,22 +473,70 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    if (!inserted.empty())
+        NotifyAddressDeltasChanged(inserted, true);
+    mapAddressInserted.insert(std::make_pair(txhash, std::move(inserted)));
+}
+
+/** Order of the deltas returned by getAddressIndex */
+static bool CompareAddressDeltaTime(const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& a,
+                                    const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& b)
+{
+    return a.first.time < b.first.time;
+}
+
+/**
+ * Merge the runs of deltas starting at vRunStarts, each of which is already in time order, pairwise until
+ * the whole vector is. This is O(n log runs) instead of sorting all of it.
+ */
+static void MergeAddressDeltaRuns(std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &deltas,
+                                  std::vector<size_t> vRunStarts)
+{
+    while (vRunStarts.size() > 1) {
+        std::vector<size_t> vMerged;
+        for (size_t i = 0; i < vRunStarts.size(); i += 2) {
+            vMerged.push_back(vRunStarts[i]);
+            if (i + 1 < vRunStarts.size()) {
+                size_t nEnd = i + 2 < vRunStarts.size() ? vRunStarts[i+2] : deltas.size();
+                std::inplace_merge(deltas.begin() + vRunStarts[i], deltas.begin() + vRunStarts[i+1],
+                                   deltas.begin() + nEnd, CompareAddressDeltaTime);
+            }
+        }
+        vRunStarts.swap(vMerged);
+    }
+}
+
+void CTxMemPool::getAddressDeltas(const std::pair<uint160, int> &address, const std::string *pAssetName,
+                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results,
+                                  std::vector<size_t> &vRunStarts) const
+{
+    AssertLockHeld(cs);
+    addressDeltaMap::const_iterator ait = pAssetName
+        ? mapAddress.lower_bound(CMempoolAddressDeltaKey(address.second, address.first, *pAssetName))
+        : mapAddress.lower_bound(CMempoolAddressDeltaKey(address.second, address.first));
+
+    const std::string* pRunAsset = nullptr;
+    while (ait != mapAddress.end() && ait->first.addressBytes == address.first && ait->first.type == address.second
+            && (!pAssetName || ait->first.asset == *pAssetName)) {
+        // Each asset of the address is a separate run in time order
+        if (!pRunAsset || ait->first.asset != *pRunAsset) {
+            vRunStarts.push_back(results.size());
+            pRunAsset = &ait->first.asset;
+        }
+        results.push_back(*ait);
+        ait++;
+    }
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
     LOCK(cs);
+    std::vector<size_t> vRunStarts;
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first,
-                                                                                       assetName));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second
-                && (*ait).first.asset == assetName) {
-            results.push_back(*ait);
-            ait++;
-        }
+        getAddressDeltas(*it, &assetName, results, vRunStarts);
     }
+    MergeAddressDeltaRuns(results, vRunStarts);
     return true;
 }
 
@@ -522,13 +544,11 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
     LOCK(cs);
+    std::vector<size_t> vRunStarts;
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+        getAddressDeltas(*it, nullptr, results, vRunStarts);
     }
+    MergeAddressDeltaRuns(results, vRunStarts);
     return true;
 }
 
@@ -538,10 +558,12 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
+        const std::vector<CMempoolAddressDeltaKey>& keys = (*it).second;
+        for (std::vector<CMempoolAddressDeltaKey>::const_iterator mit = keys.begin(); mit != keys.end(); mit++) {
             mapAddress.erase(*mit);
         }
+        if (!keys.empty())
+            NotifyAddressDeltasChanged(keys, false);
         mapAddressInserted.erase(it);
     }
 
@@ -532,6 +532,11 @@ private:
     typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
+    /** Append the deltas of one address (and asset, if given) to results, recording where each run in time order starts */
+    void getAddressDeltas(const std::pair<uint160, int> &address, const std::string *pAssetName,
+                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results,
+                          std::vector<size_t> &vRunStarts) const;
+
     typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
     mapSpentIndex mapSpent;
 
@@ -568,6 +573,7 @@ public:
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate = true);
 
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
+    /** The deltas of all given addresses (for one asset, or all of them), ordered by the time they entered the mempool */
     bool getAddressIndex(std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
     bool getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
@@ -686,6 +692,8 @@ public:
 
     boost::signals2::signal<void (CTransactionRef)> NotifyEntryAdded;
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
+    /** Deltas added to (true) or removed from (false) the address index, signalled with cs held */
+    boost::signals2::signal<void (const std::vector<CMempoolAddressDeltaKey>&, bool)> NotifyAddressDeltasChanged;
 
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
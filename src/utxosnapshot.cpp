@@ -0,0 +1,251 @@
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+
+#include "clientversion.h"
+#include "dbwrapper.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <memory>
+
+static const unsigned char UTXO_SNAPSHOT_MAGIC[5] = {'r', 'u', 't', 'x', 0xff};
+
+//! The files are read and written front to back, a large stdio buffer keeps that to few system calls
+static const size_t UTXO_SNAPSHOT_BUFFER_SIZE = 1 << 20;
+
+CCoinsHasher::CCoinsHasher(const uint256& hashBlock) : ss(SER_GETHASH, PROTOCOL_VERSION), fTx(false)
+{
+    ss << hashBlock;
+}
+
+void CCoinsHasher::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    // The outputs of a transaction are next to each other, its height is written once before them
+    if (!fTx || outpoint.hash != hashTx) {
+        if (fTx)
+            ss << VARINT(0);
+        ss << outpoint.hash;
+        ss << VARINT(coin.nHeight * 2 + coin.fCoinBase);
+        hashTx = outpoint.hash;
+        fTx = true;
+    }
+    ss << VARINT(outpoint.n + 1);
+    ss << coin.out.scriptPubKey;
+    ss << VARINT(coin.out.nValue);
+}
+
+uint256 CCoinsHasher::GetHash()
+{
+    if (fTx)
+        ss << VARINT(0);
+    return ss.GetHash();
+}
+
+CUTXOSnapshotHasher::CUTXOSnapshotHasher() : assets(SER_GETHASH, PROTOCOL_VERSION), holders(SER_GETHASH, PROTOCOL_VERSION), content(SNAPSHOT_CONTENT_COINS)
+{
+}
+
+void CUTXOSnapshotHasher::Init(const uint256& hashBlock)
+{
+    coins.reset(new CCoinsHasher(hashBlock));
+    assets = CHashWriter(SER_GETHASH, PROTOCOL_VERSION);
+    holders = CHashWriter(SER_GETHASH, PROTOCOL_VERSION);
+}
+
+void CUTXOSnapshotHasher::BeginTable(UTXOSnapshotContent contentIn, char chPrefix)
+{
+    content = contentIn;
+    if (content != SNAPSHOT_CONTENT_COINS)
+        TableHasher() << chPrefix;
+}
+
+bool CUTXOSnapshotHasher::AddEntry(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+{
+    if (content != SNAPSHOT_CONTENT_COINS) {
+        TableHasher() << key << value;
+        return true;
+    }
+
+    // Coin keys are the DB_COIN prefix, the txid and VARINT(n)
+    try {
+        CDataStream ssKey(key, SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(value, SER_DISK, CLIENT_VERSION);
+        char chKey;
+        COutPoint outpoint;
+        Coin coin;
+        ssKey >> chKey >> outpoint.hash >> VARINT(outpoint.n);
+        ssValue >> coin;
+        coins->Add(outpoint, coin);
+    } catch (const std::exception& e) {
+        return error("%s: a coin of the UTXO snapshot doesn't decode: %s", __func__, e.what());
+    }
+    return true;
+}
+
+void CUTXOSnapshotHasher::EndTable()
+{
+    if (content != SNAPSHOT_CONTENT_COINS)
+        TableHasher() << std::vector<unsigned char>();
+}
+
+void CUTXOSnapshotHasher::Finish(CUTXOSnapshotStats& stats)
+{
+    stats.hashCoins = coins->GetHash();
+    stats.hashAssets = assets.GetHash();
+    stats.hashAssetHolders = holders.GetHash();
+}
+
+CUTXOSnapshotWriter::CUTXOSnapshotWriter(FILE* fileIn) : file(fileIn, SER_DISK, CLIENT_VERSION), hasher(SER_DISK, CLIENT_VERSION)
+{
+    if (!file.IsNull())
+        setvbuf(file.Get(), nullptr, _IOFBF, UTXO_SNAPSHOT_BUFFER_SIZE);
+}
+
+void CUTXOSnapshotWriter::WriteMetadata(const CUTXOSnapshotMetadata& metadata)
+{
+    Write(FLATDATA(UTXO_SNAPSHOT_MAGIC));
+    Write(UTXO_SNAPSHOT_VERSION);
+    Write(metadata);
+    contentHasher.Init(metadata.hashBlock);
+}
+
+uint64_t CUTXOSnapshotWriter::WriteTable(CDBIterator& cursor, char chPrefix, UTXOSnapshotContent content)
+{
+    Write(chPrefix);
+    contentHasher.BeginTable(content, chPrefix);
+
+    uint64_t nEntries = 0;
+    std::vector<unsigned char> key, value;
+    for (cursor.Seek(chPrefix); cursor.Valid(); cursor.Next()) {
+        cursor.GetRawEntry(key, value);
+        if (key.empty() || key[0] != (unsigned char)chPrefix)
+            break;
+        Write(key);
+        Write(value);
+        if (!contentHasher.AddEntry(key, value))
+            throw std::ios_base::failure("CUTXOSnapshotWriter::WriteTable: undecodable coin in the coin database");
+        nEntries++;
+    }
+
+    Write(std::vector<unsigned char>());
+    contentHasher.EndTable();
+    return nEntries;
+}
+
+void CUTXOSnapshotWriter::Finish()
+{
+    file << hasher.GetHash();
+    if (fflush(file.Get()) != 0)
+        throw std::ios_base::failure("CUTXOSnapshotWriter::Finish: fflush failed");
+    FileCommit(file.Get());
+    file.fclose();
+}
+
+CUTXOSnapshotReader::CUTXOSnapshotReader(FILE* fileIn, bool fVerifyOnlyIn) : file(fileIn, SER_DISK, CLIENT_VERSION), verifier(&file), fVerifyOnly(fVerifyOnlyIn)
+{
+    if (!file.IsNull())
+        setvbuf(file.Get(), nullptr, _IOFBF, UTXO_SNAPSHOT_BUFFER_SIZE);
+}
+
+bool CUTXOSnapshotReader::ReadMetadata(CUTXOSnapshotMetadata& metadata)
+{
+    unsigned char magic[sizeof(UTXO_SNAPSHOT_MAGIC)];
+    verifier >> FLATDATA(magic);
+    if (memcmp(magic, UTXO_SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+        return error("%s: not a UTXO snapshot file", __func__);
+
+    uint16_t nVersion;
+    verifier >> nVersion;
+    if (nVersion != UTXO_SNAPSHOT_VERSION)
+        return error("%s: UTXO snapshot version %d is not supported, expected %d", __func__, nVersion, UTXO_SNAPSHOT_VERSION);
+
+    verifier >> metadata;
+    contentHasher.Init(metadata.hashBlock);
+    return true;
+}
+
+bool CUTXOSnapshotReader::ReadTable(CDBWrapper* pdb, char chPrefix, UTXOSnapshotContent content, uint64_t& nEntries)
+{
+    char chTable;
+    verifier >> chTable;
+    if (chTable != chPrefix)
+        return error("%s: expected table '%c' but the file has table '%c'", __func__, chPrefix, chTable);
+    contentHasher.BeginTable(content, chPrefix);
+
+    std::unique_ptr<CDBBatch> batch;
+    if (pdb && !fVerifyOnly) {
+        if (!EraseTable(*pdb, chPrefix))
+            return false;
+        batch.reset(new CDBBatch(*pdb));
+    }
+    size_t nBatchSize = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+
+    // The keys come in the order LevelDB keeps them in, so each batch appends to the end of the key space
+    nEntries = 0;
+    std::vector<unsigned char> key, value, keyLast;
+    while (true) {
+        verifier >> key;
+        if (key.empty())
+            break;
+        verifier >> value;
+
+        if (key[0] != (unsigned char)chPrefix || (nEntries > 0 && !(keyLast < key)))
+            return error("%s: the keys of table '%c' are out of order", __func__, chPrefix);
+        if (!contentHasher.AddEntry(key, value))
+            return false;
+
+        if (batch) {
+            batch->Write(CFlatData(key), CFlatData(value));
+            if (batch->SizeEstimate() > nBatchSize) {
+                LogPrint(BCLog::COINDB, "Writing a batch of %.2f MiB from the UTXO snapshot\n", batch->SizeEstimate() * (1.0 / 1048576.0));
+                pdb->WriteBatch(*batch);
+                batch->Clear();
+            }
+        }
+
+        keyLast.swap(key);
+        nEntries++;
+    }
+
+    contentHasher.EndTable();
+    if (batch)
+        pdb->WriteBatch(*batch);
+    return true;
+}
+
+bool CUTXOSnapshotReader::EraseTable(CDBWrapper& db, char chPrefix)
+{
+    if (fVerifyOnly)
+        return true;
+
+    CDBBatch batch(db);
+    size_t nBatchSize = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    std::vector<unsigned char> key, value;
+    for (pcursor->Seek(chPrefix); pcursor->Valid(); pcursor->Next()) {
+        pcursor->GetRawEntry(key, value);
+        if (key.empty() || key[0] != (unsigned char)chPrefix)
+            break;
+        batch.Erase(CFlatData(key));
+        if (batch.SizeEstimate() > nBatchSize) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+    }
+    return db.WriteBatch(batch);
+}
+
+bool CUTXOSnapshotReader::Finish()
+{
+    uint256 hashExpected = verifier.GetHash();
+    uint256 hashFile;
+    file >> hashFile;
+    if (hashFile != hashExpected)
+        return error("%s: checksum mismatch, the UTXO snapshot is damaged", __func__);
+    if (fgetc(file.Get()) != EOF)
+        return error("%s: the UTXO snapshot has data after its checksum", __func__);
+    return true;
+}
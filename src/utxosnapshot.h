@@ -0,0 +1,206 @@
+// Copyright (c) 2017-2021 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_UTXOSNAPSHOT_H
+#define RAVEN_UTXOSNAPSHOT_H
+
+#include "coins.h"
+#include "hash.h"
+#include "serialize.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <memory>
+#include <string.h>
+
+class CDBIterator;
+class CDBWrapper;
+
+/**
+ * A UTXO snapshot file holds the chainstate at one block: the coin database and the asset databases, copied table
+ * by table as they are stored. It starts with a magic, the format version and a CUTXOSnapshotMetadata. Each table
+ * is its key prefix followed by its entries in key order, as serialized key and value byte vectors, and ends with an
+ * empty key. The file ends with the double SHA256 of everything before it.
+ *
+ * The checksum only protects against damage. What a snapshot holds is checked against the content hashes pinned for
+ * its height in the chain params, which a node refuses to load it without.
+ */
+static const uint16_t UTXO_SNAPSHOT_VERSION = 2;
+
+/** The chainstate a UTXO snapshot holds */
+class CUTXOSnapshotMetadata
+{
+public:
+    //! Message start of the network the snapshot was taken on
+    unsigned char pchMessageStart[4];
+    uint256 hashBlock;
+    int nHeight;
+    //! Transactions in the chain up to and including hashBlock
+    uint64_t nChainTx;
+    //! Whether the snapshot carries the asset holder tables of -assetindex
+    bool fAssetIndex;
+
+    CUTXOSnapshotMetadata() {
+        SetNull();
+    }
+
+    CUTXOSnapshotMetadata(const unsigned char* pchMessageStartIn, const uint256& hash, int height, uint64_t chainTx, bool fIndex) {
+        memcpy(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart));
+        hashBlock = hash;
+        nHeight = height;
+        nChainTx = chainTx;
+        fAssetIndex = fIndex;
+    }
+
+    void SetNull() {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+        hashBlock.SetNull();
+        nHeight = -1;
+        nChainTx = 0;
+        fAssetIndex = false;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nChainTx);
+        READWRITE(fAssetIndex);
+    }
+};
+
+/** Entries copied into or out of each database by a UTXO snapshot, and the content hashes of what was copied */
+struct CUTXOSnapshotStats
+{
+    uint64_t nCoins = 0;
+    uint64_t nAssetEntries = 0;
+    uint64_t nRestrictedEntries = 0;
+    uint256 hashCoins;
+    uint256 hashAssets;
+    uint256 hashAssetHolders;
+};
+
+/** The content hash a snapshot table is part of */
+enum UTXOSnapshotContent {
+    SNAPSHOT_CONTENT_COINS,         //!< The coin database
+    SNAPSHOT_CONTENT_ASSETS,        //!< The asset and restricted asset tables validation reads
+    SNAPSHOT_CONTENT_ASSET_HOLDERS, //!< The address quantity tables of -assetindex
+};
+
+/** Computes the hash_serialized_2 of gettxoutsetinfo, from the coins in the order the coin database keeps them */
+class CCoinsHasher
+{
+public:
+    explicit CCoinsHasher(const uint256& hashBlock);
+
+    void Add(const COutPoint& outpoint, const Coin& coin);
+
+    /** Only call once, after the last coin */
+    uint256 GetHash();
+
+private:
+    CHashWriter ss;
+    uint256 hashTx;
+    bool fTx;
+};
+
+/**
+ * Content hashes of the chainstate a UTXO snapshot holds. The coins are hashed like gettxoutsetinfo does, so the
+ * coins hash can be compared with any synced node. The asset tables are hashed as they are stored, table by table.
+ * Unlike the file checksum they don't depend on how the file was written.
+ */
+class CUTXOSnapshotHasher
+{
+public:
+    CUTXOSnapshotHasher();
+
+    /** Start over for the chainstate at hashBlock */
+    void Init(const uint256& hashBlock);
+
+    void BeginTable(UTXOSnapshotContent contentIn, char chPrefix);
+    /** Fails on a coin that doesn't decode */
+    bool AddEntry(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value);
+    void EndTable();
+
+    /** Set the hashes in stats, once every table was added */
+    void Finish(CUTXOSnapshotStats& stats);
+
+private:
+    std::unique_ptr<CCoinsHasher> coins;
+    CHashWriter assets;
+    CHashWriter holders;
+    UTXOSnapshotContent content;
+
+    CHashWriter& TableHasher() { return content == SNAPSHOT_CONTENT_ASSETS ? assets : holders; }
+};
+
+/** Writes a UTXO snapshot file. The stream functions throw std::ios_base::failure when the file can't be written */
+class CUTXOSnapshotWriter
+{
+public:
+    explicit CUTXOSnapshotWriter(FILE* fileIn);
+
+    void WriteMetadata(const CUTXOSnapshotMetadata& metadata);
+
+    /** Write every entry of the cursor's database whose key starts with chPrefix, returns how many there were */
+    uint64_t WriteTable(CDBIterator& cursor, char chPrefix, UTXOSnapshotContent content);
+
+    /** Append the checksum, then flush the file to disk and close it */
+    void Finish();
+
+    /** Set the content hashes of the tables written in stats, after Finish */
+    void GetContentHashes(CUTXOSnapshotStats& stats) { contentHasher.Finish(stats); }
+
+private:
+    CAutoFile file;
+    CHashWriter hasher;
+    CUTXOSnapshotHasher contentHasher;
+
+    template<typename T>
+    void Write(const T& obj) {
+        file << obj;
+        hasher << obj;
+    }
+};
+
+/**
+ * Reads a UTXO snapshot file into the databases. The stream functions throw std::ios_base::failure on a short or
+ * unreadable file. A verify-only reader reads the whole file the same way but leaves the databases alone, so a file
+ * can be checked before anything is replaced.
+ */
+class CUTXOSnapshotReader
+{
+public:
+    CUTXOSnapshotReader(FILE* fileIn, bool fVerifyOnlyIn);
+
+    bool VerifyOnly() const { return fVerifyOnly; }
+
+    /** Read the metadata, fails on a file of another format or version */
+    bool ReadMetadata(CUTXOSnapshotMetadata& metadata);
+
+    /** Replace the entries of pdb whose key starts with chPrefix with the next table of the file, written in sorted
+     *  batches of -dbbatchsize bytes. Fails if the table has another prefix or its keys are out of order. A null
+     *  pdb only reads past the table, it is still part of the content hashes */
+    bool ReadTable(CDBWrapper* pdb, char chPrefix, UTXOSnapshotContent content, uint64_t& nEntries);
+
+    /** Remove the entries of db whose key starts with chPrefix, for tables a snapshot doesn't carry */
+    bool EraseTable(CDBWrapper& db, char chPrefix);
+
+    /** Check the checksum against what was read, and that nothing follows it */
+    bool Finish();
+
+    /** Set the content hashes of the tables read in stats, after Finish */
+    void GetContentHashes(CUTXOSnapshotStats& stats) { contentHasher.Finish(stats); }
+
+private:
+    CAutoFile file;
+    CHashVerifier<CAutoFile> verifier;
+    bool fVerifyOnly;
+    CUTXOSnapshotHasher contentHasher;
+};
+
+#endif // RAVEN_UTXOSNAPSHOT_H
@@ -15,9 +15,11 @@
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "crypto/ethash/include/ethash/ethash.hpp"
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
+#include "index/addressindexes.h"
 #include "init.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
@@ -39,6 +41,7 @@
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "validationinterface.h"
 #include "versionbits.h"
 #include "warnings.h"
@@ -211,8 +214,22 @@ namespace {
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /** The block the chainstate was loaded at from a UTXO snapshot, null if it wasn't. Blocks up to it
+     *  were never connected here and may have no data, the snapshot's nChainTx links the chain on top of it. */
+    uint256 hashSnapshotBlock;
+    uint64_t nSnapshotChainTx = 0;
 } // anon namespace
 
+/** The block index entry of hashSnapshotBlock, or nullptr */
+static CBlockIndex* LookupSnapshotBlockIndex()
+{
+    if (hashSnapshotBlock.IsNull())
+        return nullptr;
+    BlockMap::iterator mi = mapBlockIndex.find(hashSnapshotBlock);
+    return mi == mapBlockIndex.end() ? nullptr : mi->second;
+}
+
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
 {
     // Find the first block the caller has in the main chain
@@ -250,6 +267,7 @@ CDistributeSnapshotRequestDB *pDistributeSnapshotDb = nullptr;
 
 CLRUCache<std::string, CNullAssetTxVerifierString> *passetsVerifierCache = nullptr;
 CLRUCache<std::string, int8_t> *passetsQualifierCache = nullptr;
+CLRUCache<std::string, std::vector<std::string>> *passetsAddressQualifiersCache = nullptr;
 CLRUCache<std::string, int8_t> *passetsRestrictionCache = nullptr;
 CLRUCache<std::string, int8_t> *passetsGlobalRestrictionCache = nullptr;
 CRestrictedDB *prestricteddb = nullptr;
@@ -987,10 +1005,11 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         }
 
         if (AreAssetsDeployed()) {
-            for (auto out : tx.vout) {
-                if (out.scriptPubKey.IsAssetScript()) {
+            for (size_t n = 0; n < tx.vout.size(); n++) {
+                const CTxOut& out = tx.vout[n];
+                if (tx.GetAssetOutInfo(n)) {
                     CAssetOutputEntry data;
-                    if (!GetAssetData(out.scriptPubKey, data))
+                    if (!GetAssetData(tx, n, data))
                         continue;
                     if (data.type == TX_NEW_ASSET && !IsAssetNameAnOwner(data.assetName)) {
                         pool.mapAssetToHash[data.assetName] = hash;
@@ -1113,10 +1132,13 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
-    if (!fTimestampIndex)
+    if (!fTimestampIndex || !ptimestampindexer)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
+    if (!ptimestampindexer->BlockUntilSyncedToCurrentChain())
+        return error("Timestamp index is still being built (at height %d)", ptimestampindexer->GetBestHeight());
+
+    if (!ptimestampindexer->ReadTimestampIndex(high, low, fActiveOnly, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -1124,13 +1146,16 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
 
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
-    if (!fSpentIndex)
+    if (!fSpentIndex || !pspentindexer)
         return false;
 
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!pspentindexer->IsSynced())
+        return false;
+
+    if (!pspentindexer->ReadSpentIndex(key, value))
         return false;
 
     return true;
@@ -1138,59 +1163,101 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 
 bool HashOnchainActive(const uint256 &hash)
 {
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (!chainActive.Contains(pblockindex)) {
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
         return false;
     }
 
     return true;
 }
 
+/** The address index once it has caught up with the chain tip, or nullptr (logging why) if it cannot be read */
+static CAddressIndexer* GetReadableAddressIndex()
+{
+    if (!fAddressIndex || !paddressindexer) {
+        error("address index not enabled");
+        return nullptr;
+    }
+
+    if (!paddressindexer->BlockUntilSyncedToCurrentChain()) {
+        error("address index is still being built (at height %d)", paddressindexer->GetBestHeight());
+        return nullptr;
+    }
+
+    return paddressindexer.get();
+}
+
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t nLimit, CAddressIndexKey *pkeyCursor)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    CAddressIndexer* pindexer = GetReadableAddressIndex();
+    if (!pindexer)
+        return false;
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
+    if (!pindexer->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end, nLimit, pkeyCursor))
         return error("unable to get txids for address");
 
     return true;
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t nLimit, CAddressIndexKey *pkeyCursor)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    return GetAddressIndex(addressHash, type, "", addressIndex, start, end, nLimit, pkeyCursor);
+}
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit, CAddressUnspentKey *pkeyCursor)
+{
+    CAddressIndexer* pindexer = GetReadableAddressIndex();
+    if (!pindexer)
+        return false;
+
+    if (!pindexer->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs, nLimit, pkeyCursor))
         return error("unable to get txids for address");
 
     return true;
 }
 
-bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+bool GetAddressUnspent(uint160 addressHash, int type,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit, CAddressUnspentKey *pkeyCursor)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    CAddressIndexer* pindexer = GetReadableAddressIndex();
+    if (!pindexer)
+        return false;
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
+    if (!pindexer->ReadAddressUnspentIndex(addressHash, type, unspentOutputs, nLimit, pkeyCursor))
         return error("unable to get txids for address");
 
     return true;
 }
 
-bool GetAddressUnspent(uint160 addressHash, int type,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+bool GetAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance)
 {
-    if (!fAddressIndex)
-        return error("address index not enabled");
+    CAddressIndexer* pindexer = GetReadableAddressIndex();
+    if (!pindexer)
+        return false;
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
-        return error("unable to get txids for address");
+    if (!pindexer->ReadAddressBalance(addressHash, type, assetName, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
+bool GetAddressBalances(uint160 addressHash, int type,
+                        std::vector<std::pair<std::string, CAddressBalanceValue> > &balances)
+{
+    CAddressIndexer* pindexer = GetReadableAddressIndex();
+    if (!pindexer)
+        return false;
+
+    if (!pindexer->ReadAddressBalances(addressHash, type, balances))
+        return error("unable to get balances for address");
 
     return true;
 }
@@ -1749,6 +1816,15 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull() || !pindex->pprev)
+        return error("%s: no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1811,7 +1887,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out, CAss
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr, bool ignoreAddressIndex = false, bool databaseMessaging = true)
+static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr, bool databaseMessaging = true)
 {
     bool fClean = true;
 
@@ -1837,12 +1913,10 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         return DISCONNECT_FAILED;
     }
     
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     // undo transactions in reverse order
-    CAssetsCache tempCache(*assetsCache);
+    // tempCache only collects the asset spends of this block's own outputs, which are thrown away, so it starts
+    // as an empty layer instead of a copy of assetsCache
+    CAssetsCache tempCache;
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
@@ -1850,61 +1924,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
         std::vector<int> vAssetTxIndex;
         std::vector<int> vNullAssetTxIndex;
-        if (fAddressIndex) {
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
-                    /** RVN START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << hash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // undo receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, k,
-                                                     false), assetAmount));
-
-                            // undo unspent index
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, hash, k),
-                                                   CAddressUnspentValue()));
-                        } else {
-                            continue;
-                        }
-                    }
-                    /** RVN END */
-                }
-            }
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         int indexOfRestrictedAssetVerifierString = -1;
@@ -1920,7 +1939,8 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 /** RVN START */
                 if (AreAssetsDeployed()) {
                     if (assetsCache) {
-                        if (IsScriptTransferAsset(tx.vout[o].scriptPubKey))
+                        const CTxOutAssetInfo* info = tx.GetAssetOutInfo(o);
+                        if (info && info->nType == TX_TRANSFER_ASSET)
                             vAssetTxIndex.emplace_back(o);
                     }
                 }
@@ -2172,67 +2192,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 int res = ApplyTxInUndo(std::move(undo), view, out, assetsCache); /** RVN START */ /* Pass assetsCache into ApplyTxInUndo function */ /** RVN END */
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        /** RVN START */
-                        if (AreAssetsDeployed()) {
-                            std::string assetName;
-                            CAmount assetAmount;
-                            uint160 hashBytes;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                                std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                          << ", " << i << ", " << hash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                                // undo spending activity
-                                addressIndex.push_back(std::make_pair(
-                                        CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, j,
-                                                         true), assetAmount * -1));
-
-                                // restore unspent index
-                                addressUnspentIndex.push_back(std::make_pair(
-                                        CAddressUnspentKey(1, uint160(hashBytes), assetName, input.prevout.hash,
-                                                           input.prevout.n),
-                                        CAddressUnspentValue(assetAmount, prevout.scriptPubKey, undo.nHeight)));
-                            } else {
-                                continue;
-                            }
-                        }
-                        /** RVN END */
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -2242,17 +2201,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2288,6 +2236,90 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure representing a run of headers to be hashed by the header hashing threads.
+ * Runs are large enough for the multi-buffer X16R code to fill its SIMD lanes.
+ */
+class CHeaderHashCheck
+{
+private:
+    const CBlockHeader *pheaders;
+    uint256 *phashes;
+    size_t nCount;
+
+public:
+    CHeaderHashCheck(): pheaders(nullptr), phashes(nullptr), nCount(0) {}
+    CHeaderHashCheck(const CBlockHeader* pheadersIn, uint256* phashesIn, size_t nCountIn) : pheaders(pheadersIn), phashes(phashesIn), nCount(nCountIn) {}
+
+    bool operator()() {
+        GetBlockHeaderHashes(pheaders, nCount, phashes);
+        return true;
+    }
+
+    void swap(CHeaderHashCheck &check) {
+        std::swap(pheaders, check.pheaders);
+        std::swap(phashes, check.phashes);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+static const size_t HEADER_HASH_RUN_SIZE = 128;
+static CCheckQueue<CHeaderHashCheck> headerhashqueue(128);
+
+void ThreadHeaderHash() {
+    RenameThread("raven-hdrhash");
+    headerhashqueue.Thread();
+}
+
+void HashBlockHeaders(const std::vector<CBlockHeader>& headers, std::vector<uint256>& hashes)
+{
+    hashes.assign(headers.size(), uint256());
+
+    // Not worth waking the workers up for a block announcement
+    if (headers.size() <= HEADER_HASH_RUN_SIZE || nScriptCheckThreads == 0) {
+        GetBlockHeaderHashes(headers.data(), headers.size(), hashes.data());
+        return;
+    }
+
+    std::vector<CHeaderHashCheck> vChecks;
+    for (size_t i = 0; i < headers.size(); i += HEADER_HASH_RUN_SIZE)
+        vChecks.emplace_back(&headers[i], &hashes[i], std::min(HEADER_HASH_RUN_SIZE, headers.size() - i));
+
+    CCheckQueueControl<CHeaderHashCheck> control(&headerhashqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+void PrepareKAWPOWEpochContext()
+{
+    int nNextHeight;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexTip = chainActive.Tip();
+        if (!pindexTip || pindexTip->nTime < nKAWPOWActivationTime)
+            return;
+        nNextHeight = pindexTip->nHeight + 1;
+    }
+
+    // Close to the boundary get the next epoch ready, otherwise make sure the current one is loaded
+    int nEpoch = ethash::get_epoch_number(nNextHeight);
+    int nUpcomingEpoch = ethash::get_epoch_number(nNextHeight + KAWPOW_EPOCH_PREPARE_BLOCKS);
+    if (nUpcomingEpoch != nEpoch) {
+        LogPrint(BCLog::BENCH, "%s: preparing KAWPOW epoch %d at height %d\n", __func__, nUpcomingEpoch, nNextHeight - 1);
+        nEpoch = nUpcomingEpoch;
+    }
+    ethash_prepare_global_epoch_context(nEpoch);
+}
+
+void ThreadPrepareKAWPOWEpoch()
+{
+    RenameThread("raven-kawpowepoch");
+    while (true) {
+        PrepareKAWPOWEpochContext();
+        MilliSleep(KAWPOW_EPOCH_PREPARE_INTERVAL);
+    }
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2385,7 +2417,7 @@ static int64_t nBlocksTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false, bool ignoreAddressIndex = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false)
 {
 
     AssertLockHeld(cs_main);
@@ -2508,16 +2540,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     std::set<CMessage> setMessages;
     std::vector<std::pair<std::string, CNullAssetTxData>> myNullAssetData;
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
 
         nInputs += tx.vin.size();
 
@@ -2536,10 +2563,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
             /** RVN START */
             if (!AreAssetsDeployed()) {
-                for (auto out : tx.vout)
-                    if (out.scriptPubKey.IsAssetScript())
+                for (size_t n = 0; n < tx.vout.size(); n++)
+                    if (tx.GetAssetOutInfo(n))
                         return state.DoS(100, error("%s : Received Block with tx that contained an asset when assets wasn't active", __func__), REJECT_INVALID, "bad-txns-assets-not-active");
-                    else if (out.scriptPubKey.IsNullAsset())
+                    else if (tx.vout[n].scriptPubKey.IsNullAsset())
                         return state.DoS(100, error("%s : Received Block with tx that contained an null asset data tx when assets wasn't active", __func__), REJECT_INVALID, "bad-txns-null-data-assets-not-active");
             }
 
@@ -2566,72 +2593,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    uint160 hashBytes;
-                    int addressType = 0;
-                    bool isAsset = false;
-                    std::string assetName;
-                    CAmount assetAmount;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        addressType = 1;
-                    } else {
-                        /** RVN START */
-                        if (AreAssetsDeployed()) {
-                            hashBytes.SetNull();
-                            addressType = 0;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                                addressType = 1;
-                                isAsset = true;
-                            }
-                        }
-                        /** RVN END */
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        /** RVN START */
-                        if (isAsset) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, pindex->nHeight, i, txhash, j, true), assetAmount * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        /** RVN END */
-                        } else {
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        }
-                    }
-                    /** RVN END */
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2654,66 +2615,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1));
-                    addressIndex.push_back(
-                            std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false),
-                                           out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k),
-                                                                 CAddressUnspentValue(out.nValue, out.scriptPubKey,
-                                                                                      pindex->nHeight)));
-                } else {
-                    /** RVN START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // record receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, txhash, k, false),
-                                    assetAmount));
-
-                            // record unspent output
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k),
-                                                   CAddressUnspentValue(assetAmount, out.scriptPubKey,
-                                                                        pindex->nHeight)));
-                        }
-                    } else {
-                        continue;
-                    }
-                    /** RVN END */
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2781,41 +2682,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (!ignoreAddressIndex && fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (!ignoreAddressIndex && fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
-
     if (AreMessagesDeployed() && fMessaging && setMessages.size()) {
         LOCK(cs_messaging);
         for (auto message : setMessages) {
@@ -2918,7 +2784,7 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             auto currentActiveAssetCache = GetCurrentAssetCache();
             if (currentActiveAssetCache) {
                 assetDynamicSize = currentActiveAssetCache->DynamicMemoryUsage();
-                assetDirtyCacheSize = currentActiveAssetCache->GetCacheSizeV2();
+                assetDirtyCacheSize = currentActiveAssetCache->GetDirtyCacheUsage();
                 assetMapAmountSize = currentActiveAssetCache->mapAssetsAddressAmount.size();
             }
         }
@@ -3379,11 +3245,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         }
     }
 
-#ifdef ENABLE_WALLET
-    if (vpwallets.size()) {
-        CheckRewardDistributions(vpwallets[0]);
-    }
-#endif
+    //  Distributions are sent out by the scheduler thread, a new block may have confirmed their batches
+    ScheduleRewardDistributions();
     /** RVN END */
 
     return true;
@@ -3772,10 +3635,9 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex) {
     return true;
 }
 
-static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+static CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
@@ -3943,13 +3805,15 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+/** phash, if set, is block.GetHash() computed ahead of time. It stands in for the full hash of pre-KAWPOW headers,
+ *  where the two are the same, and for the mix_hash only check of KAWPOW headers below the last checkpoint */
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* phash = nullptr)
 {
     // If we are checking a KAWPOW block below a know checkpoint height. We can validate the proof of work using the mix_hash
     if (fCheckPOW && block.nTime >= nKAWPOWActivationTime) {
         CBlockIndex* pcheckpoint = Checkpoints::GetLastCheckpoint(GetParams().Checkpoints());
         if (fCheckPOW && pcheckpoint && block.nHeight <= (uint32_t)pcheckpoint->nHeight) {
-           if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams)) {
+           if (!CheckProofOfWork(phash ? *phash : block.GetHash(), block.nBits, consensusParams)) {
                return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed with mix_hash only check");
            }
 
@@ -3959,7 +3823,7 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
 
     uint256 mix_hash;
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetHashFull(mix_hash), block.nBits, consensusParams)) {
+    if (fCheckPOW && !CheckProofOfWork(phash && block.nTime < nKAWPOWActivationTime ? *phash : block.GetHashFull(mix_hash), block.nBits, consensusParams)) {
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
     }
 
@@ -3972,7 +3836,7 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fDBCheck)
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fDBCheck, const uint256* phash)
 {
     // These are checks that are independent of context.
 
@@ -3981,7 +3845,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW, phash))
         return error("%s: Consensus::CheckBlockHeader: %s", __func__, FormatStateMessage(state));
 
     // Check the merkle root.
@@ -4264,11 +4128,12 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/** phash, if set, is block.GetHash() computed ahead of time (see HashBlockHeaders) */
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* phash = nullptr)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = phash ? *phash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -4283,7 +4148,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, &hash))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -4313,7 +4178,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -4324,14 +4189,23 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 }
 
 // Exposed wrapper for AcceptBlockHeader
-bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid, const std::vector<uint256>* pvHashes)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+
+    // Hash the headers before taking cs_main
+    std::vector<uint256> vHashes;
+    if (!pvHashes || pvHashes->size() != headers.size()) {
+        HashBlockHeaders(headers, vHashes);
+        pvHashes = &vHashes;
+    }
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(header, state, chainparams, &pindex, &(*pvHashes)[i])) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -4345,7 +4219,7 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock, bool fFromLoad = false)
+static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock, bool fFromLoad = false, const uint256* phash = nullptr)
 {
     const CBlock& block = *pblock;
 
@@ -4355,7 +4229,7 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, phash))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -4393,7 +4267,9 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
 
     auto currentActiveAssetCache = GetCurrentAssetCache();
     // Dont force the CheckBlock asset duplciates when checking from this state
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), true, true) ||
+    // pindex is keyed by the block's hash, hand it over so pre-KAWPOW headers aren't hashed again
+    const uint256 hashBlock = pindex->GetBlockHash();
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), true, true, false, &hashBlock) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev, currentActiveAssetCache)) {
         if (fFromLoad && state.GetRejectReason() == "bad-txns-transfer-asset-bad-deserialize") {
             // keep going, we are only loading blocks from database
@@ -4481,7 +4357,8 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     indexDummy.nHeight = pindexPrev->nHeight + 1;
 
     /** RVN START */
-    CAssetsCache assetCache = *GetCurrentAssetCache();
+    // Empty layer on top of passets, same as ConnectTip. Only the block's own asset changes are recorded in it
+    CAssetsCache assetCache;
     /** RVN END */
 
     // NOTE: CheckBlockHeader is called by CheckBlock
@@ -4722,6 +4599,11 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), InsertBlockIndex))
         return false;
 
+    if (!pblocktree->ReadSnapshotBlock(hashSnapshotBlock, nSnapshotChainTx)) {
+        hashSnapshotBlock.SetNull();
+        nSnapshotChainTx = 0;
+    }
+
     boost::this_thread::interruption_point();
 
     // Calculate nChainWork
@@ -4740,7 +4622,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
-        if (pindex->nTx > 0) {
+        if (pindex->GetBlockHash() == hashSnapshotBlock) {
+            // The chainstate was loaded from a UTXO snapshot at this block, its ancestors don't need data
+            pindex->nChainTx = nSnapshotChainTx;
+        } else if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -4818,17 +4703,11 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("assetindex", fAssetIndex);
     LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
+    // The address, timestamp and spent indexes are built in the background in their own databases,
+    // drop the entries older versions kept here
+    if (!pblocktree->EraseLegacyIndexes())
+        return error("%s: failed to remove the legacy address, timestamp and spent indexes", __func__);
 
-    // Check whether we have a timestamp index
-    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Check whether we have a spent index
-    pblocktree->ReadFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
     return true;
 }
 
@@ -4889,8 +4768,9 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     CValidationState state;
     int reportDone = 0;
 
-    auto currentActiveAssetCache = GetCurrentAssetCache();
-    CAssetsCache assetCache(*currentActiveAssetCache);
+    // Disconnected and reconnected blocks are layered on top of passets, which is never modified here
+    CAssetsCache assetCache;
+    const CBlockIndex* pindexSnapshot = LookupSnapshotBlockIndex();
     LogPrintf("[0%%]...");
     for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
     {
@@ -4909,6 +4789,11 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
+        if (pindexSnapshot && pindex->nHeight <= pindexSnapshot->nHeight) {
+            // Blocks up to a UTXO snapshot were never connected here, so there is no undo data to check them with.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (UTXO snapshot)\n", pindex->nHeight);
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
@@ -4932,7 +4817,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache, true, false);
+            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache, false);
             if (res == DISCONNECT_FAILED) {
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
@@ -4960,7 +4845,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache, false, true))
+            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache, false))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -4997,8 +4882,7 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     LOCK(cs_main);
 
     CCoinsViewCache cache(view);
-    auto currentActiveAssetCache = GetCurrentAssetCache();
-    CAssetsCache assetsCache(*currentActiveAssetCache);
+    CAssetsCache assetsCache;
 
     std::vector<uint256> hashHeads = view->GetHeadBlocks();
     if (hashHeads.empty()) return true; // We're already in a consistent state.
@@ -5067,6 +4951,10 @@ bool RewindBlockIndex(const CChainParams& params)
     // Note that during -reindex-chainstate we are called with an empty chainActive!
 
     int nHeight = 1;
+    // Blocks up to a UTXO snapshot were never connected here, they can't be rewound and the snapshot vouches for them
+    const CBlockIndex* pindexSnapshot = LookupSnapshotBlockIndex();
+    if (pindexSnapshot && chainActive.Contains(pindexSnapshot))
+        nHeight = pindexSnapshot->nHeight + 1;
     while (nHeight <= chainActive.Height()) {
         if (IsWitnessEnabled(chainActive[nHeight - 1], params.GetConsensus()) && !(chainActive[nHeight]->nStatus & BLOCK_OPT_WITNESS)) {
             break;
@@ -5181,6 +5069,8 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    hashSnapshotBlock.SetNull();
+    nSnapshotChainTx = 0;
 }
 
 bool LoadBlockIndex(const CChainParams& chainparams)
@@ -5211,22 +5101,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         fAssetIndex = gArgs.GetBoolArg("-assetindex", DEFAULT_ASSETINDEX);
         pblocktree->WriteFlag("assetindex", fAssetIndex);
         LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
-
-        // Use the provided setting for -addressindex in the new database
-        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-        pblocktree->WriteFlag("addressindex", fAddressIndex);
-        LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-        // Use the provided setting for -timestampindex in the new database
-        fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-        LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-        // Use the provided setting for -spentindex in the new database
-        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
-        pblocktree->WriteFlag("spentindex", fSpentIndex);
-        LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
-
     }
     return true;
 }
@@ -5252,7 +5126,7 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
             return error("%s: FindBlockPos failed", __func__);
         if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
             return error("%s: writing genesis block to disk failed", __func__);
-        CBlockIndex *pindex = AddToBlockIndex(block);
+        CBlockIndex *pindex = AddToBlockIndex(block, block.GetHash());
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos, chainparams.GetConsensus()))
             return error("%s: genesis block not accepted", __func__);
     } catch (const std::runtime_error& e) {
@@ -5266,6 +5140,9 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    // Blocks are read ahead in batches so their headers can be hashed across all cores
+    static const size_t MAX_READ_AHEAD_BLOCKS = 128;
+    static const uint64_t MAX_READ_AHEAD_BYTES = 16 << 20;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -5273,104 +5150,133 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*GetMaxBlockSerializedSize(), GetMaxBlockSerializedSize()+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fEndOfData = false;
+        bool fAbort = false;
+        while (!blkdat.eof() && !fEndOfData && !fAbort) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > GetMaxBlockSerializedSize())
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
+            std::vector<std::shared_ptr<CBlock> > vBlocks;
+            std::vector<uint64_t> vBlockPos;
+            uint64_t nReadAhead = 0;
+            while (!blkdat.eof() && vBlocks.size() < MAX_READ_AHEAD_BLOCKS && nReadAhead < MAX_READ_AHEAD_BYTES) {
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > GetMaxBlockSerializedSize())
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEndOfData = true;
+                    break;
+                }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    blkdat >> *pblock;
+                    nRewind = blkdat.GetPos();
+
+                    vBlocks.push_back(pblock);
+                    vBlockPos.push_back(nBlockPos);
+                    nReadAhead += nSize;
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
+            }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr, true)) {
-                        nLoaded++;
+            std::vector<CBlockHeader> vHeaders;
+            vHeaders.reserve(vBlocks.size());
+            for (const auto& pblock : vBlocks)
+                vHeaders.push_back(pblock->GetBlockHeader());
+            std::vector<uint256> vHashes;
+            HashBlockHeaders(vHeaders, vHashes);
+
+            for (size_t i = 0; i < vBlocks.size() && !fAbort; i++) {
+                try {
+                    if (dbp)
+                        dbp->nPos = vBlockPos[i];
+                    std::shared_ptr<CBlock> pblock = vBlocks[i];
+                    CBlock& block = *pblock;
+
+                    // detect out of order blocks, and store them for later
+                    const uint256& hash = vHashes[i];
+                    if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                block.hashPrevBlock.ToString());
+                        if (dbp)
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                        continue;
                     }
-                    if (state.IsError()) {
-                        break;
+
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        LOCK(cs_main);
+                        CValidationState state;
+                        if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr, true, &hash)) {
+                            nLoaded++;
+                        }
+                        if (state.IsError()) {
+                            fAbort = true;
+                            break;
+                        }
+                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
                     }
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fAbort = true;
+                            break;
+                        }
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr, true))
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr, true))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
     } catch (const std::runtime_error& e) {
@@ -5389,6 +5295,12 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
 
     LOCK(cs_main);
 
+    // The checks below assume every block in the active chain had its data at some point, which doesn't hold
+    // below a UTXO snapshot.
+    if (!hashSnapshotBlock.IsNull()) {
+        return;
+    }
+
     // During a reindex, we read the genesis block and call CheckBlockIndex before ActivateBestChain,
     // so we have the genesis block in mapBlockIndex but no active chain.  (A few of the tests when
     // iterating the block tree require that chainActive has been initialized.)
@@ -5723,6 +5635,255 @@ bool DumpMempool(void)
     return true;
 }
 
+bool DumpUTXOSnapshot(const CChainParams& chainparams, const fs::path& path, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats, std::string& strError)
+{
+    int64_t nStart = GetTimeMillis();
+
+    std::unique_ptr<CDBIterator> pcoinscursor, passetscursor, prestrictedcursor;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS)) {
+            strError = "Unable to flush the chainstate to disk";
+            return false;
+        }
+
+        // LevelDB iterators keep seeing the databases as they are now, so the tables all match the tip
+        CBlockIndex* tip = chainActive.Tip();
+        metadata = CUTXOSnapshotMetadata(chainparams.MessageStart(), tip->GetBlockHash(), tip->nHeight, tip->nChainTx, fAssetIndex);
+        pcoinscursor.reset(pcoinsdbview->NewIterator());
+        passetscursor.reset(passetsdb->NewIterator());
+        prestrictedcursor.reset(prestricteddb->NewIterator());
+    }
+
+    fs::path pathTmp = fs::path(path.string() + ".incomplete");
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file) {
+        strError = strprintf("Unable to open %s for writing", pathTmp.string());
+        return false;
+    }
+
+    try {
+        CUTXOSnapshotWriter writer(file);
+        writer.WriteMetadata(metadata);
+        stats.nCoins = pcoinsdbview->DumpSnapshot(writer, *pcoinscursor);
+        stats.nAssetEntries = passetsdb->DumpSnapshot(writer, *passetscursor, metadata.fAssetIndex);
+        stats.nRestrictedEntries = prestricteddb->DumpSnapshot(writer, *prestrictedcursor);
+        writer.Finish();
+        writer.GetContentHashes(stats);
+    } catch (const std::exception& e) {
+        fs::remove(pathTmp);
+        strError = strprintf("Failed to write the UTXO snapshot: %s", e.what());
+        return false;
+    }
+
+    if (!RenameOver(pathTmp, path)) {
+        strError = strprintf("Unable to rename %s to %s", pathTmp.string(), path.string());
+        return false;
+    }
+
+    LogPrintf("Dumped a UTXO snapshot at height %d: %u coins, %u asset and %u restricted asset entries in %dms\n",
+        metadata.nHeight, stats.nCoins, stats.nAssetEntries, stats.nRestrictedEntries, GetTimeMillis() - nStart);
+    return true;
+}
+
+/** Read a UTXO snapshot file into the coin and asset databases, or only check it with fVerifyOnly */
+static bool ReadUTXOSnapshot(const CChainParams& chainparams, const fs::path& path, bool fVerifyOnly, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats, std::string& strError)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        strError = strprintf("Unable to open %s", path.string());
+        return false;
+    }
+
+    try {
+        CUTXOSnapshotReader reader(file, fVerifyOnly);
+        if (!reader.ReadMetadata(metadata)) {
+            strError = "The file is not a UTXO snapshot of a supported version";
+            return false;
+        }
+        if (memcmp(metadata.pchMessageStart, chainparams.MessageStart(), sizeof(metadata.pchMessageStart)) != 0) {
+            strError = "The UTXO snapshot was taken on another network";
+            return false;
+        }
+        if (fAssetIndex && !metadata.fAssetIndex) {
+            strError = "The UTXO snapshot has no asset holder tables, it can't be loaded with -assetindex";
+            return false;
+        }
+
+        if (!pcoinsdbview->LoadSnapshot(reader, metadata.hashBlock, stats.nCoins) ||
+            !passetsdb->LoadSnapshot(reader, metadata.fAssetIndex, metadata.nHeight, stats.nAssetEntries) ||
+            !prestricteddb->LoadSnapshot(reader, stats.nRestrictedEntries) ||
+            !reader.Finish()) {
+            strError = "The UTXO snapshot is damaged";
+            return false;
+        }
+        reader.GetContentHashes(stats);
+    } catch (const std::exception& e) {
+        strError = strprintf("Failed to read the UTXO snapshot: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+/** Check what a UTXO snapshot holds against the hashes pinned for its height in the chain params */
+static bool CheckUTXOSnapshotPinned(const CChainParams& chainparams, const CUTXOSnapshotMetadata& metadata, const CUTXOSnapshotStats& stats, std::string& strError)
+{
+    const MapAssumeutxo& mapAssumeutxo = chainparams.Assumeutxo();
+    MapAssumeutxo::const_iterator it = mapAssumeutxo.find(metadata.nHeight);
+    if (it == mapAssumeutxo.end()) {
+        strError = strprintf("No UTXO snapshot is pinned at height %d, only the snapshots pinned in the chain params can be loaded", metadata.nHeight);
+        return false;
+    }
+
+    const AssumeutxoData& data = it->second;
+    if (metadata.hashBlock != data.hashBlock || metadata.nChainTx != data.nChainTx ||
+        stats.hashCoins != data.hashSerialized || stats.hashAssets != data.hashAssets) {
+        strError = strprintf("The UTXO snapshot doesn't match the one pinned at height %d", metadata.nHeight);
+        return false;
+    }
+
+    // The holder tables are only loaded with -assetindex, they have to be pinned too then
+    if (fAssetIndex && (data.hashAssetHolders.IsNull() || stats.hashAssetHolders != data.hashAssetHolders)) {
+        strError = strprintf("The asset holder tables of the UTXO snapshot don't match the ones pinned at height %d, it can't be loaded with -assetindex", metadata.nHeight);
+        return false;
+    }
+    return true;
+}
+
+bool IsSnapshotChainstate()
+{
+    LOCK(cs_main);
+    return !hashSnapshotBlock.IsNull();
+}
+
+bool LoadUTXOSnapshot(const CChainParams& chainparams, const fs::path& path, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats, std::string& strError)
+{
+    int64_t nStart = GetTimeMillis();
+
+    if (fTxIndex || fAddressIndex || fSpentIndex || fTimestampIndex) {
+        strError = "The transaction, address, spent and timestamp indexes are built from every block, a UTXO snapshot can't be loaded with them enabled";
+        return false;
+    }
+
+    // Check the whole file first, so a damaged one or one that isn't pinned leaves the chainstate alone
+    if (!ReadUTXOSnapshot(chainparams, path, true, metadata, stats, strError) ||
+        !CheckUTXOSnapshotPinned(chainparams, metadata, stats, strError))
+        return false;
+
+    {
+        LOCK(cs_main);
+
+        BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBlock);
+        if (mi == mapBlockIndex.end()) {
+            strError = strprintf("The header of the snapshot block %s is not known yet, wait for the headers to sync", metadata.hashBlock.ToString());
+            return false;
+        }
+        CBlockIndex* pindex = mi->second;
+        if (pindex->nHeight != metadata.nHeight || metadata.nChainTx < (uint64_t)pindex->nHeight + 1) {
+            strError = "The UTXO snapshot's height or transaction count doesn't match its block";
+            return false;
+        }
+        if (pindex->nStatus & BLOCK_FAILED_MASK) {
+            strError = "The snapshot block is invalid";
+            return false;
+        }
+        if (chainActive.Height() >= pindex->nHeight || pindex->GetAncestor(chainActive.Height()) != chainActive.Tip()) {
+            strError = "The active chain is already at or past the snapshot block, or on another branch";
+            return false;
+        }
+
+        CValidationState state;
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS)) {
+            strError = "Unable to flush the chainstate to disk";
+            return false;
+        }
+        mempool.clear();
+
+        // Record the snapshot block first, a chainstate at it can't be linked to the block index without it
+        pblocktree->WriteSnapshotBlock(metadata.hashBlock, metadata.nChainTx);
+
+        // The file may have changed since it was checked, what was loaded has to match the pin as well
+        CUTXOSnapshotMetadata metadataLoaded;
+        if (!ReadUTXOSnapshot(chainparams, path, false, metadataLoaded, stats, strError) || metadataLoaded.hashBlock != metadata.hashBlock ||
+            !CheckUTXOSnapshotPinned(chainparams, metadataLoaded, stats, strError)) {
+            pblocktree->WriteSnapshotBlock(uint256(), 0);
+            strError += " The chainstate was partly replaced, restart with -reindex-chainstate.";
+            return AbortNode(strError);
+        }
+
+        /** RVN START */
+        // The asset caches still hold the replaced state
+        delete passets;
+        passets = new CAssetsCache();
+        passetsCache->Clear();
+        passetsVerifierCache->Clear();
+        passetsQualifierCache->Clear();
+        passetsAddressQualifiersCache->Clear();
+        passetsRestrictionCache->Clear();
+        passetsGlobalRestrictionCache->Clear();
+        mapReissuedAssets.clear();
+        if (!passetsdb->LoadAssets()) {
+            strError = "Failed to load the assets of the UTXO snapshot";
+            return AbortNode(strError);
+        }
+        /** RVN END */
+
+        // The flush above emptied the coins cache, only its best block is left to move
+        pcoinsTip->SetBestBlock(metadata.hashBlock);
+
+        hashSnapshotBlock = metadata.hashBlock;
+        nSnapshotChainTx = metadata.nChainTx;
+        pindex->nChainTx = nSnapshotChainTx;
+        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        {
+            LOCK(cs_nBlockSequenceId);
+            pindex->nSequenceId = nBlockSequenceId++;
+        }
+        setDirtyBlockIndex.insert(pindex);
+        chainActive.SetTip(pindex);
+        setBlockIndexCandidates.insert(pindex);
+
+        // Link the blocks on top of the snapshot block that arrived before it was loaded
+        std::deque<CBlockIndex*> queue;
+        queue.push_back(pindex);
+        while (!queue.empty()) {
+            CBlockIndex* pindexParent = queue.front();
+            queue.pop_front();
+            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindexParent);
+            for (std::multimap<CBlockIndex*, CBlockIndex*>::iterator it = range.first; it != range.second; ++it) {
+                CBlockIndex* pindexChild = it->second;
+                pindexChild->nChainTx = pindexParent->nChainTx + pindexChild->nTx;
+                {
+                    LOCK(cs_nBlockSequenceId);
+                    pindexChild->nSequenceId = nBlockSequenceId++;
+                }
+                if (!setBlockIndexCandidates.value_comp()(pindexChild, chainActive.Tip()))
+                    setBlockIndexCandidates.insert(pindexChild);
+                queue.push_back(pindexChild);
+            }
+            mapBlocksUnlinked.erase(range.first, range.second);
+        }
+        PruneBlockIndexCandidates();
+
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS)) {
+            strError = "Unable to flush the chainstate to disk";
+            return false;
+        }
+    }
+
+    LogPrintf("Loaded a UTXO snapshot at height %d: %u coins, %u asset and %u restricted asset entries in %dms\n",
+        metadata.nHeight, stats.nCoins, stats.nAssetEntries, stats.nRestrictedEntries, GetTimeMillis() - nStart);
+
+    // Connect the blocks on top of it that are already here
+    CValidationState state;
+    if (!ActivateBestChain(state, chainparams)) {
+        strError = FormatStateMessage(state);
+        return false;
+    }
+    return true;
+}
+
 //! Guess how far we are in the verification process at the given block index
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex *pindex) {
     if (pindex == nullptr)
@@ -5819,6 +5980,16 @@ bool AreTransferScriptsSizeDeployed() {
     return fTransferScriptIsActive;
 }
 
+bool AreTransferScriptsSizeDeployed(const CBlockIndex* pindex) {
+
+    // Separate cache from versionbitscache, which is protected by cs_main
+    static CCriticalSection cs_transferScriptsSize;
+    static VersionBitsCache transferScriptsSizeCache;
+
+    LOCK(cs_transferScriptsSize);
+    return VersionBitsState(pindex->pprev, GetParams().GetConsensus(), Consensus::DEPLOYMENT_TRANSFER_SCRIPT_SIZE, transferScriptsSizeCache) == THRESHOLD_ACTIVE;
+}
+
 bool AreRestrictedAssetsDeployed() {
 
     return IsRip5Active();
@@ -52,7 +52,10 @@ class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
 class CTxUndo;
+class CBlockUndo;
 struct ChainTxData;
+class CUTXOSnapshotMetadata;
+struct CUTXOSnapshotStats;
 
 class CAssetsDB;
 class CAssets;
@@ -96,6 +99,12 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Default for -kawpowlightcache */
+static const bool DEFAULT_KAWPOW_LIGHT_CACHE = true;
+/** Number of blocks ahead of a KAWPOW epoch boundary at which the next epoch context is built in the background */
+static const int KAWPOW_EPOCH_PREPARE_BLOCKS = 1000;
+/** Time to wait (in milliseconds) between checks for an upcoming KAWPOW epoch */
+static const int64_t KAWPOW_EPOCH_PREPARE_INTERVAL = 10 * 1000;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -283,8 +292,9 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  * @param[in]  chainparams The params for the chain we want to connect to
  * @param[out] ppindex If set, the pointer will be set to point to the last new block index object for the given headers
  * @param[out] first_invalid First header that fails validation, if one exists
+ * @param[in]  pvHashes If set, the hashes of the headers as computed by HashBlockHeaders
  */
-bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex=nullptr, CBlockHeader *first_invalid=nullptr);
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex=nullptr, CBlockHeader *first_invalid=nullptr, const std::vector<uint256>* pvHashes=nullptr);
 
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
@@ -305,6 +315,15 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header hashing thread */
+void ThreadHeaderHash();
+/** Hash a batch of headers (X16R/X16RV2, or the KAWPOW mix_hash only hash) across the header hashing threads */
+void HashBlockHeaders(const std::vector<CBlockHeader>& headers, std::vector<uint256>& hashes);
+/** Load or build the KAWPOW epoch context the next blocks will need, ahead of the epoch switch. */
+void PrepareKAWPOWEpochContext();
+/** Run PrepareKAWPOWEpochContext every KAWPOW_EPOCH_PREPARE_INTERVAL. Building a context takes seconds, so it gets
+ *  its own thread instead of holding up the scheduler */
+void ThreadPrepareKAWPOWEpoch();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 bool IsInitialSyncSpeedUp();
@@ -435,23 +454,30 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool HashOnchainActive(const uint256 &hash);
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pkeyCursor = nullptr);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t nLimit = 0, CAddressIndexKey *pkeyCursor = nullptr);
 bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
 bool GetAddressUnspent(uint160 addressHash, int type,
-                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                       size_t nLimit = 0, CAddressUnspentKey *pkeyCursor = nullptr);
+bool GetAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance);
+bool GetAddressBalances(uint160 addressHash, int type,
+                        std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the undo data written when pindex was connected */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fDBCheck = false);
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fDBCheck = false, const uint256* phash = nullptr);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
@@ -541,6 +567,9 @@ extern CLRUCache<std::string, CNullAssetTxVerifierString> *passetsVerifierCache;
 /** Global variable that points to the asset address qualifier LRU Cache (protected by cs_main) */
 extern CLRUCache<std::string, int8_t> *passetsQualifierCache; // hash(address,qualifier_name) ->int8_t
 
+/** Global variable that points to the address qualifier index LRU Cache (protected by cs_main) */
+extern CLRUCache<std::string, std::vector<std::string>> *passetsAddressQualifiersCache; // address -> sorted qualifier names held in the database
+
 /** Global variable that points to the asset address restriction LRU Cache (protected by cs_main) */
 extern CLRUCache<std::string, int8_t> *passetsRestrictionCache; // hash(address,qualifier_name) ->int8_t
 
@@ -588,6 +617,17 @@ bool DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Write the chainstate at the tip, the coins and the asset databases, to a UTXO snapshot file. */
+bool DumpUTXOSnapshot(const CChainParams& chainparams, const fs::path& path, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats, std::string& strError);
+
+/** Replace the chainstate with the one in a UTXO snapshot file and make the snapshot block the tip. The snapshot
+ *  must match the hashes pinned for its height in the chain params, its block's header must be known and the active
+ *  chain must lead up to it. The blocks up to it are left without data. */
+bool LoadUTXOSnapshot(const CChainParams& chainparams, const fs::path& path, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats, std::string& strError);
+
+/** Whether the chainstate was loaded from a UTXO snapshot, the blocks below the snapshot block may have no data */
+bool IsSnapshotChainstate();
+
 /** RVN START */
 bool AreAssetsDeployed();
 
@@ -607,6 +647,8 @@ bool IsRip5Active();
 
 
 bool AreTransferScriptsSizeDeployed();
+/** Same as above for the transactions of block pindex, whatever the tip is. Doesn't need cs_main */
+bool AreTransferScriptsSizeDeployed(const CBlockIndex* pindex);
 
 bool IsDGWActive(unsigned int nBlockNumber);
 bool IsMessagingActive(unsigned int nBlockNumber);
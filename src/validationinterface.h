@@ -7,6 +7,7 @@
 #ifndef RAVEN_VALIDATIONINTERFACE_H
 #define RAVEN_VALIDATIONINTERFACE_H
 
+#include <functional>
 #include <memory>
 
 #include "primitives/transaction.h" // CTransaction(Ref)
@@ -31,6 +32,13 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn);
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
+/** Run func on the background notification thread once the notifications queued before it are delivered */
+void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+/**
+ * Wait until every notification queued so far has been delivered. Must not be called with cs_main
+ * held, as listeners take it while handling their notifications.
+ */
+void SyncWithValidationInterfaceQueue();
 
 class CValidationInterface {
 protected:
@@ -86,6 +94,7 @@ private:
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
 
 public:
     /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
@@ -1688,7 +1688,7 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
             address = CNoDestination();
         }
 
-        if (!txout.scriptPubKey.IsAssetScript()) {
+        if (!tx->GetAssetOutInfo(i)) {
             COutputEntry output = {address, txout.nValue, (int) i};
 
             // If we are debited by the transaction, add the output as a "sent" entry
@@ -1702,10 +1702,10 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
 
         /** RVN START */
         if (AreAssetsDeployed()) {
-            if (txout.scriptPubKey.IsAssetScript()) {
+            if (tx->GetAssetOutInfo(i)) {
                 CAssetOutputEntry assetoutput;
                 assetoutput.vout = i;
-                GetAssetData(txout.scriptPubKey, assetoutput);
+                GetAssetData(*tx, i, assetoutput);
 
                 // The only asset type we send is transfer_asset. We need to skip all other types for the sent category
                 if (nDebit > 0 && assetoutput.type == TX_TRANSFER_ASSET)
@@ -2397,9 +2397,7 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
 
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
 
-                int nType;
-                bool fIsOwner;
-                bool isAssetScript = pcoin->tx->vout[i].scriptPubKey.IsAssetScript(nType, fIsOwner);
+                bool isAssetScript = pcoin->tx->GetAssetOutInfo(i) != nullptr;
                 if (coinControl && !isAssetScript && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint((*it).first, i)))
                     continue;
 
@@ -2429,7 +2427,7 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
                 if (fGetAssets && AreAssetsDeployed() && isAssetScript) {
 
                     CAssetOutputEntry output_data;
-                    if (!GetAssetData(pcoin->tx->vout[i].scriptPubKey, output_data))
+                    if (!GetAssetData(*pcoin->tx, i, output_data))
                         continue;
 
                     address = EncodeDestination(output_data.destination);
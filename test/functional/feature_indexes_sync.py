@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2021 The Raven Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Test building the address, spent and timestamp indexes in the background
+
+- enabling the indexes on a node that already has a chain builds them without a reindex
+- a block disconnected after the indexes caught up is rolled back out of them
+- a node stopped while the indexes are being built finishes them on the next start
+"""
+
+from test_framework.test_framework import RavenTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.messages import COIN
+from test_framework.util import assert_equal, connect_nodes_bi, wait_until
+
+ADDRESS = "mo9ncXisMeAoXwqcV5EWuyncbmCcQN4rVs"
+INDEX_ARGS = ["-addressindex", "-spentindex", "-timestampindex"]
+
+
+class IndexesSyncTest(RavenTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def restart_indexing_node(self, extra_args):
+        self.restart_node(1, extra_args)
+        connect_nodes_bi(self.nodes, 0, 1)
+
+    # The index reads fail until the index has caught up with the chain
+    @staticmethod
+    def try_rpc(fn):
+        try:
+            return fn()
+        except JSONRPCException:
+            return None
+
+    def wait_for_balance(self, amount):
+        n1 = self.nodes[1]
+        wait_until(lambda: self.try_rpc(lambda: n1.getaddressbalance(ADDRESS)["balance"]) == amount * COIN,
+                   err_msg="address balance of %d" % amount)
+
+    def run_test(self):
+        n0, n1 = self.nodes
+
+        self.log.info("Building a chain on a node without the indexes...")
+        n0.generate(105)
+        txid = n0.sendtoaddress(ADDRESS, 10)
+        n0.generate(1)
+        self.sync_all()
+
+        self.log.info("Enabling the indexes without a reindex...")
+        self.restart_indexing_node(INDEX_ARGS)
+        self.wait_for_balance(10)
+        assert_equal(n1.getaddresstxids(ADDRESS), [txid])
+
+        prevout = n0.decoderawtransaction(n0.gettransaction(txid)["hex"])["vin"][0]
+        wait_until(lambda: self.try_rpc(lambda: n1.getspentinfo({"txid": prevout["txid"], "index": prevout["vout"]})["txid"]) == txid,
+                   err_msg="spent index")
+
+        tip = n1.getblock(n1.getbestblockhash())
+        wait_until(lambda: tip["hash"] in (self.try_rpc(lambda: n1.getblockhashes(tip["time"] + 1, tip["time"])) or []),
+                   err_msg="timestamp index")
+
+        self.log.info("Rolling back a disconnected block...")
+        txid2 = n0.sendtoaddress(ADDRESS, 5)
+        blockhash = n0.generate(1)[0]
+        self.sync_all()
+        self.wait_for_balance(15)
+
+        n1.invalidateblock(blockhash)
+        self.wait_for_balance(10)
+        assert_equal(n1.getaddresstxids(ADDRESS), [txid])
+
+        n1.reconsiderblock(blockhash)
+        self.wait_for_balance(15)
+        assert_equal(n1.getaddresstxids(ADDRESS), [txid, txid2])
+        self.sync_all()
+
+        self.log.info("Stopping the node while the indexes are being built...")
+        self.restart_indexing_node([])
+        for _ in range(20):
+            n0.sendtoaddress(ADDRESS, 1)
+            n0.generate(10)
+        self.sync_all()
+
+        # The indexes start 200 blocks behind, stop before they can catch up and let them finish on the next start
+        self.restart_indexing_node(INDEX_ARGS)
+        self.restart_indexing_node(INDEX_ARGS)
+        self.wait_for_balance(35)
+        assert_equal(len(n1.getaddresstxids(ADDRESS)), 22)
+        self.sync_all()
+
+
+if __name__ == '__main__':
+    IndexesSyncTest().main()
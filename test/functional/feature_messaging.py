@@ -38,6 +38,11 @@ class MessagingTest(RavenTestFramework):
         channel_two = "MESSAGING~TWO"
         ipfs_hash = "QmZPGfJojdTzaqCWJu2m3krark38X1rqEHBo4SjeqHKB26"
 
+        # the startup scan for owned channels has finished
+        scan_status = n0.getchannelscanstatus()
+        assert_equal(False, scan_status['scanning'])
+        assert_equal(1, scan_status['progress'])
+
         # need ownership before channels can be created
         assert_raises_rpc_error(-32600, "Wallet doesn't have asset: " + owner_name,
             n0.issue, channel_one)
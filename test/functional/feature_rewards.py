@@ -7,7 +7,7 @@
 """Testing rewards use cases"""
 
 from test_framework.test_framework import RavenTestFramework
-from test_framework.util import assert_equal, assert_raises_rpc_error, assert_contains, Decimal
+from test_framework.util import assert_equal, assert_raises_rpc_error, assert_contains, wait_until, Decimal
 
 # noinspection PyAttributeOutsideInit
 class RewardsTest(RavenTestFramework):
@@ -17,6 +17,14 @@ class RewardsTest(RavenTestFramework):
         self.extra_args = [["-assetindex", "-debug=rewards"], ["-assetindex", "-minrewardheight=15"], ["-assetindex"],
                            ["-assetindex"]]
 
+    # Distributions are sent out by a background thread, wait for it to put every batch of the distribution in the
+    # mempool (or to give up on it) before mining them
+    def wait_for_distribution(self, node, asset_name, snapshot_height, distribution_asset_name, amount, exception_addresses):
+        def batches_sent():
+            status = node.getdistributestatus(asset_name, snapshot_height, distribution_asset_name, amount, exception_addresses)
+            return status['Status'] != 1 or (status['Batches'] > 0 and status['Batches Sent'] == status['Batches'])
+        wait_until(batches_sent, err_msg="distribution of %s" % asset_name)
+
     def activate_assets(self):
         self.log.info("Generating RVN for node[0] and activating assets...")
         n0, n1, n2 = self.nodes[0], self.nodes[1], self.nodes[2]
@@ -181,6 +189,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK1", snapshot_height=tgt_block_height, distribution_asset_name="RVN",
                             gross_distribution_amount=2000, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK1", tgt_block_height, "RVN", 2000, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -328,6 +337,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK2", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT1",
                             gross_distribution_amount=2000, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK2", tgt_block_height, "PAYOUT1", 2000, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -495,6 +505,7 @@ class RewardsTest(RavenTestFramework):
 
         self.log.info("Initiating reward payout should succeed because -minrewardheight=15 on node1")
         n1.distributereward("STOCK7", tgt_block_height, "RVN", 2000, owner_addr0)
+        self.wait_for_distribution(n1, "STOCK7", tgt_block_height, "RVN", 2000, owner_addr0)
 
         n1.generate(2)
         self.sync_all()
@@ -552,6 +563,7 @@ class RewardsTest(RavenTestFramework):
 
         self.log.info("Initiating reward payout")
         n1.distributereward("STOCK_7.1", tgt_block_height, "LOW_ASSET_AMOUNT", 2000, owner_addr0)
+        self.wait_for_distribution(n1, "STOCK_7.1", tgt_block_height, "LOW_ASSET_AMOUNT", 2000, owner_addr0)
 
         n1.generate(2)
         self.sync_all()
@@ -706,6 +718,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK8", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT8",
                             gross_distribution_amount=10, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK8", tgt_block_height, "PAYOUT8", 10, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -809,6 +822,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK9", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT9",
                             gross_distribution_amount=10, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK9", tgt_block_height, "PAYOUT9", 10, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -913,6 +927,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK10", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT10",
                             gross_distribution_amount=10, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK10", tgt_block_height, "PAYOUT10", 10, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -1024,6 +1039,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK11", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT11",
                             gross_distribution_amount=10, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK11", tgt_block_height, "PAYOUT11", 10, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -1131,6 +1147,7 @@ class RewardsTest(RavenTestFramework):
         self.log.info("Initiating reward payout")
         n0.distributereward(asset_name="STOCK12", snapshot_height=tgt_block_height, distribution_asset_name="PAYOUT12",
                             gross_distribution_amount=10, exception_addresses=dist_addr0)
+        self.wait_for_distribution(n0, "STOCK12", tgt_block_height, "PAYOUT12", 10, dist_addr0)
         n0.generate(10)
         self.sync_all()
 
@@ -1236,6 +1253,7 @@ class RewardsTest(RavenTestFramework):
         n0.distributereward(asset_name="BULK1", snapshot_height=tgt_block_height,
                             distribution_asset_name="TTTTTTTTTTTTTTTTTTTTTTTTTTTTT1", gross_distribution_amount=100000,
                             exception_addresses=dist_addr0, change_address="", dry_run=False)
+        self.wait_for_distribution(n0, "BULK1", tgt_block_height, "TTTTTTTTTTTTTTTTTTTTTTTTTTTTT1", 100000, dist_addr0)
         # print(result)
         n0.generate(10)
         self.sync_all()
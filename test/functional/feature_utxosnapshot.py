@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2021 The Raven Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""
+Test dumptxoutset and loadtxoutset.
+
+node0 builds a chain with an asset and dumps a UTXO snapshot. node1 only loads
+a snapshot pinned with -assumeutxo. It runs with a -minimumchainwork above the
+chain's work, so it syncs the headers but downloads no blocks, and loads the
+snapshot. Once node0 has mined past that work, node1 connects the blocks on top
+of the snapshot without a restart.
+"""
+
+import shutil
+
+from test_framework.test_framework import RavenTestFramework
+from test_framework.messages import NODE_NETWORK
+from test_framework.util import assert_equal, assert_raises_rpc_error, connect_nodes, wait_until
+
+
+class UTXOSnapshotTest(RavenTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [['-assetindex'], ['-assetindex']]
+
+    def setup_network(self):
+        # node1 is connected once it only syncs the headers
+        self.setup_nodes()
+
+    def run_test(self):
+        n0 = self.nodes[0]
+
+        self.log.info("Building a chain with an asset on node0...")
+        n0.generate(432)
+        address = n0.getnewaddress()
+        n0.issue(asset_name="SNAPSHOT_ASSET", qty=1000, to_address=address)
+        n0.generate(1)
+
+        self.log.info("Dumping the UTXO snapshot...")
+        snapshot = n0.dumptxoutset("utxo.dat")
+        assert_equal(snapshot["base_hash"], n0.getbestblockhash())
+        assert_equal(snapshot["base_height"], 433)
+        assert_equal(snapshot["assetindex"], True)
+        assert_equal(snapshot["coins"], n0.gettxoutsetinfo()["txouts"])
+        assert_equal(snapshot["coins_hash"], n0.gettxoutsetinfo()["hash_serialized_2"])
+        assert snapshot["asset_entries"] > 0
+        assert_raises_rpc_error(-8, "already exists", n0.dumptxoutset, "utxo.dat")
+        utxo_info = n0.gettxoutsetinfo()
+
+        pin = "%d:%s:%d:%s:%s:%s" % (snapshot["base_height"], snapshot["base_hash"], snapshot["nchaintx"],
+                                     snapshot["coins_hash"], snapshot["assets_hash"], snapshot["asset_holders_hash"])
+        wrong_pin = "%d:%s:%d:%s:%s:%s" % (snapshot["base_height"], snapshot["base_hash"], snapshot["nchaintx"],
+                                           snapshot["coins_hash"], snapshot["asset_holders_hash"], snapshot["asset_holders_hash"])
+
+        n0.generate(5)
+        tip = n0.getbestblockhash()
+        chainwork = int(n0.getblockheader(tip)["chainwork"], 16)
+
+        self.log.info("Checking that snapshots that don't fit are refused...")
+        n1 = self.nodes[1]
+        damaged = snapshot["path"] + ".damaged"
+        shutil.copyfile(snapshot["path"], damaged)
+        with open(damaged, "r+b") as f:
+            f.seek(-1, 2)
+            last = f.read(1)
+            f.seek(-1, 2)
+            f.write(bytes([last[0] ^ 0xff]))
+        assert_raises_rpc_error(-1, "damaged", n1.loadtxoutset, damaged)
+        assert_raises_rpc_error(-1, "No UTXO snapshot is pinned at height 433", n1.loadtxoutset, snapshot["path"])
+        self.restart_node(1, ['-assetindex', '-assumeutxo=' + wrong_pin])
+        n1 = self.nodes[1]
+        assert_raises_rpc_error(-1, "doesn't match the one pinned", n1.loadtxoutset, snapshot["path"])
+        assert_equal(n1.getblockcount(), 0)
+
+        self.restart_node(1, ['-assetindex', '-minimumchainwork=%x' % (chainwork + 1), '-assumeutxo=' + pin])
+        n1 = self.nodes[1]
+        connect_nodes(n1, 0)
+        wait_until(lambda: any(t["hash"] == tip for t in n1.getchaintips()), err_msg="node1 syncs the headers")
+        assert_equal(n1.getblockcount(), 0)
+
+        self.log.info("Loading the UTXO snapshot into node1...")
+        loaded = n1.loadtxoutset(snapshot["path"])
+        assert_equal(loaded["base_hash"], snapshot["base_hash"])
+        assert_equal(loaded["coins"], snapshot["coins"])
+        assert_equal(loaded["asset_entries"], snapshot["asset_entries"])
+        assert_equal(loaded["asset_holders_hash"], snapshot["asset_holders_hash"])
+        assert_equal(n1.getbestblockhash(), snapshot["base_hash"])
+        assert_equal(n1.gettxoutsetinfo()["hash_serialized_2"], utxo_info["hash_serialized_2"])
+        assert_equal(n1.getassetdata("SNAPSHOT_ASSET")["amount"], 1000)
+        assert_equal(n1.listaddressesbyasset("SNAPSHOT_ASSET"), {address: 1000})
+        assert_equal(int(n1.getnetworkinfo()["localservices"], 16) & NODE_NETWORK, 0)
+        assert_raises_rpc_error(-1, "already at or past", n1.loadtxoutset, snapshot["path"])
+
+        self.log.info("Syncing the blocks on top of the snapshot without a restart...")
+        n0.generate(10)
+        self.sync_blocks()
+        assert_equal(n1.getbestblockhash(), n0.getbestblockhash())
+        assert_equal(n1.gettxoutsetinfo()["hash_serialized_2"], n0.gettxoutsetinfo()["hash_serialized_2"])
+
+        self.log.info("Restarting node1 keeps the snapshot chainstate...")
+        self.restart_node(1, ['-assetindex'])
+        n1 = self.nodes[1]
+        assert_equal(n1.getbestblockhash(), n0.getbestblockhash())
+        assert_equal(int(n1.getnetworkinfo()["localservices"], 16) & NODE_NETWORK, 0)
+        assert_equal(n1.listaddressesbyasset("SNAPSHOT_ASSET"), {address: 1000})
+
+        self.log.info("Checking that the block indexes can't be built on the snapshot chainstate...")
+        self.stop_node(1)
+        for index in ['-addressindex', '-spentindex', '-timestampindex']:
+            self.assert_start_raises_init_error(1, ['-assetindex', index], "The chainstate was loaded from a UTXO snapshot")
+        self.start_node(1, ['-assetindex'])
+        assert_equal(self.nodes[1].getbestblockhash(), n0.getbestblockhash())
+
+
+if __name__ == '__main__':
+    UTXOSnapshotTest().main()
@@ -106,6 +106,22 @@ class AddressIndexTest(RavenTestFramework):
         assert_equal(multi_tx_ids[4], tx_id2)
         assert_equal(multi_tx_ids[5], tx_idb2)
 
+        # Check that paging returns every txid once, address after address
+        self.log.info("Testing paged txids...")
+        paged_txids = []
+        cursor = None
+        while True:
+            params = {"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br", "mo9ncXisMeAoXwqcV5EWuyncbmCcQN4rVs"], "limit": 2}
+            if cursor is not None:
+                params["cursor"] = cursor
+            page = self.nodes[1].getaddresstxids(params)
+            assert(len(page["txids"]) <= 2)
+            paged_txids += page["txids"]
+            if "cursor" not in page:
+                break
+            cursor = page["cursor"]
+        assert_equal(paged_txids, [tx_idb0, tx_idb1, tx_idb2, tx_id0, tx_id1, tx_id2])
+
         # Check that balances are correct
         balance0 = self.nodes[1].getaddressbalance("2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br")
         assert_equal(balance0["balance"], 45 * 100000000)
@@ -154,6 +170,8 @@ class AddressIndexTest(RavenTestFramework):
         self.sync_all()
         balance1 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance1["balance"], amount)
+        assert_equal(balance1["received"], amount)
+        assert_equal(balance1["txcount"], 1)
 
         tx = CTransaction()
         tx.vin = [CTxIn(COutPoint(int(spending_txid, 16), 0))]
@@ -169,6 +187,8 @@ class AddressIndexTest(RavenTestFramework):
 
         balance2 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance2["balance"], change_amount)
+        assert_equal(balance2["received"], amount + change_amount)
+        assert_equal(balance2["txcount"], 2)
 
         # Check that deltas are returned correctly
         deltas = self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 1, "end": 200})
@@ -90,6 +90,7 @@ BASE_SCRIPTS= [
     'feature_assets_mempool.py',
     'feature_restricted_assets.py',
     'feature_raw_restricted_assets.py',
+    'feature_utxosnapshot.py',
     'wallet_bip44.py',    
     'wallet_bip44_multilanguage.py',
     'mining_prioritisetransaction.py',
@@ -100,6 +101,7 @@ BASE_SCRIPTS= [
     # vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv Tests less than 15s vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
     'rpc_rawtransaction.py',
     'rpc_addressindex.py',
+    'feature_indexes_sync.py',
     'wallet_dump.py',
     'mempool_persist.py',
     'rpc_timestampindex.py',